@@ -0,0 +1,190 @@
+#include "AllocTracker.h"
+
+#ifdef ENABLE_ALLOC_TRACKER
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#endif
+
+namespace alloctracker {
+
+namespace {
+#ifdef ARDUINO
+// Allocations are reported from the main loop and from render tasks
+portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+#define TRACKER_LOCK() portENTER_CRITICAL(&statsMux)
+#define TRACKER_UNLOCK() portEXIT_CRITICAL(&statsMux)
+#else
+#define TRACKER_LOCK()
+#define TRACKER_UNLOCK()
+#endif
+
+constexpr const char* TAG_NAMES[TAG_COUNT] = {"EHP", "CSS", "IMG", "FDC", "ZIP", "GFX"};
+
+AllocStats tags[TAG_COUNT] = {};
+ActivityStats activities[MAX_ACTIVITIES] = {};
+size_t activityCount = 0;
+
+// Indices into `activities`, innermost last
+size_t activityStack[MAX_ACTIVITY_DEPTH] = {};
+size_t activityDepth = 0;
+
+void accumulate(AllocStats& stats, const size_t bytes, const bool succeeded) {
+  stats.allocCount++;
+  stats.allocBytes += bytes;
+  if (bytes > stats.largestRequest) {
+    stats.largestRequest = bytes;
+  }
+  if (!succeeded) {
+    stats.failures++;
+  }
+}
+
+ActivityStats* currentActivity() {
+  return activityDepth > 0 ? &activities[activityStack[activityDepth - 1]] : nullptr;
+}
+
+void sampleLocked(const HeapSnapshot& heap) {
+  ActivityStats* activity = currentActivity();
+  if (!activity) {
+    return;
+  }
+  if (heap.freeBytes < activity->minFreeBytes) {
+    activity->minFreeBytes = heap.freeBytes;
+  }
+  if (heap.largestFreeBlock < activity->minLargestFreeBlock) {
+    activity->minLargestFreeBlock = heap.largestFreeBlock;
+  }
+}
+
+size_t findOrAddActivity(const char* name) {
+  for (size_t i = 0; i < activityCount; i++) {
+    if (strncmp(activities[i].name, name, ActivityStats::NAME_SIZE - 1) == 0) {
+      return i;
+    }
+  }
+  // Table full: fold everything else into the last slot
+  const size_t index = activityCount < MAX_ACTIVITIES ? activityCount++ : MAX_ACTIVITIES - 1;
+  ActivityStats& activity = activities[index];
+  memset(&activity, 0, sizeof(activity));
+  strncpy(activity.name, name, ActivityStats::NAME_SIZE - 1);
+  activity.minFreeBytes = UINT32_MAX;
+  activity.minLargestFreeBlock = UINT32_MAX;
+  return index;
+}
+}  // namespace
+
+const char* tagName(const Tag tag) { return tag < TAG_COUNT ? TAG_NAMES[tag] : "?"; }
+
+HeapSnapshot heapSnapshot() {
+#ifdef ARDUINO
+  return {static_cast<uint32_t>(heap_caps_get_free_size(MALLOC_CAP_8BIT)),
+          static_cast<uint32_t>(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT)),
+          static_cast<uint32_t>(heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT))};
+#else
+  // Host builds have no meaningful heap figures; keep reports deterministic
+  return {0, 0, 0};
+#endif
+}
+
+void onAlloc(const Tag tag, const size_t bytes, const bool succeeded) {
+  if (tag >= TAG_COUNT) {
+    return;
+  }
+  const HeapSnapshot heap = heapSnapshot();
+  TRACKER_LOCK();
+  accumulate(tags[tag], bytes, succeeded);
+  if (ActivityStats* activity = currentActivity()) {
+    accumulate(activity->allocs, bytes, succeeded);
+  }
+  sampleLocked(heap);
+  TRACKER_UNLOCK();
+}
+
+void enterActivity(const char* name) {
+  const HeapSnapshot heap = heapSnapshot();
+  TRACKER_LOCK();
+  const size_t index = findOrAddActivity(name);
+  activities[index].visits++;
+  if (activityDepth < MAX_ACTIVITY_DEPTH) {
+    activityStack[activityDepth++] = index;
+  }
+  sampleLocked(heap);
+  TRACKER_UNLOCK();
+}
+
+void exitActivity(const char* name) {
+  const HeapSnapshot heap = heapSnapshot();
+  TRACKER_LOCK();
+  sampleLocked(heap);
+  // Pop back to (and including) the named activity; tolerates unbalanced exits
+  for (size_t depth = activityDepth; depth > 0; depth--) {
+    if (strncmp(activities[activityStack[depth - 1]].name, name, ActivityStats::NAME_SIZE - 1) == 0) {
+      activityDepth = depth - 1;
+      break;
+    }
+  }
+  TRACKER_UNLOCK();
+}
+
+void sample() {
+  const HeapSnapshot heap = heapSnapshot();
+  TRACKER_LOCK();
+  sampleLocked(heap);
+  TRACKER_UNLOCK();
+}
+
+const AllocStats& tagStats(const Tag tag) { return tags[tag < TAG_COUNT ? tag : 0]; }
+
+size_t activityStats(const ActivityStats** out) {
+  *out = activities;
+  return activityCount;
+}
+
+void reset() {
+  TRACKER_LOCK();
+  memset(tags, 0, sizeof(tags));
+  memset(activities, 0, sizeof(activities));
+  activityCount = 0;
+  activityDepth = 0;
+  TRACKER_UNLOCK();
+}
+
+void dump(const LineWriter writeLine) {
+  char line[160];
+  const HeapSnapshot heap = heapSnapshot();
+
+  writeLine("ALLOC_START");
+  snprintf(line, sizeof(line), "ALLOC_HEAP:%lu,%lu,%lu", static_cast<unsigned long>(heap.freeBytes),
+           static_cast<unsigned long>(heap.largestFreeBlock), static_cast<unsigned long>(heap.minFreeBytes));
+  writeLine(line);
+
+  for (uint8_t t = 0; t < TAG_COUNT; t++) {
+    const AllocStats& s = tags[t];
+    snprintf(line, sizeof(line), "ALLOC_TAG:%s,%lu,%lu,%lu,%lu", TAG_NAMES[t], static_cast<unsigned long>(s.allocCount),
+             static_cast<unsigned long>(s.allocBytes), static_cast<unsigned long>(s.largestRequest),
+             static_cast<unsigned long>(s.failures));
+    writeLine(line);
+  }
+
+  for (size_t i = 0; i < activityCount; i++) {
+    const ActivityStats& a = activities[i];
+    // Activities that never sampled the heap (host builds) report 0
+    const unsigned long minFree = a.minFreeBytes == UINT32_MAX ? 0 : a.minFreeBytes;
+    const unsigned long minLargest = a.minLargestFreeBlock == UINT32_MAX ? 0 : a.minLargestFreeBlock;
+    snprintf(line, sizeof(line), "ALLOC_ACTIVITY:%.23s,%u,%lu,%lu,%lu,%lu,%lu,%lu", a.name, a.visits, minFree,
+             minLargest, static_cast<unsigned long>(a.allocs.allocCount),
+             static_cast<unsigned long>(a.allocs.allocBytes), static_cast<unsigned long>(a.allocs.largestRequest),
+             static_cast<unsigned long>(a.allocs.failures));
+    writeLine(line);
+  }
+  writeLine("ALLOC_END");
+}
+
+}  // namespace alloctracker
+
+#endif  // ENABLE_ALLOC_TRACKER
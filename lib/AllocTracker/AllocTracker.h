@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+Define ENABLE_ALLOC_TRACKER to compile in the allocation tracker (see the `profile` env in platformio.ini).
+When it is not defined, every ALLOC_TRACK* macro below expands to nothing.
+
+The tracker records, per subsystem tag, how many allocations were requested, how many bytes, the largest single
+request and how many failed (or were refused because the heap was too low). The same numbers are aggregated per
+Activity together with the lowest free heap and the smallest largest-free-block seen while that Activity was on top,
+which is what actually predicts failures like GfxRenderer::storeBwBuffer's 8KB chunks.
+
+Only allocations are counted, not frees, so the numbers are cumulative. The per-tag/per-activity counts do not depend
+on heap state, so a host build (no ARDUINO) produces identical reports run to run; heap fields read as 0 there.
+
+Dump format (CMD:ALLOC):
+    ALLOC_START
+    ALLOC_HEAP:<free>,<largest free block>,<min free ever>
+    ALLOC_TAG:<tag>,<allocs>,<bytes>,<largest request>,<failures>
+    ALLOC_ACTIVITY:<name>,<visits>,<min free>,<min largest block>,<allocs>,<bytes>,<largest request>,<failures>
+    ALLOC_END
+*/
+
+namespace alloctracker {
+
+enum Tag : uint8_t {
+  EHP = 0,  // ChapterHtmlSlimParser (expat)
+  CSS,      // CssParser rules
+  IMG,      // image decoders and pixel caches
+  FDC,      // FontDecompressor glyph groups
+  ZIP,      // ZipFile inflate buffers
+  GFX,      // GfxRenderer BW buffer chunks
+  TAG_COUNT
+};
+
+struct AllocStats {
+  uint32_t allocCount;
+  uint32_t allocBytes;
+  uint32_t largestRequest;
+  uint32_t failures;
+};
+
+struct HeapSnapshot {
+  uint32_t freeBytes;
+  uint32_t largestFreeBlock;
+  uint32_t minFreeBytes;
+};
+
+struct ActivityStats {
+  static constexpr size_t NAME_SIZE = 24;
+  char name[NAME_SIZE];
+  uint16_t visits;
+  uint32_t minFreeBytes;
+  uint32_t minLargestFreeBlock;
+  AllocStats allocs;
+};
+
+constexpr size_t MAX_ACTIVITIES = 24;
+constexpr size_t MAX_ACTIVITY_DEPTH = 4;
+
+const char* tagName(Tag tag);
+
+void onAlloc(Tag tag, size_t bytes, bool succeeded);
+// Activity lifecycle; nested sub-activities are tracked as a stack.
+void enterActivity(const char* name);
+void exitActivity(const char* name);
+// Refresh the heap minima of the current activity.
+void sample();
+
+HeapSnapshot heapSnapshot();
+const AllocStats& tagStats(Tag tag);
+// Returns the number of distinct activities seen and points `out` at the table.
+size_t activityStats(const ActivityStats** out);
+void reset();
+
+using LineWriter = void (*)(const char* line);
+// Emits the report in the format described above, one line per call.
+void dump(LineWriter writeLine);
+
+}  // namespace alloctracker
+
+#ifdef ENABLE_ALLOC_TRACKER
+#define ALLOC_TRACK(tag, bytes, succeeded) alloctracker::onAlloc(tag, bytes, succeeded)
+#define ALLOC_TRACK_ACTIVITY_ENTER(name) alloctracker::enterActivity(name)
+#define ALLOC_TRACK_ACTIVITY_EXIT(name) alloctracker::exitActivity(name)
+#define ALLOC_TRACK_SAMPLE() alloctracker::sample()
+#else
+#define ALLOC_TRACK(tag, bytes, succeeded)
+#define ALLOC_TRACK_ACTIVITY_ENTER(name)
+#define ALLOC_TRACK_ACTIVITY_EXIT(name)
+#define ALLOC_TRACK_SAMPLE()
+#endif
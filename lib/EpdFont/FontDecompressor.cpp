@@ -1,5 +1,6 @@
 #include "FontDecompressor.h"
 
+#include <AllocTracker.h>
 #include <Logging.h>
 #include <uzlib.h>
 
@@ -77,6 +78,7 @@ bool FontDecompressor::decompressGroup(const EpdFontData* fontData, uint16_t gro
 
   // Allocate output buffer
   auto* outBuf = static_cast<uint8_t*>(malloc(group.uncompressedSize));
+  ALLOC_TRACK(alloctracker::FDC, group.uncompressedSize, outBuf != nullptr);
   if (!outBuf) {
     LOG_ERR("FDC", "Failed to allocate %u bytes for group %u", group.uncompressedSize, groupIndex);
     return false;
@@ -7,6 +7,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "Epub/BookCacheKeys.h"
 #include "Epub/BookMetadataCache.h"
 #include "Epub/css/CssParser.h"
 
@@ -38,8 +39,8 @@ class Epub {
 
  public:
   explicit Epub(std::string filepath, const std::string& cacheDir) : filepath(std::move(filepath)) {
-    // create a cache key based on the filepath
-    cachePath = cacheDir + "/epub_" + std::to_string(std::hash<std::string>{}(this->filepath));
+    // Cache key based on the file's content, so the cache follows the book when it is moved
+    cachePath = BookCacheKeys::cacheDirFor(this->filepath, cacheDir, "epub_");
   }
   ~Epub() = default;
   std::string& getBasePath() { return contentBasePath; }
@@ -51,6 +52,7 @@ class Epub {
   const std::string& getTitle() const;
   const std::string& getAuthor() const;
   const std::string& getLanguage() const;
+  const std::string& getSeries() const;
   std::string getCoverBmpPath(bool cropped = false) const;
   bool generateCoverBmp(bool cropped = false) const;
   std::string getThumbBmpPath() const;
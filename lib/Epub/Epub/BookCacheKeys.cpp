@@ -0,0 +1,244 @@
+#include "BookCacheKeys.h"
+
+#include <BufferedFile.h>
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <unordered_map>
+
+namespace {
+constexpr uint8_t BOOK_KEYS_FILE_VERSION = 1;
+// Paths remembered; the least recently looked up one is dropped past this
+constexpr size_t MAX_BOOK_KEYS = 256;
+constexpr uint32_t SAMPLE_SIZE = 1024;
+// Samples are hashed in pieces to keep the buffer small on the render task's stack
+constexpr uint32_t SAMPLE_CHUNK = 256;
+constexpr int SAMPLE_COUNT = 12;  // Same offsets as KOReaderDocumentId: 0, then 1024 << 2i
+constexpr uint32_t ZIP_EOCD_SIGNATURE = 0x06054b50;
+constexpr uint32_t ZIP_CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+constexpr uint32_t ZIP_EOCD_SIZE = 22;
+constexpr uint32_t ZIP_CENTRAL_HEADER_SIZE = 46;
+constexpr uint32_t EOCD_SEARCH_SIZE = 512;  // Room for a short archive comment
+
+struct KeyEntry {
+  uint64_t key;
+  uint32_t fileSize;
+  uint32_t modified;  // FAT date << 16 | time
+  uint32_t lastUsed;
+};
+
+// Loaded lazily from the first cacheDir asked for (always /.crosspoint on the device)
+std::unordered_map<std::string, KeyEntry> keys;
+std::string loadedFrom;
+uint32_t useClock = 0;
+
+uint64_t fnv1a64(uint64_t hash, const void* data, const size_t size) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+uint32_t readLe32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24; }
+
+uint16_t readLe16(const uint8_t* p) { return p[0] | p[1] << 8; }
+
+std::string keysFilePath(const std::string& cacheDir) { return cacheDir + "/book_keys.bin"; }
+
+void loadKeys(const std::string& cacheDir) {
+  if (loadedFrom == cacheDir) {
+    return;
+  }
+  loadedFrom = cacheDir;
+  keys.clear();
+  useClock = 0;
+
+  FsFile file;
+  if (!Storage.openFileForRead("BCK", keysFilePath(cacheDir), file)) {
+    return;
+  }
+  uint8_t version = 0;
+  uint16_t count = 0;
+  serialization::readPod(file, version);
+  if (version != BOOK_KEYS_FILE_VERSION) {
+    LOG_ERR("BCK", "Deserialization failed: Unknown version %u", version);
+    file.close();
+    return;
+  }
+  serialization::readPod(file, count);
+  for (uint16_t i = 0; i < count && i < MAX_BOOK_KEYS; i++) {
+    std::string path;
+    KeyEntry entry{};
+    serialization::readString(file, path);
+    serialization::readPod(file, entry.key);
+    serialization::readPod(file, entry.fileSize);
+    serialization::readPod(file, entry.modified);
+    serialization::readPod(file, entry.lastUsed);
+    useClock = std::max(useClock, entry.lastUsed);
+    keys[path] = entry;
+  }
+  file.close();
+}
+
+void saveKeys(const std::string& cacheDir) {
+  Storage.mkdir(cacheDir.c_str());
+  FsFile file;
+  if (!Storage.openFileForWrite("BCK", keysFilePath(cacheDir), file)) {
+    return;
+  }
+  serialization::writePod(file, BOOK_KEYS_FILE_VERSION);
+  serialization::writePod(file, static_cast<uint16_t>(keys.size()));
+  for (const auto& [path, entry] : keys) {
+    serialization::writeString(file, path);
+    serialization::writePod(file, entry.key);
+    serialization::writePod(file, entry.fileSize);
+    serialization::writePod(file, entry.modified);
+    serialization::writePod(file, entry.lastUsed);
+  }
+  file.close();
+}
+
+// Hash every central directory entry's CRC-32 and uncompressed size. False if the file has no readable ZIP directory.
+bool hashCentralDirectory(BufferedFile& file, const uint32_t fileSize, uint64_t& hash) {
+  if (fileSize < ZIP_EOCD_SIZE) {
+    return false;
+  }
+  const uint32_t tailSize = std::min(fileSize, EOCD_SEARCH_SIZE);
+  uint8_t tail[EOCD_SEARCH_SIZE];
+  file.seek(fileSize - tailSize);
+  if (file.read(tail, tailSize) != static_cast<int>(tailSize)) {
+    return false;
+  }
+  int eocd = -1;
+  for (int i = static_cast<int>(tailSize - ZIP_EOCD_SIZE); i >= 0; i--) {
+    if (readLe32(tail + i) == ZIP_EOCD_SIGNATURE) {
+      eocd = i;
+      break;
+    }
+  }
+  if (eocd < 0) {
+    return false;
+  }
+
+  const uint16_t entries = readLe16(tail + eocd + 10);
+  uint32_t pos = readLe32(tail + eocd + 16);
+  for (uint16_t i = 0; i < entries; i++) {
+    uint8_t header[ZIP_CENTRAL_HEADER_SIZE];
+    file.seek(pos);
+    if (file.read(header, sizeof(header)) != sizeof(header) || readLe32(header) != ZIP_CENTRAL_HEADER_SIGNATURE) {
+      return false;
+    }
+    hash = fnv1a64(hash, header + 16, 4);  // CRC-32
+    hash = fnv1a64(hash, header + 24, 4);  // Uncompressed size
+    pos += ZIP_CENTRAL_HEADER_SIZE + readLe16(header + 28) + readLe16(header + 30) + readLe16(header + 32);
+  }
+  return true;
+}
+
+uint64_t fingerprint(BufferedFile& file, const uint32_t fileSize) {
+  uint64_t hash = 14695981039346656037ull;
+  hash = fnv1a64(hash, &fileSize, sizeof(fileSize));
+  if (!hashCentralDirectory(file, fileSize, hash)) {
+    LOG_DBG("BCK", "No ZIP directory, fingerprinting samples only");
+  }
+
+  uint8_t chunk[SAMPLE_CHUNK];
+  for (int i = -1; i < SAMPLE_COUNT - 1; i++) {
+    const uint32_t offset = i < 0 ? 0 : SAMPLE_SIZE << (2 * i);
+    if (offset >= fileSize) {
+      break;
+    }
+    file.seek(offset);
+    for (uint32_t remaining = std::min(SAMPLE_SIZE, fileSize - offset); remaining > 0;) {
+      const int n = file.read(chunk, std::min(SAMPLE_CHUNK, remaining));
+      if (n <= 0) {
+        break;
+      }
+      hash = fnv1a64(hash, chunk, n);
+      remaining -= n;
+    }
+  }
+  return hash;
+}
+
+std::string pathHashDir(const std::string& filePath, const std::string& cacheDir, const char* prefix) {
+  return cacheDir + "/" + prefix + std::to_string(std::hash<std::string>{}(filePath));
+}
+}  // namespace
+
+std::string BookCacheKeys::cacheDirFor(const std::string& filePath, const std::string& cacheDir, const char* prefix) {
+  const std::string legacyDir = pathHashDir(filePath, cacheDir, prefix);
+  FsFile stat = Storage.open(filePath.c_str());
+  if (!stat) {
+    return legacyDir;
+  }
+  const auto fileSize = static_cast<uint32_t>(stat.size());
+  uint16_t date = 0;
+  uint16_t time = 0;
+  stat.getModifyDateTime(&date, &time);
+  stat.close();
+  const uint32_t modified = static_cast<uint32_t>(date) << 16 | time;
+
+  loadKeys(cacheDir);
+  auto it = keys.find(filePath);
+  if (it == keys.end() || it->second.fileSize != fileSize || it->second.modified != modified) {
+    BufferedFile file;
+    if (!file.openForRead("BCK", filePath)) {
+      return legacyDir;
+    }
+    const uint32_t start = millis();
+    const uint64_t key = fingerprint(file, fileSize);
+    file.close();
+    LOG_DBG("BCK", "Fingerprinted %s in %lu ms", filePath.c_str(), millis() - start);
+
+    if (keys.size() >= MAX_BOOK_KEYS && it == keys.end()) {
+      keys.erase(std::min_element(keys.begin(), keys.end(), [](const auto& a, const auto& b) {
+        return a.second.lastUsed < b.second.lastUsed;
+      }));
+    }
+    it = keys.insert_or_assign(filePath, KeyEntry{key, fileSize, modified, ++useClock}).first;
+    saveKeys(cacheDir);
+  } else {
+    // Recency only matters for eviction from the map; not worth a write on every lookup
+    it->second.lastUsed = ++useClock;
+  }
+
+  char name[17];
+  snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(it->second.key));
+  const std::string keyDir = cacheDir + "/" + prefix + name;
+
+  // Adopt a cache built before content keys existed
+  if (!Storage.exists(keyDir.c_str()) && Storage.exists(legacyDir.c_str())) {
+    FsFile dir = Storage.open(legacyDir.c_str());
+    if (dir && dir.rename(keyDir.c_str())) {
+      LOG_DBG("BCK", "Moved cache %s -> %s", legacyDir.c_str(), keyDir.c_str());
+    }
+    if (dir) dir.close();
+  }
+  return keyDir;
+}
+
+void BookCacheKeys::forget(const std::string& filePath, const std::string& cacheDir) {
+  loadKeys(cacheDir);
+  if (keys.erase(filePath) > 0) {
+    saveKeys(cacheDir);
+  }
+}
+
+void BookCacheKeys::rename(const std::string& fromPath, const std::string& toPath, const std::string& cacheDir) {
+  loadKeys(cacheDir);
+  const auto it = keys.find(fromPath);
+  if (it == keys.end()) {
+    return;  // Fingerprinted from the new path on its next lookup
+  }
+  const KeyEntry entry = it->second;
+  keys.erase(it);
+  keys.insert_or_assign(toPath, entry);
+  saveKeys(cacheDir);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+Cache directory names derived from a book's content rather than its path, so a book that is moved, renamed or uploaded
+again finds the sections it was already indexed with.
+
+The key is a 64-bit FNV-1a fingerprint of the file size, every ZIP central directory entry's CRC-32 and uncompressed
+size, and 1KB samples at the offsets KOReaderDocumentId reads. Computing it costs a pass over the central directory, so
+keys are remembered per path in <cacheDir>/book_keys.bin together with the file's size and modification time; while
+those match, a lookup is a hash map hit and one stat of the file.
+
+A cache directory still named after the path hash (the previous scheme) is renamed to the content key the first time
+the book is looked up.
+*/
+class BookCacheKeys {
+ public:
+  // Cache directory for the book at filePath, e.g. "/.crosspoint/epub_0123456789abcdef". Falls back to the path hash
+  // if the file can't be read.
+  static std::string cacheDirFor(const std::string& filePath, const std::string& cacheDir, const char* prefix);
+
+  // The file at filePath was replaced: fingerprint it again on the next lookup
+  static void forget(const std::string& filePath, const std::string& cacheDir);
+  // The file was moved or renamed: carry its key over without reading it again
+  static void rename(const std::string& fromPath, const std::string& toPath, const std::string& cacheDir);
+};
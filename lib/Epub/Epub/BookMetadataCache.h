@@ -1,6 +1,6 @@
 #pragma once
 
-#include <HalStorage.h>
+#include <BufferedFile.h>
 
 #include <algorithm>
 #include <string>
@@ -12,6 +12,7 @@ class BookMetadataCache {
     std::string title;
     std::string author;
     std::string language;
+    std::string series;
     std::string coverItemHref;
     std::string textReferenceHref;
   };
@@ -44,16 +45,16 @@ class BookMetadataCache {
 
  private:
   std::string cachePath;
-  size_t lutOffset;
+  uint32_t lutOffset;
   uint16_t spineCount;
   uint16_t tocCount;
   bool loaded;
   bool buildMode;
 
-  FsFile bookFile;
+  BufferedFile bookFile;
   // Temp file handles during build
-  FsFile spineFile;
-  FsFile tocFile;
+  BufferedFile spineFile;
+  BufferedFile tocFile;
 
   // Index for fast href→spineIndex lookup (used only for large EPUBs)
   struct SpineHrefIndexEntry {
@@ -76,10 +77,10 @@ class BookMetadataCache {
     return hash;
   }
 
-  uint32_t writeSpineEntry(FsFile& file, const SpineEntry& entry) const;
-  uint32_t writeTocEntry(FsFile& file, const TocEntry& entry) const;
-  SpineEntry readSpineEntry(FsFile& file) const;
-  TocEntry readTocEntry(FsFile& file) const;
+  uint32_t writeSpineEntry(BufferedFile& file, const SpineEntry& entry) const;
+  uint32_t writeTocEntry(BufferedFile& file, const TocEntry& entry) const;
+  SpineEntry readSpineEntry(BufferedFile& file) const;
+  TocEntry readTocEntry(BufferedFile& file) const;
 
  public:
   BookMetadata coreMetadata;
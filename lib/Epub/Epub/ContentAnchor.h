@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+
+// Position in a chapter that does not depend on layout settings: the byte offset in the chapter's XHTML where the
+// text block (paragraph, heading, image container) starts, and how many of that block's words come before it.
+// Every page stores the anchor of its first element, so pages are in non-decreasing anchor order.
+// With hyphenation on, words split across lines count once per piece, so an anchor taken from one layout can land a
+// line early in another.
+struct ContentAnchor {
+  uint32_t sourceOffset = 0;
+  uint16_t wordIndex = 0;
+
+  bool operator<(const ContentAnchor& other) const {
+    return sourceOffset != other.sourceOffset ? sourceOffset < other.sourceOffset : wordIndex < other.wordIndex;
+  }
+  bool operator==(const ContentAnchor& other) const {
+    return sourceOffset == other.sourceOffset && wordIndex == other.wordIndex;
+  }
+};
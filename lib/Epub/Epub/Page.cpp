@@ -1,13 +1,15 @@
 #include "Page.h"
 
+#include <GfxRenderer.h>
 #include <Logging.h>
+#include <Profiler.h>
 #include <Serialization.h>
 
 void PageLine::render(GfxRenderer& renderer, const int fontId, const int xOffset, const int yOffset) {
   block->render(renderer, fontId, xPos + xOffset, yPos + yOffset);
 }
 
-bool PageLine::serialize(FsFile& file) {
+bool PageLine::serialize(BufferedFile& file) {
   serialization::writePod(file, xPos);
   serialization::writePod(file, yPos);
 
@@ -15,7 +17,7 @@ bool PageLine::serialize(FsFile& file) {
   return block->serialize(file);
 }
 
-std::unique_ptr<PageLine> PageLine::deserialize(FsFile& file) {
+std::unique_ptr<PageLine> PageLine::deserialize(BufferedFile& file) {
   int16_t xPos;
   int16_t yPos;
   serialization::readPod(file, xPos);
@@ -30,7 +32,7 @@ void PageImage::render(GfxRenderer& renderer, const int fontId, const int xOffse
   imageBlock->render(renderer, xPos + xOffset, yPos + yOffset);
 }
 
-bool PageImage::serialize(FsFile& file) {
+bool PageImage::serialize(BufferedFile& file) {
   serialization::writePod(file, xPos);
   serialization::writePod(file, yPos);
 
@@ -38,7 +40,7 @@ bool PageImage::serialize(FsFile& file) {
   return imageBlock->serialize(file);
 }
 
-std::unique_ptr<PageImage> PageImage::deserialize(FsFile& file) {
+std::unique_ptr<PageImage> PageImage::deserialize(BufferedFile& file) {
   int16_t xPos;
   int16_t yPos;
   serialization::readPod(file, xPos);
@@ -49,12 +51,16 @@ std::unique_ptr<PageImage> PageImage::deserialize(FsFile& file) {
 }
 
 void Page::render(GfxRenderer& renderer, const int fontId, const int xOffset, const int yOffset) const {
+  PROFILE_SCOPE(renderer.getRenderMode() == GfxRenderer::BW ? profiler::TEXT_RASTER : profiler::GRAYSCALE_PASS);
   for (auto& element : elements) {
     element->render(renderer, fontId, xOffset, yOffset);
   }
 }
 
-bool Page::serialize(FsFile& file) const {
+bool Page::serialize(BufferedFile& file) const {
+  serialization::writePod(file, anchor.sourceOffset);
+  serialization::writePod(file, anchor.wordIndex);
+
   const uint16_t count = elements.size();
   serialization::writePod(file, count);
 
@@ -70,11 +76,14 @@ bool Page::serialize(FsFile& file) const {
   return true;
 }
 
-std::unique_ptr<Page> Page::deserialize(FsFile& file) {
+std::unique_ptr<Page> Page::deserialize(BufferedFile& file) {
   auto page = std::unique_ptr<Page>(new Page());
+  serialization::readPod(file, page->anchor.sourceOffset);
+  serialization::readPod(file, page->anchor.wordIndex);
 
   uint16_t count;
   serialization::readPod(file, count);
+  PROFILE_COUNT(profiler::PAGE_ELEMENTS, count);
 
   for (uint16_t i = 0; i < count; i++) {
     uint8_t tag;
@@ -4,18 +4,122 @@
 #include <Logging.h>
 #include <Serialization.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
 #include "Epub/css/CssParser.h"
 #include "Page.h"
 #include "hyphenation/Hyphenator.h"
 #include "parsers/ChapterHtmlSlimParser.h"
 
+#ifndef SECTION_LAYOUT_VARIANTS
+#define SECTION_LAYOUT_VARIANTS 3  // Layouts per book whose section files are kept side by side
+#endif
+
 namespace {
-constexpr uint8_t SECTION_FILE_VERSION = 14;
+constexpr uint8_t SECTION_FILE_VERSION = 16;
 constexpr uint32_t HEADER_SIZE = sizeof(uint8_t) + sizeof(int) + sizeof(float) + sizeof(bool) + sizeof(uint8_t) +
                                  sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint16_t) + sizeof(bool) + sizeof(bool) +
                                  sizeof(bool) + sizeof(uint32_t);
+
+// Anchor table, written right after the page LUT: uint16 count, then count x (uint32 id hash, uint16 page) sorted by
+// hash. Ids are stored hashed so a chapter that tags every paragraph doesn't need its id strings in RAM while indexing;
+// a collision between two ids of the same chapter can only send a jump to the wrong page of that chapter.
+constexpr uint32_t ANCHOR_ENTRY_SIZE = sizeof(uint32_t) + sizeof(uint16_t);
+// Caps the RAM the table takes while the chapter is parsed (8 bytes per entry). Later ids are dropped.
+constexpr size_t MAX_ANCHORS = 2048;
+
+// Book-wide list of the layouts with section files on the card: uint8 count, then count x uint32 layout hash, most
+// recently used first
+constexpr size_t MAX_LAYOUT_VARIANTS = SECTION_LAYOUT_VARIANTS;
+static_assert(MAX_LAYOUT_VARIANTS >= 1 && MAX_LAYOUT_VARIANTS <= UINT8_MAX, "SECTION_LAYOUT_VARIANTS out of range");
+
+// FNV-1a
+constexpr uint32_t FNV_OFFSET_BASIS = 2166136261u;
+uint32_t fnv1a(uint32_t hash, const void* data, const size_t size) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+uint32_t hashAnchor(const std::string& id) { return fnv1a(FNV_OFFSET_BASIS, id.data(), id.size()); }
+
+template <typename T>
+uint32_t hashField(const uint32_t hash, const T& value) {
+  return fnv1a(hash, &value, sizeof(T));
+}
+
+std::string sectionFilePath(const std::string& cachePath, const int spineIndex, const uint32_t layoutHash) {
+  char name[24];
+  snprintf(name, sizeof(name), "%d_%08lx.bin", spineIndex, static_cast<unsigned long>(layoutHash));
+  return cachePath + "/sections/" + name;
+}
 }  // namespace
 
+void Section::selectLayout(const int fontId, const float lineCompression, const bool extraParagraphSpacing,
+                           const uint8_t paragraphAlignment, const uint16_t viewportWidth,
+                           const uint16_t viewportHeight, const bool hyphenationEnabled, const bool embeddedStyle,
+                           const bool forceBoldText) {
+  uint32_t hash = FNV_OFFSET_BASIS;
+  hash = hashField(hash, fontId);
+  hash = hashField(hash, lineCompression);
+  hash = hashField(hash, extraParagraphSpacing);
+  hash = hashField(hash, paragraphAlignment);
+  hash = hashField(hash, viewportWidth);
+  hash = hashField(hash, viewportHeight);
+  hash = hashField(hash, hyphenationEnabled);
+  hash = hashField(hash, embeddedStyle);
+  hash = hashField(hash, forceBoldText);
+  layoutHash = hash;
+  filePath = sectionFilePath(epub->getCachePath(), spineIndex, layoutHash);
+}
+
+void Section::markLayoutUsed() const {
+  const auto listPath = epub->getCachePath() + "/sections/layouts.bin";
+  std::vector<uint32_t> layouts;
+  FsFile listFile;
+  if (Storage.openFileForRead("SCT", listPath, listFile)) {
+    uint8_t count = 0;
+    serialization::readPod(listFile, count);
+    for (uint8_t i = 0; i < count; i++) {
+      uint32_t hash = 0;
+      serialization::readPod(listFile, hash);
+      layouts.push_back(hash);
+    }
+    listFile.close();
+  }
+  if (!layouts.empty() && layouts.front() == layoutHash) {
+    return;  // Already the most recent: nothing to write
+  }
+
+  layouts.erase(std::remove(layouts.begin(), layouts.end(), layoutHash), layouts.end());
+  layouts.insert(layouts.begin(), layoutHash);
+  while (layouts.size() > MAX_LAYOUT_VARIANTS) {
+    const uint32_t evicted = layouts.back();
+    layouts.pop_back();
+    LOG_DBG("SCT", "Evicting sections of layout %08lx", static_cast<unsigned long>(evicted));
+    for (int i = 0; i < epub->getSpineItemsCount(); i++) {
+      const auto path = sectionFilePath(epub->getCachePath(), i, evicted);
+      if (Storage.exists(path.c_str())) {
+        Storage.remove(path.c_str());
+      }
+    }
+  }
+
+  if (!Storage.openFileForWrite("SCT", listPath, listFile)) {
+    return;
+  }
+  serialization::writePod(listFile, static_cast<uint8_t>(layouts.size()));
+  for (const uint32_t hash : layouts) {
+    serialization::writePod(listFile, hash);
+  }
+  listFile.close();
+}
+
 uint32_t Section::onPageComplete(std::unique_ptr<Page> page) {
   if (!file) {
     LOG_ERR("SCT", "File not open for writing page %d", pageCount);
@@ -64,7 +168,9 @@ bool Section::loadSectionFile(const int fontId, const float lineCompression, con
                               const uint8_t paragraphAlignment, const uint16_t viewportWidth,
                               const uint16_t viewportHeight, const bool hyphenationEnabled, const bool embeddedStyle,
                               const bool forceBoldText) {
-  if (!Storage.openFileForRead("SCT", filePath, file)) {
+  selectLayout(fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth, viewportHeight,
+               hyphenationEnabled, embeddedStyle, forceBoldText);
+  if (!file.openForRead("SCT", filePath)) {
     return false;
   }
 
@@ -112,6 +218,7 @@ bool Section::loadSectionFile(const int fontId, const float lineCompression, con
   serialization::readPod(file, pageCount);
   file.close();
   LOG_DBG("SCT", "Deserialization succeeded: %d pages", pageCount);
+  markLayoutUsed();
   return true;
 }
 
@@ -137,11 +244,105 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
                                 const bool forceBoldText, const std::function<void()>& popupFn) {
   const auto localPath = epub->getSpineItem(spineIndex).href;
   const auto tmpHtmlPath = epub->getCachePath() + "/.tmp_" + std::to_string(spineIndex) + ".html";
+  selectLayout(fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth, viewportHeight,
+               hyphenationEnabled, embeddedStyle, forceBoldText);
 
   // Create cache directory if it doesn't exist
   {
     const auto sectionsDir = epub->getCachePath() + "/sections";
     Storage.mkdir(sectionsDir.c_str());
+    // Section file from before layouts got their own files
+    const auto legacyPath = sectionsDir + "/" + std::to_string(spineIndex) + ".bin";
+    if (Storage.exists(legacyPath.c_str())) {
+      Storage.remove(legacyPath.c_str());
+    }
+  }
+
+  // Writes the section file around one run of the parser: header, the pages it emits, then LUT and anchor table
+  const auto writeSectionFile = [&](const std::string& htmlPath, CssParser* cssParser,
+                                    const std::function<bool(ChapterHtmlSlimParser&)>& build) {
+    if (!file.openForWrite("SCT", filePath)) {
+      return false;
+    }
+    pageCount = 0;
+    writeSectionFileHeader(fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth,
+                           viewportHeight, hyphenationEnabled, embeddedStyle, forceBoldText);
+    std::vector<uint32_t> lut = {};
+    std::vector<std::pair<uint32_t, uint16_t>> anchors;
+
+    // Derive the content base directory and image cache path prefix for the parser
+    size_t lastSlash = localPath.find_last_of('/');
+    std::string contentBase = (lastSlash != std::string::npos) ? localPath.substr(0, lastSlash + 1) : "";
+    std::string imageBasePath = epub->getCachePath() + "/img_" + std::to_string(spineIndex) + "_";
+
+    ChapterHtmlSlimParser visitor(
+        epub, htmlPath, renderer, fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth,
+        viewportHeight, hyphenationEnabled,
+        [this, &lut](std::unique_ptr<Page> page) { lut.emplace_back(this->onPageComplete(std::move(page))); },
+        embeddedStyle, contentBase, imageBasePath, popupFn, cssParser,
+        [&anchors](const std::string& id, const uint16_t page) {
+          if (anchors.size() < MAX_ANCHORS) {
+            anchors.emplace_back(hashAnchor(id), page);
+          }
+        });
+    Hyphenator::setPreferredLanguage(epub->getLanguage());
+    if (!build(visitor)) {
+      file.close();
+      Storage.remove(filePath.c_str());
+      return false;
+    }
+
+    const uint32_t lutOffset = file.position();
+    bool hasFailedLutRecords = false;
+    // Write LUT
+    for (const uint32_t& pos : lut) {
+      if (pos == 0) {
+        hasFailedLutRecords = true;
+        break;
+      }
+      serialization::writePod(file, pos);
+    }
+
+    if (hasFailedLutRecords) {
+      LOG_ERR("SCT", "Failed to write LUT due to invalid page positions");
+      file.close();
+      Storage.remove(filePath.c_str());
+      return false;
+    }
+
+    // Write anchor table
+    if (anchors.size() == MAX_ANCHORS) {
+      LOG_ERR("SCT", "Anchor table full, ids past the first %zu are not indexed", MAX_ANCHORS);
+    }
+    std::sort(anchors.begin(), anchors.end());
+    serialization::writePod(file, static_cast<uint16_t>(anchors.size()));
+    for (const auto& anchor : anchors) {
+      serialization::writePod(file, anchor.first);
+      serialization::writePod(file, anchor.second);
+    }
+    LOG_DBG("SCT", "Indexed %zu anchors", anchors.size());
+
+    // Go back and write LUT offset
+    file.seek(HEADER_SIZE - sizeof(uint32_t) - sizeof(pageCount));
+    serialization::writePod(file, pageCount);
+    serialization::writePod(file, lutOffset);
+    file.close();
+    return true;
+  };
+
+  // A layout change only needs the chapter IR replayed: no decompression, XML parsing or CSS matching
+  BufferedFile ir;
+  if (ir.openForRead("SCT", irPath)) {
+    const bool replayed = writeSectionFile(
+        tmpHtmlPath, nullptr, [&ir](ChapterHtmlSlimParser& visitor) { return visitor.buildPagesFromIr(ir); });
+    ir.close();
+    if (replayed) {
+      LOG_DBG("SCT", "Built %d pages from chapter IR", pageCount);
+      markLayoutUsed();
+      return true;
+    }
+    LOG_DBG("SCT", "Chapter IR unusable, parsing the chapter again");
+    Storage.remove(irPath.c_str());
   }
 
   // Retry logic for SD card timing issues
@@ -180,18 +381,6 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
 
   LOG_DBG("SCT", "Streamed temp HTML to %s (%d bytes)", tmpHtmlPath.c_str(), fileSize);
 
-  if (!Storage.openFileForWrite("SCT", filePath, file)) {
-    return false;
-  }
-  writeSectionFileHeader(fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth,
-                         viewportHeight, hyphenationEnabled, embeddedStyle, forceBoldText);
-  std::vector<uint32_t> lut = {};
-
-  // Derive the content base directory and image cache path prefix for the parser
-  size_t lastSlash = localPath.find_last_of('/');
-  std::string contentBase = (lastSlash != std::string::npos) ? localPath.substr(0, lastSlash + 1) : "";
-  std::string imageBasePath = epub->getCachePath() + "/img_" + std::to_string(spineIndex) + "_";
-
   CssParser* cssParser = nullptr;
   if (embeddedStyle) {
     cssParser = epub->getCssParser();
@@ -202,63 +391,44 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
     }
   }
 
-  ChapterHtmlSlimParser visitor(
-      epub, tmpHtmlPath, renderer, fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth,
-      viewportHeight, hyphenationEnabled,
-      [this, &lut](std::unique_ptr<Page> page) { lut.emplace_back(this->onPageComplete(std::move(page))); },
-      embeddedStyle, contentBase, imageBasePath, popupFn, cssParser);
-  Hyphenator::setPreferredLanguage(epub->getLanguage());
-  success = visitor.parseAndBuildPages();
-
-  Storage.remove(tmpHtmlPath.c_str());
-  if (!success) {
-    LOG_ERR("SCT", "Failed to parse XML and build pages");
-    file.close();
-    Storage.remove(filePath.c_str());
-    if (cssParser) {
-      cssParser->clear();
-    }
-    return false;
-  }
-
-  const uint32_t lutOffset = file.position();
-  bool hasFailedLutRecords = false;
-  // Write LUT
-  for (const uint32_t& pos : lut) {
-    if (pos == 0) {
-      hasFailedLutRecords = true;
-      break;
+  // Record the IR alongside; without it the chapter is still laid out, just parsed again on the next re-flow
+  BufferedFile irOut;
+  const bool recording = irOut.openForWrite("SCT", irPath);
+  success = writeSectionFile(tmpHtmlPath, cssParser, [&irOut, recording](ChapterHtmlSlimParser& visitor) {
+    if (!visitor.parseAndBuildPages(recording ? &irOut : nullptr)) {
+      LOG_ERR("SCT", "Failed to parse XML and build pages");
+      return false;
     }
-    serialization::writePod(file, pos);
-  }
-
-  if (hasFailedLutRecords) {
-    LOG_ERR("SCT", "Failed to write LUT due to invalid page positions");
-    file.close();
-    Storage.remove(filePath.c_str());
-    return false;
+    return true;
+  });
+  const bool irWritten = recording && irOut.flush();
+  irOut.close();
+  if (recording && (!success || !irWritten)) {
+    Storage.remove(irPath.c_str());
   }
 
-  // Go back and write LUT offset
-  file.seek(HEADER_SIZE - sizeof(uint32_t) - sizeof(pageCount));
-  serialization::writePod(file, pageCount);
-  serialization::writePod(file, lutOffset);
-  file.close();
+  Storage.remove(tmpHtmlPath.c_str());
   if (cssParser) {
     cssParser->clear();
   }
-  return true;
+  if (success) {
+    markLayoutUsed();
+  }
+  return success;
 }
 
-std::unique_ptr<Page> Section::loadPageFromSectionFile() {
-  if (!Storage.openFileForRead("SCT", filePath, file)) {
+std::unique_ptr<Page> Section::loadPage(const int pageIndex) {
+  if (pageIndex < 0 || pageIndex >= pageCount) {
+    return nullptr;
+  }
+  if (!file.openForRead("SCT", filePath)) {
     return nullptr;
   }
 
   file.seek(HEADER_SIZE - sizeof(uint32_t));
   uint32_t lutOffset;
   serialization::readPod(file, lutOffset);
-  file.seek(lutOffset + sizeof(uint32_t) * currentPage);
+  file.seek(lutOffset + sizeof(uint32_t) * pageIndex);
   uint32_t pagePos;
   serialization::readPod(file, pagePos);
   file.seek(pagePos);
@@ -267,3 +437,90 @@ std::unique_ptr<Page> Section::loadPageFromSectionFile() {
   file.close();
   return page;
 }
+
+int Section::findPageForAnchor(const std::string& anchor) {
+  if (anchor.empty() || !file.openForRead("SCT", filePath)) {
+    return -1;
+  }
+
+  file.seek(HEADER_SIZE - sizeof(uint32_t));
+  uint32_t lutOffset;
+  serialization::readPod(file, lutOffset);
+  file.seek(lutOffset + sizeof(uint32_t) * pageCount);
+  uint16_t count = 0;
+  serialization::readPod(file, count);
+  const uint32_t tableStart = file.position();
+
+  // Lower bound over the sorted hashes
+  const uint32_t hash = hashAnchor(anchor);
+  uint16_t lo = 0;
+  uint16_t hi = count;
+  while (lo < hi) {
+    const uint16_t mid = lo + (hi - lo) / 2;
+    uint32_t midHash;
+    file.seek(tableStart + ANCHOR_ENTRY_SIZE * mid);
+    serialization::readPod(file, midHash);
+    if (midHash < hash) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  int page = -1;
+  if (lo < count) {
+    uint32_t foundHash;
+    uint16_t foundPage;
+    file.seek(tableStart + ANCHOR_ENTRY_SIZE * lo);
+    serialization::readPod(file, foundHash);
+    serialization::readPod(file, foundPage);
+    if (foundHash == hash && foundPage < pageCount) {
+      page = foundPage;
+    }
+  }
+  file.close();
+  LOG_DBG("SCT", "Anchor #%s -> page %d", anchor.c_str(), page);
+  return page;
+}
+
+int Section::findPageForContentAnchor(const ContentAnchor& anchor) {
+  if (pageCount == 0 || !file.openForRead("SCT", filePath)) {
+    return -1;
+  }
+
+  file.seek(HEADER_SIZE - sizeof(uint32_t));
+  uint32_t lutOffset;
+  serialization::readPod(file, lutOffset);
+
+  // First page whose anchor is not before the target; each probe reads a LUT entry and the page's leading anchor
+  const auto readPageAnchor = [this, lutOffset](const uint16_t pageIndex) {
+    uint32_t pagePos;
+    file.seek(lutOffset + sizeof(uint32_t) * pageIndex);
+    serialization::readPod(file, pagePos);
+    file.seek(pagePos);
+    ContentAnchor pageAnchor;
+    serialization::readPod(file, pageAnchor.sourceOffset);
+    serialization::readPod(file, pageAnchor.wordIndex);
+    return pageAnchor;
+  };
+  uint16_t lo = 0;
+  uint16_t hi = pageCount;
+  bool exact = false;  // Whether page hi starts exactly at the anchor
+  while (lo < hi) {
+    const uint16_t mid = lo + (hi - lo) / 2;
+    const ContentAnchor midAnchor = readPageAnchor(mid);
+    if (midAnchor < anchor) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+      exact = midAnchor == anchor;
+    }
+  }
+  file.close();
+
+  // Unless a page starts right at it, the anchored word sits on the page before: the last one starting ahead of it
+  const int page = exact || lo == 0 ? lo : lo - 1;
+  LOG_DBG("SCT", "Content anchor %lu+%u -> page %d", static_cast<unsigned long>(anchor.sourceOffset), anchor.wordIndex,
+          page);
+  return page;
+}
@@ -2,6 +2,9 @@
 #include <functional>
 #include <memory>
 
+#include <BufferedFile.h>
+
+#include "ContentAnchor.h"
 #include "Epub.h"
 
 class Page;
@@ -11,14 +14,27 @@ class Section {
   std::shared_ptr<Epub> epub;
   const int spineIndex;
   GfxRenderer& renderer;
+  // sections/<spine>_<layout hash>.bin, set once the layout is known (see selectLayout)
   std::string filePath;
-  FsFile file;
+  // Layout-independent chapter IR (see ChapterHtmlSlimParser); survives clearCache so a re-flow skips the XHTML
+  std::string irPath;
+  BufferedFile file;
 
+  // Point filePath at this chapter's cache for the given layout. Each layout gets its own file so switching back to
+  // a recent font size or orientation finds its pages still on the card.
+  void selectLayout(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
+                    uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled, bool embeddedStyle,
+                    bool forceBoldText);
+  // Move the selected layout to the front of the book's recently used list, deleting the sections of any layout that
+  // falls off its end
+  void markLayoutUsed() const;
   void writeSectionFileHeader(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
                               uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled,
                               bool embeddedStyle, bool forceBoldText);
   uint32_t onPageComplete(std::unique_ptr<Page> page);
 
+  uint32_t layoutHash = 0;
+
  public:
   uint16_t pageCount = 0;
   int currentPage = 0;
@@ -27,7 +43,7 @@ class Section {
       : epub(epub),
         spineIndex(spineIndex),
         renderer(renderer),
-        filePath(epub->getCachePath() + "/sections/" + std::to_string(spineIndex) + ".bin") {}
+        irPath(epub->getCachePath() + "/sections/" + std::to_string(spineIndex) + ".ir") {}
   ~Section() = default;
   bool loadSectionFile(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
                        uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled, bool embeddedStyle,
@@ -36,5 +52,11 @@ class Section {
   bool createSectionFile(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
                          uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled, bool embeddedStyle,
                          bool forceBoldText, const std::function<void()>& popupFn = nullptr);
-  std::unique_ptr<Page> loadPageFromSectionFile();
+  std::unique_ptr<Page> loadPageFromSectionFile() { return loadPage(currentPage); }
+  // Load any page of the section without touching currentPage (e.g. to render ahead of the reader)
+  std::unique_ptr<Page> loadPage(int pageIndex);
+  // Page an element id (a TOC or link fragment, without '#') was laid out on, or -1 if the chapter has no such id
+  int findPageForAnchor(const std::string& anchor);
+  // Page holding a position saved from any layout of this chapter (see ContentAnchor), or -1 if the file can't be read
+  int findPageForContentAnchor(const ContentAnchor& anchor);
 };
@@ -1,7 +1,9 @@
 #include "ImageBlock.h"
 
+#include <AllocTracker.h>
 #include <GfxRenderer.h>
 #include <Logging.h>
+#include <Profiler.h>
 #include <SDCardManager.h>
 #include <Serialization.h>
 
@@ -61,6 +63,7 @@ bool renderFromCache(GfxRenderer& renderer, const std::string& cachePath, int x,
   // Read and render row by row to minimize memory usage
   const int bytesPerRow = (cachedWidth + 3) / 4;  // 2 bits per pixel, 4 pixels per byte
   uint8_t* rowBuffer = (uint8_t*)malloc(bytesPerRow);
+  ALLOC_TRACK(alloctracker::IMG, bytesPerRow, rowBuffer != nullptr);
   if (!rowBuffer) {
     LOG_ERR("IMG", "Failed to allocate row buffer");
     cacheFile.close();
@@ -94,6 +97,8 @@ bool renderFromCache(GfxRenderer& renderer, const std::string& cachePath, int x,
 }  // namespace
 
 void ImageBlock::render(GfxRenderer& renderer, const int x, const int y) {
+  PROFILE_SCOPE(profiler::IMAGE_DECODE);
+  PROFILE_COUNT(profiler::IMAGES, 1);
   LOG_DBG("IMG", "Rendering image at %d,%d: %s (%dx%d)", x, y, imagePath.c_str(), width, height);
 
   const int screenWidth = renderer.getScreenWidth();
@@ -157,14 +162,14 @@ void ImageBlock::render(GfxRenderer& renderer, const int x, const int y) {
   LOG_DBG("IMG", "Decode successful");
 }
 
-bool ImageBlock::serialize(FsFile& file) {
+bool ImageBlock::serialize(BufferedFile& file) {
   serialization::writeString(file, imagePath);
   serialization::writePod(file, width);
   serialization::writePod(file, height);
   return true;
 }
 
-std::unique_ptr<ImageBlock> ImageBlock::deserialize(FsFile& file) {
+std::unique_ptr<ImageBlock> ImageBlock::deserialize(BufferedFile& file) {
   std::string path;
   serialization::readString(file, path);
   int16_t w, h;
@@ -1,6 +1,6 @@
 #pragma once
+#include <BufferedFile.h>
 #include <EpdFontFamily.h>
-#include <HalStorage.h>
 
 #include <list>
 #include <memory>
@@ -31,8 +31,8 @@ class TextBlock final : public Block {
   // given a renderer works out where to break the words into lines
   void render(const GfxRenderer& renderer, int fontId, int x, int y) const;
   BlockType getType() override { return TEXT_BLOCK; }
-  bool serialize(FsFile& file) const;
-  static std::unique_ptr<TextBlock> deserialize(FsFile& file);
+  bool serialize(BufferedFile& file) const;
+  static std::unique_ptr<TextBlock> deserialize(BufferedFile& file);
 
   // --- HIGHLIGHT MODE ---
   const std::list<std::string>& getWords() const { return words; }
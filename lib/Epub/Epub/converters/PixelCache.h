@@ -1,5 +1,6 @@
 #pragma once
 
+#include <AllocTracker.h>
 #include <HalStorage.h>
 #include <Logging.h>
 #include <stdint.h>
@@ -35,6 +36,7 @@ struct PixelCache {
       return false;
     }
     buffer = (uint8_t*)malloc(bufferSize);
+    ALLOC_TRACK(alloctracker::IMG, bufferSize, buffer != nullptr);
     if (buffer) {
       memset(buffer, 0, bufferSize);
       LOG_DBG("IMG", "Allocated cache buffer: %d bytes for %dx%d", bufferSize, w, h);
@@ -1,5 +1,6 @@
 #include "PngToFramebufferConverter.h"
 
+#include <AllocTracker.h>
 #include <GfxRenderer.h>
 #include <Logging.h>
 #include <PNGdec.h>
@@ -243,10 +244,12 @@ bool PngToFramebufferConverter::getDimensionsStatic(const std::string& imagePath
   size_t freeHeap = ESP.getFreeHeap();
   if (freeHeap < MIN_FREE_HEAP_FOR_PNG) {
     LOG_ERR("PNG", "Not enough heap for PNG decoder (%u free, need %u)", freeHeap, MIN_FREE_HEAP_FOR_PNG);
+    ALLOC_TRACK(alloctracker::IMG, sizeof(PNG), false);
     return false;
   }
 
   PNG* png = new (std::nothrow) PNG();
+  ALLOC_TRACK(alloctracker::IMG, sizeof(PNG), png != nullptr);
   if (!png) {
     LOG_ERR("PNG", "Failed to allocate PNG decoder for dimensions");
     return false;
@@ -276,11 +279,13 @@ bool PngToFramebufferConverter::decodeToFramebuffer(const std::string& imagePath
   size_t freeHeap = ESP.getFreeHeap();
   if (freeHeap < MIN_FREE_HEAP_FOR_PNG) {
     LOG_ERR("PNG", "Not enough heap for PNG decoder (%u free, need %u)", freeHeap, MIN_FREE_HEAP_FOR_PNG);
+    ALLOC_TRACK(alloctracker::IMG, sizeof(PNG), false);
     return false;
   }
 
   // Heap-allocate PNG decoder (~42 KB) - freed at end of function
   PNG* png = new (std::nothrow) PNG();
+  ALLOC_TRACK(alloctracker::IMG, sizeof(PNG), png != nullptr);
   if (!png) {
     LOG_ERR("PNG", "Failed to allocate PNG decoder");
     return false;
@@ -349,6 +354,7 @@ bool PngToFramebufferConverter::decodeToFramebuffer(const std::string& imagePath
   // Allocate grayscale line buffer on demand (~3.2 KB) - freed after decode
   const size_t grayBufSize = PNG_MAX_BUFFERED_PIXELS / 2;
   ctx.grayLineBuffer = static_cast<uint8_t*>(malloc(grayBufSize));
+  ALLOC_TRACK(alloctracker::IMG, grayBufSize, ctx.grayLineBuffer != nullptr);
   if (!ctx.grayLineBuffer) {
     LOG_ERR("PNG", "Failed to allocate gray line buffer");
     png->close();
@@ -9,6 +9,8 @@
 
 #include "CssStyle.h"
 
+class BufferedFile;
+
 /**
  * Lightweight CSS parser for EPUB stylesheets
  *
@@ -90,6 +92,13 @@ class CssParser {
    */
   void deleteCache() const;
 
+  /**
+   * Write / read one CssStyle in the rules cache format (also used by the chapter IR cache)
+   * @return readStyle: false if the file ended early
+   */
+  static void writeStyle(BufferedFile& file, const CssStyle& style);
+  static bool readStyle(BufferedFile& file, CssStyle& style);
+
   /**
    * Save parsed CSS rules to a cache file.
    * @return true if cache was written successfully
@@ -1,9 +1,11 @@
 #include "ChapterHtmlSlimParser.h"
 
+#include <AllocTracker.h>
 #include <FsHelpers.h>
 #include <GfxRenderer.h>
 #include <HalStorage.h>
 #include <Logging.h>
+#include <Serialization.h>
 #include <expat.h>
 
 #include "../../Epub.h"
@@ -19,6 +21,34 @@ constexpr int NUM_HEADER_TAGS = sizeof(HEADER_TAGS) / sizeof(HEADER_TAGS[0]);
 constexpr size_t MIN_SIZE_FOR_POPUP = 10 * 1024;  // 10KB
 constexpr size_t PARSE_BUFFER_SIZE = 1024;
 
+// Chapter IR file: uint8 version, uint8 CSS cache version, bool embedded style, then ops until IR_END.
+//   IR_BLOCK:  uint8 kind, CssStyle (Paragraph and Header only), uint32 source offset
+//   IR_WORD:   uint8 font style, uint8 flags (1 underline, 2 attach to previous), uint8 length, bytes
+//   IR_ANCHOR: string id, bool word pending
+//   IR_IMAGE:  string cached image path, int16 width, int16 height, CssStyle of the img
+//   IR_SPLIT:  the >750 word block split, replayed at the same word so pagination matches a fresh parse
+constexpr uint8_t IR_VERSION = 1;
+enum IrOp : uint8_t { IR_BLOCK = 1, IR_WORD = 2, IR_ANCHOR = 3, IR_IMAGE = 4, IR_SPLIT = 5, IR_END = 6 };
+
+#ifdef ENABLE_ALLOC_TRACKER
+namespace {
+// Routes expat's own allocations (parser state, buffers, tag stacks) through the allocation tracker
+void* trackedXmlMalloc(const size_t size) {
+  void* ptr = malloc(size);
+  ALLOC_TRACK(alloctracker::EHP, size, ptr != nullptr);
+  return ptr;
+}
+
+void* trackedXmlRealloc(void* ptr, const size_t size) {
+  void* newPtr = realloc(ptr, size);
+  ALLOC_TRACK(alloctracker::EHP, size, newPtr != nullptr);
+  return newPtr;
+}
+
+const XML_Memory_Handling_Suite trackedXmlMemorySuite = {trackedXmlMalloc, trackedXmlRealloc, free};
+}  // namespace
+#endif
+
 const char* BLOCK_TAGS[] = {"p", "li", "div", "br", "blockquote"};
 constexpr int NUM_BLOCK_TAGS = sizeof(BLOCK_TAGS) / sizeof(BLOCK_TAGS[0]);
 
@@ -100,7 +130,7 @@ void ChapterHtmlSlimParser::flushPartWordBuffer() {
 
   // flush the buffer
   partWordBuffer[partWordBufferIndex] = '\0';
-  currentTextBlock->addWord(partWordBuffer, fontStyle, false, nextWordContinues);
+  addWordToBlock(partWordBuffer, fontStyle, false, nextWordContinues);
   partWordBufferIndex = 0;
   nextWordContinues = false;
 }
@@ -121,6 +151,254 @@ void ChapterHtmlSlimParser::startNewTextBlock(const BlockStyle& blockStyle) {
     makePages();
   }
   currentTextBlock.reset(new ParsedText(extraParagraphSpacing, hyphenationEnabled, blockStyle));
+  wordsPlaced = 0;
+  blockSourceOffset = sourceOffset();
+}
+
+uint32_t ChapterHtmlSlimParser::sourceOffset() const {
+  if (!xmlParser) {
+    return replaySourceOffset;
+  }
+  const XML_Index offset = XML_GetCurrentByteIndex(xmlParser);
+  return offset > 0 ? static_cast<uint32_t>(offset) : 0;
+}
+
+BlockStyle ChapterHtmlSlimParser::resolveBlockStyle(const BlockKind kind, const CssStyle& cssStyle) {
+  const float emSize = static_cast<float>(renderer.getLineHeight(fontId)) * lineCompression;
+  switch (kind) {
+    case BlockKind::Aligned: {
+      auto blockStyle = BlockStyle();
+      blockStyle.textAlignDefined = true;
+      // Resolve None sentinel to Justify (no CSS context)
+      blockStyle.alignment = (paragraphAlignment == static_cast<uint8_t>(CssTextAlign::None))
+                                 ? CssTextAlign::Justify
+                                 : static_cast<CssTextAlign>(paragraphAlignment);
+      return blockStyle;
+    }
+    case BlockKind::Centered: {
+      auto blockStyle = BlockStyle();
+      blockStyle.textAlignDefined = true;
+      blockStyle.alignment = CssTextAlign::Center;
+      return blockStyle;
+    }
+    case BlockKind::Header: {
+      auto blockStyle = BlockStyle::fromCssStyle(cssStyle, emSize, CssTextAlign::Center, viewportWidth);
+      blockStyle.textAlignDefined = true;
+      if (embeddedStyle && cssStyle.hasTextAlign()) {
+        blockStyle.alignment = cssStyle.textAlign;
+      }
+      return blockStyle;
+    }
+    case BlockKind::Repeat:
+      return currentTextBlock ? currentTextBlock->getBlockStyle() : BlockStyle();
+    case BlockKind::Paragraph:
+    default:
+      return BlockStyle::fromCssStyle(cssStyle, emSize, static_cast<CssTextAlign>(paragraphAlignment), viewportWidth);
+  }
+}
+
+void ChapterHtmlSlimParser::beginBlock(const BlockKind kind, const CssStyle& cssStyle) {
+  if (irOut) {
+    serialization::writePod(*irOut, static_cast<uint8_t>(IR_BLOCK));
+    serialization::writePod(*irOut, static_cast<uint8_t>(kind));
+    if (kind == BlockKind::Paragraph || kind == BlockKind::Header) {
+      CssParser::writeStyle(*irOut, cssStyle);
+    }
+    serialization::writePod(*irOut, sourceOffset());
+  }
+  startNewTextBlock(resolveBlockStyle(kind, cssStyle));
+}
+
+void ChapterHtmlSlimParser::addWordToBlock(std::string word, const EpdFontFamily::Style fontStyle, const bool underline,
+                                           const bool attachToPrevious) {
+  if (irOut) {
+    const auto length = static_cast<uint8_t>(std::min<size_t>(word.size(), UINT8_MAX));
+    serialization::writePod(*irOut, static_cast<uint8_t>(IR_WORD));
+    serialization::writePod(*irOut, static_cast<uint8_t>(fontStyle));
+    serialization::writePod(*irOut, static_cast<uint8_t>((underline ? 1 : 0) | (attachToPrevious ? 2 : 0)));
+    serialization::writePod(*irOut, length);
+    irOut->write(word.data(), length);
+  }
+  currentTextBlock->addWord(std::move(word), fontStyle, underline, attachToPrevious);
+}
+
+// Lay out all but the last line of an overlong block to free its words
+void ChapterHtmlSlimParser::splitLongBlock() {
+  if (irOut) {
+    serialization::writePod(*irOut, static_cast<uint8_t>(IR_SPLIT));
+  }
+  LOG_DBG("EHP", "Text block too long, splitting into multiple pages");
+  currentTextBlock->layoutAndExtractLines(
+      renderer, fontId, viewportWidth,
+      [this](const std::shared_ptr<TextBlock>& textBlock) { addLineToPage(textBlock); }, false);
+}
+
+void ChapterHtmlSlimParser::recordAnchor(const char* id, const bool wordPending) {
+  if (irOut) {
+    serialization::writePod(*irOut, static_cast<uint8_t>(IR_ANCHOR));
+    serialization::writeString(*irOut, std::string(id));
+    serialization::writePod(*irOut, wordPending);
+  }
+  if (!anchorFn) {
+    return;
+  }
+  // The id belongs to the next word that reaches the block: the one being buffered, or the next one added
+  size_t wordIndex = wordsPlaced + (currentTextBlock ? currentTextBlock->size() : 0);
+  if (wordPending) {
+    wordIndex++;
+  }
+  pendingAnchors.push_back({id, wordIndex});
+}
+
+void ChapterHtmlSlimParser::resolvePendingAnchors(const size_t wordLimit) {
+  if (pendingAnchors.empty()) {
+    return;
+  }
+  auto it = pendingAnchors.begin();
+  while (it != pendingAnchors.end()) {
+    if (it->wordIndex < wordLimit) {
+      anchorFn(it->id, pagesCompleted);
+      it = pendingAnchors.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// Anchor the current page at the next content of the current block, if nothing has been placed on it yet. An image
+// placed ahead of text still waiting for layout shares the anchor of the line that will follow it.
+void ChapterHtmlSlimParser::markPageStart() {
+  if (currentPage->elements.empty()) {
+    currentPage->anchor = {blockSourceOffset, static_cast<uint16_t>(std::min<size_t>(wordsPlaced, UINT16_MAX))};
+  }
+}
+
+void ChapterHtmlSlimParser::completePage() {
+  completePageFn(std::move(currentPage));
+  pagesCompleted++;
+}
+
+// Size an image for the current layout (CSS size or fit to viewport) and add it to the page
+bool ChapterHtmlSlimParser::placeImage(const std::string& cachedImagePath, const int16_t width, const int16_t height,
+                                       const CssStyle& imgStyle) {
+  if (irOut) {
+    serialization::writePod(*irOut, static_cast<uint8_t>(IR_IMAGE));
+    serialization::writeString(*irOut, cachedImagePath);
+    serialization::writePod(*irOut, width);
+    serialization::writePod(*irOut, height);
+    CssParser::writeStyle(*irOut, imgStyle);
+  }
+
+  const ImageDimensions dims = {width, height};
+  int displayWidth = 0;
+  int displayHeight = 0;
+  const float emSize = static_cast<float>(renderer.getLineHeight(fontId)) * lineCompression;
+  const bool hasCssHeight = imgStyle.hasImageHeight();
+  const bool hasCssWidth = imgStyle.hasImageWidth();
+
+  if (hasCssHeight && hasCssWidth && dims.width > 0 && dims.height > 0) {
+    // Both CSS height and width set: resolve both, then clamp to viewport preserving requested ratio
+    displayHeight =
+        static_cast<int>(imgStyle.imageHeight.toPixels(emSize, static_cast<float>(viewportHeight)) + 0.5f);
+    displayWidth = static_cast<int>(imgStyle.imageWidth.toPixels(emSize, static_cast<float>(viewportWidth)) + 0.5f);
+    if (displayHeight < 1) displayHeight = 1;
+    if (displayWidth < 1) displayWidth = 1;
+    if (displayWidth > viewportWidth || displayHeight > viewportHeight) {
+      float scaleX = (displayWidth > viewportWidth) ? static_cast<float>(viewportWidth) / displayWidth : 1.0f;
+      float scaleY = (displayHeight > viewportHeight) ? static_cast<float>(viewportHeight) / displayHeight : 1.0f;
+      float scale = (scaleX < scaleY) ? scaleX : scaleY;
+      displayWidth = static_cast<int>(displayWidth * scale + 0.5f);
+      displayHeight = static_cast<int>(displayHeight * scale + 0.5f);
+      if (displayWidth < 1) displayWidth = 1;
+      if (displayHeight < 1) displayHeight = 1;
+    }
+    LOG_DBG("EHP", "Display size from CSS height+width: %dx%d", displayWidth, displayHeight);
+  } else if (hasCssHeight && !hasCssWidth && dims.width > 0 && dims.height > 0) {
+    // Use CSS height (resolve % against viewport height) and derive width from aspect ratio
+    displayHeight =
+        static_cast<int>(imgStyle.imageHeight.toPixels(emSize, static_cast<float>(viewportHeight)) + 0.5f);
+    if (displayHeight < 1) displayHeight = 1;
+    displayWidth = static_cast<int>(displayHeight * (static_cast<float>(dims.width) / dims.height) + 0.5f);
+    if (displayHeight > viewportHeight) {
+      displayHeight = viewportHeight;
+      // Rescale width to preserve aspect ratio when height is clamped
+      displayWidth = static_cast<int>(displayHeight * (static_cast<float>(dims.width) / dims.height) + 0.5f);
+      if (displayWidth < 1) displayWidth = 1;
+    }
+    if (displayWidth > viewportWidth) {
+      displayWidth = viewportWidth;
+      // Rescale height to preserve aspect ratio when width is clamped
+      displayHeight = static_cast<int>(displayWidth * (static_cast<float>(dims.height) / dims.width) + 0.5f);
+      if (displayHeight < 1) displayHeight = 1;
+    }
+    if (displayWidth < 1) displayWidth = 1;
+    LOG_DBG("EHP", "Display size from CSS height: %dx%d", displayWidth, displayHeight);
+  } else if (hasCssWidth && !hasCssHeight && dims.width > 0 && dims.height > 0) {
+    // Use CSS width (resolve % against viewport width) and derive height from aspect ratio
+    displayWidth = static_cast<int>(imgStyle.imageWidth.toPixels(emSize, static_cast<float>(viewportWidth)) + 0.5f);
+    if (displayWidth > viewportWidth) displayWidth = viewportWidth;
+    if (displayWidth < 1) displayWidth = 1;
+    displayHeight = static_cast<int>(displayWidth * (static_cast<float>(dims.height) / dims.width) + 0.5f);
+    if (displayHeight > viewportHeight) {
+      displayHeight = viewportHeight;
+      // Rescale width to preserve aspect ratio when height is clamped
+      displayWidth = static_cast<int>(displayHeight * (static_cast<float>(dims.width) / dims.height) + 0.5f);
+      if (displayWidth < 1) displayWidth = 1;
+    }
+    if (displayHeight < 1) displayHeight = 1;
+    LOG_DBG("EHP", "Display size from CSS width: %dx%d", displayWidth, displayHeight);
+  } else {
+    // Scale to fit viewport while maintaining aspect ratio
+    int maxWidth = viewportWidth;
+    int maxHeight = viewportHeight;
+    float scaleX = (dims.width > maxWidth) ? (float)maxWidth / dims.width : 1.0f;
+    float scaleY = (dims.height > maxHeight) ? (float)maxHeight / dims.height : 1.0f;
+    float scale = (scaleX < scaleY) ? scaleX : scaleY;
+    if (scale > 1.0f) scale = 1.0f;
+
+    displayWidth = (int)(dims.width * scale);
+    displayHeight = (int)(dims.height * scale);
+    LOG_DBG("EHP", "Display size: %dx%d (scale %.2f)", displayWidth, displayHeight, scale);
+  }
+
+  // Create page for image - only break if image won't fit remaining space
+  if (currentPage && !currentPage->elements.empty() && (currentPageNextY + displayHeight > viewportHeight)) {
+    completePage();
+    currentPage.reset(new Page());
+    if (!currentPage) {
+      LOG_ERR("EHP", "Failed to create new page");
+      return false;
+    }
+    currentPageNextY = 0;
+  } else if (!currentPage) {
+    currentPage.reset(new Page());
+    if (!currentPage) {
+      LOG_ERR("EHP", "Failed to create initial page");
+      return false;
+    }
+    currentPageNextY = 0;
+  }
+
+  // Create ImageBlock and add to page
+  auto imageBlock = std::make_shared<ImageBlock>(cachedImagePath, displayWidth, displayHeight);
+  if (!imageBlock) {
+    LOG_ERR("EHP", "Failed to create ImageBlock");
+    return false;
+  }
+  int xPos = (viewportWidth - displayWidth) / 2;
+  auto pageImage = std::make_shared<PageImage>(imageBlock, xPos, currentPageNextY);
+  if (!pageImage) {
+    LOG_ERR("EHP", "Failed to create PageImage");
+    return false;
+  }
+  markPageStart();
+  currentPage->elements.push_back(pageImage);
+  currentPageNextY += displayHeight;
+  // Ids waiting for the next content land on the image's page, unless text still ahead of it is pending layout
+  if (currentTextBlock->isEmpty()) {
+    resolvePendingAnchors(SIZE_MAX);
+  }
+  return true;
 }
 
 void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char* name, const XML_Char** atts) {
@@ -132,7 +410,7 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
     return;
   }
 
-  // Extract class and style attributes for CSS processing
+  // Extract class and style attributes for CSS processing, and the id for the section's anchor table
   std::string classAttr;
   std::string styleAttr;
   if (atts != nullptr) {
@@ -141,14 +419,12 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
         classAttr = atts[i + 1];
       } else if (strcmp(atts[i], "style") == 0) {
         styleAttr = atts[i + 1];
+      } else if (strcmp(atts[i], "id") == 0 && atts[i + 1][0] != '\0') {
+        self->recordAnchor(atts[i + 1], self->partWordBufferIndex > 0);
       }
     }
   }
 
-  auto centeredBlockStyle = BlockStyle();
-  centeredBlockStyle.textAlignDefined = true;
-  centeredBlockStyle.alignment = CssTextAlign::Center;
-
   // Special handling for tables/cells: flatten into per-cell paragraphs with a prefixed header.
   if (strcmp(name, "table") == 0) {
     // skip nested tables
@@ -180,13 +456,7 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
     }
     self->tableColIndex += 1;
 
-    auto tableCellBlockStyle = BlockStyle();
-    tableCellBlockStyle.textAlignDefined = true;
-    const auto align = (self->paragraphAlignment == static_cast<uint8_t>(CssTextAlign::None))
-                           ? CssTextAlign::Justify
-                           : static_cast<CssTextAlign>(self->paragraphAlignment);
-    tableCellBlockStyle.alignment = align;
-    self->startNewTextBlock(tableCellBlockStyle);
+    self->beginBlock(BlockKind::Aligned);
 
     const std::string headerText =
         "Tab Row " + std::to_string(self->tableRowIndex) + ", Cell " + std::to_string(self->tableColIndex) + ":";
@@ -257,127 +527,14 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
               if (decoder && decoder->getDimensions(cachedImagePath, dims)) {
                 LOG_DBG("EHP", "Image dimensions: %dx%d", dims.width, dims.height);
 
-                int displayWidth = 0;
-                int displayHeight = 0;
-                const float emSize =
-                    static_cast<float>(self->renderer.getLineHeight(self->fontId)) * self->lineCompression;
                 CssStyle imgStyle = self->cssParser ? self->cssParser->resolveStyle("img", classAttr) : CssStyle{};
                 // Merge inline style (e.g. style="height: 2em") so it overrides stylesheet rules
                 if (!styleAttr.empty()) {
                   imgStyle.applyOver(CssParser::parseInlineStyle(styleAttr));
                 }
-                const bool hasCssHeight = imgStyle.hasImageHeight();
-                const bool hasCssWidth = imgStyle.hasImageWidth();
-
-                if (hasCssHeight && hasCssWidth && dims.width > 0 && dims.height > 0) {
-                  // Both CSS height and width set: resolve both, then clamp to viewport preserving requested ratio
-                  displayHeight = static_cast<int>(
-                      imgStyle.imageHeight.toPixels(emSize, static_cast<float>(self->viewportHeight)) + 0.5f);
-                  displayWidth = static_cast<int>(
-                      imgStyle.imageWidth.toPixels(emSize, static_cast<float>(self->viewportWidth)) + 0.5f);
-                  if (displayHeight < 1) displayHeight = 1;
-                  if (displayWidth < 1) displayWidth = 1;
-                  if (displayWidth > self->viewportWidth || displayHeight > self->viewportHeight) {
-                    float scaleX = (displayWidth > self->viewportWidth)
-                                       ? static_cast<float>(self->viewportWidth) / displayWidth
-                                       : 1.0f;
-                    float scaleY = (displayHeight > self->viewportHeight)
-                                       ? static_cast<float>(self->viewportHeight) / displayHeight
-                                       : 1.0f;
-                    float scale = (scaleX < scaleY) ? scaleX : scaleY;
-                    displayWidth = static_cast<int>(displayWidth * scale + 0.5f);
-                    displayHeight = static_cast<int>(displayHeight * scale + 0.5f);
-                    if (displayWidth < 1) displayWidth = 1;
-                    if (displayHeight < 1) displayHeight = 1;
-                  }
-                  LOG_DBG("EHP", "Display size from CSS height+width: %dx%d", displayWidth, displayHeight);
-                } else if (hasCssHeight && !hasCssWidth && dims.width > 0 && dims.height > 0) {
-                  // Use CSS height (resolve % against viewport height) and derive width from aspect ratio
-                  displayHeight = static_cast<int>(
-                      imgStyle.imageHeight.toPixels(emSize, static_cast<float>(self->viewportHeight)) + 0.5f);
-                  if (displayHeight < 1) displayHeight = 1;
-                  displayWidth =
-                      static_cast<int>(displayHeight * (static_cast<float>(dims.width) / dims.height) + 0.5f);
-                  if (displayHeight > self->viewportHeight) {
-                    displayHeight = self->viewportHeight;
-                    // Rescale width to preserve aspect ratio when height is clamped
-                    displayWidth =
-                        static_cast<int>(displayHeight * (static_cast<float>(dims.width) / dims.height) + 0.5f);
-                    if (displayWidth < 1) displayWidth = 1;
-                  }
-                  if (displayWidth > self->viewportWidth) {
-                    displayWidth = self->viewportWidth;
-                    // Rescale height to preserve aspect ratio when width is clamped
-                    displayHeight =
-                        static_cast<int>(displayWidth * (static_cast<float>(dims.height) / dims.width) + 0.5f);
-                    if (displayHeight < 1) displayHeight = 1;
-                  }
-                  if (displayWidth < 1) displayWidth = 1;
-                  LOG_DBG("EHP", "Display size from CSS height: %dx%d", displayWidth, displayHeight);
-                } else if (hasCssWidth && !hasCssHeight && dims.width > 0 && dims.height > 0) {
-                  // Use CSS width (resolve % against viewport width) and derive height from aspect ratio
-                  displayWidth = static_cast<int>(
-                      imgStyle.imageWidth.toPixels(emSize, static_cast<float>(self->viewportWidth)) + 0.5f);
-                  if (displayWidth > self->viewportWidth) displayWidth = self->viewportWidth;
-                  if (displayWidth < 1) displayWidth = 1;
-                  displayHeight =
-                      static_cast<int>(displayWidth * (static_cast<float>(dims.height) / dims.width) + 0.5f);
-                  if (displayHeight > self->viewportHeight) {
-                    displayHeight = self->viewportHeight;
-                    // Rescale width to preserve aspect ratio when height is clamped
-                    displayWidth =
-                        static_cast<int>(displayHeight * (static_cast<float>(dims.width) / dims.height) + 0.5f);
-                    if (displayWidth < 1) displayWidth = 1;
-                  }
-                  if (displayHeight < 1) displayHeight = 1;
-                  LOG_DBG("EHP", "Display size from CSS width: %dx%d", displayWidth, displayHeight);
-                } else {
-                  // Scale to fit viewport while maintaining aspect ratio
-                  int maxWidth = self->viewportWidth;
-                  int maxHeight = self->viewportHeight;
-                  float scaleX = (dims.width > maxWidth) ? (float)maxWidth / dims.width : 1.0f;
-                  float scaleY = (dims.height > maxHeight) ? (float)maxHeight / dims.height : 1.0f;
-                  float scale = (scaleX < scaleY) ? scaleX : scaleY;
-                  if (scale > 1.0f) scale = 1.0f;
-
-                  displayWidth = (int)(dims.width * scale);
-                  displayHeight = (int)(dims.height * scale);
-                  LOG_DBG("EHP", "Display size: %dx%d (scale %.2f)", displayWidth, displayHeight, scale);
-                }
-
-                // Create page for image - only break if image won't fit remaining space
-                if (self->currentPage && !self->currentPage->elements.empty() &&
-                    (self->currentPageNextY + displayHeight > self->viewportHeight)) {
-                  self->completePageFn(std::move(self->currentPage));
-                  self->currentPage.reset(new Page());
-                  if (!self->currentPage) {
-                    LOG_ERR("EHP", "Failed to create new page");
-                    return;
-                  }
-                  self->currentPageNextY = 0;
-                } else if (!self->currentPage) {
-                  self->currentPage.reset(new Page());
-                  if (!self->currentPage) {
-                    LOG_ERR("EHP", "Failed to create initial page");
-                    return;
-                  }
-                  self->currentPageNextY = 0;
-                }
-
-                // Create ImageBlock and add to page
-                auto imageBlock = std::make_shared<ImageBlock>(cachedImagePath, displayWidth, displayHeight);
-                if (!imageBlock) {
-                  LOG_ERR("EHP", "Failed to create ImageBlock");
-                  return;
-                }
-                int xPos = (self->viewportWidth - displayWidth) / 2;
-                auto pageImage = std::make_shared<PageImage>(imageBlock, xPos, self->currentPageNextY);
-                if (!pageImage) {
-                  LOG_ERR("EHP", "Failed to create PageImage");
+                if (!self->placeImage(cachedImagePath, dims.width, dims.height, imgStyle)) {
                   return;
                 }
-                self->currentPage->elements.push_back(pageImage);
-                self->currentPageNextY += displayHeight;
 
                 self->depth += 1;
                 return;
@@ -395,7 +552,7 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
       // Fallback to alt text if image processing fails
       if (!alt.empty()) {
         alt = "[Image: " + alt + "]";
-        self->startNewTextBlock(centeredBlockStyle);
+        self->beginBlock(BlockKind::Centered);
         self->italicUntilDepth = std::min(self->italicUntilDepth, self->depth);
         self->depth += 1;
         self->characterData(userData, alt.c_str(), alt.length());
@@ -442,18 +599,9 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
     }
   }
 
-  const float emSize = static_cast<float>(self->renderer.getLineHeight(self->fontId)) * self->lineCompression;
-  const auto userAlignmentBlockStyle = BlockStyle::fromCssStyle(
-      cssStyle, emSize, static_cast<CssTextAlign>(self->paragraphAlignment), self->viewportWidth);
-
   if (matches(name, HEADER_TAGS, NUM_HEADER_TAGS)) {
     self->currentCssStyle = cssStyle;
-    auto headerBlockStyle = BlockStyle::fromCssStyle(cssStyle, emSize, CssTextAlign::Center, self->viewportWidth);
-    headerBlockStyle.textAlignDefined = true;
-    if (self->embeddedStyle && cssStyle.hasTextAlign()) {
-      headerBlockStyle.alignment = cssStyle.textAlign;
-    }
-    self->startNewTextBlock(headerBlockStyle);
+    self->beginBlock(BlockKind::Header, cssStyle);
     self->boldUntilDepth = std::min(self->boldUntilDepth, self->depth);
     self->updateEffectiveInlineStyle();
   } else if (matches(name, BLOCK_TAGS, NUM_BLOCK_TAGS)) {
@@ -462,14 +610,14 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
         // flush word preceding <br/> to currentTextBlock before calling startNewTextBlock
         self->flushPartWordBuffer();
       }
-      self->startNewTextBlock(self->currentTextBlock->getBlockStyle());
+      self->beginBlock(BlockKind::Repeat);
     } else {
       self->currentCssStyle = cssStyle;
-      self->startNewTextBlock(userAlignmentBlockStyle);
+      self->beginBlock(BlockKind::Paragraph, cssStyle);
       self->updateEffectiveInlineStyle();
 
       if (strcmp(name, "li") == 0) {
-        self->currentTextBlock->addWord("\xe2\x80\xa2", EpdFontFamily::REGULAR);
+        self->addWordToBlock("\xe2\x80\xa2", EpdFontFamily::REGULAR, false, false);
       }
     }
   } else if (matches(name, UNDERLINE_TAGS, NUM_UNDERLINE_TAGS)) {
@@ -675,10 +823,7 @@ void XMLCALL ChapterHtmlSlimParser::characterData(void* userData, const XML_Char
   // memory.
   // Spotted when reading Intermezzo, there are some really long text blocks in there.
   if (self->currentTextBlock->size() > 750) {
-    LOG_DBG("EHP", "Text block too long, splitting into multiple pages");
-    self->currentTextBlock->layoutAndExtractLines(
-        self->renderer, self->fontId, self->viewportWidth,
-        [self](const std::shared_ptr<TextBlock>& textBlock) { self->addLineToPage(textBlock); }, false);
+    self->splitLongBlock();
   }
 }
 
@@ -792,17 +937,20 @@ void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* n
   }
 }
 
-bool ChapterHtmlSlimParser::parseAndBuildPages() {
-  auto paragraphAlignmentBlockStyle = BlockStyle();
-  paragraphAlignmentBlockStyle.textAlignDefined = true;
-  // Resolve None sentinel to Justify for initial block (no CSS context yet)
-  const auto align = (this->paragraphAlignment == static_cast<uint8_t>(CssTextAlign::None))
-                         ? CssTextAlign::Justify
-                         : static_cast<CssTextAlign>(this->paragraphAlignment);
-  paragraphAlignmentBlockStyle.alignment = align;
-  startNewTextBlock(paragraphAlignmentBlockStyle);
+bool ChapterHtmlSlimParser::parseAndBuildPages(BufferedFile* irOut) {
+  this->irOut = irOut;
+  if (irOut) {
+    serialization::writePod(*irOut, IR_VERSION);
+    serialization::writePod(*irOut, CssParser::CSS_CACHE_VERSION);
+    serialization::writePod(*irOut, embeddedStyle);
+  }
+  beginBlock(BlockKind::Aligned);
 
+#ifdef ENABLE_ALLOC_TRACKER
+  const XML_Parser parser = XML_ParserCreate_MM(nullptr, &trackedXmlMemorySuite, nullptr);
+#else
   const XML_Parser parser = XML_ParserCreate(nullptr);
+#endif
   int done;
 
   if (!parser) {
@@ -826,6 +974,7 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
   }
 
   XML_SetUserData(parser, this);
+  xmlParser = parser;
   XML_SetElementHandler(parser, startElement, endElement);
   XML_SetCharacterDataHandler(parser, characterData);
 
@@ -874,32 +1023,128 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
   XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
   XML_SetCharacterDataHandler(parser, nullptr);
   XML_ParserFree(parser);
+  xmlParser = nullptr;
   file.close();
 
-  // Process last page if there is still text
+  if (irOut) {
+    serialization::writePod(*irOut, static_cast<uint8_t>(IR_END));
+    this->irOut = nullptr;
+  }
+  finishPages();
+  return true;
+}
+
+bool ChapterHtmlSlimParser::buildPagesFromIr(BufferedFile& ir) {
+  uint8_t version = 0;
+  uint8_t cssVersion = 0;
+  bool irEmbeddedStyle = false;
+  serialization::readPod(ir, version);
+  serialization::readPod(ir, cssVersion);
+  serialization::readPod(ir, irEmbeddedStyle);
+  if (version != IR_VERSION || cssVersion != CssParser::CSS_CACHE_VERSION || irEmbeddedStyle != embeddedStyle) {
+    LOG_DBG("EHP", "Chapter IR is stale (version %u, CSS %u, embedded style %d)", version, cssVersion,
+            irEmbeddedStyle);
+    return false;
+  }
+
+  if (popupFn && ir.size() >= MIN_SIZE_FOR_POPUP) {
+    popupFn();
+  }
+
+  const uint32_t chapterStartTime = millis();
+  std::string text;
+  while (true) {
+    uint8_t op = 0;
+    if (ir.read(&op, 1) != 1) {
+      LOG_ERR("EHP", "Chapter IR ends without end marker");
+      return false;
+    }
+
+    if (op == IR_END) {
+      break;
+    } else if (op == IR_BLOCK) {
+      uint8_t kind = 0;
+      CssStyle cssStyle;
+      serialization::readPod(ir, kind);
+      const auto blockKind = static_cast<BlockKind>(kind);
+      if ((blockKind == BlockKind::Paragraph || blockKind == BlockKind::Header) &&
+          !CssParser::readStyle(ir, cssStyle)) {
+        return false;
+      }
+      serialization::readPod(ir, replaySourceOffset);
+      beginBlock(blockKind, cssStyle);
+    } else if (op == IR_WORD) {
+      uint8_t fontStyle = 0;
+      uint8_t flags = 0;
+      uint8_t length = 0;
+      serialization::readPod(ir, fontStyle);
+      serialization::readPod(ir, flags);
+      serialization::readPod(ir, length);
+      text.resize(length);
+      if (ir.read(&text[0], length) != length) {
+        return false;
+      }
+      addWordToBlock(text, static_cast<EpdFontFamily::Style>(fontStyle), (flags & 1) != 0, (flags & 2) != 0);
+    } else if (op == IR_ANCHOR) {
+      bool wordPending = false;
+      serialization::readString(ir, text);
+      serialization::readPod(ir, wordPending);
+      recordAnchor(text.c_str(), wordPending);
+    } else if (op == IR_IMAGE) {
+      int16_t width = 0;
+      int16_t height = 0;
+      CssStyle imgStyle;
+      serialization::readString(ir, text);
+      serialization::readPod(ir, width);
+      serialization::readPod(ir, height);
+      if (!CssParser::readStyle(ir, imgStyle) || !placeImage(text, width, height, imgStyle)) {
+        return false;
+      }
+    } else if (op == IR_SPLIT) {
+      splitLongBlock();
+    } else {
+      LOG_ERR("EHP", "Unknown chapter IR op %u", op);
+      return false;
+    }
+  }
+  LOG_DBG("EHP", "Time to lay out pages from IR: %lu ms", millis() - chapterStartTime);
+
+  finishPages();
+  return true;
+}
+
+// Lay out the last block and emit the final page
+void ChapterHtmlSlimParser::finishPages() {
   if (currentTextBlock) {
     makePages();
-    completePageFn(std::move(currentPage));
+    // Ids after the last content point at the chapter's last page
+    resolvePendingAnchors(SIZE_MAX);
+    completePage();
     currentPage.reset();
     currentTextBlock.reset();
   }
-
-  return true;
+  pendingAnchors.clear();
 }
 
 void ChapterHtmlSlimParser::addLineToPage(std::shared_ptr<TextBlock> line) {
   const int lineHeight = renderer.getLineHeight(fontId) * lineCompression;
 
   if (currentPageNextY + lineHeight > viewportHeight) {
-    completePageFn(std::move(currentPage));
+    completePage();
     currentPage.reset(new Page());
     currentPageNextY = 0;
   }
 
   // Apply horizontal left inset (margin + padding) as x position offset
   const int16_t xOffset = line->getBlockStyle().leftInset();
+  markPageStart();
   currentPage->elements.push_back(std::make_shared<PageLine>(line, xOffset, currentPageNextY));
   currentPageNextY += lineHeight;
+
+  // A word split by hyphenation after its id was recorded counts twice here, so the id can resolve a few words
+  // early, never on a later page
+  wordsPlaced += line->getWords().size();
+  resolvePendingAnchors(wordsPlaced);
 }
 
 void ChapterHtmlSlimParser::makePages() {
@@ -945,4 +1190,9 @@ void ChapterHtmlSlimParser::makePages() {
   if (extraParagraphSpacing) {
     currentPageNextY += lineHeight / 2;
   }
+
+  // Ids after the block's last word belong to whatever comes next
+  for (auto& anchor : pendingAnchors) {
+    anchor.wordIndex = 0;
+  }
 }
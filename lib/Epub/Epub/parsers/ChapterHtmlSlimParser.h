@@ -1,5 +1,6 @@
 #pragma once
 
+#include <BufferedFile.h>
 #include <expat.h>
 
 #include <climits>
@@ -24,6 +25,7 @@ class ChapterHtmlSlimParser {
   GfxRenderer& renderer;
   std::function<void(std::unique_ptr<Page>)> completePageFn;
   std::function<void()> popupFn;  // Popup callback
+  std::function<void(const std::string& id, uint16_t page)> anchorFn;
   int depth = 0;
   int skipUntilDepth = INT_MAX;
   int boldUntilDepth = INT_MAX;
@@ -66,7 +68,43 @@ class ChapterHtmlSlimParser {
   int tableRowIndex = 0;
   int tableColIndex = 0;
 
+  // Element ids seen but not yet placed. wordIndex counts words of the current text block, including those already
+  // laid out into lines (wordsPlaced); the id resolves to the page of the line holding that word.
+  struct PendingAnchor {
+    std::string id;
+    size_t wordIndex;
+  };
+  std::vector<PendingAnchor> pendingAnchors;
+  size_t wordsPlaced = 0;
+  uint16_t pagesCompleted = 0;
+  // Source byte offset of currentTextBlock, for the content anchor of pages it starts
+  uint32_t blockSourceOffset = 0;
+  XML_Parser xmlParser = nullptr;
+
+  // Chapter IR: the block, word, image and id stream the parser hands to layout, free of anything that depends on
+  // font or viewport. Recorded to irOut while parsing; buildPagesFromIr replays it through the same layout calls.
+  enum class BlockKind : uint8_t {
+    Aligned = 0,    // No CSS, user paragraph alignment (first block, table cells)
+    Centered = 1,   // Image alt text
+    Paragraph = 2,  // Block tag with its CSS, user paragraph alignment
+    Header = 3,     // Header tag with its CSS, centered unless the CSS aligns it
+    Repeat = 4,     // <br>: same style as the block it breaks
+  };
+  BufferedFile* irOut = nullptr;
+  uint32_t replaySourceOffset = 0;  // Source offset of the block being replayed
+
   void updateEffectiveInlineStyle();
+  uint32_t sourceOffset() const;
+  BlockStyle resolveBlockStyle(BlockKind kind, const CssStyle& cssStyle);
+  void beginBlock(BlockKind kind, const CssStyle& cssStyle = CssStyle());
+  void addWordToBlock(std::string word, EpdFontFamily::Style fontStyle, bool underline, bool attachToPrevious);
+  void splitLongBlock();
+  bool placeImage(const std::string& cachedImagePath, int16_t width, int16_t height, const CssStyle& imgStyle);
+  void finishPages();
+  void recordAnchor(const char* id, bool wordPending);
+  void resolvePendingAnchors(size_t wordLimit);
+  void completePage();
+  void markPageStart();
   void startNewTextBlock(const BlockStyle& blockStyle);
   void flushPartWordBuffer();
   void makePages();
@@ -84,7 +122,8 @@ class ChapterHtmlSlimParser {
                                  const std::function<void(std::unique_ptr<Page>)>& completePageFn,
                                  const bool embeddedStyle, const std::string& contentBase,
                                  const std::string& imageBasePath, const std::function<void()>& popupFn = nullptr,
-                                 const CssParser* cssParser = nullptr)
+                                 const CssParser* cssParser = nullptr,
+                                 const std::function<void(const std::string& id, uint16_t page)>& anchorFn = nullptr)
 
       : epub(epub),
         filepath(filepath),
@@ -98,12 +137,17 @@ class ChapterHtmlSlimParser {
         hyphenationEnabled(hyphenationEnabled),
         completePageFn(completePageFn),
         popupFn(popupFn),
+        anchorFn(anchorFn),
         cssParser(cssParser),
         embeddedStyle(embeddedStyle),
         contentBase(contentBase),
         imageBasePath(imageBasePath) {}
 
   ~ChapterHtmlSlimParser() = default;
-  bool parseAndBuildPages();
+  // Parse the XHTML file into pages. With irOut, also records the chapter IR for later re-layouts.
+  bool parseAndBuildPages(BufferedFile* irOut = nullptr);
+  // Lay out pages from an IR recorded by parseAndBuildPages (any layout, same embedded style setting). False if the IR
+  // is stale or cut short; pages may already have been emitted by then.
+  bool buildPagesFromIr(BufferedFile& ir);
   void addLineToPage(std::shared_ptr<TextBlock> line);
 };
@@ -17,6 +17,7 @@ class ContentOpfParser final : public Print {
     IN_BOOK_TITLE,
     IN_BOOK_AUTHOR,
     IN_BOOK_LANGUAGE,
+    IN_BOOK_SERIES,
     IN_MANIFEST,
     IN_SPINE,
     IN_GUIDE,
@@ -60,6 +61,7 @@ class ContentOpfParser final : public Print {
   std::string title;
   std::string author;
   std::string language;
+  std::string series;  // calibre:series, or the EPUB 3 belongs-to-collection
   std::string tocNcxPath;
   std::string tocNavPath;  // EPUB 3 nav document path
   std::string coverItemHref;
@@ -1,6 +1,8 @@
 #include "GfxRenderer.h"
 
+#include <AllocTracker.h>
 #include <Logging.h>
+#include <Profiler.h>
 #include <Utf8.h>
 
 const uint8_t* GfxRenderer::getGlyphBitmap(const EpdFontData* fontData, const EpdGlyph* glyph) const {
@@ -77,6 +79,7 @@ static void renderCharImpl(const GfxRenderer& renderer, GfxRenderer::RenderMode
     return;
   }
 
+  PROFILE_COUNT(profiler::GLYPHS, 1);
   const EpdFontData* fontData = fontFamily.getData(style);
   const bool is2Bit = fontData->is2Bit;
   const uint8_t width = glyph->width;
@@ -1026,42 +1029,70 @@ void GfxRenderer::copyGrayscaleMsbBuffers() const { display.copyGrayscaleMsbBuff
 
 void GfxRenderer::displayGrayBuffer() const { display.displayGrayBuffer(fadingFix); }
 
-void GfxRenderer::freeBwBufferChunks() {
-  for (auto& bwBufferChunk : bwBufferChunks) {
-    if (bwBufferChunk) {
-      free(bwBufferChunk);
-      bwBufferChunk = nullptr;
+bool GfxRenderer::FrameSnapshot::isStored() const {
+  for (const auto* chunk : chunks) {
+    if (!chunk) {
+      return false;
     }
   }
+  return true;
 }
 
-/**
- * This should be called before grayscale buffers are populated.
- * A `restoreBwBuffer` call should always follow the grayscale render if this method was called.
- * Uses chunked allocation to avoid needing 48KB of contiguous memory.
- * Returns true if buffer was stored successfully, false if allocation failed.
- */
-bool GfxRenderer::storeBwBuffer() {
+void GfxRenderer::FrameSnapshot::release() {
+  for (auto& chunk : chunks) {
+    if (chunk) {
+      free(chunk);
+      chunk = nullptr;
+    }
+  }
+}
+
+bool GfxRenderer::storeFrame(FrameSnapshot& snapshot) const {
   // Allocate and copy each chunk
   for (size_t i = 0; i < BW_BUFFER_NUM_CHUNKS; i++) {
-    // Check if any chunks are already allocated
-    if (bwBufferChunks[i]) {
-      LOG_ERR("GFX", "!! BW buffer chunk %zu already stored - this is likely a bug, freeing chunk", i);
-      free(bwBufferChunks[i]);
-      bwBufferChunks[i] = nullptr;
+    if (!snapshot.chunks[i]) {
+      snapshot.chunks[i] = static_cast<uint8_t*>(malloc(BW_BUFFER_CHUNK_SIZE));
+      ALLOC_TRACK(alloctracker::GFX, BW_BUFFER_CHUNK_SIZE, snapshot.chunks[i] != nullptr);
     }
 
-    const size_t offset = i * BW_BUFFER_CHUNK_SIZE;
-    bwBufferChunks[i] = static_cast<uint8_t*>(malloc(BW_BUFFER_CHUNK_SIZE));
-
-    if (!bwBufferChunks[i]) {
-      LOG_ERR("GFX", "!! Failed to allocate BW buffer chunk %zu (%zu bytes)", i, BW_BUFFER_CHUNK_SIZE);
+    if (!snapshot.chunks[i]) {
+      LOG_ERR("GFX", "!! Failed to allocate frame chunk %zu (%zu bytes)", i, BW_BUFFER_CHUNK_SIZE);
       // Free previously allocated chunks
-      freeBwBufferChunks();
+      snapshot.release();
       return false;
     }
 
-    memcpy(bwBufferChunks[i], frameBuffer + offset, BW_BUFFER_CHUNK_SIZE);
+    memcpy(snapshot.chunks[i], frameBuffer + i * BW_BUFFER_CHUNK_SIZE, BW_BUFFER_CHUNK_SIZE);
+  }
+  return true;
+}
+
+bool GfxRenderer::restoreFrame(const FrameSnapshot& snapshot) const {
+  if (!snapshot.isStored()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < BW_BUFFER_NUM_CHUNKS; i++) {
+    memcpy(frameBuffer + i * BW_BUFFER_CHUNK_SIZE, snapshot.chunks[i], BW_BUFFER_CHUNK_SIZE);
+  }
+  return true;
+}
+
+/**
+ * This should be called before grayscale buffers are populated.
+ * A `restoreBwBuffer` call should always follow the grayscale render if this method was called.
+ * Uses chunked allocation to avoid needing 48KB of contiguous memory.
+ * Returns true if buffer was stored successfully, false if allocation failed.
+ */
+bool GfxRenderer::storeBwBuffer() {
+  // Check if any chunks are already allocated
+  if (bwBuffer.chunks[0]) {
+    LOG_ERR("GFX", "!! BW buffer already stored - this is likely a bug, freeing chunks");
+    bwBuffer.release();
+  }
+
+  if (!storeFrame(bwBuffer)) {
+    return false;
   }
 
   LOG_DBG("GFX", "Stored BW buffer in %zu chunks (%zu bytes each)", BW_BUFFER_NUM_CHUNKS, BW_BUFFER_CHUNK_SIZE);
@@ -1074,44 +1105,20 @@ bool GfxRenderer::storeBwBuffer() {
  * Uses chunked restoration to match chunked storage.
  */
 void GfxRenderer::restoreBwBuffer() {
-  // Check if all chunks are allocated
-  bool missingChunks = false;
-  for (const auto& bwBufferChunk : bwBufferChunks) {
-    if (!bwBufferChunk) {
-      missingChunks = true;
-      break;
-    }
-  }
-
-  if (missingChunks) {
-    freeBwBufferChunks();
+  if (!restoreFrame(bwBuffer)) {
+    bwBuffer.release();
     return;
   }
 
-  for (size_t i = 0; i < BW_BUFFER_NUM_CHUNKS; i++) {
-    const size_t offset = i * BW_BUFFER_CHUNK_SIZE;
-    memcpy(frameBuffer + offset, bwBufferChunks[i], BW_BUFFER_CHUNK_SIZE);
-  }
-
   display.cleanupGrayscaleBuffers(frameBuffer);
 
-  freeBwBufferChunks();
+  bwBuffer.release();
   LOG_DBG("GFX", "Restored and freed BW buffer chunks");
 }
 
-bool GfxRenderer::restoreBwBufferKeep() {
-  for (const auto& bwBufferChunk : bwBufferChunks) {
-    if (!bwBufferChunk) return false;
-  }
-
-  for (size_t i = 0; i < BW_BUFFER_NUM_CHUNKS; i++) {
-    const size_t offset = i * BW_BUFFER_CHUNK_SIZE;
-    memcpy(frameBuffer + offset, bwBufferChunks[i], BW_BUFFER_CHUNK_SIZE);
-  }
-  return true;
-}
+bool GfxRenderer::restoreBwBufferKeep() { return restoreFrame(bwBuffer); }
 
-bool GfxRenderer::hasBwBufferStored() const { return bwBufferChunks[0] != nullptr; }
+bool GfxRenderer::hasBwBufferStored() const { return bwBuffer.chunks[0] != nullptr; }
 
 /**
  * Cleanup grayscale buffers using the current frame buffer.
@@ -35,21 +35,38 @@ class GfxRenderer {
   Orientation orientation;
   bool fadingFix;
   uint8_t* frameBuffer = nullptr;
-  uint8_t* bwBufferChunks[BW_BUFFER_NUM_CHUNKS] = {nullptr};
   std::map<int, EpdFontFamily> fontMap;
   FontDecompressor* fontDecompressor = nullptr;
   void renderChar(const EpdFontFamily& fontFamily, uint32_t cp, int* x, int* y, bool pixelState,
                   EpdFontFamily::Style style) const;
-  void freeBwBufferChunks();
   template <Color color>
   void drawPixelDither(int x, int y) const;
   template <Color color>
   void fillArc(int maxRadius, int cx, int cy, int xDir, int yDir) const;
 
+ public:
+  // A full frame buffer copy kept in BW_BUFFER_CHUNK_SIZE pieces so it never needs 48KB of contiguous heap.
+  // Used for the BW buffer saved across grayscale passes and for pre-rendered reader pages.
+  class FrameSnapshot {
+    friend class GfxRenderer;
+    uint8_t* chunks[BW_BUFFER_NUM_CHUNKS] = {nullptr};
+
+   public:
+    FrameSnapshot() = default;
+    ~FrameSnapshot() { release(); }
+    FrameSnapshot(const FrameSnapshot&) = delete;
+    FrameSnapshot& operator=(const FrameSnapshot&) = delete;
+
+    bool isStored() const;
+    void release();
+  };
+
+ private:
+  FrameSnapshot bwBuffer;
+
  public:
   explicit GfxRenderer(HalDisplay& halDisplay)
       : display(halDisplay), renderMode(BW), orientation(Portrait), fadingFix(false) {}
-  ~GfxRenderer() { freeBwBufferChunks(); }
 
   static constexpr int VIEWABLE_MARGIN_TOP = 9;
   static constexpr int VIEWABLE_MARGIN_RIGHT = 3;
@@ -76,6 +93,8 @@ class GfxRenderer {
   int getScreenHeight() const;
   void displayBuffer(HalDisplay::RefreshMode refreshMode = HalDisplay::FAST_REFRESH) const;
   void displayHighlightBuffer() const;
+  // Block until the previous refresh has reached the panel (see HAL_DISPLAY_ASYNC)
+  void waitForDisplayIdle() const { display.waitUntilIdle(); }
   // EXPERIMENTAL: Windowed update - display only a rectangular region
   // void displayWindow(int x, int y, int width, int height) const;
   void invertScreen() const;
@@ -133,6 +152,10 @@ class GfxRenderer {
   bool restoreBwBufferKeep();      // Restore from stored buffer WITHOUT freeing (keeps cache for reuse)
   bool hasBwBufferStored() const;  // Check if a stored buffer exists
   void cleanupGrayscaleWithFrameBuffer() const;
+  // Copy the frame buffer into / back from a snapshot. storeFrame() releases the snapshot and returns false if any
+  // chunk can't be allocated; restoreFrame() returns false (leaving the frame buffer alone) if nothing is stored.
+  bool storeFrame(FrameSnapshot& snapshot) const;
+  bool restoreFrame(const FrameSnapshot& snapshot) const;
 
   // Font helpers
   const uint8_t* getGlyphBitmap(const EpdFontData* fontData, const EpdGlyph* glyph) const;
@@ -361,6 +361,13 @@ enum class StrId : uint16_t {
   STR_BLE_CONNECTED,
   STR_BLE_DISCONNECTED,
   STR_BLE_NOT_CONFIGURED,
+  STR_LIBRARY_SORT,
+  STR_TITLE,
+  STR_AUTHOR,
+  STR_SERIES,
+  STR_OPDS_PREVIOUS_PAGE,
+  STR_OPDS_NEXT_PAGE,
+  STR_OPDS_SAVED_COPY,
   // Sentinel - must be last
   _COUNT
 };
@@ -67,6 +67,9 @@ size_t OpdsParser::write(const uint8_t* xmlData, const size_t length) {
 }
 
 void OpdsParser::flush() {
+  if (!parser) {
+    return;  // Already failed
+  }
   if (XML_Parse(parser, nullptr, 0, XML_TRUE) != XML_STATUS_OK) {
     errorOccured = true;
     XML_ParserFree(parser);
@@ -78,6 +81,8 @@ bool OpdsParser::error() const { return errorOccured; }
 
 void OpdsParser::clear() {
   entries.clear();
+  nextHref.clear();
+  previousHref.clear();
   currentEntry = OpdsEntry{};
   currentText.clear();
   inEntry = false;
@@ -116,7 +121,21 @@ void XMLCALL OpdsParser::startElement(void* userData, const XML_Char* name, cons
     return;
   }
 
-  if (!self->inEntry) return;
+  if (!self->inEntry) {
+    // Feed-level links: pagination of a large catalog
+    if (strcmp(name, "link") == 0 || strstr(name, ":link") != nullptr) {
+      const char* rel = findAttribute(atts, "rel");
+      const char* href = findAttribute(atts, "href");
+      if (rel && href) {
+        if (strcmp(rel, "next") == 0) {
+          self->nextHref = href;
+        } else if (strcmp(rel, "previous") == 0 || strcmp(rel, "prev") == 0) {
+          self->previousHref = href;
+        }
+      }
+    }
+    return;
+  }
 
   // Check for title element
   if (strcmp(name, "title") == 0 || strstr(name, ":title") != nullptr) {
@@ -177,7 +196,11 @@ void XMLCALL OpdsParser::endElement(void* userData, const XML_Char* name) {
   if (strcmp(name, "entry") == 0 || strstr(name, ":entry") != nullptr) {
     // Only add entry if it has required fields (title and href)
     if (!self->currentEntry.title.empty() && !self->currentEntry.href.empty()) {
-      self->entries.push_back(self->currentEntry);
+      if (self->onEntry) {
+        self->onEntry(self->currentEntry);
+      } else {
+        self->entries.push_back(self->currentEntry);
+      }
     }
     self->inEntry = false;
     self->currentEntry = OpdsEntry{};
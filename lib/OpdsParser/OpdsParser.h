@@ -2,6 +2,7 @@
 #include <Print.h>
 #include <expat.h>
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -42,6 +43,9 @@ using OpdsBook = OpdsEntry;
  *       }
  *     }
  *   }
+ *
+ * Large feeds can be handled one entry at a time instead: with an entry callback set, entries are passed to it as
+ * they are parsed and not kept.
  */
 class OpdsParser final : public Print {
  public:
@@ -61,6 +65,17 @@ class OpdsParser final : public Print {
 
   operator bool() { return !error(); }
 
+  /**
+   * Receive entries as they are parsed instead of collecting them in getEntries().
+   */
+  void setEntryCallback(std::function<void(const OpdsEntry&)> callback) { onEntry = std::move(callback); }
+
+  /**
+   * Pagination links of the feed (rel="next" / rel="previous"), empty if it has none.
+   */
+  const std::string& getNextHref() const { return nextHref; }
+  const std::string& getPreviousHref() const { return previousHref; }
+
   /**
    * Get the parsed entries (both navigation and book entries).
    * @return Vector of OpdsEntry entries
@@ -90,6 +105,9 @@ class OpdsParser final : public Print {
 
   XML_Parser parser = nullptr;
   std::vector<OpdsEntry> entries;
+  std::function<void(const OpdsEntry&)> onEntry;
+  std::string nextHref;
+  std::string previousHref;
   OpdsEntry currentEntry;
   std::string currentText;
 
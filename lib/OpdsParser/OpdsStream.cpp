@@ -1,6 +1,6 @@
 #include "OpdsStream.h"
 
-OpdsParserStream::OpdsParserStream(OpdsParser& parser) : parser(parser) {}
+OpdsParserStream::OpdsParserStream(OpdsParser& parser, Print* copy) : parser(parser), copy(copy) {}
 
 int OpdsParserStream::available() { return 0; }
 
@@ -8,8 +8,14 @@ int OpdsParserStream::peek() { abort(); }
 
 int OpdsParserStream::read() { abort(); }
 
-size_t OpdsParserStream::write(uint8_t c) { return parser.write(c); }
+size_t OpdsParserStream::write(uint8_t c) { return write(&c, 1); }
 
-size_t OpdsParserStream::write(const uint8_t* buffer, size_t size) { return parser.write(buffer, size); }
+size_t OpdsParserStream::write(const uint8_t* buffer, size_t size) {
+  if (copy && copy->write(buffer, size) != size) {
+    copy = nullptr;  // The copy is incomplete from here on; parsing goes on
+    copyFailed = true;
+  }
+  return parser.write(buffer, size);
+}
 
 OpdsParserStream::~OpdsParserStream() { parser.flush(); }
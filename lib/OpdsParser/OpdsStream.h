@@ -6,7 +6,8 @@
 
 class OpdsParserStream : public Stream {
  public:
-  explicit OpdsParserStream(OpdsParser& parser);
+  // Everything written is also written to copy when given, e.g. to keep the feed on the SD card
+  explicit OpdsParserStream(OpdsParser& parser, Print* copy = nullptr);
 
   // That functions are not implimented for that stream
   int available() override;
@@ -18,6 +19,11 @@ class OpdsParserStream : public Stream {
 
   ~OpdsParserStream() override;
 
+  // Writing to the copy failed: it is incomplete
+  bool hasCopyFailed() const { return copyFailed; }
+
  private:
   OpdsParser& parser;
+  Print* copy;
+  bool copyFailed = false;
 };
@@ -0,0 +1,133 @@
+#include "Profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <Arduino.h>
+#include <Logging.h>
+#include <freertos/FreeRTOS.h>
+
+#include <cstring>
+
+namespace profiler {
+
+namespace {
+// Scopes are only opened from render tasks, but the ring is read from the main loop on CMD:PROFILE
+portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+
+PageRecord ring[RING_SIZE];
+size_t ringHead = 0;   // next slot to write
+size_t ringCount = 0;  // valid records
+
+PageRecord current = {};
+uint32_t pageStartUs = 0;
+bool pageActive = false;
+
+Stage activeStage = STAGE_COUNT;
+uint32_t activeStageStartUs = 0;
+
+constexpr const char* STAGE_NAMES[STAGE_COUNT] = {"section", "deserialize", "text",   "image",
+                                                  "gray",    "spi",         "refresh"};
+constexpr const char* COUNTER_NAMES[COUNTER_COUNT] = {"glyphs", "images", "elements"};
+
+void chargeActiveStage(const uint32_t now) {
+  if (activeStage != STAGE_COUNT) {
+    current.stageUs[activeStage] += now - activeStageStartUs;
+  }
+  activeStageStartUs = now;
+}
+}  // namespace
+
+const char* stageName(const Stage stage) { return stage < STAGE_COUNT ? STAGE_NAMES[stage] : "?"; }
+
+const char* counterName(const Counter counter) { return counter < COUNTER_COUNT ? COUNTER_NAMES[counter] : "?"; }
+
+void beginPage() {
+  const uint32_t now = micros();
+  memset(&current, 0, sizeof(current));
+  pageStartUs = now;
+  activeStageStartUs = now;
+  pageActive = true;
+}
+
+void endPage(const int spineIndex, const int pageIndex) {
+  if (!pageActive) {
+    return;
+  }
+  const uint32_t now = micros();
+  chargeActiveStage(now);
+  current.timestampMs = millis();
+  current.spineIndex = static_cast<uint16_t>(spineIndex);
+  current.pageIndex = static_cast<uint16_t>(pageIndex);
+  current.totalUs = now - pageStartUs;
+  pageActive = false;
+
+  portENTER_CRITICAL(&ringMux);
+  ring[ringHead] = current;
+  ringHead = (ringHead + 1) % RING_SIZE;
+  if (ringCount < RING_SIZE) {
+    ringCount++;
+  }
+  portEXIT_CRITICAL(&ringMux);
+}
+
+void count(const Counter counter, const uint32_t amount) {
+  if (counter < COUNTER_COUNT) {
+    current.counters[counter] += amount;
+  }
+}
+
+size_t snapshot(PageRecord* out, const size_t maxRecords) {
+  portENTER_CRITICAL(&ringMux);
+  const size_t n = ringCount < maxRecords ? ringCount : maxRecords;
+  const size_t first = (ringHead + RING_SIZE - n) % RING_SIZE;
+  for (size_t i = 0; i < n; i++) {
+    out[i] = ring[(first + i) % RING_SIZE];
+  }
+  portEXIT_CRITICAL(&ringMux);
+  return n;
+}
+
+void dumpToSerial() {
+  // Copy out first so we don't hold the lock while printing
+  PageRecord records[RING_SIZE];
+  const size_t n = snapshot(records, RING_SIZE);
+
+  logSerial.printf("PROFILE_START:%u\n", static_cast<unsigned>(n));
+  logSerial.print("PROFILE_STAGES:");
+  for (uint8_t s = 0; s < STAGE_COUNT; s++) {
+    logSerial.printf(s == 0 ? "%s" : ",%s", STAGE_NAMES[s]);
+  }
+  logSerial.print("\nPROFILE_COUNTERS:");
+  for (uint8_t c = 0; c < COUNTER_COUNT; c++) {
+    logSerial.printf(c == 0 ? "%s" : ",%s", COUNTER_NAMES[c]);
+  }
+  logSerial.print("\n");
+
+  for (size_t i = 0; i < n; i++) {
+    const PageRecord& r = records[i];
+    logSerial.printf("PROFILE:%lu,%u,%u,%lu", static_cast<unsigned long>(r.timestampMs), r.spineIndex, r.pageIndex,
+                     static_cast<unsigned long>(r.totalUs));
+    for (const uint32_t us : r.stageUs) {
+      logSerial.printf(",%lu", static_cast<unsigned long>(us));
+    }
+    for (const uint32_t value : r.counters) {
+      logSerial.printf(",%lu", static_cast<unsigned long>(value));
+    }
+    logSerial.print("\n");
+  }
+  logSerial.print("PROFILE_END\n");
+}
+
+ScopedTimer::ScopedTimer(const Stage stage) : previous(activeStage) {
+  chargeActiveStage(micros());
+  activeStage = stage;
+}
+
+ScopedTimer::~ScopedTimer() {
+  chargeActiveStage(micros());
+  activeStage = previous;
+}
+
+}  // namespace profiler
+
+#endif  // ENABLE_PROFILER
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+Define ENABLE_PROFILER to compile in the page render profiler (see the `profile` env in platformio.ini).
+When it is not defined, every PROFILE_* macro below expands to nothing and no profiler code is linked.
+
+Stage timers are exclusive: entering a nested PROFILE_SCOPE pauses the enclosing stage, so the per-stage totals of a
+page turn add up to (at most) the page total and can be stacked in a chart. Time not covered by any scope is reported
+as "other" by the host tooling.
+
+The last RING_SIZE page turns are kept in a ring buffer and dumped over serial with `CMD:PROFILE`:
+    PROFILE_START:<records>
+    PROFILE_STAGES:<stage names, comma separated>
+    PROFILE_COUNTERS:<counter names, comma separated>
+    PROFILE:<ms>,<spine>,<page>,<total us>,<stage us...>,<counter values...>
+    PROFILE_END
+*/
+
+namespace profiler {
+
+enum Stage : uint8_t {
+  SECTION_LOAD = 0,      // Section::loadSectionFile / createSectionFile
+  PAGE_DESERIALIZE,      // Section::loadPageFromSectionFile
+  TEXT_RASTER,           // BW Page::render
+  IMAGE_DECODE,          // ImageBlock::render (pixel cache read or full decode)
+  GRAYSCALE_PASS,        // LSB/MSB Page::render for anti-aliasing
+  DISPLAY_TRANSFER,      // SPI RAM writes without a refresh (grayscale plane copies)
+  DISPLAY_REFRESH,       // SPI transfer + panel refresh busy-wait inside the driver
+  STAGE_COUNT
+};
+
+enum Counter : uint8_t {
+  GLYPHS = 0,     // glyphs rasterized (all render modes)
+  IMAGES,         // ImageBlock renders
+  PAGE_ELEMENTS,  // elements deserialized from the section file
+  COUNTER_COUNT
+};
+
+struct PageRecord {
+  uint32_t timestampMs;
+  uint16_t spineIndex;
+  uint16_t pageIndex;
+  uint32_t totalUs;
+  uint32_t stageUs[STAGE_COUNT];
+  uint32_t counters[COUNTER_COUNT];
+};
+
+constexpr size_t RING_SIZE = 16;
+
+const char* stageName(Stage stage);
+const char* counterName(Counter counter);
+
+// Start collecting a new page turn. Any unfinished record is discarded.
+void beginPage();
+// Close the current page turn and push it into the ring buffer.
+void endPage(int spineIndex, int pageIndex);
+void count(Counter counter, uint32_t amount = 1);
+
+// Copies up to maxRecords of the most recent records (oldest first) into out. Returns number copied.
+size_t snapshot(PageRecord* out, size_t maxRecords);
+// Writes the ring buffer to the serial port in the format described above.
+void dumpToSerial();
+
+class ScopedTimer {
+  Stage previous;
+
+ public:
+  explicit ScopedTimer(Stage stage);
+  ~ScopedTimer();
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+}  // namespace profiler
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(stage) profiler::ScopedTimer PROFILE_CONCAT(profileScope_, __LINE__)(stage)
+#define PROFILE_COUNT(counter, amount) profiler::count(counter, amount)
+#define PROFILE_PAGE_BEGIN() profiler::beginPage()
+#define PROFILE_PAGE_END(spineIndex, pageIndex) profiler::endPage(spineIndex, pageIndex)
+#else
+#define PROFILE_SCOPE(stage)
+#define PROFILE_COUNT(counter, amount)
+#define PROFILE_PAGE_BEGIN()
+#define PROFILE_PAGE_END(spineIndex, pageIndex)
+#endif
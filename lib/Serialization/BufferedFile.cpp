@@ -0,0 +1,221 @@
+#include "BufferedFile.h"
+
+#include <Logging.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+bool BufferedFile::openForRead(const char* moduleName, const std::string& path) {
+  close();
+  if (!Storage.openFileForRead(moduleName, path, file)) {
+    return false;
+  }
+  onOpened();
+  return true;
+}
+
+bool BufferedFile::openForWrite(const char* moduleName, const std::string& path) {
+  close();
+  if (!Storage.openFileForWrite(moduleName, path, file)) {
+    return false;
+  }
+  onOpened();
+  return true;
+}
+
+void BufferedFile::onOpened() {
+  mode = Mode::Idle;
+  pos = 0;
+  blockStart = 0;
+  blockLen = 0;
+  filePos = 0;
+  if (blockSize > 0) {
+    block = static_cast<uint8_t*>(malloc(blockSize));
+    if (!block) {
+      LOG_ERR("BUF", "No memory for %zu byte block, falling back to unbuffered I/O", blockSize);
+    }
+  }
+}
+
+void BufferedFile::close() {
+  if (file) {
+    flush();
+    file.close();
+  }
+  free(block);
+  block = nullptr;
+  mode = Mode::Idle;
+  blockLen = 0;
+}
+
+bool BufferedFile::seekFile(const uint32_t position) {
+  if (filePos == position) {
+    return true;
+  }
+  if (!file.seek(position)) {
+    return false;
+  }
+  filePos = position;
+  return true;
+}
+
+bool BufferedFile::fillBlock(const uint32_t position) {
+  const uint32_t start = position - position % blockSize;
+  mode = Mode::Idle;
+  blockLen = 0;
+  if (!seekFile(start)) {
+    return false;
+  }
+  const int n = file.read(block, blockSize);
+  if (n <= 0) {
+    return false;
+  }
+  filePos = start + n;
+  mode = Mode::Reading;
+  blockStart = start;
+  blockLen = n;
+  return position < blockStart + blockLen;
+}
+
+int BufferedFile::read(void* buf, const size_t count) {
+  if (!file) {
+    return -1;
+  }
+  if (!block) {
+    seekFile(pos);
+    const int n = file.read(buf, count);
+    if (n > 0) {
+      pos += n;
+      filePos = pos;
+    }
+    return n;
+  }
+  if (mode == Mode::Writing) {
+    flush();
+  }
+
+  auto* out = static_cast<uint8_t*>(buf);
+  size_t done = 0;
+  while (done < count) {
+    if (mode == Mode::Reading && pos >= blockStart && pos < blockStart + blockLen) {
+      const size_t n = std::min<size_t>(count - done, blockStart + blockLen - pos);
+      memcpy(out + done, block + (pos - blockStart), n);
+      pos += n;
+      done += n;
+      continue;
+    }
+
+    const size_t remaining = count - done;
+    if (remaining >= blockSize) {
+      // Large request: read it directly instead of copying through the block
+      if (!seekFile(pos)) {
+        break;
+      }
+      const int n = file.read(out + done, remaining);
+      if (n <= 0) {
+        break;
+      }
+      pos += n;
+      filePos = pos;
+      done += n;
+      if (static_cast<size_t>(n) < remaining) {
+        break;
+      }
+      continue;
+    }
+
+    if (!fillBlock(pos)) {
+      break;
+    }
+  }
+  return static_cast<int>(done);
+}
+
+int BufferedFile::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+size_t BufferedFile::write(const void* buf, const size_t count) {
+  if (!file) {
+    return 0;
+  }
+  if (!block) {
+    seekFile(pos);
+    const size_t n = file.write(static_cast<const uint8_t*>(buf), count);
+    pos += n;
+    filePos = pos;
+    return n;
+  }
+  if (mode == Mode::Reading) {
+    mode = Mode::Idle;
+    blockLen = 0;
+  }
+
+  const auto* in = static_cast<const uint8_t*>(buf);
+  size_t done = 0;
+  while (done < count) {
+    if (mode != Mode::Writing) {
+      mode = Mode::Writing;
+      blockStart = pos;
+      blockLen = 0;
+    }
+    // Only fill up to the next block boundary so every flush after the first lands sector aligned
+    const uint32_t blockEnd = blockStart - blockStart % blockSize + blockSize;
+    const size_t n = std::min<size_t>(count - done, blockEnd - pos);
+    memcpy(block + blockLen, in + done, n);
+    blockLen += n;
+    pos += n;
+    done += n;
+    if (pos == blockEnd && !flush()) {
+      break;
+    }
+  }
+  return done;
+}
+
+bool BufferedFile::flush() {
+  if (mode != Mode::Writing) {
+    return true;
+  }
+  mode = Mode::Idle;
+  if (blockLen == 0) {
+    return true;
+  }
+  const size_t pending = blockLen;
+  blockLen = 0;
+  if (!seekFile(blockStart)) {
+    return false;
+  }
+  const size_t n = file.write(block, pending);
+  filePos = blockStart + n;
+  if (n != pending) {
+    LOG_ERR("BUF", "Short write: %zu of %zu bytes at %lu", n, pending, static_cast<unsigned long>(blockStart));
+    return false;
+  }
+  return true;
+}
+
+bool BufferedFile::seek(const uint32_t position) {
+  if (!file) {
+    return false;
+  }
+  if (!block) {
+    if (!file.seek(position)) {
+      return false;
+    }
+    pos = filePos = position;
+    return true;
+  }
+  if (mode == Mode::Writing && !flush()) {
+    return false;
+  }
+  pos = position;
+  return true;
+}
+
+uint32_t BufferedFile::size() {
+  flush();
+  return file.size();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <HalStorage.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifndef BUFFERED_FILE_BLOCK_SIZE
+#define BUFFERED_FILE_BLOCK_SIZE 512  // One SD sector
+#endif
+
+/*
+FsFile wrapper for the cache files (sections, book.bin, CSS rules) that are written and read one field at a time.
+Small reads and writes are batched into a block aligned to BLOCK_SIZE file offsets, so serializing a page costs one
+SD transaction per sector instead of one per field.
+
+- read() fills the whole aligned block around the current position; requests of a block or more go straight through.
+- write() collects bytes up to the next block boundary and hands them to the file when the boundary is reached, on
+  flush(), on seek() and on close(). Until then they are NOT on the card.
+- position() and seek() are logical. Seeking inside the block that was just read costs nothing.
+- The block is allocated when the file is opened. If that fails, or blockSize is 0, every call goes straight to FsFile
+  exactly as before. Building with -DBUFFERED_FILE_BLOCK_SIZE=0 does that for every cache file (the host benchmark
+  uses it as its baseline).
+*/
+class BufferedFile {
+ public:
+  static constexpr size_t BLOCK_SIZE = BUFFERED_FILE_BLOCK_SIZE;
+
+  explicit BufferedFile(size_t blockSize = BLOCK_SIZE) : blockSize(blockSize) {}
+  ~BufferedFile() { close(); }
+  BufferedFile(const BufferedFile&) = delete;
+  BufferedFile& operator=(const BufferedFile&) = delete;
+
+  bool openForRead(const char* moduleName, const std::string& path);
+  bool openForWrite(const char* moduleName, const std::string& path);
+  // Flushes pending writes before closing
+  void close();
+
+  explicit operator bool() const { return static_cast<bool>(file); }
+
+  // Same contract as FsFile: number of bytes read, -1 if the file isn't open
+  int read(void* buf, size_t count);
+  // Single byte, -1 at end of file
+  int read();
+  size_t write(const void* buf, size_t count);
+  size_t write(const uint8_t b) { return write(&b, 1); }
+
+  bool seek(uint32_t position);
+  uint32_t position() const { return pos; }
+  uint32_t size();
+  int available() { return static_cast<int>(size() - pos); }
+
+  // Push pending writes to the file. Returns false if the file accepted fewer bytes than were pending.
+  bool flush();
+
+ private:
+  enum class Mode : uint8_t { Idle, Reading, Writing };
+
+  FsFile file;
+  const size_t blockSize;
+  uint8_t* block = nullptr;
+  Mode mode = Mode::Idle;
+  uint32_t pos = 0;         // Logical position seen by callers
+  uint32_t blockStart = 0;  // File offset of block[0]
+  size_t blockLen = 0;      // Valid bytes when reading, pending bytes when writing
+  uint32_t filePos = 0;     // Where the underlying file's cursor is, to skip redundant seeks
+
+  void onOpened();
+  bool seekFile(uint32_t position);
+  // Load the aligned block containing `position`; false at end of file
+  bool fillBlock(uint32_t position);
+};
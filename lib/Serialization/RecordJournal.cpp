@@ -0,0 +1,182 @@
+#include "RecordJournal.h"
+
+#include <HalStorage.h>
+#include <Logging.h>
+
+#include <cstring>
+
+namespace {
+constexpr uint16_t RECORD_MAGIC = 0x4A52;  // "RJ"
+constexpr size_t HEADER_SIZE = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint16_t);
+constexpr size_t CRC_SIZE = sizeof(uint32_t);
+
+// CRC-32 (IEEE 802.3, reflected); records are small enough that a table isn't worth its 1KB
+uint32_t crc32(uint32_t crc, const uint8_t* data, const size_t size) {
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+}  // namespace
+
+bool RecordJournal::scan(std::string* newest) {
+  scanned = true;
+  restartActive = false;
+  bool found = false;
+  uint32_t newestSequence = 0;
+  int newestFile = 0;
+  uint32_t intactEnd[2] = {0, 0};
+  bool torn[2] = {false, false};
+
+  std::string payload;
+  for (int i = 0; i < 2; i++) {
+    FsFile file;
+    if (!Storage.openFileForRead("JNL", filePath(i), file)) {
+      continue;
+    }
+    const uint32_t fileSize = file.size();
+    uint32_t pos = 0;
+    while (pos + HEADER_SIZE + CRC_SIZE <= fileSize) {
+      uint8_t header[HEADER_SIZE];
+      uint16_t magic;
+      uint32_t recordSequence;
+      uint16_t length;
+      if (file.read(header, HEADER_SIZE) != static_cast<int>(HEADER_SIZE)) {
+        break;
+      }
+      memcpy(&magic, header, sizeof(magic));
+      memcpy(&recordSequence, header + 2, sizeof(recordSequence));
+      memcpy(&length, header + 6, sizeof(length));
+      if (magic != RECORD_MAGIC || length > MAX_PAYLOAD || pos + HEADER_SIZE + length + CRC_SIZE > fileSize) {
+        break;
+      }
+      payload.resize(length);
+      uint32_t storedCrc;
+      if (file.read(&payload[0], length) != length ||
+          file.read(&storedCrc, CRC_SIZE) != static_cast<int>(CRC_SIZE)) {
+        break;
+      }
+      const uint32_t crc = crc32(crc32(0, header + 2, HEADER_SIZE - 2),
+                                 reinterpret_cast<const uint8_t*>(payload.data()), length);
+      if (crc != storedCrc) {
+        break;
+      }
+
+      pos += HEADER_SIZE + length + CRC_SIZE;
+      if (!found || recordSequence > newestSequence) {
+        found = true;
+        newestSequence = recordSequence;
+        newestFile = i;
+        if (newest) {
+          newest->swap(payload);
+        }
+      }
+    }
+    intactEnd[i] = pos;
+    torn[i] = pos < fileSize;
+    file.close();
+  }
+
+  if (!found) {
+    // Next save truncates file 0, whatever is in it
+    sequence = 0;
+    activeFile = 0;
+    activeSize = 0;
+    restartActive = true;
+    return false;
+  }
+  sequence = newestSequence;
+  activeFile = newestFile;
+  activeSize = torn[newestFile] ? MAX_FILE_SIZE : intactEnd[newestFile];
+  if (torn[newestFile]) {
+    LOG_DBG("JNL", "%s has a torn record after byte %lu", filePath(newestFile).c_str(),
+            static_cast<unsigned long>(intactEnd[newestFile]));
+  }
+  return true;
+}
+
+bool RecordJournal::load(std::string& payload) {
+  if (scan(&payload)) {
+    return true;
+  }
+  if (legacyPath.empty()) {
+    return false;
+  }
+
+  FsFile file;
+  if (!Storage.openFileForRead("JNL", legacyPath, file)) {
+    return false;
+  }
+  const uint32_t size = file.size();
+  if (size > MAX_PAYLOAD) {
+    file.close();
+    return false;
+  }
+  payload.resize(size);
+  const bool ok = size == 0 || file.read(&payload[0], size) == static_cast<int>(size);
+  file.close();
+  return ok;
+}
+
+bool RecordJournal::append(const std::string& payload) {
+  if (payload.size() > MAX_PAYLOAD) {
+    LOG_ERR("JNL", "Record of %zu bytes too large for %s", payload.size(), basePath.c_str());
+    return false;
+  }
+  if (!scanned) {
+    scan(nullptr);
+  }
+
+  const auto length = static_cast<uint16_t>(payload.size());
+  const uint32_t recordSequence = sequence + 1;
+  std::string record(HEADER_SIZE + length + CRC_SIZE, '\0');
+  auto* bytes = reinterpret_cast<uint8_t*>(&record[0]);
+  memcpy(bytes, &RECORD_MAGIC, sizeof(RECORD_MAGIC));
+  memcpy(bytes + 2, &recordSequence, sizeof(recordSequence));
+  memcpy(bytes + 6, &length, sizeof(length));
+  memcpy(bytes + HEADER_SIZE, payload.data(), length);
+  const uint32_t crc = crc32(0, bytes + 2, HEADER_SIZE - 2 + length);
+  memcpy(bytes + HEADER_SIZE + length, &crc, sizeof(crc));
+
+  // Past the size limit, start over in the other file: its newest record is older than anything in the current one
+  FsFile file;
+  const bool rotate = !restartActive && activeSize > 0 && activeSize + record.size() > MAX_FILE_SIZE;
+  const int target = rotate ? activeFile ^ 1 : activeFile;
+  const bool restart = rotate || restartActive;
+  const bool opened = restart ? Storage.openFileForWrite("JNL", filePath(target), file)
+                              : Storage.openFileForAppend("JNL", filePath(target), file);
+  if (!opened) {
+    return false;
+  }
+  if (restart) {
+    activeFile = target;
+    activeSize = 0;
+  }
+  const size_t written = file.write(bytes, record.size());
+  file.close();
+  if (written != record.size()) {
+    LOG_ERR("JNL", "Short write to %s: %zu of %zu bytes", filePath(activeFile).c_str(), written, record.size());
+    if (restart) {
+      // Nothing intact in it: keep the other file, which holds the newest record, and retry here
+      restartActive = true;
+    } else {
+      activeSize = MAX_FILE_SIZE;  // The tail may be torn after the newest record: never append after it
+    }
+    return false;
+  }
+  activeSize += record.size();
+  restartActive = false;
+  sequence = recordSequence;
+
+  if (!legacyPath.empty()) {
+    if (Storage.exists(legacyPath.c_str())) {
+      Storage.remove(legacyPath.c_str());
+    }
+    legacyPath.clear();
+  }
+  return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+/*
+Append-only store for small state that is saved often (reading position, app state, recent books). A save appends one
+record instead of truncating and rewriting the file, and load() returns the newest record whose CRC checks out, so a
+write cut short by power loss costs that one save and never the state before it.
+
+Record: uint16 magic, uint32 sequence, uint16 payload length, payload, uint32 CRC-32 of sequence, length and payload.
+
+Two files, <base>.0.jnl and <base>.1.jnl, take turns. Records are appended to one until it reaches MAX_FILE_SIZE; the
+next save truncates the other and starts over there. The newest record of the full file stays on the card until the
+new file holds a complete one, so something is always recoverable. A file whose tail is torn after its intact records
+is never appended to again: the next save moves to the other file. A file just started over that fails its first write
+holds nothing worth keeping, so the next save starts it over again rather than truncating the other one.
+
+legacyPath, if given, is the single file the state lived in before: while the journal holds no record, load() returns
+its whole content, and the first save removes it.
+*/
+class RecordJournal {
+ public:
+  static constexpr size_t MAX_FILE_SIZE = 16 * 1024;
+  static constexpr uint16_t MAX_PAYLOAD = 8 * 1024;
+
+  explicit RecordJournal(std::string basePath, std::string legacyPath = "")
+      : basePath(std::move(basePath)), legacyPath(std::move(legacyPath)) {}
+
+  // Newest intact payload. False if there is none (and no legacy file).
+  bool load(std::string& payload);
+  bool append(const std::string& payload);
+
+  std::string filePath(int index) const { return basePath + "." + std::to_string(index) + ".jnl"; }
+
+ private:
+  std::string basePath;
+  std::string legacyPath;
+  bool scanned = false;
+  uint32_t sequence = 0;       // Of the newest record on the card
+  int activeFile = 0;          // File the next record goes to
+  uint32_t activeSize = 0;     // Bytes of intact records in it; MAX_FILE_SIZE forces a switch
+  bool restartActive = false;  // Its first write failed: the next record truncates it and starts over
+
+  // Read both files, leaving the newest payload in `newest` (if any) and the append position in the members
+  bool scan(std::string* newest);
+};
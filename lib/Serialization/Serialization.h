@@ -3,47 +3,72 @@
 
 #include <iostream>
 
+#include "BufferedFile.h"
+
 namespace serialization {
 template <typename T>
-static void writePod(std::ostream& os, const T& value) {
+inline void writePod(std::ostream& os, const T& value) {
   os.write(reinterpret_cast<const char*>(&value), sizeof(T));
 }
 
 template <typename T>
-static void writePod(FsFile& file, const T& value) {
+inline void writePod(FsFile& file, const T& value) {
   file.write(reinterpret_cast<const uint8_t*>(&value), sizeof(T));
 }
 
 template <typename T>
-static void readPod(std::istream& is, T& value) {
+inline void writePod(BufferedFile& file, const T& value) {
+  file.write(&value, sizeof(T));
+}
+
+template <typename T>
+inline void readPod(std::istream& is, T& value) {
   is.read(reinterpret_cast<char*>(&value), sizeof(T));
 }
 
 template <typename T>
-static void readPod(FsFile& file, T& value) {
+inline void readPod(FsFile& file, T& value) {
   file.read(reinterpret_cast<uint8_t*>(&value), sizeof(T));
 }
 
-static void writeString(std::ostream& os, const std::string& s) {
+template <typename T>
+inline void readPod(BufferedFile& file, T& value) {
+  file.read(&value, sizeof(T));
+}
+
+inline void writeString(std::ostream& os, const std::string& s) {
   const uint32_t len = s.size();
   writePod(os, len);
   os.write(s.data(), len);
 }
 
-static void writeString(FsFile& file, const std::string& s) {
+inline void writeString(FsFile& file, const std::string& s) {
   const uint32_t len = s.size();
   writePod(file, len);
   file.write(reinterpret_cast<const uint8_t*>(s.data()), len);
 }
 
-static void readString(std::istream& is, std::string& s) {
+inline void writeString(BufferedFile& file, const std::string& s) {
+  const uint32_t len = s.size();
+  writePod(file, len);
+  file.write(s.data(), len);
+}
+
+inline void readString(std::istream& is, std::string& s) {
   uint32_t len;
   readPod(is, len);
   s.resize(len);
   is.read(&s[0], len);
 }
 
-static void readString(FsFile& file, std::string& s) {
+inline void readString(FsFile& file, std::string& s) {
+  uint32_t len;
+  readPod(file, len);
+  s.resize(len);
+  file.read(&s[0], len);
+}
+
+inline void readString(BufferedFile& file, std::string& s) {
   uint32_t len;
   readPod(file, len);
   s.resize(len);
@@ -1,5 +1,6 @@
 #include "ZipFile.h"
 
+#include <AllocTracker.h>
 #include <HalStorage.h>
 #include <Logging.h>
 #include <miniz.h>
@@ -9,6 +10,7 @@
 static bool inflateOneShot(const uint8_t* inputBuf, const size_t deflatedSize, uint8_t* outputBuf,
                            const size_t inflatedSize) {
   const auto inflator = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+  ALLOC_TRACK(alloctracker::ZIP, sizeof(tinfl_decompressor), inflator != nullptr);
   if (!inflator) {
     LOG_ERR("ZIP", "Failed to allocate memory for inflator");
     return false;
@@ -234,6 +236,7 @@ bool ZipFile::loadZipDetails() {
   // 0x06054b50 is stored as 0x50, 0x4b, 0x05, 0x06 in little-endian
   const int scanRange = fileSize > 1024 ? 1024 : fileSize;
   const auto buffer = static_cast<uint8_t*>(malloc(scanRange));
+  ALLOC_TRACK(alloctracker::ZIP, scanRange, buffer != nullptr);
   if (!buffer) {
     LOG_ERR("ZIP", "Failed to allocate memory for EOCD scan buffer");
     if (!wasOpen) {
@@ -407,6 +410,7 @@ uint8_t* ZipFile::readFileToMemory(const char* filename, size_t* size, const boo
   const auto inflatedDataSize = fileStat.uncompressedSize;
   const auto dataSize = trailingNullByte ? inflatedDataSize + 1 : inflatedDataSize;
   const auto data = static_cast<uint8_t*>(malloc(dataSize));
+  ALLOC_TRACK(alloctracker::ZIP, dataSize, data != nullptr);
   if (data == nullptr) {
     LOG_ERR("ZIP", "Failed to allocate memory for output buffer (%zu bytes)", dataSize);
     if (!wasOpen) {
@@ -432,6 +436,7 @@ uint8_t* ZipFile::readFileToMemory(const char* filename, size_t* size, const boo
   } else if (fileStat.method == MZ_DEFLATED) {
     // Read out deflated content from file
     const auto deflatedData = static_cast<uint8_t*>(malloc(deflatedDataSize));
+    ALLOC_TRACK(alloctracker::ZIP, deflatedDataSize, deflatedData != nullptr);
     if (deflatedData == nullptr) {
       LOG_ERR("ZIP", "Failed to allocate memory for decompression buffer");
       if (!wasOpen) {
@@ -498,6 +503,7 @@ bool ZipFile::readFileToStream(const char* filename, Print& out, const size_t ch
   if (fileStat.method == MZ_NO_COMPRESSION) {
     // no deflation, just read content
     const auto buffer = static_cast<uint8_t*>(malloc(chunkSize));
+    ALLOC_TRACK(alloctracker::ZIP, chunkSize, buffer != nullptr);
     if (!buffer) {
       LOG_ERR("ZIP", "Failed to allocate memory for buffer");
       if (!wasOpen) {
@@ -531,6 +537,7 @@ bool ZipFile::readFileToStream(const char* filename, Print& out, const size_t ch
 
   if (fileStat.method == MZ_DEFLATED) {
     auto* inflator = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+    ALLOC_TRACK(alloctracker::ZIP, sizeof(tinfl_decompressor), inflator != nullptr);
     if (!inflator) {
       LOG_ERR("ZIP", "Failed to allocate memory for inflator");
       if (!wasOpen) {
@@ -543,6 +550,7 @@ bool ZipFile::readFileToStream(const char* filename, Print& out, const size_t ch
 
     // Setup file read buffer
     const auto fileReadBuffer = static_cast<uint8_t*>(malloc(chunkSize));
+    ALLOC_TRACK(alloctracker::ZIP, chunkSize, fileReadBuffer != nullptr);
     if (!fileReadBuffer) {
       LOG_ERR("ZIP", "Failed to allocate memory for zip file read buffer");
       free(inflator);
@@ -553,6 +561,7 @@ bool ZipFile::readFileToStream(const char* filename, Print& out, const size_t ch
     }
 
     const auto outputBuffer = static_cast<uint8_t*>(malloc(TINFL_LZ_DICT_SIZE));
+    ALLOC_TRACK(alloctracker::ZIP, TINFL_LZ_DICT_SIZE, outputBuffer != nullptr);
     if (!outputBuffer) {
       LOG_ERR("ZIP", "Failed to allocate memory for dictionary");
       free(inflator);
@@ -1,5 +1,9 @@
 #include <HalDisplay.h>
 #include <HalGPIO.h>
+#include <Logging.h>
+#include <Profiler.h>
+
+#include <cstring>
 
 #define SD_SPI_MISO 7
 
@@ -7,17 +11,66 @@ HalDisplay::HalDisplay() : einkDisplay(EPD_SCLK, EPD_MOSI, EPD_CS, EPD_DC, EPD_R
 
 HalDisplay::~HalDisplay() {}
 
-void HalDisplay::begin() { einkDisplay.begin(); }
+void HalDisplay::begin() {
+  einkDisplay.begin();
+
+#ifdef HAL_DISPLAY_ASYNC
+  // Allocate at boot while the heap is still in one piece; 48KB contiguous is hard to find later
+  backBuffer = static_cast<uint8_t*>(malloc(BUFFER_SIZE));
+  idleSemaphore = xSemaphoreCreateBinary();
+  if (backBuffer && idleSemaphore) {
+    xSemaphoreGive(idleSemaphore);
+    xTaskCreate(&displayTaskTrampoline, "DisplayTask",
+                4096,               // Stack size
+                this,               // Parameters
+                1,                  // Priority
+                &displayTaskHandle  // Task handle
+    );
+  }
+  if (!displayTaskHandle) {
+    LOG_ERR("DISP", "Async display unavailable (heap %lu), refreshing synchronously",
+            static_cast<unsigned long>(ESP.getMaxAllocHeap()));
+    free(backBuffer);
+    backBuffer = nullptr;
+    if (idleSemaphore) {
+      vSemaphoreDelete(idleSemaphore);
+      idleSemaphore = nullptr;
+    }
+    return;
+  }
+  memcpy(backBuffer, einkDisplay.getFrameBuffer(), BUFFER_SIZE);
+#endif
+}
 
-void HalDisplay::clearScreen(uint8_t color) const { einkDisplay.clearScreen(color); }
+void HalDisplay::clearScreen(uint8_t color) const {
+#ifdef HAL_DISPLAY_ASYNC
+  if (backBuffer) {
+    memset(backBuffer, color, BUFFER_SIZE);
+    return;
+  }
+#endif
+  einkDisplay.clearScreen(color);
+}
 
 void HalDisplay::drawImage(const uint8_t* imageData, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
                            bool fromProgmem) const {
+#ifdef HAL_DISPLAY_ASYNC
+  if (backBuffer) {
+    blit(imageData, x, y, w, h, false);
+    return;
+  }
+#endif
   einkDisplay.drawImage(imageData, x, y, w, h, fromProgmem);
 }
 
 void HalDisplay::drawImageTransparent(const uint8_t* imageData, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
                                       bool fromProgmem) const {
+#ifdef HAL_DISPLAY_ASYNC
+  if (backBuffer) {
+    blit(imageData, x, y, w, h, true);
+    return;
+  }
+#endif
   einkDisplay.drawImageTransparent(imageData, x, y, w, h, fromProgmem);
 }
 
@@ -33,28 +86,158 @@ EInkDisplay::RefreshMode convertRefreshMode(HalDisplay::RefreshMode mode) {
   }
 }
 
+// In async mode the profiler scopes below measure how long the caller was held up (waiting for the previous
+// refresh plus the back -> front copy), which is the part that still adds to page-turn latency.
+
 void HalDisplay::displayBuffer(HalDisplay::RefreshMode mode, bool turnOffScreen) {
+  PROFILE_SCOPE(profiler::DISPLAY_REFRESH);
+#ifdef HAL_DISPLAY_ASYNC
+  if (backBuffer) {
+    submit({JobKind::Bw, mode, turnOffScreen}, backBuffer);
+    return;
+  }
+#endif
   einkDisplay.displayBuffer(convertRefreshMode(mode), turnOffScreen);
 }
 
-void HalDisplay::displayHighlightBuffer(bool turnOffScreen) { einkDisplay.displayHighlightBuffer(turnOffScreen); }
+void HalDisplay::displayHighlightBuffer(bool turnOffScreen) {
+  PROFILE_SCOPE(profiler::DISPLAY_REFRESH);
+#ifdef HAL_DISPLAY_ASYNC
+  if (backBuffer) {
+    submit({JobKind::Highlight, FAST_REFRESH, turnOffScreen}, backBuffer);
+    return;
+  }
+#endif
+  einkDisplay.displayHighlightBuffer(turnOffScreen);
+}
 
 void HalDisplay::refreshDisplay(HalDisplay::RefreshMode mode, bool turnOffScreen) {
+  waitUntilIdle();
   einkDisplay.refreshDisplay(convertRefreshMode(mode), turnOffScreen);
 }
 
-void HalDisplay::deepSleep() { einkDisplay.deepSleep(); }
+void HalDisplay::deepSleep() {
+  waitUntilIdle();
+  einkDisplay.deepSleep();
+}
 
-uint8_t* HalDisplay::getFrameBuffer() const { return einkDisplay.getFrameBuffer(); }
+uint8_t* HalDisplay::getFrameBuffer() const {
+#ifdef HAL_DISPLAY_ASYNC
+  if (backBuffer) {
+    return backBuffer;
+  }
+#endif
+  return einkDisplay.getFrameBuffer();
+}
 
 void HalDisplay::copyGrayscaleBuffers(const uint8_t* lsbBuffer, const uint8_t* msbBuffer) {
+  PROFILE_SCOPE(profiler::DISPLAY_TRANSFER);
+  waitUntilIdle();
   einkDisplay.copyGrayscaleBuffers(lsbBuffer, msbBuffer);
 }
 
-void HalDisplay::copyGrayscaleLsbBuffers(const uint8_t* lsbBuffer) { einkDisplay.copyGrayscaleLsbBuffers(lsbBuffer); }
+void HalDisplay::copyGrayscaleLsbBuffers(const uint8_t* lsbBuffer) {
+  PROFILE_SCOPE(profiler::DISPLAY_TRANSFER);
+  waitUntilIdle();
+  einkDisplay.copyGrayscaleLsbBuffers(lsbBuffer);
+}
+
+void HalDisplay::copyGrayscaleMsbBuffers(const uint8_t* msbBuffer) {
+  PROFILE_SCOPE(profiler::DISPLAY_TRANSFER);
+  waitUntilIdle();
+  einkDisplay.copyGrayscaleMsbBuffers(msbBuffer);
+}
+
+void HalDisplay::cleanupGrayscaleBuffers(const uint8_t* bwBuffer) {
+#ifdef HAL_DISPLAY_ASYNC
+  if (backBuffer) {
+    submit({JobKind::Cleanup, FAST_REFRESH, false}, bwBuffer);
+    return;
+  }
+#endif
+  einkDisplay.cleanupGrayscaleBuffers(bwBuffer);
+}
+
+void HalDisplay::displayGrayBuffer(bool turnOffScreen) {
+  PROFILE_SCOPE(profiler::DISPLAY_REFRESH);
+#ifdef HAL_DISPLAY_ASYNC
+  if (backBuffer) {
+    // The grayscale planes are already in panel RAM, nothing to copy
+    submit({JobKind::Gray, FAST_REFRESH, turnOffScreen}, nullptr);
+    return;
+  }
+#endif
+  einkDisplay.displayGrayBuffer(turnOffScreen);
+}
+
+void HalDisplay::waitUntilIdle() const {
+#ifdef HAL_DISPLAY_ASYNC
+  if (idleSemaphore) {
+    xSemaphoreTake(idleSemaphore, portMAX_DELAY);
+    xSemaphoreGive(idleSemaphore);
+  }
+#endif
+}
+
+bool HalDisplay::isBusy() const {
+#ifdef HAL_DISPLAY_ASYNC
+  return idleSemaphore && uxSemaphoreGetCount(idleSemaphore) == 0;
+#else
+  return false;
+#endif
+}
+
+#ifdef HAL_DISPLAY_ASYNC
+void HalDisplay::submit(const Job& job, const uint8_t* source) {
+  // Only one job in flight: the front buffer and panel RAM stay untouched until the previous refresh is done
+  xSemaphoreTake(idleSemaphore, portMAX_DELAY);
+  if (source) {
+    memcpy(einkDisplay.getFrameBuffer(), source, BUFFER_SIZE);
+  }
+  pendingJob = job;
+  xTaskNotifyGive(displayTaskHandle);
+}
 
-void HalDisplay::copyGrayscaleMsbBuffers(const uint8_t* msbBuffer) { einkDisplay.copyGrayscaleMsbBuffers(msbBuffer); }
+void HalDisplay::displayTaskTrampoline(void* param) {
+  auto* self = static_cast<HalDisplay*>(param);
+  self->displayTaskLoop();
+}
+
+void HalDisplay::displayTaskLoop() {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    runJob(pendingJob);
+    xSemaphoreGive(idleSemaphore);
+  }
+}
 
-void HalDisplay::cleanupGrayscaleBuffers(const uint8_t* bwBuffer) { einkDisplay.cleanupGrayscaleBuffers(bwBuffer); }
+void HalDisplay::runJob(const Job& job) {
+  switch (job.kind) {
+    case JobKind::Bw:
+      einkDisplay.displayBuffer(convertRefreshMode(job.mode), job.turnOffScreen);
+      break;
+    case JobKind::Highlight:
+      einkDisplay.displayHighlightBuffer(job.turnOffScreen);
+      break;
+    case JobKind::Gray:
+      einkDisplay.displayGrayBuffer(job.turnOffScreen);
+      break;
+    case JobKind::Cleanup:
+      einkDisplay.cleanupGrayscaleBuffers(einkDisplay.getFrameBuffer());
+      break;
+  }
+}
 
-void HalDisplay::displayGrayBuffer(bool turnOffScreen) { einkDisplay.displayGrayBuffer(turnOffScreen); }
+void HalDisplay::blit(const uint8_t* imageData, const uint16_t x, const uint16_t y, const uint16_t w, const uint16_t h,
+                      const bool transparent) const {
+  // Same layout as EInkDisplay::drawImage: x is byte aligned, rows are w / 8 bytes, clipped to the panel
+  const uint16_t widthBytes = w / 8;
+  for (uint16_t row = 0; row < h && y + row < DISPLAY_HEIGHT; row++) {
+    uint8_t* dst = backBuffer + (y + row) * DISPLAY_WIDTH_BYTES + x / 8;
+    const uint8_t* src = imageData + row * widthBytes;
+    for (uint16_t col = 0; col < widthBytes && x / 8 + col < DISPLAY_WIDTH_BYTES; col++) {
+      dst[col] = transparent ? (dst[col] & src[col]) : src[col];
+    }
+  }
+}
+#endif
@@ -2,6 +2,21 @@
 #include <Arduino.h>
 #include <EInkDisplay.h>
 
+#ifdef HAL_DISPLAY_ASYNC
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+/*
+With HAL_DISPLAY_ASYNC defined, the renderer draws into a back buffer owned by HalDisplay while the SDK's own frame
+buffer acts as the front buffer being sent to the panel. displayBuffer() and friends copy back -> front, hand the
+refresh to a display task and return, so the caller can draw the next frame or touch the SD card while the panel
+is busy. Any call that needs the panel (or the front buffer) first waits for the previous refresh to finish.
+Without the flag (or when the back buffer can't be allocated) every call is synchronous, as before. The back buffer
+costs 48KB of heap for the whole session, so only the async_display env turns it on.
+*/
+
 class HalDisplay {
  public:
   // Constructor with pin configuration
@@ -50,6 +65,32 @@ class HalDisplay {
 
   void displayGrayBuffer(bool turnOffScreen = false);
 
+  // Block until the panel has finished the last queued refresh. No-op in synchronous mode.
+  void waitUntilIdle() const;
+  // True while a queued refresh is still running on the panel
+  bool isBusy() const;
+
  private:
   EInkDisplay einkDisplay;
+
+#ifdef HAL_DISPLAY_ASYNC
+  enum class JobKind : uint8_t { Bw, Highlight, Gray, Cleanup };
+  struct Job {
+    JobKind kind;
+    RefreshMode mode;
+    bool turnOffScreen;
+  };
+
+  uint8_t* backBuffer = nullptr;  // nullptr => synchronous fallback
+  Job pendingJob = {};
+  TaskHandle_t displayTaskHandle = nullptr;
+  SemaphoreHandle_t idleSemaphore = nullptr;  // Taken while a job is queued or running
+
+  [[noreturn]] static void displayTaskTrampoline(void* param);
+  [[noreturn]] void displayTaskLoop();
+  void runJob(const Job& job);
+  // Waits for the panel, copies `source` (if any) into the front buffer and hands `job` to the display task
+  void submit(const Job& job, const uint8_t* source);
+  void blit(const uint8_t* imageData, uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool transparent) const;
+#endif
 };
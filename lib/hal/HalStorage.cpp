@@ -1,5 +1,6 @@
 #include "HalStorage.h"
 
+#include <Logging.h>
 #include <SDCardManager.h>
 
 #define SDCard SDCardManager::getInstance()
@@ -62,4 +63,13 @@ bool HalStorage::openFileForWrite(const char* moduleName, const String& path, Fs
   return openFileForWrite(moduleName, path.c_str(), file);
 }
 
+bool HalStorage::openFileForAppend(const char* moduleName, const std::string& path, FsFile& file) {
+  file = SDCard.open(path.c_str(), O_RDWR | O_CREAT | O_AT_END);
+  if (!file) {
+    LOG_ERR(moduleName, "Failed to open file for append: %s", path.c_str());
+    return false;
+  }
+  return true;
+}
+
 bool HalStorage::removeDir(const char* path) { return SDCard.removeDir(path); }
\ No newline at end of file
@@ -36,6 +36,8 @@ class HalStorage {
   bool openFileForWrite(const char* moduleName, const char* path, FsFile& file);
   bool openFileForWrite(const char* moduleName, const std::string& path, FsFile& file);
   bool openFileForWrite(const char* moduleName, const String& path, FsFile& file);
+  // Open (creating it if needed) with the position at the end, for append-only files
+  bool openFileForAppend(const char* moduleName, const std::string& path, FsFile& file);
   bool removeDir(const char* path);
 
   static HalStorage& getInstance() { return instance; }
@@ -11,6 +11,8 @@ Features:
 - Interactive memory usage graphing with matplotlib
 - Command input interface for sending commands to the ESP32 device
 - Screenshot capture and processing (1-bit black/white format)
+- Page render profile charting (firmware built with -DENABLE_PROFILER, send `PROFILE`)
+- Allocation tracker report (firmware built with -DENABLE_ALLOC_TRACKER, send `ALLOC`)
 - Graceful shutdown handling with Ctrl-C signal processing
 - Configurable filtering and suppression of log messages
 - Thread-safe operation with coordinated shutdown events
@@ -78,8 +80,15 @@ MAX_POINTS = 50
 time_data: deque[str] = deque(maxlen=MAX_POINTS)
 free_mem_data: deque[float] = deque(maxlen=MAX_POINTS)
 total_mem_data: deque[float] = deque(maxlen=MAX_POINTS)
+max_alloc_data: deque[float] = deque(maxlen=MAX_POINTS)
 data_lock: threading.Lock = threading.Lock()  # Prevent reading while writing
 
+# Page render profile (CMD:PROFILE). Each record is a dict with spine, page, total_ms,
+# a "stages" dict of stage name -> ms and a "counters" dict of counter name -> value.
+profile_stage_names: list[str] = []
+profile_counter_names: list[str] = []
+profile_records: list[dict] = []
+
 # Global shutdown flag
 shutdown_event = threading.Event()
 
@@ -172,10 +181,11 @@ def get_color_for_line(line: str) -> str:
     return Fore.WHITE
 
 
-def parse_memory_line(line: str) -> tuple[int | None, int | None]:
+def parse_memory_line(line: str) -> tuple[int | None, int | None, int | None]:
     """
-    Extracts Free and Total bytes from the specific log line.
-    Format: [MEM] Free: 196344 bytes, Total: 226412 bytes, Min Free: 112620 bytes
+    Extracts Free, Total and (if present) Max Alloc bytes from the specific log line.
+    Format: [MEM] Free: 196344 bytes, Total: 226412 bytes, Min Free: 112620 bytes, Max Alloc: 65524 bytes
+    Max Alloc is the largest contiguous free block; older firmware omits it.
     """
     # Regex to find 'Free: <digits>' and 'Total: <digits>'
     match = re.search(r"Free:\s*(\d+).*Total:\s*(\d+)", line)
@@ -183,10 +193,80 @@ def parse_memory_line(line: str) -> tuple[int | None, int | None]:
         try:
             free_bytes = int(match.group(1))
             total_bytes = int(match.group(2))
-            return free_bytes, total_bytes
         except ValueError:
-            return None, None
-    return None, None
+            return None, None, None
+        max_alloc_match = re.search(r"Max Alloc:\s*(\d+)", line)
+        max_alloc = int(max_alloc_match.group(1)) if max_alloc_match else None
+        return free_bytes, total_bytes, max_alloc
+    return None, None, None
+
+
+def print_alloc_line(line: str) -> None:
+    """Pretty-prints one line of a CMD:ALLOC dump."""
+    kind, _, payload = line.partition(":")
+    fields = payload.split(",")
+    if kind == "ALLOC_HEAP" and len(fields) == 3:
+        print(
+            f"{Fore.CYAN}Heap free {int(fields[0]) / 1024:.1f} KB, largest block "
+            f"{int(fields[1]) / 1024:.1f} KB, min free {int(fields[2]) / 1024:.1f} KB{Style.RESET_ALL}"
+        )
+    elif kind == "ALLOC_TAG" and len(fields) == 5:
+        print(
+            f"{Fore.CYAN}  [{fields[0]}] allocs {fields[1]:>6}  bytes {fields[2]:>9}  "
+            f"largest {fields[3]:>7}  failed {fields[4]}{Style.RESET_ALL}"
+        )
+    elif kind == "ALLOC_ACTIVITY" and len(fields) == 8:
+        print(
+            f"{Fore.CYAN}  {fields[0]:<24} visits {fields[1]:>3}  min free {int(fields[2]) / 1024:7.1f} KB  "
+            f"min block {int(fields[3]) / 1024:6.1f} KB  allocs {fields[4]:>6}  bytes {fields[5]:>9}  "
+            f"largest {fields[6]:>7}  failed {fields[7]}{Style.RESET_ALL}"
+        )
+
+
+def parse_profile_record(
+    line: str, stage_names: list[str], counter_names: list[str]
+) -> dict | None:
+    """
+    Parses one ring buffer entry of a CMD:PROFILE dump.
+    Format: PROFILE:<ms>,<spine>,<page>,<total us>,<stage us...>,<counter values...>
+    """
+    try:
+        values = [int(v) for v in line.split(":", 1)[1].split(",")]
+    except ValueError:
+        return None
+    if len(values) != 4 + len(stage_names) + len(counter_names):
+        return None
+    stage_values = values[4 : 4 + len(stage_names)]
+    counter_values = values[4 + len(stage_names) :]
+    return {
+        "timestamp_ms": values[0],
+        "spine": values[1],
+        "page": values[2],
+        "total_ms": values[3] / 1000,
+        "stages": {n: v / 1000 for n, v in zip(stage_names, stage_values)},
+        "counters": dict(zip(counter_names, counter_values)),
+    }
+
+
+def print_profile_summary(records: list[dict]) -> None:
+    """Prints a per-page breakdown table and the mean of each stage."""
+    if not records:
+        print(f"{Fore.YELLOW}Profile buffer is empty{Style.RESET_ALL}")
+        return
+    names = list(records[0]["stages"].keys())
+    header = "spine/page  total " + " ".join(f"{n[:8]:>8}" for n in names) + "    other"
+    print(f"{Fore.BLUE}{header}{Style.RESET_ALL}")
+    for r in records:
+        other = r["total_ms"] - sum(r["stages"].values())
+        cols = " ".join(f"{r['stages'][n]:8.1f}" for n in names)
+        print(
+            f"{Fore.BLUE}{r['spine']:5}/{r['page']:<5}{r['total_ms']:6.0f} {cols} {other:8.1f}{Style.RESET_ALL}"
+        )
+    means = " ".join(
+        f"{sum(r['stages'][n] for r in records) / len(records):8.1f}" for n in names
+    )
+    mean_total = sum(r["total_ms"] for r in records) / len(records)
+    print(f"{Fore.BLUE}{'mean':11}{mean_total:6.0f} {means}{Style.RESET_ALL}")
 
 
 def serial_worker(ser, kwargs: dict[str, str]) -> None:
@@ -216,6 +296,7 @@ def serial_worker(ser, kwargs: dict[str, str]) -> None:
     expecting_screenshot = False
     screenshot_size = 0
     screenshot_data = b""
+    pending_profile: list[dict] | None = None
 
     try:
         while not shutdown_event.is_set():
@@ -259,18 +340,50 @@ def serial_worker(ser, kwargs: dict[str, str]) -> None:
                     elif clean_line == "SCREENSHOT_END":
                         continue  # ignore
 
+                    # Allocation tracker dump
+                    if clean_line.startswith("ALLOC_"):
+                        print_alloc_line(clean_line)
+                        continue
+
+                    # Page render profile dump
+                    if clean_line.startswith("PROFILE_START:"):
+                        pending_profile = []
+                        continue
+                    if pending_profile is not None:
+                        if clean_line.startswith("PROFILE_STAGES:"):
+                            profile_stage_names[:] = clean_line.split(":", 1)[1].split(",")
+                        elif clean_line.startswith("PROFILE_COUNTERS:"):
+                            profile_counter_names[:] = clean_line.split(":", 1)[1].split(",")
+                        elif clean_line.startswith("PROFILE:"):
+                            record = parse_profile_record(
+                                clean_line, profile_stage_names, profile_counter_names
+                            )
+                            if record is not None:
+                                pending_profile.append(record)
+                        elif clean_line == "PROFILE_END":
+                            with data_lock:
+                                profile_records[:] = pending_profile
+                            print_profile_summary(pending_profile)
+                            pending_profile = None
+                        continue
+
                     # Add PC timestamp
                     pc_time = datetime.now().strftime("%H:%M:%S")
                     formatted_line = re.sub(r"^\[\d+\]", f"[{pc_time}]", clean_line)
 
                     # Check for Memory Line
                     if "[MEM]" in formatted_line:
-                        free_val, total_val = parse_memory_line(formatted_line)
+                        free_val, total_val, max_alloc_val = parse_memory_line(
+                            formatted_line
+                        )
                         if free_val is not None and total_val is not None:
                             with data_lock:
                                 time_data.append(pc_time)
                                 free_mem_data.append(free_val / 1024)  # Convert to KB
                                 total_mem_data.append(total_val / 1024)  # Convert to KB
+                                max_alloc_data.append(
+                                    max_alloc_val / 1024 if max_alloc_val is not None else float("nan")
+                                )
                     # Apply filters
                     if filter_keyword and filter_keyword not in formatted_line.lower():
                         continue
@@ -305,9 +418,34 @@ def input_worker(ser) -> None:
             break
 
 
+def draw_profile_chart(ax, records: list[dict]) -> None:
+    """
+    Draws one stacked bar per page turn, split into the profiler stages plus the
+    unaccounted remainder ("other").
+    """
+    ax.cla()
+    labels = [f"{r['spine']}/{r['page']}" for r in records]
+    names = list(records[0]["stages"].keys())
+    bottoms = [0.0] * len(records)
+    for name in names:
+        values = [r["stages"][name] for r in records]
+        ax.bar(labels, values, bottom=bottoms, label=name)
+        bottoms = [b + v for b, v in zip(bottoms, values)]
+    other = [max(0.0, r["total_ms"] - b) for r, b in zip(records, bottoms)]
+    ax.bar(labels, other, bottom=bottoms, label="other", color="lightgray")
+
+    ax.set_title("Page Turn Breakdown (CMD:PROFILE)")
+    ax.set_ylabel("Time (ms)")
+    ax.set_xlabel("Spine/Page")
+    ax.legend(loc="upper left", fontsize="small", ncol=4)
+    ax.grid(True, axis="y", linestyle=":", alpha=0.6)
+    ax.tick_params(axis="x", rotation=45)
+
+
 def update_graph(frame) -> list:  # pylint: disable=unused-argument
     """
-    Called by Matplotlib animation to redraw the memory usage chart.
+    Called by Matplotlib animation to redraw the memory usage chart and,
+    once a profile dump has been received, the page turn breakdown.
     Monitors the global shutdown event and closes the plot when shutdown is requested.
     """
     if shutdown_event.is_set():
@@ -315,33 +453,49 @@ def update_graph(frame) -> list:  # pylint: disable=unused-argument
         return []
 
     with data_lock:
-        if not time_data:
-            return []
-
         # Convert deques to lists for plotting
         x = list(time_data)
         y_free = list(free_mem_data)
         y_total = list(total_mem_data)
+        y_max_alloc = list(max_alloc_data)
+        records = list(profile_records)
+
+    if not x and not records:
+        return []
 
-    plt.cla()  # Clear axis
+    fig = plt.gcf()
+    if records and len(fig.axes) < 2:
+        fig.clf()
+        fig.add_subplot(2, 1, 1)
+        fig.add_subplot(2, 1, 2)
+    mem_ax = fig.axes[0] if fig.axes else fig.add_subplot(1, 1, 1)
+
+    mem_ax.cla()  # Clear axis
 
     # Plot Total RAM
-    plt.plot(x, y_total, label="Total RAM (KB)", color="red", linestyle="--")
+    mem_ax.plot(x, y_total, label="Total RAM (KB)", color="red", linestyle="--")
 
     # Plot Free RAM
-    plt.plot(x, y_free, label="Free RAM (KB)", color="green", marker="o")
+    mem_ax.plot(x, y_free, label="Free RAM (KB)", color="green", marker="o")
 
     # Fill area under Free RAM
-    plt.fill_between(x, y_free, color="green", alpha=0.1)
+    mem_ax.fill_between(x, y_free, color="green", alpha=0.1)
+
+    # Plot largest free block (fragmentation indicator)
+    mem_ax.plot(x, y_max_alloc, label="Largest Block (KB)", color="orange", marker=".")
 
-    plt.title("ESP32 Memory Monitor")
-    plt.ylabel("Memory (KB)")
-    plt.xlabel("Time")
-    plt.legend(loc="upper left")
-    plt.grid(True, linestyle=":", alpha=0.6)
+    mem_ax.set_title("ESP32 Memory Monitor")
+    mem_ax.set_ylabel("Memory (KB)")
+    mem_ax.set_xlabel("Time")
+    mem_ax.legend(loc="upper left")
+    mem_ax.grid(True, linestyle=":", alpha=0.6)
 
     # Rotate date labels
-    plt.xticks(rotation=45, ha="right")
+    mem_ax.tick_params(axis="x", rotation=45)
+
+    if records:
+        draw_profile_chart(fig.axes[1], records)
+
     plt.tight_layout()
 
     return []
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""
+Download throughput benchmark and Range/ETag check for the device's file server.
+
+Downloads a file from /download several times and reports the sustained rate,
+then checks what download managers and browsers rely on:
+- the file arrives in two Range requests (206) identical to the full download,
+  as when an interrupted download is resumed
+- a range past the end is refused with 416
+- a repeated fetch with If-None-Match gets 304 and no body
+
+Usage:
+    python download_bench.py 192.168.4.1 /books/large.epub --repeat 3
+
+Upload a large file first (see upload_bench.py) to measure more than latency.
+Only the Python standard library is needed.
+"""
+
+from __future__ import annotations
+
+import argparse
+import http.client
+import statistics
+import sys
+import time
+import urllib.parse
+
+
+def fetch(args: argparse.Namespace, headers: dict[str, str] | None = None) -> tuple[int, dict[str, str], bytes, float]:
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+    try:
+        query = urllib.parse.urlencode({"path": args.path})
+        start = time.monotonic()
+        conn.request("GET", f"/download?{query}", headers=headers or {})
+        response = conn.getresponse()
+        body = response.read()
+        elapsed = time.monotonic() - start
+        return response.status, {k.lower(): v for k, v in response.getheaders()}, body, elapsed
+    finally:
+        conn.close()
+
+
+def check(condition: bool, message: str) -> bool:
+    print(f"  {'ok  ' if condition else 'FAIL'} {message}")
+    return condition
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Measure download throughput and check Range/ETag support")
+    parser.add_argument("host", help="Device address, e.g. 192.168.4.1 or crosspoint.local")
+    parser.add_argument("path", help="File on the SD card, e.g. /books/large.epub")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--repeat", type=int, default=3, help="Number of full downloads (default: 3)")
+    parser.add_argument("--timeout", type=float, default=60.0, help="Socket timeout in seconds")
+    args = parser.parse_args()
+
+    rates = []
+    full = b""
+    headers: dict[str, str] = {}
+    for run in range(1, args.repeat + 1):
+        try:
+            status, headers, full, elapsed = fetch(args)
+        except OSError as e:
+            print(f"Run {run}: failed: {e}", file=sys.stderr)
+            return 1
+        if status != 200:
+            print(f"Run {run}: HTTP {status}: {full[:200].decode(errors='replace')}", file=sys.stderr)
+            return 1
+        rate = len(full) / elapsed / (1024 * 1024)
+        rates.append(rate)
+        print(f"Run {run}: {len(full)} bytes in {elapsed:.2f} s, {rate:.2f} MB/s")
+    if len(rates) > 1:
+        print(f"Download: median {statistics.median(rates):.2f} MB/s, "
+              f"min {min(rates):.2f}, max {max(rates):.2f} over {len(rates)} downloads")
+
+    print("Checks:")
+    passed = True
+    size = len(full)
+    etag = headers.get("etag", "")
+    passed &= check(headers.get("accept-ranges") == "bytes", "Accept-Ranges: bytes")
+    passed &= check(bool(etag), f"ETag present ({etag})")
+
+    if size > 1:
+        # Odd split point, so the second request starts mid-sector
+        middle = size // 2 + 1
+        status, first_headers, first, _ = fetch(args, {"Range": f"bytes=0-{middle - 1}"})
+        passed &= check(status == 206 and first_headers.get("content-range") == f"bytes 0-{middle - 1}/{size}",
+                        f"first half: {status} {first_headers.get('content-range')}")
+        status, _, rest, _ = fetch(args, {"Range": f"bytes={middle}-", "If-Range": etag})
+        passed &= check(status == 206 and first + rest == full, f"resumed rest with If-Range: {status}, "
+                        f"{len(first) + len(rest)} of {size} bytes match")
+        status, _, tail, _ = fetch(args, {"Range": "bytes=-100"})
+        passed &= check(status == 206 and tail == full[-100:], f"suffix range: {status}")
+        status, _, whole, _ = fetch(args, {"Range": f"bytes={middle}-", "If-Range": '"stale"'})
+        passed &= check(status == 200 and whole == full, f"stale If-Range gets the whole file: {status}")
+
+    status, unsatisfiable_headers, _, _ = fetch(args, {"Range": f"bytes={size}-"})
+    passed &= check(status == 416 and unsatisfiable_headers.get("content-range") == f"bytes */{size}",
+                    f"range past the end: {status} {unsatisfiable_headers.get('content-range')}")
+    status, _, body, _ = fetch(args, {"If-None-Match": etag})
+    passed &= check(status == 304 and not body, f"If-None-Match: {status}")
+
+    return 0 if passed else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+Request rate and time-to-first-byte benchmark for the device's web server.
+
+Requests each path --requests times from --clients parallel connections and
+reports requests/s and the time to the first byte of the response (median and
+95th percentile). Run it against firmware before and after a change to the
+server, e.g. with the device on the File Transfer screen while you press
+buttons, which used to share the main loop with the server.
+
+Also checks that a page fetched again with its ETag gets 304 and no body.
+
+Usage:
+    python http_latency_bench.py 192.168.4.1
+    python http_latency_bench.py crosspoint.local --paths / /api/status "/api/files?path=/" --clients 4
+
+Only the Python standard library is needed.
+"""
+
+from __future__ import annotations
+
+import argparse
+import socket
+import statistics
+import sys
+import threading
+import time
+
+
+def get(args: argparse.Namespace, path: str,
+        headers: dict[str, str] | None = None) -> tuple[int, dict[str, str], bytes, float]:
+    """One request on a fresh connection; returns status, headers, body and seconds to the first byte."""
+    sock = socket.create_connection((args.host, args.port), timeout=args.timeout)
+    try:
+        extra = "".join(f"{name}: {value}\r\n" for name, value in (headers or {}).items())
+        start = time.monotonic()
+        sock.sendall(f"GET {path} HTTP/1.1\r\nHost: {args.host}\r\nAccept-Encoding: gzip\r\n{extra}\r\n".encode())
+        response = sock.recv(4096)
+        ttfb = time.monotonic() - start
+        while part := sock.recv(4096):
+            response += part
+    finally:
+        sock.close()
+    head, _, body = response.partition(b"\r\n\r\n")
+    lines = head.decode(errors="replace").split("\r\n")
+    status = int(lines[0].split(" ", 2)[1])
+    response_headers = {}
+    for line in lines[1:]:
+        name, _, value = line.partition(":")
+        response_headers[name.strip().lower()] = value.strip()
+    return status, response_headers, body, ttfb
+
+
+def bench(args: argparse.Namespace, path: str) -> bool:
+    ttfbs: list[float] = []
+    errors: list[str] = []
+    lock = threading.Lock()
+    per_client = max(1, args.requests // args.clients)
+
+    def client() -> None:
+        for _ in range(per_client):
+            try:
+                status, _, _, ttfb = get(args, path)
+            except OSError as e:
+                with lock:
+                    errors.append(str(e))
+                continue
+            with lock:
+                if status == 200:
+                    ttfbs.append(ttfb)
+                else:
+                    errors.append(f"HTTP {status}")
+
+    threads = [threading.Thread(target=client) for _ in range(args.clients)]
+    start = time.monotonic()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    elapsed = time.monotonic() - start
+
+    if not ttfbs:
+        print(f"{path}: all {len(errors)} requests failed ({errors[0] if errors else 'no requests'})")
+        return False
+    ttfbs.sort()
+    p95 = ttfbs[min(len(ttfbs) - 1, int(len(ttfbs) * 0.95))]
+    print(f"{path}: {len(ttfbs) / elapsed:.1f} requests/s, time to first byte median "
+          f"{statistics.median(ttfbs) * 1000:.0f} ms, p95 {p95 * 1000:.0f} ms, max {ttfbs[-1] * 1000:.0f} ms"
+          + (f", {len(errors)} failed ({errors[0]})" if errors else ""))
+    return not errors
+
+
+def check_etag(args: argparse.Namespace) -> bool:
+    status, headers, _, _ = get(args, "/")
+    etag = headers.get("etag", "")
+    if status != 200 or not etag:
+        print(f"  FAIL / has no ETag (HTTP {status})")
+        return False
+    status, _, body, _ = get(args, "/", {"If-None-Match": etag})
+    ok = status == 304 and not body
+    print(f"  {'ok  ' if ok else 'FAIL'} / again with If-None-Match {etag}: {status}")
+    return ok
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Measure web server request rate and time to first byte")
+    parser.add_argument("host", help="Device address, e.g. 192.168.4.1 or crosspoint.local")
+    parser.add_argument("--paths", nargs="+", default=["/", "/api/status", "/api/files?path=/"],
+                        help="Paths to request (default: / /api/status /api/files?path=/)")
+    parser.add_argument("--requests", type=int, default=50, help="Requests per path (default: 50)")
+    parser.add_argument("--clients", type=int, default=1, help="Parallel connections (default: 1)")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--timeout", type=float, default=30.0, help="Socket timeout in seconds")
+    args = parser.parse_args()
+
+    passed = True
+    for path in args.paths:
+        passed &= bench(args, path)
+    print("Checks:")
+    try:
+        passed &= check_etag(args)
+    except OSError as e:
+        print(f"  FAIL {e}")
+        passed = False
+    return 0 if passed else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+"""
+Stand-in OPDS server with large generated catalogs, for testing the OPDS browser.
+
+Serves an Atom/OPDS catalog whose root lists:
+- "Paged catalog": N books split into pages with rel="next"/"previous" links
+- "Whole catalog": the same N books in a single feed, to test the resident-entry
+  window and reading the feed's copy on the SD card again
+- "Small catalog": a few books, one screen
+Every book links to a small generated EPUB, so downloads can be tested too.
+
+Feeds are sent with an ETag and Last-Modified and answered with 304 when the
+request carries a matching If-None-Match or If-Modified-Since, which is how the
+device revalidates its cached copy. --touch makes every feed change its ETag
+each N seconds; stop the server to test browsing the saved copy offline.
+
+Each request is logged with its status and body size, and a summary of 200s,
+304s and bytes sent is printed on Ctrl+C.
+
+Usage:
+    python opds_stand_in_server.py --books 2000 --page-size 50
+    python opds_stand_in_server.py --port 8080 --user reader --password secret
+
+Then set the device's OPDS server URL to http://<this computer>:<port>/opds.
+Only the Python standard library is needed.
+"""
+
+from __future__ import annotations
+
+import argparse
+import base64
+import email.utils
+import hashlib
+import http.server
+import io
+import threading
+import time
+import urllib.parse
+import zipfile
+from xml.sax.saxutils import escape
+
+ATOM_HEADER = (
+    '<?xml version="1.0" encoding="UTF-8"?>\n'
+    '<feed xmlns="http://www.w3.org/2005/Atom" xmlns:opds="http://opds-spec.org/2010/catalog">\n'
+)
+NAVIGATION_TYPE = "application/atom+xml;profile=opds-catalog;kind=navigation"
+ACQUISITION_TYPE = "application/atom+xml;profile=opds-catalog;kind=acquisition"
+
+AUTHORS = ["Ada Lovelace", "Jules Verne", "Mary Shelley", "H. G. Wells", "Selma Lagerlöf", "Karel Čapek"]
+WORDS = ["Silent", "Northern", "Clockwork", "Harbour", "Lantern", "Garden", "Voyage", "Winter", "Machine", "River"]
+
+
+class Stats:
+    def __init__(self) -> None:
+        self.lock = threading.Lock()
+        self.counts: dict[int, int] = {}
+        self.bytes_sent = 0
+
+    def record(self, status: int, size: int) -> None:
+        with self.lock:
+            self.counts[status] = self.counts.get(status, 0) + 1
+            self.bytes_sent += size
+
+    def summary(self) -> str:
+        statuses = ", ".join(f"{status}: {count}" for status, count in sorted(self.counts.items()))
+        return f"Requests by status: {statuses or 'none'}; {self.bytes_sent} body bytes sent"
+
+
+def book_title(index: int) -> str:
+    return f"{WORDS[index % len(WORDS)]} {WORDS[(index // len(WORDS)) % len(WORDS)]} {index + 1:05d}"
+
+
+def book_author(index: int) -> str:
+    return AUTHORS[index % len(AUTHORS)]
+
+
+def make_epub(index: int) -> bytes:
+    title = escape(book_title(index))
+    author = escape(book_author(index))
+    out = io.BytesIO()
+    with zipfile.ZipFile(out, "w") as epub:
+        epub.writestr(zipfile.ZipInfo("mimetype"), "application/epub+zip", compress_type=zipfile.ZIP_STORED)
+        epub.writestr(
+            "META-INF/container.xml",
+            '<?xml version="1.0"?>\n'
+            '<container version="1.0" xmlns="urn:oasis:names:tc:opendocument:xmlns:container">'
+            '<rootfiles><rootfile full-path="OEBPS/content.opf" media-type="application/oebps-package+xml"/>'
+            "</rootfiles></container>",
+            compress_type=zipfile.ZIP_DEFLATED,
+        )
+        epub.writestr(
+            "OEBPS/content.opf",
+            '<?xml version="1.0" encoding="UTF-8"?>\n'
+            '<package xmlns="http://www.idpf.org/2007/opf" version="2.0" unique-identifier="id">'
+            '<metadata xmlns:dc="http://purl.org/dc/elements/1.1/">'
+            f'<dc:title>{title}</dc:title><dc:creator>{author}</dc:creator>'
+            f'<dc:identifier id="id">stand-in-{index}</dc:identifier><dc:language>en</dc:language></metadata>'
+            '<manifest><item id="ch1" href="ch1.xhtml" media-type="application/xhtml+xml"/>'
+            '<item id="ncx" href="toc.ncx" media-type="application/x-dtbncx+xml"/></manifest>'
+            '<spine toc="ncx"><itemref idref="ch1"/></spine></package>',
+            compress_type=zipfile.ZIP_DEFLATED,
+        )
+        epub.writestr(
+            "OEBPS/toc.ncx",
+            '<?xml version="1.0" encoding="UTF-8"?>\n'
+            '<ncx xmlns="http://www.daisy.org/z3986/2005/ncx/" version="2005-1">'
+            f'<docTitle><text>{title}</text></docTitle><navMap><navPoint id="p1" playOrder="1">'
+            '<navLabel><text>Chapter 1</text></navLabel><content src="ch1.xhtml"/></navPoint></navMap></ncx>',
+            compress_type=zipfile.ZIP_DEFLATED,
+        )
+        paragraphs = "".join(f"<p>Paragraph {p + 1} of book {index + 1}.</p>" for p in range(40))
+        epub.writestr(
+            "OEBPS/ch1.xhtml",
+            '<?xml version="1.0" encoding="UTF-8"?>\n'
+            '<html xmlns="http://www.w3.org/1999/xhtml"><head><title>Chapter 1</title></head>'
+            f"<body><h1>{title}</h1>{paragraphs}</body></html>",
+            compress_type=zipfile.ZIP_DEFLATED,
+        )
+    return out.getvalue()
+
+
+def feed(feed_id: str, title: str, links: list[tuple[str, str, str]], entries: list[str]) -> bytes:
+    parts = [ATOM_HEADER, f"<id>{escape(feed_id)}</id><title>{escape(title)}</title>\n"]
+    parts.extend(f'<link rel="{rel}" href="{escape(href)}" type="{kind}"/>\n' for rel, href, kind in links)
+    parts.extend(entries)
+    parts.append("</feed>\n")
+    return "".join(parts).encode("utf-8")
+
+
+def navigation_entry(title: str, href: str) -> str:
+    return (
+        f"<entry><title>{escape(title)}</title><id>{escape(href)}</id>"
+        f'<link rel="subsection" href="{escape(href)}" type="{ACQUISITION_TYPE}"/></entry>\n'
+    )
+
+
+def book_entry(index: int) -> str:
+    return (
+        f"<entry><title>{escape(book_title(index))}</title><id>urn:stand-in:{index}</id>"
+        f"<author><name>{escape(book_author(index))}</name></author>"
+        f'<link rel="http://opds-spec.org/acquisition" href="/books/{index}.epub" type="application/epub+zip"/>'
+        "</entry>\n"
+    )
+
+
+def make_handler(args: argparse.Namespace, stats: Stats, started: float) -> type[http.server.BaseHTTPRequestHandler]:
+    expected_auth = None
+    if args.user:
+        token = base64.b64encode(f"{args.user}:{args.password}".encode()).decode()
+        expected_auth = f"Basic {token}"
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def log_message(self, format: str, *log_args: object) -> None:  # noqa: A002 - base class signature
+            pass
+
+        def send(self, status: int, body: bytes, headers: dict[str, str]) -> None:
+            self.send_response(status)
+            for name, value in headers.items():
+                self.send_header(name, value)
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            if self.command != "HEAD":
+                self.wfile.write(body)
+            stats.record(status, len(body))
+            print(f"{time.strftime('%H:%M:%S')} {self.command} {self.path} -> {status} ({len(body)} bytes)")
+
+        def feed_version(self) -> int:
+            # Changes every --touch seconds, or never
+            return int((time.time() - started) // args.touch) if args.touch > 0 else 0
+
+        def send_feed(self, body: bytes) -> None:
+            version = self.feed_version()
+            etag = '"' + hashlib.sha1(body + str(version).encode()).hexdigest()[:16] + '"'
+            last_modified = email.utils.formatdate(started + version * args.touch, usegmt=True)
+            headers = {"ETag": etag, "Last-Modified": last_modified, "Cache-Control": "no-cache"}
+
+            if_none_match = self.headers.get("If-None-Match")
+            if_modified_since = self.headers.get("If-Modified-Since")
+            if (if_none_match is not None and if_none_match == etag) or (
+                if_none_match is None and if_modified_since == last_modified
+            ):
+                self.send(304, b"", headers)
+                return
+            headers["Content-Type"] = "application/atom+xml;charset=utf-8"
+            self.send(200, body, headers)
+
+        def do_HEAD(self) -> None:  # noqa: N802 - http.server naming
+            self.do_GET()
+
+        def do_GET(self) -> None:  # noqa: N802 - http.server naming
+            if expected_auth and self.headers.get("Authorization") != expected_auth:
+                self.send(401, b"Authentication required\n", {"WWW-Authenticate": 'Basic realm="OPDS"'})
+                return
+
+            url = urllib.parse.urlsplit(self.path)
+            query = urllib.parse.parse_qs(url.query)
+            if url.path in ("/opds", "/opds/"):
+                self.send_feed(
+                    feed(
+                        "urn:stand-in:root",
+                        "Stand-in catalog",
+                        [("self", "/opds", NAVIGATION_TYPE), ("start", "/opds", NAVIGATION_TYPE)],
+                        [
+                            navigation_entry(f"Paged catalog ({args.books} books)", "/opds/paged"),
+                            navigation_entry(f"Whole catalog ({args.books} books)", "/opds/all"),
+                            navigation_entry("Small catalog (5 books)", "/opds/small"),
+                        ],
+                    )
+                )
+            elif url.path == "/opds/paged":
+                page_count = max(1, (args.books + args.page_size - 1) // args.page_size)
+                page = min(max(int(query.get("page", ["1"])[0]), 1), page_count)
+                first = (page - 1) * args.page_size
+                links = [("self", f"/opds/paged?page={page}", ACQUISITION_TYPE)]
+                if page > 1:
+                    links.append(("previous", f"/opds/paged?page={page - 1}", ACQUISITION_TYPE))
+                if page < page_count:
+                    links.append(("next", f"/opds/paged?page={page + 1}", ACQUISITION_TYPE))
+                entries = [book_entry(i) for i in range(first, min(first + args.page_size, args.books))]
+                self.send_feed(feed(f"urn:stand-in:paged:{page}", f"Paged catalog {page}/{page_count}", links, entries))
+            elif url.path == "/opds/all":
+                entries = [book_entry(i) for i in range(args.books)]
+                self.send_feed(feed("urn:stand-in:all", "Whole catalog", [], entries))
+            elif url.path == "/opds/small":
+                self.send_feed(feed("urn:stand-in:small", "Small catalog", [], [book_entry(i) for i in range(5)]))
+            elif url.path.startswith("/books/") and url.path.endswith(".epub"):
+                try:
+                    index = int(url.path[len("/books/") : -len(".epub")])
+                except ValueError:
+                    index = -1
+                if not 0 <= index < args.books:
+                    self.send(404, b"No such book\n", {"Content-Type": "text/plain"})
+                    return
+                self.send(200, make_epub(index), {"Content-Type": "application/epub+zip"})
+            else:
+                self.send(404, b"Not found\n", {"Content-Type": "text/plain"})
+
+    return Handler
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Serve generated OPDS catalogs for testing the OPDS browser")
+    parser.add_argument("--host", default="0.0.0.0", help="Address to listen on (default: all)")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--books", type=int, default=2000, help="Books in the large catalogs (default: 2000)")
+    parser.add_argument("--page-size", type=int, default=50, help="Books per page of the paged catalog (default: 50)")
+    parser.add_argument("--touch", type=float, default=0, help="Change every feed's ETag each N seconds (default: never)")
+    parser.add_argument("--user", help="Require HTTP Basic authentication with this user name")
+    parser.add_argument("--password", default="", help="Password for --user")
+    args = parser.parse_args()
+    if args.books < 0 or args.page_size < 1:
+        parser.error("--books must be at least 0 and --page-size at least 1")
+
+    stats = Stats()
+    server = http.server.ThreadingHTTPServer((args.host, args.port), make_handler(args, stats, time.time()))
+    print(f"Serving OPDS on http://{args.host}:{args.port}/opds ({args.books} books, {args.page_size} per page)")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+        print(stats.summary())
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,301 @@
+#!/usr/bin/env python3
+"""
+Stand-in book server that drops connections, for testing resumed OPDS downloads.
+
+Serves an OPDS feed with one book, "Resume Test - CrossPoint.epub", of about
+--size bytes. The first --drops responses for the book are cut off after
+--drop-after bytes, like a WiFi dropout, so the device has to come back with
+"Range: bytes=<n>-" and "If-Range: <ETag>" to finish it. --change-after-drop
+makes the book change (new ETag) after the first drop: If-Range no longer
+matches, and the device must take the whole new file instead of mixing the two.
+
+Checked (ok/FAIL):
+- every resumed request starts within what was sent before the drop
+- the book is complete without starting over (unless --change-after-drop)
+- with --device, the copy on the device's SD card is byte-identical: it is
+  downloaded from the device's file server and compared
+
+Usage:
+    python resumable_download_test.py --device 192.168.4.1 --size 4M --drop-after 1M
+    python resumable_download_test.py --self-test --drops 3
+
+Set the device's OPDS server URL to http://<this computer>:<port>/opds and
+download the book; the checks run once it has been served to the end.
+--self-test runs a client doing what the device does instead, to check the
+server. Only the Python standard library is needed.
+"""
+
+from __future__ import annotations
+
+import argparse
+import email.utils
+import hashlib
+import http.client
+import http.server
+import io
+import random
+import sys
+import threading
+import time
+import urllib.parse
+import zipfile
+
+from upload_bench import parse_size
+
+BOOK_TITLE = "Resume Test"
+BOOK_AUTHOR = "CrossPoint"
+DEVICE_PATH = f"/{BOOK_TITLE} - {BOOK_AUTHOR}.epub"
+
+
+def make_epub(size: int, version: int) -> bytes:
+    out = io.BytesIO()
+    with zipfile.ZipFile(out, "w") as epub:
+        epub.writestr(zipfile.ZipInfo("mimetype"), "application/epub+zip", compress_type=zipfile.ZIP_STORED)
+        epub.writestr(
+            "META-INF/container.xml",
+            '<?xml version="1.0"?>\n'
+            '<container version="1.0" xmlns="urn:oasis:names:tc:opendocument:xmlns:container">'
+            '<rootfiles><rootfile full-path="OEBPS/content.opf" media-type="application/oebps-package+xml"/>'
+            "</rootfiles></container>",
+        )
+        epub.writestr(
+            "OEBPS/content.opf",
+            '<?xml version="1.0" encoding="UTF-8"?>\n'
+            '<package xmlns="http://www.idpf.org/2007/opf" version="2.0" unique-identifier="id">'
+            '<metadata xmlns:dc="http://purl.org/dc/elements/1.1/">'
+            f"<dc:title>{BOOK_TITLE}</dc:title><dc:creator>{BOOK_AUTHOR}</dc:creator>"
+            f'<dc:identifier id="id">resume-test-{version}</dc:identifier><dc:language>en</dc:language></metadata>'
+            '<manifest><item id="ch1" href="ch1.xhtml" media-type="application/xhtml+xml"/>'
+            '<item id="pad" href="padding.bin" media-type="application/octet-stream"/></manifest>'
+            '<spine><itemref idref="ch1"/></spine></package>',
+        )
+        epub.writestr(
+            "OEBPS/ch1.xhtml",
+            '<?xml version="1.0" encoding="UTF-8"?>\n<html xmlns="http://www.w3.org/1999/xhtml">'
+            f"<head><title>{BOOK_TITLE}</title></head><body><p>Version {version}.</p></body></html>",
+        )
+        # Random, stored: the EPUB is about --size bytes, and a resumed byte in the wrong place can't go unnoticed
+        padding = random.Random(version).randbytes(max(size - 2048, 0))
+        epub.writestr("OEBPS/padding.bin", padding, compress_type=zipfile.ZIP_STORED)
+    return out.getvalue()
+
+
+class Book:
+    """The served book and what happened to it, shared by the request threads."""
+
+    def __init__(self, args: argparse.Namespace) -> None:
+        self.args = args
+        self.lock = threading.Lock()
+        self.version = 1
+        self.data = make_epub(args.size, self.version)
+        self.drops_left = args.drops
+        self.changed = False
+        self.requests: list[str] = []
+        self.last_drop_at: int | None = None  # Bytes of the file sent when the last connection was cut
+        self.resume_problems: list[str] = []
+        self.full_downloads = 0
+        self.complete = threading.Event()
+
+    @property
+    def etag(self) -> str:
+        return f'"book-v{self.version}-{hashlib.sha1(self.data).hexdigest()[:12]}"'
+
+    def change(self) -> None:
+        self.version += 1
+        self.data = make_epub(self.args.size, self.version)
+        self.changed = True
+
+
+def make_handler(book: Book, started: float) -> type[http.server.BaseHTTPRequestHandler]:
+    class Handler(http.server.BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def log_message(self, format: str, *log_args: object) -> None:  # noqa: A002 - base class signature
+            pass
+
+        def send_body(self, status: int, body: bytes, headers: dict[str, str]) -> None:
+            self.send_response(status)
+            for name, value in headers.items():
+                self.send_header(name, value)
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def do_GET(self) -> None:  # noqa: N802 - http.server naming
+            path = urllib.parse.urlsplit(self.path).path
+            if path in ("/opds", "/opds/"):
+                feed = (
+                    '<?xml version="1.0" encoding="UTF-8"?>\n'
+                    '<feed xmlns="http://www.w3.org/2005/Atom"><id>urn:resume-test</id><title>Resume test</title>'
+                    f"<entry><title>{BOOK_TITLE}</title><id>urn:resume-test:book</id>"
+                    f"<author><name>{BOOK_AUTHOR}</name></author>"
+                    '<link rel="http://opds-spec.org/acquisition" href="/book.epub" type="application/epub+zip"/>'
+                    "</entry></feed>\n"
+                )
+                self.send_body(200, feed.encode(), {"Content-Type": "application/atom+xml;charset=utf-8"})
+            elif path == "/book.epub":
+                self.send_book()
+            else:
+                self.send_body(404, b"Not found\n", {"Content-Type": "text/plain"})
+
+        def send_book(self) -> None:
+            with book.lock:
+                data = book.data
+                etag = book.etag
+                range_header = self.headers.get("Range")
+                if_range = self.headers.get("If-Range")
+                start = 0
+                if range_header and range_header.startswith("bytes=") and (if_range is None or if_range == etag):
+                    first = range_header[len("bytes=") :].split("-", 1)[0]
+                    start = int(first) if first.isdigit() else 0
+                    if start >= len(data):
+                        book.requests.append(f"{range_header} -> 416")
+                        self.send_body(416, b"", {"Content-Range": f"bytes */{len(data)}"})
+                        return
+                    if book.last_drop_at is not None and not book.changed and start > book.last_drop_at:
+                        book.resume_problems.append(f"resumed at {start}, past the drop at {book.last_drop_at}")
+                drop = book.drops_left > 0
+                if drop:
+                    book.drops_left -= 1
+                partial = start > 0
+                if not partial:
+                    book.full_downloads += 1
+                book.requests.append(
+                    f"{range_header or 'full'}{' If-Range ' + if_range if if_range else ''} -> {206 if partial else 200}"
+                    f"{' (dropped)' if drop else ''}"
+                )
+
+            body = data[start:]
+            self.send_response(206 if partial else 200)
+            self.send_header("Content-Type", "application/epub+zip")
+            self.send_header("ETag", etag)
+            self.send_header("Last-Modified", email.utils.formatdate(started, usegmt=True))
+            self.send_header("Accept-Ranges", "bytes")
+            self.send_header("Content-Length", str(len(body)))
+            if partial:
+                self.send_header("Content-Range", f"bytes {start}-{len(data) - 1}/{len(data)}")
+            self.end_headers()
+
+            if drop:
+                cut = min(book.args.drop_after, len(body) - 1)
+                self.wfile.write(body[:cut])
+                self.wfile.flush()
+                self.close_connection = True
+                with book.lock:
+                    book.last_drop_at = start + cut
+                    print(f"  dropped the connection at byte {start + cut} of {len(data)}")
+                    if book.args.change_after_drop and not book.changed:
+                        book.change()
+                        print("  the book changed")
+                return
+
+            self.wfile.write(body)
+            print(f"  served bytes {start}-{len(data) - 1} of {len(data)}")
+            book.complete.set()
+
+    return Handler
+
+
+def self_test(port: int) -> bytes:
+    """Download the book the way the device does: resume with Range and If-Range until it is complete."""
+    data = b""
+    etag = None
+    total = None
+    for _ in range(20):
+        conn = http.client.HTTPConnection("127.0.0.1", port, timeout=10)
+        headers = {}
+        if data:
+            headers["Range"] = f"bytes={len(data)}-"
+            if etag:
+                headers["If-Range"] = etag
+        conn.request("GET", "/book.epub", headers=headers)
+        response = conn.getresponse()
+        if response.status == 200:
+            data = b""
+            etag = response.getheader("ETag")
+            total = int(response.getheader("Content-Length"))
+        elif response.status != 206:
+            raise RuntimeError(f"Unexpected status {response.status}")
+        try:
+            while True:
+                chunk = response.read(4096)
+                if not chunk:
+                    break
+                data += chunk
+        except http.client.IncompleteRead as e:
+            data += e.partial
+        conn.close()
+        if total is not None and len(data) >= total:
+            return data
+        time.sleep(0.1)
+    raise RuntimeError("Gave up after 20 requests")
+
+
+def fetch_from_device(host: str) -> bytes:
+    conn = http.client.HTTPConnection(host, 80, timeout=60)
+    try:
+        conn.request("GET", "/download?" + urllib.parse.urlencode({"path": DEVICE_PATH}))
+        response = conn.getresponse()
+        body = response.read()
+        if response.status != 200:
+            raise RuntimeError(f"Device answered {response.status}")
+        return body
+    finally:
+        conn.close()
+
+
+def check(condition: bool, message: str) -> bool:
+    print(f"  {'ok  ' if condition else 'FAIL'} {message}")
+    return condition
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Serve a book with dropped connections and check the resumed copy")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--size", type=parse_size, default=parse_size("2M"), help="Book size, e.g. 4M (default: 2M)")
+    parser.add_argument("--drop-after", type=parse_size, default=parse_size("512K"), help="Bytes sent before a drop")
+    parser.add_argument("--drops", type=int, default=2, help="Responses to cut off (default: 2)")
+    parser.add_argument("--change-after-drop", action="store_true", help="Change the book after the first drop")
+    parser.add_argument("--device", help="Device address, to compare its copy of the book")
+    parser.add_argument("--self-test", action="store_true", help="Download with a local client instead of the device")
+    parser.add_argument("--timeout", type=float, default=600.0, help="Seconds to wait for the download")
+    args = parser.parse_args()
+
+    book = Book(args)
+    server = http.server.ThreadingHTTPServer(("0.0.0.0", args.port), make_handler(book, time.time()))
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    print(f"Serving OPDS on port {args.port}/opds: {DEVICE_PATH[1:]}, {len(book.data)} bytes, {args.drops} drops")
+
+    try:
+        if args.self_test:
+            received = self_test(args.port)
+        else:
+            print("Download the book on the device now")
+            if not book.complete.wait(args.timeout):
+                print("Timed out waiting for the download")
+                return 1
+            received = fetch_from_device(args.device) if args.device else None
+    finally:
+        server.shutdown()
+        server.server_close()
+
+    print("Requests:")
+    for request in book.requests:
+        print(f"  {request}")
+    ok = True
+    ok &= check(not book.resume_problems, "resumed within what was sent" + "".join(f"; {p}" for p in book.resume_problems))
+    expected_full = 2 if args.change_after_drop else 1
+    ok &= check(book.full_downloads <= expected_full, f"{book.full_downloads} full download(s), expected {expected_full}")
+    if received is not None:
+        ok &= check(len(received) == len(book.data), f"size {len(received)} of {len(book.data)} bytes")
+        ok &= check(
+            hashlib.sha256(received).digest() == hashlib.sha256(book.data).digest(),
+            "identical to the served book" + (" (the changed version)" if book.changed else ""),
+        )
+    else:
+        print("  (no --device: the device's copy was not compared)")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
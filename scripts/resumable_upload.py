@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""
+Test client for resumable uploads to the device's file transfer server.
+
+Uploads a file with the resumable protocols the web UI uses and checks that an
+interrupted upload continues instead of starting over:
+- WebSocket (default): "RESUME:<name>:<size>:<id>:<path>" on port 81, answered
+  with "OFFSET:<n>"; binary frames carry a uint32 offset and the CRC-32 of their
+  data, and a damaged frame is answered with "RESEND:<offset>"
+- HTTP: GET /api/upload/resume for the offset, then one POST /upload/chunk per
+  chunk with its CRC-32; 409 means "send again from this offset"
+
+--drop-after cuts the connection after that many bytes of each connection, like a
+WiFi dropout, and the client reconnects and resumes. --corrupt-at damages the data
+of the chunk at that offset (keeping the CRC of the real data) so the device must
+reject it. Afterwards the file is downloaded and compared.
+
+Usage:
+    python resumable_upload.py 192.168.4.1 --size 4M --drop-after 1M
+    python resumable_upload.py crosspoint.local --mode http --corrupt-at 300000 --path /bench
+    python resumable_upload.py 192.168.4.1 --file book.xtc --path /Books
+
+Only the Python standard library is needed.
+"""
+
+from __future__ import annotations
+
+import argparse
+import hashlib
+import http.client
+import json
+import os
+import socket
+import struct
+import sys
+import time
+import urllib.parse
+import zlib
+
+from upload_bench import WebSocket, parse_size
+
+WS_CHUNK_SIZE = 4096
+HTTP_CHUNK_SIZE = 256 * 1024
+MAX_CONNECTIONS = 50
+
+
+class Dropped(Exception):
+    """The client cut the connection on purpose."""
+
+
+class Upload:
+    def __init__(self, args: argparse.Namespace, name: str, data: bytes, upload_id: str):
+        self.args = args
+        self.name = name
+        self.data = data
+        self.id = upload_id
+        self.corrupt_at = args.corrupt_at
+        self.damaged_offset: int | None = None
+        self.damage_caught = False
+        self.rejected = 0
+        self.resumed_at: list[int] = []
+
+    def chunk_payload(self, offset: int, chunk: bytes) -> bytes:
+        # Damage the chunk at corrupt_at once; the CRC sent with it is still the real data's
+        if self.corrupt_at is not None and offset <= self.corrupt_at < offset + len(chunk):
+            index = self.corrupt_at - offset
+            self.corrupt_at = None
+            self.damaged_offset = offset
+            return chunk[:index] + bytes([chunk[index] ^ 0xFF]) + chunk[index + 1:]
+        return chunk
+
+    def device_offset(self, offset: int) -> int:
+        """An offset the device asked to continue from: at or before the damaged chunk means it was caught."""
+        if self.damaged_offset is not None and offset <= self.damaged_offset:
+            self.damaged_offset = None
+            self.damage_caught = True
+        return offset
+
+    # --- WebSocket ---
+
+    def ws_connection(self) -> bool:
+        """One connection; True when the upload is done."""
+        size = len(self.data)
+        ws = WebSocket(self.args.host, self.args.ws_port, self.args.timeout)
+        try:
+            ws.send_text(f"RESUME:{self.name}:{size}:{self.id}:{self.args.path}")
+            reply = ws.recv_text()
+            if not reply.startswith("OFFSET:"):
+                raise RuntimeError(f"Upload refused: {reply}")
+            offset = self.device_offset(int(reply[7:]))
+            self.resumed_at.append(offset)
+            sent = 0
+            while True:
+                while offset < size:
+                    while ws.pending():
+                        offset = self.ws_message(ws.recv_text(), offset)
+                        if offset is None:
+                            return True
+                    chunk = self.data[offset:offset + WS_CHUNK_SIZE]
+                    header = struct.pack("<II", offset, zlib.crc32(chunk))
+                    ws.send_binary(header + self.chunk_payload(offset, chunk))
+                    offset += len(chunk)
+                    sent += len(chunk)
+                    if self.args.drop_after and sent >= self.args.drop_after and offset < size:
+                        raise Dropped()
+                offset = self.ws_message(ws.recv_text(), offset)
+                if offset is None:
+                    return True
+        except Dropped:
+            ws.sock.close()
+            return False
+        finally:
+            ws.close()
+
+    def ws_message(self, message: str, offset: int) -> int | None:
+        """Offset to continue from, None when done."""
+        if message == "DONE":
+            return None
+        if message.startswith("RESEND:"):
+            self.rejected += 1
+            return self.device_offset(int(message[7:]))
+        if message.startswith("ERROR:"):
+            raise RuntimeError(message)
+        return offset  # PROGRESS
+
+    # --- HTTP ---
+
+    def http_query(self) -> str:
+        return urllib.parse.urlencode(
+            {"path": self.args.path, "name": self.name, "size": len(self.data), "id": self.id})
+
+    def http_resume_offset(self) -> int:
+        conn = http.client.HTTPConnection(self.args.host, self.args.http_port, timeout=self.args.timeout)
+        try:
+            conn.request("GET", "/api/upload/resume?" + self.http_query())
+            response = conn.getresponse()
+            body = response.read()
+            if response.status != 200:
+                raise RuntimeError(f"Resume query: HTTP {response.status}: {body.decode(errors='replace')}")
+            return json.loads(body)["offset"]
+        finally:
+            conn.close()
+
+    def http_post_chunk(self, offset: int, chunk: bytes, payload: bytes, cut_after: int | None) -> tuple[int, dict]:
+        boundary = "----resumable" + os.urandom(8).hex()
+        head = (f"--{boundary}\r\nContent-Disposition: form-data; name=\"file\"; filename=\"{self.name}\"\r\n"
+                f"Content-Type: application/octet-stream\r\n\r\n").encode()
+        tail = f"\r\n--{boundary}--\r\n".encode()
+        query = f"{self.http_query()}&offset={offset}&crc={zlib.crc32(chunk):x}"
+        body = head + payload + tail
+        request = (f"POST /upload/chunk?{query} HTTP/1.1\r\nHost: {self.args.host}\r\nConnection: close\r\n"
+                   f"Content-Type: multipart/form-data; boundary={boundary}\r\n"
+                   f"Content-Length: {len(body)}\r\n\r\n").encode()
+        sock = socket.create_connection((self.args.host, self.args.http_port), timeout=self.args.timeout)
+        try:
+            if cut_after is not None:
+                # Part of the chunk, then the connection goes away
+                sock.sendall(request + body[:len(head) + cut_after])
+                raise Dropped()
+            sock.sendall(request + body)
+            response = b""
+            while part := sock.recv(4096):
+                response += part
+        finally:
+            sock.close()
+        header, _, content = response.partition(b"\r\n\r\n")
+        status = int(header.split(b" ", 2)[1])
+        if status in (200, 409):
+            return status, json.loads(content)
+        raise RuntimeError(f"HTTP {status}: {content.decode(errors='replace')}")
+
+    def http_connection(self) -> bool:
+        """A run of chunk requests until done or dropped; True when the upload is done."""
+        size = len(self.data)
+        offset = self.device_offset(self.http_resume_offset())
+        self.resumed_at.append(offset)
+        sent = 0
+        while True:
+            chunk = self.data[offset:offset + HTTP_CHUNK_SIZE]
+            cut_after = None
+            if self.args.drop_after and sent + len(chunk) > self.args.drop_after and offset + len(chunk) < size:
+                cut_after = max(1, self.args.drop_after - sent)
+            payload = chunk if cut_after is not None else self.chunk_payload(offset, chunk)
+            try:
+                status, reply = self.http_post_chunk(offset, chunk, payload, cut_after)
+            except Dropped:
+                time.sleep(0.5)  # Let the device see the connection go
+                return False
+            if status == 409:
+                self.rejected += 1
+            else:
+                sent += len(chunk)
+            offset = self.device_offset(reply["offset"])
+            if reply.get("done"):
+                return True
+
+    # ---
+
+    def run(self) -> float:
+        connect = self.ws_connection if self.args.mode == "ws" else self.http_connection
+        start = time.monotonic()
+        for _ in range(MAX_CONNECTIONS):
+            if connect():
+                return time.monotonic() - start
+            time.sleep(0.2)
+        raise RuntimeError(f"Not done after {MAX_CONNECTIONS} connections")
+
+
+def download(args: argparse.Namespace, name: str) -> bytes:
+    path = args.path.rstrip("/") + "/" + name
+    conn = http.client.HTTPConnection(args.host, args.http_port, timeout=args.timeout)
+    try:
+        conn.request("GET", "/download?" + urllib.parse.urlencode({"path": path}))
+        response = conn.getresponse()
+        body = response.read()
+        if response.status != 200:
+            raise RuntimeError(f"Download: HTTP {response.status}: {body[:200].decode(errors='replace')}")
+        return body
+    finally:
+        conn.close()
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Upload with the resumable protocol and check interruptions")
+    parser.add_argument("host", help="Device address, e.g. 192.168.4.1 or crosspoint.local")
+    parser.add_argument("--mode", choices=["ws", "http"], default="ws", help="Upload protocol (default: ws)")
+    parser.add_argument("--file", help="File to upload (default: random data of --size)")
+    parser.add_argument("--size", default="2M", help="Size of the random file, e.g. 512K or 8M (default: 2M)")
+    parser.add_argument("--name", default="resumable_test.bin", help="Name to upload random data as")
+    parser.add_argument("--path", default="/", help="Folder on the SD card to upload into (default: /)")
+    parser.add_argument("--drop-after", type=parse_size, default=0,
+                        help="Cut each connection after this many bytes, e.g. 1M (default: never)")
+    parser.add_argument("--corrupt-at", type=parse_size, default=None,
+                        help="Damage the chunk holding this byte offset once, e.g. 300000")
+    parser.add_argument("--no-verify", action="store_true", help="Skip downloading the file to compare it")
+    parser.add_argument("--http-port", type=int, default=80)
+    parser.add_argument("--ws-port", type=int, default=81)
+    parser.add_argument("--timeout", type=float, default=60.0, help="Socket timeout in seconds")
+    args = parser.parse_args()
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+        name = os.path.basename(args.file)
+        modified = int(os.path.getmtime(args.file))
+    else:
+        data = os.urandom(parse_size(args.size))
+        name = args.name
+        modified = time.time_ns()  # Random data: never continue an earlier run
+    # Same idea as the web UI: the id names the content, so only the same file continues an upload
+    upload_id = f"{zlib.crc32(f'{name}:{len(data)}:{modified}'.encode()):08x}-{len(data):x}"
+
+    upload = Upload(args, name, data, upload_id)
+    try:
+        elapsed = upload.run()
+    except (OSError, RuntimeError) as e:
+        print(f"Upload failed: {e}", file=sys.stderr)
+        return 1
+
+    rate = len(data) / elapsed / (1024 * 1024)
+    print(f"Uploaded {len(data)} bytes in {elapsed:.2f} s ({rate:.2f} MB/s) over {len(upload.resumed_at)} "
+          f"connection(s), starting at offsets {upload.resumed_at}; {upload.rejected} chunk(s) rejected")
+
+    passed = True
+    if args.drop_after and len(data) > args.drop_after:
+        resumed = len(upload.resumed_at) > 1 and all(o > 0 for o in upload.resumed_at[1:])
+        print(f"  {'ok  ' if resumed else 'FAIL'} reconnections continued where the upload stopped")
+        passed &= resumed
+    if args.corrupt_at is not None and args.corrupt_at < len(data):
+        print(f"  {'ok  ' if upload.damage_caught else 'FAIL'} damaged chunk was rejected")
+        passed &= upload.damage_caught
+    if not args.no_verify:
+        try:
+            same = hashlib.sha256(download(args, name)).digest() == hashlib.sha256(data).digest()
+        except (OSError, RuntimeError) as e:
+            print(f"  FAIL download: {e}")
+            return 1
+        print(f"  {'ok  ' if same else 'FAIL'} downloaded file matches")
+        passed &= same
+    return 0 if passed else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,237 @@
+#!/usr/bin/env python3
+"""
+Upload throughput benchmark for the device's file transfer server.
+
+Uploads a generated file to the device and reports the sustained rate, the same
+way the web UI does it:
+- WebSocket mode (default): port 81, "START:<name>:<size>:<path>", binary chunks,
+  waiting for "DONE" (FilesPage.html's fast path)
+- HTTP mode: multipart POST to /upload?path=<path> on port 80
+
+The file is random data, so every run writes the full size to the SD card. Run it
+against firmware before and after a change and compare the MB/s; the device logs
+how long the upload spent waiting for the card ("ms waiting for the card").
+
+Usage:
+    python upload_bench.py 192.168.4.1 --size 8M --repeat 3
+    python upload_bench.py crosspoint.local --mode http --path /bench
+
+Only the Python standard library is needed.
+"""
+
+from __future__ import annotations
+
+import argparse
+import base64
+import os
+import socket
+import statistics
+import struct
+import sys
+import time
+import urllib.parse
+
+CHUNK_SIZE = 4096  # What the web UI sends per WebSocket frame
+
+
+def parse_size(text: str) -> int:
+    units = {"K": 1024, "M": 1024 * 1024}
+    suffix = text[-1].upper()
+    if suffix in units:
+        return int(float(text[:-1]) * units[suffix])
+    return int(text)
+
+
+def recv_line(sock: socket.socket) -> bytes:
+    line = b""
+    while not line.endswith(b"\r\n"):
+        byte = sock.recv(1)
+        if not byte:
+            raise ConnectionError("Connection closed during handshake")
+        line += byte
+    return line
+
+
+class WebSocket:
+    """Just enough of RFC 6455 for the upload protocol: masked client frames, unfragmented server frames."""
+
+    def __init__(self, host: str, port: int, timeout: float):
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        key = base64.b64encode(os.urandom(16)).decode()
+        request = (
+            f"GET / HTTP/1.1\r\nHost: {host}:{port}\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            f"Sec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n\r\n"
+        )
+        self.sock.sendall(request.encode())
+        status = recv_line(self.sock)
+        if b" 101 " not in status:
+            raise ConnectionError(f"WebSocket handshake failed: {status.decode(errors='replace').strip()}")
+        while recv_line(self.sock) != b"\r\n":
+            pass
+
+    def send(self, payload: bytes, opcode: int) -> None:
+        header = bytearray([0x80 | opcode])
+        length = len(payload)
+        if length < 126:
+            header.append(0x80 | length)
+        elif length < 65536:
+            header.append(0x80 | 126)
+            header += struct.pack(">H", length)
+        else:
+            header.append(0x80 | 127)
+            header += struct.pack(">Q", length)
+        mask = os.urandom(4)
+        header += mask
+        # XOR with the repeated mask, as one big integer so it stays fast for large chunks
+        repeated = (mask * (length // 4 + 1))[:length]
+        masked = (int.from_bytes(payload, "little") ^ int.from_bytes(repeated, "little")).to_bytes(length, "little")
+        self.sock.sendall(bytes(header) + masked)
+
+    def send_text(self, text: str) -> None:
+        self.send(text.encode(), 0x1)
+
+    def send_binary(self, data: bytes) -> None:
+        self.send(data, 0x2)
+
+    def _recv_exact(self, count: int) -> bytes:
+        data = b""
+        while len(data) < count:
+            part = self.sock.recv(count - len(data))
+            if not part:
+                raise ConnectionError("Connection closed")
+            data += part
+        return data
+
+    def recv_text(self) -> str:
+        while True:
+            first, second = self._recv_exact(2)
+            length = second & 0x7F
+            if length == 126:
+                length = struct.unpack(">H", self._recv_exact(2))[0]
+            elif length == 127:
+                length = struct.unpack(">Q", self._recv_exact(8))[0]
+            payload = self._recv_exact(length)
+            opcode = first & 0x0F
+            if opcode == 0x1:
+                return payload.decode(errors="replace")
+            if opcode == 0x8:
+                raise ConnectionError("Server closed the WebSocket")
+            if opcode == 0x9:
+                self.send(payload, 0xA)  # Pong
+
+    def pending(self) -> bool:
+        self.sock.setblocking(False)
+        try:
+            return len(self.sock.recv(1, socket.MSG_PEEK)) > 0
+        except BlockingIOError:
+            return False
+        finally:
+            self.sock.setblocking(True)
+
+    def close(self) -> None:
+        try:
+            self.send(b"", 0x8)
+        except OSError:
+            pass
+        self.sock.close()
+
+
+def upload_websocket(args: argparse.Namespace, name: str, data: bytes) -> float:
+    ws = WebSocket(args.host, args.ws_port, args.timeout)
+    try:
+        ws.send_text(f"START:{name}:{len(data)}:{args.path}")
+        reply = ws.recv_text()
+        if reply != "READY":
+            raise RuntimeError(f"Upload refused: {reply}")
+        start = time.monotonic()
+        for offset in range(0, len(data), CHUNK_SIZE):
+            ws.send_binary(data[offset:offset + CHUNK_SIZE])
+            # Drain progress messages as they come so neither side's buffers fill up
+            while ws.pending():
+                reply = ws.recv_text()
+                if reply.startswith("ERROR"):
+                    raise RuntimeError(reply)
+        while True:
+            reply = ws.recv_text()
+            if reply == "DONE":
+                return time.monotonic() - start
+            if reply.startswith("ERROR"):
+                raise RuntimeError(reply)
+    finally:
+        ws.close()
+
+
+def upload_http(args: argparse.Namespace, name: str, data: bytes) -> float:
+    boundary = "----uploadbench" + os.urandom(8).hex()
+    head = (
+        f"--{boundary}\r\nContent-Disposition: form-data; name=\"file\"; filename=\"{name}\"\r\n"
+        f"Content-Type: application/octet-stream\r\n\r\n"
+    ).encode()
+    tail = f"\r\n--{boundary}--\r\n".encode()
+    query = urllib.parse.urlencode({"path": args.path})
+    request = (
+        f"POST /upload?{query} HTTP/1.1\r\nHost: {args.host}\r\nConnection: close\r\n"
+        f"Content-Type: multipart/form-data; boundary={boundary}\r\n"
+        f"Content-Length: {len(head) + len(data) + len(tail)}\r\n\r\n"
+    ).encode()
+
+    sock = socket.create_connection((args.host, args.http_port), timeout=args.timeout)
+    try:
+        start = time.monotonic()
+        sock.sendall(request + head)
+        view = memoryview(data)
+        for offset in range(0, len(data), 64 * 1024):
+            sock.sendall(view[offset:offset + 64 * 1024])
+        sock.sendall(tail)
+        response = b""
+        while True:
+            part = sock.recv(4096)
+            if not part:
+                break
+            response += part
+        elapsed = time.monotonic() - start
+    finally:
+        sock.close()
+    status = response.split(b"\r\n", 1)[0].decode(errors="replace")
+    if " 200 " not in status:
+        body = response.split(b"\r\n\r\n", 1)[-1].decode(errors="replace")
+        raise RuntimeError(f"{status}: {body.strip()}")
+    return elapsed
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Measure sustained upload throughput to the device")
+    parser.add_argument("host", help="Device address, e.g. 192.168.4.1 or crosspoint.local")
+    parser.add_argument("--mode", choices=["ws", "http"], default="ws", help="Upload protocol (default: ws)")
+    parser.add_argument("--size", default="4M", help="File size, e.g. 512K or 8M (default: 4M)")
+    parser.add_argument("--repeat", type=int, default=3, help="Number of uploads (default: 3)")
+    parser.add_argument("--path", default="/", help="Folder on the SD card to upload into (default: /)")
+    parser.add_argument("--name", default="upload_bench.bin", help="File name to upload as")
+    parser.add_argument("--http-port", type=int, default=80)
+    parser.add_argument("--ws-port", type=int, default=81)
+    parser.add_argument("--timeout", type=float, default=60.0, help="Socket timeout in seconds")
+    args = parser.parse_args()
+
+    size = parse_size(args.size)
+    upload = upload_websocket if args.mode == "ws" else upload_http
+    rates = []
+    for run in range(1, args.repeat + 1):
+        data = os.urandom(size)
+        try:
+            elapsed = upload(args, args.name, data)
+        except (OSError, RuntimeError) as e:
+            print(f"Run {run}: failed: {e}", file=sys.stderr)
+            return 1
+        rate = size / elapsed / (1024 * 1024)
+        rates.append(rate)
+        print(f"Run {run}: {size} bytes in {elapsed:.2f} s, {rate:.2f} MB/s")
+
+    if len(rates) > 1:
+        print(f"{args.mode}: median {statistics.median(rates):.2f} MB/s, "
+              f"min {min(rates):.2f}, max {max(rates):.2f} over {len(rates)} uploads")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
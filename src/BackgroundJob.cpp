@@ -0,0 +1,57 @@
+#include "BackgroundJob.h"
+
+#include <Logging.h>
+
+#include "activities/Activity.h"
+
+BackgroundJob BackgroundJob::instance;
+
+void BackgroundJob::taskTrampoline(void* param) {
+  auto* self = static_cast<BackgroundJob*>(param);
+  {
+    Activity::RenderLock lock(*self->activity);
+    xSemaphoreGive(self->lockHeld);
+    self->work();
+  }
+  // The activity may be gone once the lock is released
+  self->activity = nullptr;
+  self->running = false;
+  xSemaphoreGive(self->finished);
+  vTaskDelete(nullptr);
+}
+
+bool BackgroundJob::start(Activity& onScreen, void (*job)()) {
+  wait();
+  if (!lockHeld) {
+    lockHeld = xSemaphoreCreateBinary();
+    finished = xSemaphoreCreateBinary();
+  }
+  activity = &onScreen.renderingActivity();
+  work = job;
+  running = true;
+  unjoined = true;
+  TaskHandle_t task = nullptr;
+  xTaskCreate(&taskTrampoline, "BackgroundJob",
+              STACK_SIZE,        // Stack size
+              this,              // Parameters
+              tskIDLE_PRIORITY,  // Priority: below the main loop and render tasks, it gets the CPU they leave
+              &task              // Task handle
+  );
+  if (!task) {
+    LOG_ERR("JOB", "Failed to create the background job task");
+    activity = nullptr;
+    running = false;
+    unjoined = false;
+    return false;
+  }
+  // Until the task holds the lock, the activity could be left and deleted under it
+  xSemaphoreTake(lockHeld, portMAX_DELAY);
+  return true;
+}
+
+void BackgroundJob::wait() {
+  if (unjoined) {
+    xSemaphoreTake(finished, portMAX_DELAY);
+    unjoined = false;
+  }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <atomic>
+
+class Activity;
+
+/*
+Runs a piece of the main loop's idle work (a sleep cover to decode, say) on a task of its own at a lower priority than
+the main loop, so the main loop keeps reading the buttons while it runs. Only one job runs at a time.
+
+A job holds the render lock of the activity on screen, as a render would, so the activity's render task stays off the
+SD card and the frame buffer. The main loop leaves the activity alone while a job runs, and when a button is pressed it
+waits for the job to end before passing the press on: it is handled late instead of being lost.
+*/
+class BackgroundJob {
+  // Static instance
+  static BackgroundJob instance;
+
+  Activity* activity = nullptr;
+  void (*work)() = nullptr;
+  SemaphoreHandle_t lockHeld = nullptr;
+  SemaphoreHandle_t finished = nullptr;
+  std::atomic<bool> running{false};
+  bool unjoined = false;  // A job was started and wait() hasn't seen it end
+
+  static void taskTrampoline(void* param);
+
+ public:
+  static constexpr uint32_t STACK_SIZE = 8192;  // As the main loop's, where the work used to run
+
+  ~BackgroundJob() = default;
+
+  // Get singleton instance
+  static BackgroundJob& getInstance() { return instance; }
+
+  // Run work on a new task, holding the render lock of activity (or of its sub-activity on screen). Returns once the
+  // lock is held; false if the task couldn't be created.
+  bool start(Activity& activity, void (*work)());
+  bool isRunning() const { return running.load(); }
+  // Block until the running job, if any, has ended
+  void wait();
+};
+
+#define BACKGROUND_JOB BackgroundJob::getInstance()
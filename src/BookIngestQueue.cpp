@@ -0,0 +1,216 @@
+#include "BookIngestQueue.h"
+
+#include <Arduino.h>
+#include <EpdFontFamily.h>
+#include <Epub.h>
+#include <Epub/Page.h>
+#include <Epub/Section.h>
+#include <GfxRenderer.h>
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "CacheManager.h"
+#include "CrossPointSettings.h"
+#include "LibraryIndex.h"
+#include "activities/reader/EpubReaderActivity.h"
+#include "components/UITheme.h"
+#include "util/StringUtils.h"
+
+namespace {
+constexpr uint8_t INGEST_QUEUE_FILE_VERSION = 1;
+constexpr char CACHE_DIR[] = "/.crosspoint";
+constexpr char INGEST_QUEUE_FILE[] = "/.crosspoint/ingest.bin";
+
+// Indexed by BookIngestQueue::Step
+constexpr const char* STEP_NAMES[] = {"metadata", "styles", "thumbnail", "first section"};
+}  // namespace
+
+BookIngestQueue BookIngestQueue::instance;
+
+void BookIngestQueue::enqueue(const std::string& path) {
+  if (!StringUtils::checkFileExtension(path, ".epub")) {
+    return;
+  }
+  // Uploaded again: start over, the content may have changed
+  remove(path);
+  if (books.size() >= MAX_BOOKS) {
+    LOG_DBG("ING", "Queue full, dropping %s", books.front().path.c_str());
+    books.erase(books.begin());
+  }
+  books.push_back({path});
+  LOG_DBG("ING", "Queued %s (%zu waiting)", path.c_str(), books.size());
+  saveToFile();
+}
+
+void BookIngestQueue::bookOpened(const std::string& path) {
+  readerOpen = true;
+  const size_t before = books.size();
+  remove(path);
+  if (books.size() != before) {
+    LOG_DBG("ING", "Opened before it was prepared: %s", path.c_str());
+    saveToFile();
+  }
+}
+
+void BookIngestQueue::remove(const std::string& path) {
+  books.erase(std::remove_if(books.begin(), books.end(), [&](const Book& book) { return book.path == path; }),
+              books.end());
+}
+
+BookIngestQueue::Book* BookIngestQueue::nextBook(const bool canLayOut) {
+  const auto it = std::find_if(books.begin(), books.end(),
+                               [canLayOut](const Book& book) { return canLayOut || book.next < Step::FirstSection; });
+  return it != books.end() ? &*it : nullptr;
+}
+
+bool BookIngestQueue::hasWork(const bool canLayOut) { return !readerOpen && nextBook(canLayOut); }
+
+bool BookIngestQueue::runStep(Book& book, GfxRenderer* renderer) const {
+  if (!Storage.exists(book.path.c_str())) {
+    return false;  // Deleted or moved since it was queued
+  }
+
+  // The reader loads CSS only with embedded styles on; only then does the first section depend on it
+  const bool skipCss = SETTINGS.embeddedStyle == 0;
+  auto epub = std::make_shared<Epub>(book.path, CACHE_DIR);
+  switch (book.next) {
+    case Step::Metadata:
+      if (!epub->load(true, true)) {
+        return false;
+      }
+      LIBRARY_INDEX.updateBook(book.path, epub->getTitle(), epub->getAuthor(), epub->getSeries(), epub->getLanguage(),
+                               epub->getThumbBmpPath());
+      // A new arrival counts as opened, so the cache manager doesn't trim what is prepared for it first
+      CACHE_MANAGER.touch(epub->getCachePath());
+      book.next = skipCss ? Step::Thumbnail : Step::Styles;
+      return true;
+
+    case Step::Styles:
+      // Parses the CSS files and writes their cache when it is missing
+      if (!epub->load(false, false)) {
+        return false;
+      }
+      book.next = Step::Thumbnail;
+      return true;
+
+    case Step::Thumbnail:
+      if (!epub->load(false, true)) {
+        return false;
+      }
+      // A book without a usable cover has no thumbnail, which isn't a reason to stop
+      epub->generateThumbBmp(UITheme::getInstance().getMetrics().homeCoverHeight);
+      book.next = Step::FirstSection;
+      return true;
+
+    case Step::FirstSection: {
+      if (!renderer || !epub->load(false, skipCss)) {
+        return false;
+      }
+      // Where the reader starts a book it opens for the first time
+      const int spineIndex = epub->getSpineIndexForTextReference();
+      if (spineIndex >= 0 && spineIndex < epub->getSpineItemsCount()) {
+        uint16_t viewportWidth = 0;
+        uint16_t viewportHeight = 0;
+        EpubReaderActivity::getSectionViewport(*renderer, viewportWidth, viewportHeight);
+        const bool useBold = SETTINGS.forceBoldText == 1;
+        Section section(epub, spineIndex, *renderer);
+        EpdFontFamily::globalForceBold = useBold;
+        if (!section.loadSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
+                                     SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, viewportWidth,
+                                     viewportHeight, SETTINGS.hyphenationEnabled, SETTINGS.embeddedStyle, useBold)) {
+          section.createSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
+                                    SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, viewportWidth,
+                                    viewportHeight, SETTINGS.hyphenationEnabled, SETTINGS.embeddedStyle, useBold);
+        }
+        EpdFontFamily::globalForceBold = false;
+      }
+      book.next = Step::Done;
+      return true;
+    }
+
+    case Step::Done:
+      break;
+  }
+  return true;
+}
+
+bool BookIngestQueue::step(GfxRenderer* renderer) {
+  if (readerOpen) {
+    return false;
+  }
+  Book* book = nextBook(renderer != nullptr);
+  if (!book) {
+    return false;
+  }
+
+  const char* stepName = STEP_NAMES[static_cast<uint8_t>(book->next)];
+  const uint32_t start = millis();
+  const bool prepared = runStep(*book, renderer);
+  LOG_DBG("ING", "%s: %s %s in %lu ms", book->path.c_str(), stepName, prepared ? "done" : "failed",
+          millis() - start);
+  if (!prepared || book->next == Step::Done) {
+    const std::string path = book->path;
+    remove(path);
+  }
+  saveToFile();
+  return hasWork(renderer != nullptr);
+}
+
+bool BookIngestQueue::saveToFile() const {
+  Storage.mkdir(CACHE_DIR);
+
+  if (books.empty()) {
+    Storage.remove(INGEST_QUEUE_FILE);
+    return true;
+  }
+
+  FsFile outputFile;
+  if (!Storage.openFileForWrite("ING", INGEST_QUEUE_FILE, outputFile)) {
+    return false;
+  }
+
+  serialization::writePod(outputFile, INGEST_QUEUE_FILE_VERSION);
+  serialization::writePod(outputFile, static_cast<uint8_t>(books.size()));
+  for (const auto& book : books) {
+    serialization::writeString(outputFile, book.path);
+    serialization::writePod(outputFile, static_cast<uint8_t>(book.next));
+  }
+  outputFile.close();
+  return true;
+}
+
+bool BookIngestQueue::loadFromFile() {
+  FsFile inputFile;
+  if (!Storage.exists(INGEST_QUEUE_FILE) || !Storage.openFileForRead("ING", INGEST_QUEUE_FILE, inputFile)) {
+    return false;
+  }
+
+  uint8_t version;
+  serialization::readPod(inputFile, version);
+  if (version != INGEST_QUEUE_FILE_VERSION) {
+    LOG_ERR("ING", "Deserialization failed: Unknown version %u", version);
+    inputFile.close();
+    return false;
+  }
+
+  uint8_t count = 0;
+  serialization::readPod(inputFile, count);
+  books.clear();
+  for (uint8_t i = 0; i < count && i < MAX_BOOKS; i++) {
+    Book book;
+    uint8_t next = 0;
+    serialization::readString(inputFile, book.path);
+    serialization::readPod(inputFile, next);
+    if (next < static_cast<uint8_t>(Step::Done)) {
+      book.next = static_cast<Step>(next);
+      books.push_back(std::move(book));
+    }
+  }
+  inputFile.close();
+  LOG_DBG("ING", "Ingest queue loaded (%zu books)", books.size());
+  return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GfxRenderer;
+
+/*
+EPUBs that arrived over WiFi (web upload, OPDS download) and haven't been opened yet. Opening a new EPUB builds
+book.bin, parses its CSS and lays out the first chapter while the user waits; the queue does that work beforehand.
+
+Each book goes through four steps: metadata (book.bin, also reported to the library index), CSS cache, home screen
+thumbnail, and the first section in the reader's current layout. step() does one of them for one book, so memory is
+bounded by what opening a single book takes, and a step lasts up to a few seconds. Laying out text needs the renderer,
+so a caller without one (the web server task) only does the first three and leaves the section for the main loop.
+
+Opening a book takes it off the queue (the reader builds whatever is still missing) and pauses the queue until the
+reader is closed. The queue is kept in /.crosspoint/ingest.bin, so books still waiting when the device sleeps are
+prepared after the next boot.
+
+Not thread-safe: only the task that owns the SD card may call it, i.e. the web server task while the server runs and the
+main loop otherwise. The main loop runs step() as a BackgroundJob, so the buttons are still read while it works.
+*/
+class BookIngestQueue {
+  // Static instance
+  static BookIngestQueue instance;
+
+  enum class Step : uint8_t { Metadata, Styles, Thumbnail, FirstSection, Done };
+
+  struct Book {
+    std::string path;
+    Step next = Step::Metadata;
+  };
+
+  std::vector<Book> books;
+  bool readerOpen = false;
+
+  // First book with a step that can be done with or without a renderer, nullptr if none
+  Book* nextBook(bool canLayOut);
+  // Do book.next; false if the book can't be prepared (missing, not a valid EPUB)
+  bool runStep(Book& book, GfxRenderer* renderer) const;
+  void remove(const std::string& path);
+
+ public:
+  // Books waiting beyond this drop the oldest: it is prepared when first opened, as before
+  static constexpr size_t MAX_BOOKS = 32;
+
+  ~BookIngestQueue() = default;
+
+  // Get singleton instance
+  static BookIngestQueue& getInstance() { return instance; }
+
+  // A book was written to path; anything other than an EPUB is ignored
+  void enqueue(const std::string& path);
+  // The reader opened the book at path: stop preparing it, and pause until bookClosed()
+  void bookOpened(const std::string& path);
+  void bookClosed() { readerOpen = false; }
+
+  // Whether step() has anything to do, with or without a renderer
+  bool hasWork(bool canLayOut);
+  // One step of one book. Without a renderer, first sections are left for a later call with one. Returns true while
+  // there is more to do (call again soon).
+  bool step(GfxRenderer* renderer);
+
+  bool saveToFile() const;
+  bool loadFromFile();
+};
+
+// Helper macro to access the ingest queue
+#define BOOK_INGEST BookIngestQueue::getInstance()
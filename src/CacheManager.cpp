@@ -0,0 +1,408 @@
+#include "CacheManager.h"
+
+#include <Arduino.h>
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+
+#include <algorithm>
+
+#include "util/StringUtils.h"
+
+namespace {
+constexpr uint8_t CACHE_MANIFEST_FILE_VERSION = 1;
+constexpr char CACHE_DIR[] = "/.crosspoint";
+constexpr char CACHE_MANIFEST_FILE[] = "/.crosspoint/cache.bin";
+constexpr uint64_t CACHE_BUDGET_BYTES = static_cast<uint64_t>(CACHE_BUDGET_MB) * 1024 * 1024;
+// Books grow while read (new chapters, layouts, images), so sizes are re-measured this often even without an open
+constexpr unsigned long PASS_INTERVAL_MS = 10 * 60 * 1000;
+// Files deleted per step: keeps a step to a few tens of milliseconds on a slow card
+constexpr size_t FILES_PER_STEP = 8;
+// Directory entries read per step while listing or measuring; each one is an open and a close on the card
+constexpr size_t ENTRIES_PER_STEP = 32;
+constexpr size_t MAX_BOOKS = 1000;
+
+bool isBookCacheDir(const std::string& name) {
+  return name.rfind("epub_", 0) == 0 || name.rfind("xtc_", 0) == 0 || name.rfind("txt_", 0) == 0;
+}
+
+bool isImageCache(const std::string& name) { return StringUtils::checkFileExtension(name, ".pxc"); }
+
+bool isExtractedImage(const std::string& name) { return name.rfind("img_", 0) == 0 && !isImageCache(name); }
+
+// Read up to ENTRIES_PER_STEP entries of dir, closing it once they run out; true when it did
+template <typename Visitor>
+bool readSome(FsFile& dir, Visitor visit) {
+  char name[128];
+  for (size_t i = 0; i < ENTRIES_PER_STEP; i++) {
+    auto file = dir.openNextFile();
+    if (!file) {
+      dir.close();
+      return true;
+    }
+    file.getName(name, sizeof(name));
+    visit(std::string(name), file);
+    file.close();
+  }
+  return false;
+}
+
+// Delete up to FILES_PER_STEP files in path that match; returns bytes freed. `more` is cleared once none are left.
+template <typename Matcher>
+uint32_t removeMatching(const std::string& path, Matcher matches, bool& more) {
+  auto dir = Storage.open(path.c_str());
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    more = false;
+    return 0;
+  }
+  std::vector<std::pair<std::string, uint32_t>> victims;
+  char name[128];
+  for (auto file = dir.openNextFile(); file && victims.size() < FILES_PER_STEP; file = dir.openNextFile()) {
+    file.getName(name, sizeof(name));
+    if (!file.isDirectory() && matches(std::string(name))) {
+      victims.emplace_back(path + "/" + name, file.size());
+    }
+    file.close();
+  }
+  dir.close();
+
+  uint32_t freed = 0;
+  for (const auto& victim : victims) {
+    if (Storage.remove(victim.first.c_str())) {
+      freed += victim.second;
+    } else {
+      LOG_ERR("CMG", "Failed to remove %s", victim.first.c_str());
+    }
+  }
+  more = victims.size() == FILES_PER_STEP;
+  return freed;
+}
+}  // namespace
+
+CacheManager CacheManager::instance;
+
+CacheManager::BookEntry* CacheManager::findBook(const std::string& dir) {
+  const auto it = std::find_if(books.begin(), books.end(), [&](const BookEntry& book) { return book.dir == dir; });
+  return it != books.end() ? &*it : nullptr;
+}
+
+uint64_t CacheManager::totalBytes() const {
+  uint64_t total = 0;
+  for (const auto& book : books) {
+    total += static_cast<uint64_t>(book.imageBytes) + book.sectionBytes + book.otherBytes;
+  }
+  return total;
+}
+
+void CacheManager::touch(const std::string& cachePath) {
+  const std::string dir = cachePath.substr(cachePath.find_last_of('/') + 1);
+  BookEntry* book = findBook(dir);
+  if (!book) {
+    books.push_back({dir});
+    book = &books.back();
+  }
+  book->lastAccess = ++accessClock;
+  book->measured = false;
+  dirty = true;
+  passRequested = true;
+  saveToFile();
+}
+
+void CacheManager::requestPass() {
+  // Whatever was being walked may be gone: start over from the listing
+  closeScan();
+  if (phase == Phase::List || phase == Phase::Measure) {
+    phase = Phase::Idle;
+  }
+  passRequested = true;
+}
+
+bool CacheManager::openScan(const std::string& path) {
+  scanDir = Storage.open(path.c_str());
+  if (scanDir && scanDir.isDirectory()) {
+    return true;
+  }
+  if (scanDir) scanDir.close();
+  return false;
+}
+
+void CacheManager::closeScan() {
+  if (scanDir) scanDir.close();
+  listed.clear();
+  measuring.clear();
+  scanSubdir.clear();
+  scanQueue.clear();
+}
+
+bool CacheManager::listSome() {
+  if (!scanDir) {
+    if (!openScan(CACHE_DIR)) {
+      books.clear();
+      return true;
+    }
+    listed.clear();
+    listStartClock = accessClock;
+  }
+  const bool done = readSome(scanDir, [this](const std::string& name, FsFile& file) {
+    if (file.isDirectory() && isBookCacheDir(name) && listed.size() < MAX_BOOKS) {
+      listed.push_back({name});
+    }
+  });
+  if (!done) {
+    return false;
+  }
+
+  // Manifest entries are looked up only now, so opens during the listing aren't lost. A book the manifest doesn't
+  // know yet (added while off, or the manifest was lost) counts as opened now, not as the first thing to trim.
+  for (auto& entry : listed) {
+    if (const BookEntry* known = findBook(entry.dir)) {
+      entry = *known;
+    } else {
+      entry.lastAccess = accessClock;
+    }
+  }
+  // A book first opened after the listing went past its directory is kept too
+  for (const auto& book : books) {
+    if (book.lastAccess > listStartClock &&
+        std::none_of(listed.begin(), listed.end(), [&](const BookEntry& entry) { return entry.dir == book.dir; })) {
+      listed.push_back(book);
+    }
+  }
+
+  // The open book keeps growing, so the most recent one is always measured again
+  const auto newest = std::max_element(listed.begin(), listed.end(), [](const BookEntry& a, const BookEntry& b) {
+    return a.lastAccess < b.lastAccess;
+  });
+  if (newest != listed.end()) {
+    newest->measured = false;
+  }
+  if (listed.size() != books.size()) {
+    dirty = true;
+  }
+  books = std::move(listed);
+  listed.clear();
+  return true;
+}
+
+bool CacheManager::measureSome(BookEntry& book) {
+  const std::string path = std::string(CACHE_DIR) + "/" + book.dir;
+  if (measuring != book.dir) {
+    closeScan();
+    book.imageBytes = 0;
+    book.sectionBytes = 0;
+    book.otherBytes = 0;
+    if (!openScan(path)) {
+      book.measured = true;
+      return true;
+    }
+    measuring = book.dir;
+  }
+
+  bool done;
+  if (scanSubdir.empty()) {
+    done = readSome(scanDir, [&](const std::string& name, FsFile& file) {
+      if (file.isDirectory()) {
+        scanQueue.push_back(name);
+      } else if (isImageCache(name)) {
+        book.imageBytes += file.size();
+      } else if (isExtractedImage(name)) {
+        book.sectionBytes += file.size();
+      } else {
+        book.otherBytes += file.size();
+      }
+    });
+  } else {
+    // Only the files directly in a subdirectory count, as laid out by the readers
+    uint32_t& tierBytes = scanSubdir == "sections" ? book.sectionBytes : book.otherBytes;
+    done = readSome(scanDir, [&](const std::string&, FsFile& file) {
+      if (!file.isDirectory()) {
+        tierBytes += file.size();
+      }
+    });
+  }
+  while (done && !scanQueue.empty()) {
+    scanSubdir = scanQueue.back();
+    scanQueue.pop_back();
+    done = !openScan(path + "/" + scanSubdir);
+  }
+  if (!done) {
+    return false;
+  }
+
+  measuring.clear();
+  scanSubdir.clear();
+  book.measured = true;
+  LOG_DBG("CMG", "%s: images %lu, sections %lu, other %lu bytes", book.dir.c_str(),
+          static_cast<unsigned long>(book.imageBytes), static_cast<unsigned long>(book.sectionBytes),
+          static_cast<unsigned long>(book.otherBytes));
+  return true;
+}
+
+bool CacheManager::evictSome() {
+  if (books.size() < 2) {
+    return false;
+  }
+  // Never the most recently opened book: it is most likely the one on screen
+  const uint32_t newestAccess =
+      std::max_element(books.begin(), books.end(), [](const BookEntry& a, const BookEntry& b) {
+        return a.lastAccess < b.lastAccess;
+      })->lastAccess;
+
+  // Oldest book that still has images; failing that, the oldest that still has sections
+  BookEntry* victim = nullptr;
+  bool images = true;
+  for (const bool imageTier : {true, false}) {
+    for (auto& book : books) {
+      const uint32_t tierBytes = imageTier ? book.imageBytes : book.sectionBytes;
+      if ((newestAccess > 0 && book.lastAccess == newestAccess) || tierBytes == 0) {
+        continue;
+      }
+      if (!victim || book.lastAccess < victim->lastAccess) {
+        victim = &book;
+      }
+    }
+    if (victim) {
+      images = imageTier;
+      break;
+    }
+  }
+  if (!victim) {
+    return false;
+  }
+
+  const std::string path = std::string(CACHE_DIR) + "/" + victim->dir;
+  bool more = false;
+  if (images) {
+    const uint32_t freed = removeMatching(path, isImageCache, more);
+    victim->imageBytes = more ? victim->imageBytes - std::min(freed, victim->imageBytes) : 0;
+  } else {
+    const auto anyFile = [](const std::string&) { return true; };
+    uint32_t freed = removeMatching(path + "/sections", anyFile, more);
+    if (!more) {
+      Storage.rmdir((path + "/sections").c_str());
+      freed += removeMatching(path, isExtractedImage, more);
+    }
+    victim->sectionBytes = more ? victim->sectionBytes - std::min(freed, victim->sectionBytes) : 0;
+  }
+  LOG_DBG("CMG", "Trimmed %s of %s (%s)", images ? "image caches" : "sections", victim->dir.c_str(),
+          more ? "more to go" : "done");
+  dirty = true;
+  return true;
+}
+
+void CacheManager::finishPass() {
+  phase = Phase::Idle;
+  lastPassEnd = millis();
+  if (dirty) {
+    saveToFile();
+  }
+}
+
+bool CacheManager::step() {
+  switch (phase) {
+    case Phase::Idle:
+      if (!passRequested && millis() - lastPassEnd < PASS_INTERVAL_MS) {
+        return false;
+      }
+      passRequested = false;
+      phase = Phase::List;
+      return true;
+
+    case Phase::List:
+      if (listSome()) {
+        phase = Phase::Measure;
+      }
+      return true;
+
+    case Phase::Measure: {
+      // Finish the book already being walked before starting another
+      BookEntry* book = measuring.empty() ? nullptr : findBook(measuring);
+      if (!book) {
+        const auto it = std::find_if(books.begin(), books.end(), [](const BookEntry& b) { return !b.measured; });
+        book = it != books.end() ? &*it : nullptr;
+      }
+      if (book) {
+        if (measureSome(*book)) {
+          dirty = true;
+        }
+        return true;
+      }
+      const uint64_t total = totalBytes();
+      LOG_DBG("CMG", "%zu books cache %llu KB (budget %d MB)", books.size(),
+              static_cast<unsigned long long>(total / 1024), CACHE_BUDGET_MB);
+      if (total <= CACHE_BUDGET_BYTES) {
+        finishPass();
+        return false;
+      }
+      phase = Phase::Evict;
+      return true;
+    }
+
+    case Phase::Evict:
+      if (totalBytes() <= CACHE_BUDGET_BYTES || !evictSome()) {
+        finishPass();
+        return false;
+      }
+      return true;
+  }
+  return false;
+}
+
+bool CacheManager::saveToFile() {
+  Storage.mkdir(CACHE_DIR);
+
+  FsFile outputFile;
+  if (!Storage.openFileForWrite("CMG", CACHE_MANIFEST_FILE, outputFile)) {
+    return false;
+  }
+
+  serialization::writePod(outputFile, CACHE_MANIFEST_FILE_VERSION);
+  serialization::writePod(outputFile, accessClock);
+  serialization::writePod(outputFile, static_cast<uint16_t>(books.size()));
+  for (const auto& book : books) {
+    serialization::writeString(outputFile, book.dir);
+    serialization::writePod(outputFile, book.lastAccess);
+    serialization::writePod(outputFile, book.imageBytes);
+    serialization::writePod(outputFile, book.sectionBytes);
+    serialization::writePod(outputFile, book.otherBytes);
+    serialization::writePod(outputFile, book.measured);
+  }
+  outputFile.close();
+  dirty = false;
+  return true;
+}
+
+bool CacheManager::loadFromFile() {
+  FsFile inputFile;
+  if (!Storage.openFileForRead("CMG", CACHE_MANIFEST_FILE, inputFile)) {
+    return false;
+  }
+
+  uint8_t version;
+  serialization::readPod(inputFile, version);
+  if (version != CACHE_MANIFEST_FILE_VERSION) {
+    LOG_ERR("CMG", "Deserialization failed: Unknown version %u", version);
+    inputFile.close();
+    return false;
+  }
+
+  uint16_t count = 0;
+  serialization::readPod(inputFile, accessClock);
+  serialization::readPod(inputFile, count);
+  books.clear();
+  books.reserve(std::min<size_t>(count, MAX_BOOKS));
+  for (uint16_t i = 0; i < count && i < MAX_BOOKS; i++) {
+    BookEntry book;
+    serialization::readString(inputFile, book.dir);
+    serialization::readPod(inputFile, book.lastAccess);
+    serialization::readPod(inputFile, book.imageBytes);
+    serialization::readPod(inputFile, book.sectionBytes);
+    serialization::readPod(inputFile, book.otherBytes);
+    serialization::readPod(inputFile, book.measured);
+    books.push_back(std::move(book));
+  }
+  inputFile.close();
+  LOG_DBG("CMG", "Cache manifest loaded (%zu books)", books.size());
+  return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <HalStorage.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef CACHE_BUDGET_MB
+#define CACHE_BUDGET_MB 512  // SD space the book caches in /.crosspoint may take before the oldest are trimmed
+#endif
+
+/*
+Keeps the per-book cache directories in /.crosspoint (epub_*, xtc_*, txt_*) under CACHE_BUDGET_MB.
+
+A manifest records, per book directory, when the book was last opened and how many bytes each kind of artifact takes:
+- images: decoded image caches (*.pxc), redrawn from the extracted image when missing
+- sections: laid-out chapters (sections/) and the img_* files the next indexing extracts again
+- other: book.bin, covers, thumbnails, progress. Never evicted.
+
+step() does one bounded piece of work (read a few directory entries while listing or measuring, or delete a few files)
+and is meant to be called from the main loop while the device is idle, so trimming never holds up the reader. Listing
+/.crosspoint and measuring a book resume where the previous step stopped, however many files they hold.
+Over budget, image caches of the least recently opened books go first, then their sections. The most recently opened
+book is never trimmed; a book first seen by the listing counts as opened then.
+*/
+class CacheManager {
+  // Static instance
+  static CacheManager instance;
+
+  struct BookEntry {
+    std::string dir;          // Directory name in /.crosspoint
+    uint32_t lastAccess = 0;  // accessClock when the book was last opened (or first listed)
+    uint32_t imageBytes = 0;
+    uint32_t sectionBytes = 0;
+    uint32_t otherBytes = 0;
+    bool measured = false;  // Sizes are current
+  };
+
+  enum class Phase : uint8_t { Idle, List, Measure, Evict };
+
+  std::vector<BookEntry> books;
+  uint32_t accessClock = 0;  // Bumped on every open; orders books without needing a wall clock
+  Phase phase = Phase::Idle;
+  bool passRequested = true;  // First idle moment after boot picks up books added or removed while off
+  bool dirty = false;         // Manifest differs from the file
+  unsigned long lastPassEnd = 0;
+
+  // Directory walk in progress, kept open across steps
+  FsFile scanDir;
+  std::vector<BookEntry> listed;       // List: book directories read so far
+  uint32_t listStartClock = 0;         // List: accessClock when the listing started
+  std::string measuring;               // Measure: book being walked, empty between books
+  std::string scanSubdir;              // Measure: subdirectory being read, empty for the book's own directory
+  std::vector<std::string> scanQueue;  // Measure: subdirectories still to read
+
+  BookEntry* findBook(const std::string& dir);
+  uint64_t totalBytes() const;
+  bool openScan(const std::string& path);
+  void closeScan();
+  // Read a step's worth of /.crosspoint; true once the book list is up to date
+  bool listSome();
+  // Read a step's worth of the book's files; true once its sizes are current
+  bool measureSome(BookEntry& book);
+  // Delete up to a step's worth of the victim's lowest tier; false once no book is left to trim
+  bool evictSome();
+  void finishPass();
+
+ public:
+  // How long the buttons must have been left alone before step() is called
+  static constexpr unsigned long IDLE_DELAY_MS = 3000;
+
+  ~CacheManager() = default;
+
+  // Get singleton instance
+  static CacheManager& getInstance() { return instance; }
+
+  // Record that the book cached in cachePath (e.g. "/.crosspoint/epub_123") was just opened
+  void touch(const std::string& cachePath);
+  // Re-check sizes at the next idle moment, e.g. after caches were deleted behind the manager's back
+  void requestPass();
+
+  // One bounded unit of housekeeping. Returns true while a pass is in progress (call again soon).
+  bool step();
+
+  bool saveToFile();
+  bool loadFromFile();
+};
+
+// Helper macro to access the cache manager
+#define CACHE_MANAGER CacheManager::getInstance()
@@ -134,6 +134,7 @@ uint8_t CrossPointSettings::writeSettings(FsFile& file, bool count_only) const {
   writer.writeItem(file, forceBoldText);
   writer.writeItem(file, swapPortraitControls);
   writer.writeItem(file, swapLandscapeControls);
+  writer.writeItem(file, librarySort);
 
   return writer.item_count;
 }
@@ -269,6 +270,9 @@ bool CrossPointSettings::loadFromFile() {
     serialization::readPod(inputFile, swapLandscapeControls);
     if (++settingsRead >= fileSettingsCount) break;
 
+    readAndValidate(inputFile, librarySort, LIBRARY_SORT_COUNT);
+    if (++settingsRead >= fileSettingsCount) break;
+
   } while (false);
 
   if (frontButtonMappingRead) {
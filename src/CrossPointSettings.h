@@ -87,6 +87,8 @@ class CrossPointSettings {
   enum HIDE_BATTERY_PERCENTAGE { HIDE_NEVER = 0, HIDE_READER = 1, HIDE_ALWAYS = 2, HIDE_BATTERY_PERCENTAGE_COUNT };
   // UI Theme
   enum UI_THEME { CLASSIC = 0, LYRA = 1, LYRA_3_COVERS = 2 };
+  // My Library order; all but the file name come from the library index
+  enum LIBRARY_SORT { SORT_FILE_NAME = 0, SORT_TITLE = 1, SORT_AUTHOR = 2, SORT_SERIES = 3, LIBRARY_SORT_COUNT };
 
   uint8_t sleepScreen = DARK;
   uint8_t sleepScreenCoverMode = FIT;
@@ -122,6 +124,7 @@ class CrossPointSettings {
   uint8_t forceBoldText = 0;
   uint8_t swapPortraitControls = 0;
   uint8_t swapLandscapeControls = 0;
+  uint8_t librarySort = SORT_FILE_NAME;
   uint8_t highlightModeEnabled = 1;  // --- HIGHLIGHT MODE --- enable/disable highlight feature
 
   ~CrossPointSettings() = default;
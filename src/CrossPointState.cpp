@@ -1,42 +1,40 @@
 #include "CrossPointState.h"
 
-#include <HalStorage.h>
 #include <Logging.h>
+#include <RecordJournal.h>
 #include <Serialization.h>
 
+#include <sstream>
+
 namespace {
 constexpr uint8_t STATE_FILE_VERSION = 4;
-constexpr char STATE_FILE[] = "/.crosspoint/state.bin";
+constexpr char STATE_FILE[] = "/.crosspoint/state.bin";  // Before the journal
+RecordJournal stateJournal("/.crosspoint/state", STATE_FILE);
 }  // namespace
 
 CrossPointState CrossPointState::instance;
 
 bool CrossPointState::saveToFile() const {
-  FsFile outputFile;
-  if (!Storage.openFileForWrite("CPS", STATE_FILE, outputFile)) {
-    return false;
-  }
-
+  std::ostringstream outputFile;
   serialization::writePod(outputFile, STATE_FILE_VERSION);
   serialization::writeString(outputFile, openEpubPath);
   serialization::writePod(outputFile, lastSleepImage);
   serialization::writePod(outputFile, readerActivityLoadCount);
   serialization::writePod(outputFile, lastSleepFromReader);
-  outputFile.close();
-  return true;
+  return stateJournal.append(outputFile.str());
 }
 
 bool CrossPointState::loadFromFile() {
-  FsFile inputFile;
-  if (!Storage.openFileForRead("CPS", STATE_FILE, inputFile)) {
+  std::string record;
+  if (!stateJournal.load(record)) {
     return false;
   }
+  std::istringstream inputFile(record);
 
   uint8_t version;
   serialization::readPod(inputFile, version);
   if (version > STATE_FILE_VERSION) {
     LOG_ERR("CPS", "Deserialization failed: Unknown version %u", version);
-    inputFile.close();
     return false;
   }
 
@@ -57,6 +55,5 @@ bool CrossPointState::loadFromFile() {
     lastSleepFromReader = false;
   }
 
-  inputFile.close();
   return true;
 }
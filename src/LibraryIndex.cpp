@@ -0,0 +1,484 @@
+#include "LibraryIndex.h"
+
+#include <BufferedFile.h>
+#include <Epub.h>
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+#include <Xtc.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#include "util/StringUtils.h"
+
+namespace {
+constexpr uint8_t LIBRARY_INDEX_FILE_VERSION = 1;
+constexpr char LIBRARY_INDEX_DIR[] = "/.crosspoint/library";
+// Books read between writes of the directory's file; the rest are read again if the device sleeps first
+constexpr size_t SAVE_EVERY_BOOKS = 8;
+constexpr size_t MAX_ENTRIES = UINT16_MAX;
+// What an allocation costs besides its bytes
+constexpr size_t HEAP_OVERHEAD = 8;
+
+std::string indexFilePath(const std::string& dir) {
+  uint32_t hash = 2166136261u;
+  for (const char c : dir) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  char name[16];
+  snprintf(name, sizeof(name), "/%08lx.bin", static_cast<unsigned long>(hash));
+  return LIBRARY_INDEX_DIR + std::string(name);
+}
+
+std::string joinPath(const std::string& dir, const std::string& name) {
+  return dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+// "/Books/a.epub" -> "/Books" and "a.epub"
+void splitPath(const std::string& path, std::string& dir, std::string& name) {
+  const size_t slash = path.find_last_of('/');
+  dir = slash == 0 || slash == std::string::npos ? "/" : path.substr(0, slash);
+  name = slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+uint32_t modifiedTime(FsFile& file) {
+  uint16_t date = 0;
+  uint16_t time = 0;
+  file.getModifyDateTime(&date, &time);
+  return static_cast<uint32_t>(date) << 16 | time;
+}
+
+size_t entryBytes(const LibraryEntry& entry) {
+  const size_t textSize = entry.textSize();
+  return sizeof(LibraryEntry) + (textSize > 0 ? textSize + HEAP_OVERHEAD : 0);
+}
+}  // namespace
+
+LibraryEntry::LibraryEntry(const LibraryEntry& other)
+    : fileSize(other.fileSize), modified(other.modified), progress(other.progress), indexed(other.indexed) {
+  if (other.text) {
+    const size_t size = other.textSize();
+    text.reset(new char[size]);
+    memcpy(text.get(), other.text.get(), size);
+  }
+}
+
+LibraryEntry& LibraryEntry::operator=(const LibraryEntry& other) {
+  if (this != &other) {
+    *this = LibraryEntry(other);
+  }
+  return *this;
+}
+
+bool LibraryEntry::isDirectory() const {
+  const char* entryName = name();
+  const size_t length = strlen(entryName);
+  return length > 0 && entryName[length - 1] == '/';
+}
+
+void LibraryEntry::setText(const char* name, const char* title, const char* author, const char* series,
+                           const char* language, const char* thumbBmpPath) {
+  const char* fields[FIELD_COUNT] = {name, title, author, series, language, thumbBmpPath};
+  size_t lengths[FIELD_COUNT];
+  size_t size = 0;
+  for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+    lengths[i] = strlen(fields[i]);
+    size += lengths[i] + 1;
+  }
+  if (size == FIELD_COUNT) {
+    text.reset();
+    return;
+  }
+  // The fields may point into the current text: it is replaced only once they are copied
+  std::unique_ptr<char[]> packed(new char[size]);
+  char* out = packed.get();
+  for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+    memcpy(out, fields[i], lengths[i] + 1);
+    out += lengths[i] + 1;
+  }
+  text = std::move(packed);
+}
+
+size_t LibraryEntry::textSize() const {
+  if (!text) {
+    return 0;
+  }
+  const char* end = text.get();
+  for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+    end += strlen(end) + 1;
+  }
+  return end - text.get();
+}
+
+const char* LibraryEntry::field(const uint8_t index) const {
+  if (!text) {
+    return "";
+  }
+  const char* value = text.get();
+  for (uint8_t i = 0; i < index; i++) {
+    value += strlen(value) + 1;
+  }
+  return value;
+}
+
+LibraryIndex LibraryIndex::instance;
+
+bool LibraryIndex::isBookFile(const std::string& name) {
+  return StringUtils::checkFileExtension(name, ".epub") || StringUtils::checkFileExtension(name, ".xtch") ||
+         StringUtils::checkFileExtension(name, ".xtc") || StringUtils::checkFileExtension(name, ".txt") ||
+         StringUtils::checkFileExtension(name, ".md");
+}
+
+void LibraryIndex::load(const std::string& dir) {
+  if (dir == loadedDir) {
+    return;
+  }
+  unload();
+  loadedDir = dir;
+  indexCursor = 0;
+  revision++;
+
+  BufferedFile file;
+  if (!file.openForRead("LIB", indexFilePath(dir))) {
+    return;
+  }
+  uint8_t version = 0;
+  std::string storedDir;
+  uint16_t count = 0;
+  serialization::readPod(file, version);
+  if (version != LIBRARY_INDEX_FILE_VERSION) {
+    LOG_ERR("LIB", "Deserialization failed: Unknown version %u", version);
+    file.close();
+    return;
+  }
+  serialization::readString(file, storedDir);
+  if (storedDir != dir) {
+    file.close();
+    return;  // Another directory with the same hash; this one's entries are rebuilt over it
+  }
+  serialization::readPod(file, count);
+  const uint32_t fileSize = file.size();
+  std::string name, title, author, series, language, thumbBmpPath;
+  size_t bytes = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    LibraryEntry entry;
+    uint8_t indexed = 0;
+    serialization::readString(file, name);
+    serialization::readPod(file, entry.fileSize);
+    serialization::readPod(file, entry.modified);
+    serialization::readString(file, title);
+    serialization::readString(file, author);
+    serialization::readString(file, series);
+    serialization::readString(file, language);
+    serialization::readString(file, thumbBmpPath);
+    serialization::readPod(file, entry.progress);
+    serialization::readPod(file, indexed);
+    if (file.position() > fileSize) {
+      break;  // Cut short while being written: the missing entries are found again by the next listing
+    }
+    entry.setText(name.c_str(), title.c_str(), author.c_str(), series.c_str(), language.c_str(),
+                  thumbBmpPath.c_str());
+    entry.indexed = indexed != 0;
+    bytes += entryBytes(entry);
+    if (bytes > MAX_BYTES) {
+      break;
+    }
+    entries.push_back(std::move(entry));
+  }
+  file.close();
+}
+
+bool LibraryIndex::save() {
+  if (loadedDir.empty()) {
+    return false;
+  }
+  Storage.mkdir(LIBRARY_INDEX_DIR);
+  BufferedFile file;
+  if (!file.openForWrite("LIB", indexFilePath(loadedDir))) {
+    return false;
+  }
+  serialization::writePod(file, LIBRARY_INDEX_FILE_VERSION);
+  serialization::writeString(file, loadedDir);
+  serialization::writePod(file, static_cast<uint16_t>(entries.size()));
+  for (const auto& entry : entries) {
+    serialization::writeString(file, std::string(entry.name()));
+    serialization::writePod(file, entry.fileSize);
+    serialization::writePod(file, entry.modified);
+    serialization::writeString(file, std::string(entry.title()));
+    serialization::writeString(file, std::string(entry.author()));
+    serialization::writeString(file, std::string(entry.series()));
+    serialization::writeString(file, std::string(entry.language()));
+    serialization::writeString(file, std::string(entry.thumbBmpPath()));
+    serialization::writePod(file, entry.progress);
+    serialization::writePod(file, static_cast<uint8_t>(entry.indexed));
+  }
+  file.close();
+  dirty = false;
+  indexedSinceSave = 0;
+  return true;
+}
+
+void LibraryIndex::unload() {
+  if (dirty) {
+    save();
+  }
+  loadedDir.clear();
+  entries.clear();
+  entries.shrink_to_fit();
+  dirty = false;
+}
+
+void LibraryIndex::scanDirectory() {
+  auto root = Storage.open(loadedDir.c_str());
+  if (!root || !root.isDirectory()) {
+    if (root) root.close();
+    if (!entries.empty()) {
+      entries.clear();
+      dirty = true;
+      revision++;
+    }
+    return;
+  }
+
+  std::unordered_map<std::string, size_t> known;
+  known.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    known.emplace(entries[i].name(), i);
+  }
+
+  std::vector<LibraryEntry> scanned;
+  scanned.reserve(entries.size());
+  bool changed = false;
+  size_t bytes = 0;
+  char name[500];
+  root.rewindDirectory();
+  for (auto file = root.openNextFile(); file && scanned.size() < MAX_ENTRIES; file = root.openNextFile()) {
+    file.getName(name, sizeof(name));
+    if (name[0] == '.' || strcmp(name, "System Volume Information") == 0) {
+      file.close();
+      continue;
+    }
+
+    LibraryEntry entry;
+    if (file.isDirectory()) {
+      entry = LibraryEntry(std::string(name) + "/");
+      entry.indexed = true;
+    } else if (isBookFile(name)) {
+      entry = LibraryEntry(name);
+      entry.fileSize = static_cast<uint32_t>(file.size());
+      entry.modified = modifiedTime(file);
+    } else {
+      file.close();
+      continue;
+    }
+    file.close();
+
+    const auto it = known.find(entry.name());
+    if (it != known.end()) {
+      LibraryEntry& old = entries[it->second];
+      if (entry.isDirectory() || (old.fileSize == entry.fileSize && old.modified == entry.modified)) {
+        entry = std::move(old);
+      } else {
+        changed = true;  // Replaced
+      }
+    } else {
+      changed = true;  // New
+    }
+    bytes += entryBytes(entry);
+    if (bytes > MAX_BYTES) {
+      LOG_DBG("LIB", "%s has more books than fit in memory, listing the first %zu", loadedDir.c_str(),
+              scanned.size());
+      break;
+    }
+    scanned.push_back(std::move(entry));
+  }
+  root.close();
+
+  if (changed || scanned.size() != entries.size()) {
+    entries = std::move(scanned);
+    dirty = true;
+    revision++;
+  }
+  indexCursor = 0;
+}
+
+bool LibraryIndex::readMetadata(LibraryEntry& entry, const bool allowBuild) const {
+  const std::string path = joinPath(loadedDir, entry.name());
+  const uint32_t start = millis();
+  if (StringUtils::checkFileExtension(path, ".epub")) {
+    if (!allowBuild) {
+      return false;  // Even finding its cache means fingerprinting the book
+    }
+    Epub epub(path, "/.crosspoint");
+    // Builds book.bin if the book was never opened; CSS isn't needed for metadata
+    if (epub.load(true, true)) {
+      entry.setText(entry.name(), epub.getTitle().c_str(), epub.getAuthor().c_str(), epub.getSeries().c_str(),
+                    epub.getLanguage().c_str(), epub.getThumbBmpPath().c_str());
+    }
+  } else if (StringUtils::checkFileExtension(path, ".xtch") || StringUtils::checkFileExtension(path, ".xtc")) {
+    Xtc xtc(path, "/.crosspoint");
+    if (xtc.load()) {
+      entry.setText(entry.name(), xtc.getTitle().c_str(), xtc.getAuthor().c_str(), "", "",
+                    xtc.getThumbBmpPath().c_str());
+    }
+  }
+  // Plain text has nothing to read; a book that fails to load isn't retried until the file changes
+  entry.indexed = true;
+  LOG_DBG("LIB", "Indexed %s in %lu ms", path.c_str(), millis() - start);
+  return true;
+}
+
+LibraryEntry* LibraryIndex::entryForBook(const std::string& path) {
+  FsFile stat = Storage.open(path.c_str());
+  if (!stat) {
+    return nullptr;
+  }
+  const auto fileSize = static_cast<uint32_t>(stat.size());
+  const uint32_t modified = modifiedTime(stat);
+  stat.close();
+
+  std::string dir;
+  std::string name;
+  splitPath(path, dir, name);
+  load(dir);
+  LibraryEntry fresh(name);
+  fresh.fileSize = fileSize;
+  fresh.modified = modified;
+  for (auto& entry : entries) {
+    if (name == entry.name()) {
+      if (entry.fileSize != fileSize || entry.modified != modified) {
+        entry = std::move(fresh);  // Replaced: nothing known about it carries over
+      }
+      return &entry;
+    }
+  }
+  if (entries.size() >= MAX_ENTRIES) {
+    return nullptr;
+  }
+  entries.push_back(std::move(fresh));
+  return &entries.back();
+}
+
+const std::vector<LibraryEntry>& LibraryIndex::listDirectory(const std::string& dir) {
+  load(dir);
+  scanDirectory();
+  if (dirty) {
+    save();
+  }
+  pinned = true;
+  indexCursor = 0;
+  return entries;
+}
+
+void LibraryIndex::release() {
+  pinned = false;
+  unload();
+}
+
+bool LibraryIndex::findBook(const std::string& path, LibraryEntry& out) {
+  std::string dir;
+  std::string name;
+  splitPath(path, dir, name);
+  load(dir);
+  for (const auto& entry : entries) {
+    if (name == entry.name() && entry.indexed) {
+      out = entry;
+      return true;
+    }
+  }
+  return false;
+}
+
+void LibraryIndex::updateBook(const std::string& path, const std::string& title, const std::string& author,
+                              const std::string& series, const std::string& language,
+                              const std::string& thumbBmpPath) {
+  LibraryEntry* entry = entryForBook(path);
+  if (!entry) {
+    return;
+  }
+  if (entry->indexed && title == entry->title() && author == entry->author() && series == entry->series() &&
+      language == entry->language() && thumbBmpPath == entry->thumbBmpPath()) {
+    return;
+  }
+  entry->setText(entry->name(), title.c_str(), author.c_str(), series.c_str(), language.c_str(), thumbBmpPath.c_str());
+  entry->indexed = true;
+  dirty = true;
+  revision++;
+  save();
+}
+
+void LibraryIndex::setProgress(const std::string& path, const uint8_t percent) {
+  LibraryEntry* entry = entryForBook(path);
+  if (!entry || entry->progress == percent) {
+    return;
+  }
+  entry->progress = percent;
+  dirty = true;
+  revision++;
+  save();
+}
+
+bool LibraryIndex::step() {
+  if (!loadedDir.empty()) {
+    while (indexCursor < entries.size()) {
+      LibraryEntry& entry = entries[indexCursor++];
+      if (entry.indexed) {
+        continue;
+      }
+      // Opening an EPUB takes up to a few seconds if it was never opened: only worth it for the directory on screen
+      if (readMetadata(entry, pinned)) {
+        dirty = true;
+        revision++;
+        if (++indexedSinceSave >= SAVE_EVERY_BOOKS) {
+          save();
+        }
+      }
+      return true;
+    }
+    if (dirty) {
+      save();
+      return true;
+    }
+  }
+  if (pinned) {
+    return false;
+  }
+
+  if (crawlRequested) {
+    crawlRequested = false;
+    pendingDirs.assign(1, "/");
+  }
+  if (pendingDirs.empty()) {
+    if (!loadedDir.empty()) {
+      unload();  // Nothing left to index: give the memory back
+    }
+    return false;
+  }
+
+  const std::string dir = std::move(pendingDirs.back());
+  pendingDirs.pop_back();
+  load(dir);
+  scanDirectory();
+  for (const auto& entry : entries) {
+    if (entry.isDirectory()) {
+      const std::string name = entry.name();
+      pendingDirs.push_back(joinPath(dir, name.substr(0, name.size() - 1)));
+    }
+  }
+  return true;
+}
+
+bool LibraryIndex::nextStepReadsEpub() const {
+  if (!pinned) {
+    return false;  // Directories that aren't on screen leave their EPUBs for later
+  }
+  for (size_t i = indexCursor; i < entries.size(); i++) {
+    if (!entries[i].indexed) {
+      return StringUtils::checkFileExtension(std::string(entries[i].name()), ".epub");
+    }
+  }
+  return false;
+}
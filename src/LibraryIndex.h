@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+A book or sub-directory in a LibraryIndex directory. Its six text fields are packed into one allocation, each ending
+in '\0', so an entry takes its text and 16 bytes instead of six strings' worth.
+*/
+class LibraryEntry {
+ public:
+  uint32_t fileSize = 0;  // Size and modification time the metadata was read at
+  uint32_t modified = 0;  // FAT date << 16 | time
+  uint8_t progress = 0;   // Percent read, 0 if never opened
+  bool indexed = false;   // Metadata has been read from the book (otherwise only the file name is known)
+
+  LibraryEntry() = default;
+  explicit LibraryEntry(const std::string& name) { setText(name.c_str(), "", "", "", "", ""); }
+  LibraryEntry(const LibraryEntry& other);
+  LibraryEntry& operator=(const LibraryEntry& other);
+  LibraryEntry(LibraryEntry&&) = default;
+  LibraryEntry& operator=(LibraryEntry&&) = default;
+
+  const char* name() const { return field(NAME); }  // File name in its directory; sub-directories end in '/'
+  const char* title() const { return field(TITLE); }
+  const char* author() const { return field(AUTHOR); }
+  const char* series() const { return field(SERIES); }
+  const char* language() const { return field(LANGUAGE); }
+  const char* thumbBmpPath() const { return field(THUMB_BMP_PATH); }  // As getThumbBmpPath(), empty without a cover
+  bool isDirectory() const;
+
+  void setText(const char* name, const char* title, const char* author, const char* series, const char* language,
+               const char* thumbBmpPath);
+  // Bytes of the packed text
+  size_t textSize() const;
+
+ private:
+  enum : uint8_t { NAME, TITLE, AUTHOR, SERIES, LANGUAGE, THUMB_BMP_PATH, FIELD_COUNT };
+
+  std::unique_ptr<char[]> text;  // nullptr while every field is empty
+
+  const char* field(uint8_t index) const;
+};
+
+/*
+Book metadata for the library and home screens, kept on the SD card so showing a directory is an index read instead of
+opening every book in it.
+
+Each directory has a file /.crosspoint/library/<hash of its path>.bin listing its books and sub-directories. A book's
+entry remembers the size and modification time the file had when its metadata was read. Listing a directory compares
+them with the card: new, replaced and removed books are the only entries that change. step() then reads the missing
+metadata, one book per call, while the device is idle. After boot it also walks the rest of the card, so directories
+are listed before they are first opened. The walk only reads XTC headers: EPUB metadata takes up to a few seconds per
+book and is read while its directory is on screen, or when the book is opened. Readers report a book's metadata when it
+is opened and its progress when it is closed.
+
+Only one directory's entries are held in memory at a time, and no more of them than fit in MAX_BYTES: a directory with
+more books than that lists the first ones the card returns.
+*/
+class LibraryIndex {
+  // Static instance
+  static LibraryIndex instance;
+
+  std::string loadedDir;  // Directory whose entries are in memory, empty if none
+  std::vector<LibraryEntry> entries;
+  bool dirty = false;                    // Entries differ from the file
+  bool pinned = false;                   // On screen: step() doesn't move on to another directory
+  size_t indexCursor = 0;                // Next entry step() looks at
+  size_t indexedSinceSave = 0;           // Books read since the file was last written
+  uint32_t revision = 0;                 // Bumped on every change to entries
+  bool crawlRequested = true;            // Walk the card at the first idle moment after boot
+  std::vector<std::string> pendingDirs;  // Directories the walk has yet to visit
+
+  void load(const std::string& dir);
+  bool save();
+  void unload();
+  // Merge the directory's files on the card into entries
+  void scanDirectory();
+  // Read title, author etc. from the book itself. Without allowBuild, EPUBs are left for later (false).
+  bool readMetadata(LibraryEntry& entry, bool allowBuild) const;
+  // Entry for the book at path, loading its directory and adding the entry if needed; nullptr if the file is missing
+  LibraryEntry* entryForBook(const std::string& path);
+
+ public:
+  // Memory the loaded directory's entries may take, with their text
+  static constexpr size_t MAX_BYTES = 64 * 1024;
+
+  ~LibraryIndex() = default;
+
+  // Get singleton instance
+  static LibraryIndex& getInstance() { return instance; }
+
+  static bool isBookFile(const std::string& name);
+
+  // Entries of dir ("/" or e.g. "/Books"), brought up to date with the card. They stay loaded (and are filled in by
+  // step()) until release().
+  const std::vector<LibraryEntry>& listDirectory(const std::string& dir);
+  void release();
+  // Changes whenever the entries returned by listDirectory() do
+  uint32_t getRevision() const { return revision; }
+  // Every book in the loaded directory has its metadata
+  bool directoryComplete() const { return indexCursor >= entries.size(); }
+
+  bool findBook(const std::string& path, LibraryEntry& out);
+  void updateBook(const std::string& path, const std::string& title, const std::string& author,
+                  const std::string& series, const std::string& language, const std::string& thumbBmpPath);
+  void setProgress(const std::string& path, uint8_t percent);
+  // Walk the card again at the next idle moment, e.g. after books were uploaded
+  void requestCrawl() { crawlRequested = true; }
+
+  // One bounded unit of indexing. Returns true while there is more to do (call again soon).
+  bool step();
+  // The next step() reads an EPUB's metadata, which takes up to a few seconds if it was never opened
+  bool nextStepReadsEpub() const;
+};
+
+// Helper macro to access the library index
+#define LIBRARY_INDEX LibraryIndex::getInstance()
@@ -3,17 +3,21 @@
 #include <Epub.h>
 #include <HalStorage.h>
 #include <Logging.h>
+#include <RecordJournal.h>
 #include <Serialization.h>
 #include <Xtc.h>
 
 #include <algorithm>
+#include <sstream>
 
+#include "LibraryIndex.h"
 #include "util/StringUtils.h"
 
 namespace {
 constexpr uint8_t RECENT_BOOKS_FILE_VERSION = 3;
-constexpr char RECENT_BOOKS_FILE[] = "/.crosspoint/recent.bin";
+constexpr char RECENT_BOOKS_FILE[] = "/.crosspoint/recent.bin";  // Before the journal
 constexpr int MAX_RECENT_BOOKS = 10;
+RecordJournal recentBooksJournal("/.crosspoint/recent", RECENT_BOOKS_FILE);
 }  // namespace
 
 RecentBooksStore RecentBooksStore::instance;
@@ -55,11 +59,7 @@ bool RecentBooksStore::saveToFile() const {
   // Make sure the directory exists
   Storage.mkdir("/.crosspoint");
 
-  FsFile outputFile;
-  if (!Storage.openFileForWrite("RBS", RECENT_BOOKS_FILE, outputFile)) {
-    return false;
-  }
-
+  std::ostringstream outputFile;
   serialization::writePod(outputFile, RECENT_BOOKS_FILE_VERSION);
   const uint8_t count = static_cast<uint8_t>(recentBooks.size());
   serialization::writePod(outputFile, count);
@@ -71,7 +71,9 @@ bool RecentBooksStore::saveToFile() const {
     serialization::writeString(outputFile, book.coverBmpPath);
   }
 
-  outputFile.close();
+  if (!recentBooksJournal.append(outputFile.str())) {
+    return false;
+  }
   LOG_DBG("RBS", "Recent books saved to file (%d entries)", count);
   return true;
 }
@@ -85,6 +87,12 @@ RecentBook RecentBooksStore::getDataFromBook(std::string path) const {
 
   LOG_DBG("RBS", "Loading recent book: %s", path.c_str());
 
+  LibraryEntry entry;
+  if (LIBRARY_INDEX.findBook(path, entry)) {
+    return RecentBook{path, entry.title()[0] == '\0' ? lastBookFileName : entry.title(), entry.author(),
+                      entry.thumbBmpPath()};
+  }
+
   // If epub, try to load the metadata for title/author and cover.
   // Use buildIfMissing=false to avoid heavy epub loading on boot; getTitle()/getAuthor() may be
   // blank until the book is opened, and entries with missing title are omitted from recent list.
@@ -107,10 +115,11 @@ RecentBook RecentBooksStore::getDataFromBook(std::string path) const {
 }
 
 bool RecentBooksStore::loadFromFile() {
-  FsFile inputFile;
-  if (!Storage.openFileForRead("RBS", RECENT_BOOKS_FILE, inputFile)) {
+  std::string record;
+  if (!recentBooksJournal.load(record)) {
     return false;
   }
+  std::istringstream inputFile(record);
 
   uint8_t version;
   serialization::readPod(inputFile, version);
@@ -161,18 +170,15 @@ bool RecentBooksStore::loadFromFile() {
     }
 
     if (omitted > 0) {
-      inputFile.close();
       saveToFile();
       LOG_DBG("RBS", "Omitted %u recent book(s) with missing title", omitted);
       return true;
     }
   } else {
     LOG_ERR("RBS", "Deserialization failed: Unknown version %u", version);
-    inputFile.close();
     return false;
   }
 
-  inputFile.close();
   LOG_DBG("RBS", "Recent books loaded from file (%d entries)", recentBooks.size());
   return true;
 }
@@ -1,5 +1,6 @@
 #include "Activity.h"
 
+#include <AllocTracker.h>
 #include <HalPowerManager.h>
 
 void Activity::renderTaskTrampoline(void* param) {
@@ -10,6 +11,7 @@ void Activity::renderTaskTrampoline(void* param) {
 void Activity::renderTaskLoop() {
   while (true) {
     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    updatePending = false;
     {
       HalPowerManager::Lock powerLock;  // Ensure we don't go into low-power mode while rendering
       RenderLock lock(*this);
@@ -26,6 +28,7 @@ void Activity::onEnter() {
               &renderTaskHandle  // Task handle
   );
   assert(renderTaskHandle != nullptr && "Failed to create render task");
+  ALLOC_TRACK_ACTIVITY_ENTER(name.c_str());
   LOG_DBG("ACT", "Entering activity: %s", name.c_str());
 }
 
@@ -36,6 +39,7 @@ void Activity::onExit() {
     renderTaskHandle = nullptr;
   }
 
+  ALLOC_TRACK_ACTIVITY_EXIT(name.c_str());
   LOG_DBG("ACT", "Exiting activity: %s", name.c_str());
 }
 
@@ -43,6 +47,7 @@ void Activity::requestUpdate() {
   // Using direct notification to signal the render task to update
   // Increment counter so multiple rapid calls won't be lost
   if (renderTaskHandle) {
+    updatePending = true;
     xTaskNotify(renderTaskHandle, 1, eIncrement);
   }
 }
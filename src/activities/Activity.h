@@ -5,6 +5,7 @@
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
+#include <atomic>
 #include <cassert>
 #include <string>
 #include <utility>
@@ -26,6 +27,12 @@ class Activity {
   // Mutex to protect rendering operations from being deleted mid-render
   SemaphoreHandle_t renderingMutex = nullptr;
 
+  // Set by requestUpdate(), cleared when the render task picks the request up
+  std::atomic<bool> updatePending{false};
+  // True if another update was requested while the current render was in progress, i.e. the frame being drawn is
+  // already stale and can be dropped instead of refreshed
+  bool hasPendingUpdate() const { return updatePending.load(); }
+
  public:
   explicit Activity(std::string name, GfxRenderer& renderer, MappedInputManager& mappedInput)
       : name(std::move(name)), renderer(renderer), mappedInput(mappedInput), renderingMutex(xSemaphoreCreateMutex()) {
@@ -46,7 +53,11 @@ class Activity {
 
   virtual bool skipLoopDelay() { return false; }
   virtual bool preventAutoSleep() { return false; }
+  // Another task reads and writes the SD card while the activity runs, so background cache work must wait
+  virtual bool usesStorageInBackground() { return false; }
   virtual bool isReaderActivity() const { return false; }
+  // The activity whose render task draws the screen: this one, or the sub-activity it shows
+  virtual Activity& renderingActivity() { return *this; }
 
   // RAII helper to lock rendering mutex for the duration of a scope.
   class RenderLock {
@@ -18,4 +18,5 @@ class ActivityWithSubactivity : public Activity {
   // the subactivity should request its own renders. This pauses parent rendering until exit.
   void requestUpdate() override;
   void onExit() override;
+  Activity& renderingActivity() override { return subActivity ? subActivity->renderingActivity() : *this; }
 };
@@ -7,122 +7,49 @@
 #include <Txt.h>
 #include <Xtc.h>
 
+#include <functional>
+#include <memory>
+
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
 #include "images/Logo120.h"
+#include "util/PageFrameCache.h"
+#include "util/SleepFrame.h"
+#include "util/SleepImageManifest.h"
 #include "util/StringUtils.h"
 
-void SleepActivity::onEnter() {
-  Activity::onEnter();
-  GUI.drawPopup(renderer, tr(STR_ENTERING_SLEEP));
-
-  switch (SETTINGS.sleepScreen) {
-    case (CrossPointSettings::SLEEP_SCREEN_MODE::BLANK):
-      return renderBlankSleepScreen();
-    case (CrossPointSettings::SLEEP_SCREEN_MODE::CUSTOM):
-      return renderCustomSleepScreen();
-    case (CrossPointSettings::SLEEP_SCREEN_MODE::COVER):
-    case (CrossPointSettings::SLEEP_SCREEN_MODE::COVER_CUSTOM):
-      return renderCoverSleepScreen();
-    default:
-      return renderDefaultSleepScreen();
+namespace {
+// Book whose cover frame prepareCoverFrame() last looked at
+std::string coverFrameBook;
+
+// Identifies an image and everything that changes how it is drawn, so a SleepFrame made for something else is ignored
+uint32_t frameKey(const std::string& imagePath, FsFile& image, const GfxRenderer& renderer) {
+  uint16_t date = 0;
+  uint16_t time = 0;
+  image.getModifyDateTime(&date, &time);
+  const uint32_t values[] = {static_cast<uint32_t>(image.size()),
+                             static_cast<uint32_t>(date) << 16 | time,
+                             static_cast<uint32_t>(renderer.getScreenWidth()),
+                             static_cast<uint32_t>(renderer.getScreenHeight()),
+                             SETTINGS.sleepScreenCoverMode,
+                             SETTINGS.sleepScreenCoverFilter};
+  uint32_t hash = 2166136261u;
+  for (const char c : imagePath) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
   }
-}
-
-void SleepActivity::renderCustomSleepScreen() const {
-  // Check if we have a /sleep directory
-  auto dir = Storage.open("/sleep");
-  if (dir && dir.isDirectory()) {
-    std::vector<std::string> files;
-    char name[500];
-    // collect all valid BMP files
-    for (auto file = dir.openNextFile(); file; file = dir.openNextFile()) {
-      if (file.isDirectory()) {
-        file.close();
-        continue;
-      }
-      file.getName(name, sizeof(name));
-      auto filename = std::string(name);
-      if (filename[0] == '.') {
-        file.close();
-        continue;
-      }
-
-      if (filename.substr(filename.length() - 4) != ".bmp") {
-        LOG_DBG("SLP", "Skipping non-.bmp file name: %s", name);
-        file.close();
-        continue;
-      }
-      Bitmap bitmap(file);
-      if (bitmap.parseHeaders() != BmpReaderError::Ok) {
-        LOG_DBG("SLP", "Skipping invalid BMP file: %s", name);
-        file.close();
-        continue;
-      }
-      files.emplace_back(filename);
-      file.close();
-    }
-    const auto numFiles = files.size();
-    if (numFiles > 0) {
-      // Generate a random number between 1 and numFiles
-      auto randomFileIndex = random(numFiles);
-      // If we picked the same image as last time, reroll
-      while (numFiles > 1 && randomFileIndex == APP_STATE.lastSleepImage) {
-        randomFileIndex = random(numFiles);
-      }
-      APP_STATE.lastSleepImage = randomFileIndex;
-      APP_STATE.saveToFile();
-      const auto filename = "/sleep/" + files[randomFileIndex];
-      FsFile file;
-      if (Storage.openFileForRead("SLP", filename, file)) {
-        LOG_DBG("SLP", "Randomly loading: /sleep/%s", files[randomFileIndex].c_str());
-        delay(100);
-        Bitmap bitmap(file, true);
-        if (bitmap.parseHeaders() == BmpReaderError::Ok) {
-          renderBitmapSleepScreen(bitmap);
-          dir.close();
-          return;
-        }
-      }
-    }
-  }
-  if (dir) dir.close();
-
-  // Look for sleep.bmp on the root of the sd card to determine if we should
-  // render a custom sleep screen instead of the default.
-  FsFile file;
-  if (Storage.openFileForRead("SLP", "/sleep.bmp", file)) {
-    Bitmap bitmap(file, true);
-    if (bitmap.parseHeaders() == BmpReaderError::Ok) {
-      LOG_DBG("SLP", "Loading: /sleep.bmp");
-      renderBitmapSleepScreen(bitmap);
-      return;
+  for (const uint32_t value : values) {
+    for (int shift = 0; shift < 32; shift += 8) {
+      hash = (hash ^ ((value >> shift) & 0xFF)) * 16777619u;
     }
   }
-
-  renderDefaultSleepScreen();
+  return hash;
 }
 
-void SleepActivity::renderDefaultSleepScreen() const {
-  const auto pageWidth = renderer.getScreenWidth();
-  const auto pageHeight = renderer.getScreenHeight();
-
-  renderer.clearScreen();
-  renderer.drawImage(Logo120, (pageWidth - 120) / 2, (pageHeight - 120) / 2, 120, 120);
-  renderer.drawCenteredText(UI_10_FONT_ID, pageHeight / 2 + 70, tr(STR_CROSSPOINT), true, EpdFontFamily::BOLD);
-  renderer.drawCenteredText(SMALL_FONT_ID, pageHeight / 2 + 95, tr(STR_SLEEPING));
-
-  // Make sleep screen dark unless light is selected in settings
-  if (SETTINGS.sleepScreen != CrossPointSettings::SLEEP_SCREEN_MODE::LIGHT) {
-    renderer.invertScreen();
-  }
-
-  renderer.displayBuffer(HalDisplay::HALF_REFRESH);
-}
-
-void SleepActivity::renderBitmapSleepScreen(const Bitmap& bitmap) const {
+// Draw bitmap as the sleep screen into the frame buffer: the BW frame, then for grayscale images the LSB and MSB
+// planes. planeDone(plane) is called as each one is in the frame buffer.
+void drawSleepBitmap(GfxRenderer& renderer, const Bitmap& bitmap, const std::function<void(int plane)>& planeDone) {
   int x, y;
   const auto pageWidth = renderer.getScreenWidth();
   const auto pageHeight = renderer.getScreenHeight();
@@ -173,107 +100,335 @@ void SleepActivity::renderBitmapSleepScreen(const Bitmap& bitmap) const {
   if (SETTINGS.sleepScreenCoverFilter == CrossPointSettings::SLEEP_SCREEN_COVER_FILTER::INVERTED_BLACK_AND_WHITE) {
     renderer.invertScreen();
   }
-
-  renderer.displayBuffer(HalDisplay::HALF_REFRESH);
+  planeDone(0);
 
   if (hasGreyscale) {
     bitmap.rewindToData();
     renderer.clearScreen(0x00);
     renderer.setRenderMode(GfxRenderer::GRAYSCALE_LSB);
     renderer.drawBitmap(bitmap, x, y, pageWidth, pageHeight, cropX, cropY);
-    renderer.copyGrayscaleLsbBuffers();
+    planeDone(1);
 
     bitmap.rewindToData();
     renderer.clearScreen(0x00);
     renderer.setRenderMode(GfxRenderer::GRAYSCALE_MSB);
     renderer.drawBitmap(bitmap, x, y, pageWidth, pageHeight, cropX, cropY);
-    renderer.copyGrayscaleMsbBuffers();
+    planeDone(2);
 
-    renderer.displayGrayBuffer();
     renderer.setRenderMode(GfxRenderer::BW);
   }
 }
 
-void SleepActivity::renderCoverSleepScreen() const {
-  void (SleepActivity::*renderNoCoverSleepScreen)() const;
-  switch (SETTINGS.sleepScreen) {
-    case (CrossPointSettings::SLEEP_SCREEN_MODE::COVER_CUSTOM):
-      renderNoCoverSleepScreen = &SleepActivity::renderCustomSleepScreen;
-      break;
-    default:
-      renderNoCoverSleepScreen = &SleepActivity::renderDefaultSleepScreen;
-      break;
-  }
+uint8_t sleepFramePlanes(const Bitmap& bitmap) {
+  return bitmap.hasGreyscale() &&
+                 SETTINGS.sleepScreenCoverFilter == CrossPointSettings::SLEEP_SCREEN_COVER_FILTER::NO_FILTER
+             ? SleepFrame::GRAYSCALE_PLANES
+             : SleepFrame::BW_PLANES;
+}
 
-  if (APP_STATE.openEpubPath.empty()) {
-    return (this->*renderNoCoverSleepScreen)();
+// Where the book's cover BMP and its sleep frame are (or will be); false for a type without covers
+bool coverPaths(const std::string& bookPath, const bool cropped, std::string& coverBmpPath, std::string& framePath) {
+  std::string cachePath;
+  if (StringUtils::checkFileExtension(bookPath, ".xtc") || StringUtils::checkFileExtension(bookPath, ".xtch")) {
+    const Xtc xtc(bookPath, "/.crosspoint");
+    coverBmpPath = xtc.getCoverBmpPath();
+    cachePath = xtc.getCachePath();
+  } else if (StringUtils::checkFileExtension(bookPath, ".txt")) {
+    const Txt txt(bookPath, "/.crosspoint");
+    coverBmpPath = txt.getCoverBmpPath();
+    cachePath = txt.getCachePath();
+  } else if (StringUtils::checkFileExtension(bookPath, ".epub")) {
+    const Epub epub(bookPath, "/.crosspoint");
+    coverBmpPath = epub.getCoverBmpPath(cropped);
+    cachePath = epub.getCachePath();
+  } else {
+    return false;
   }
+  framePath = cachePath + "/sleep.frm";
+  return true;
+}
 
-  std::string coverBmpPath;
-  bool cropped = SETTINGS.sleepScreenCoverMode == CrossPointSettings::SLEEP_SCREEN_COVER_MODE::CROP;
-
+// Decode the book's cover into its cache as a BMP, unless that was done before
+bool generateCoverBmp(const std::string& bookPath, const bool cropped) {
   // Check if the current book is XTC, TXT, or EPUB
-  if (StringUtils::checkFileExtension(APP_STATE.openEpubPath, ".xtc") ||
-      StringUtils::checkFileExtension(APP_STATE.openEpubPath, ".xtch")) {
+  if (StringUtils::checkFileExtension(bookPath, ".xtc") || StringUtils::checkFileExtension(bookPath, ".xtch")) {
     // Handle XTC file
-    Xtc lastXtc(APP_STATE.openEpubPath, "/.crosspoint");
+    Xtc lastXtc(bookPath, "/.crosspoint");
     if (!lastXtc.load()) {
       LOG_ERR("SLP", "Failed to load last XTC");
-      return (this->*renderNoCoverSleepScreen)();
+      return false;
     }
 
     if (!lastXtc.generateCoverBmp()) {
       LOG_ERR("SLP", "Failed to generate XTC cover bmp");
-      return (this->*renderNoCoverSleepScreen)();
+      return false;
     }
-
-    coverBmpPath = lastXtc.getCoverBmpPath();
-  } else if (StringUtils::checkFileExtension(APP_STATE.openEpubPath, ".txt")) {
+    return true;
+  }
+  if (StringUtils::checkFileExtension(bookPath, ".txt")) {
     // Handle TXT file - looks for cover image in the same folder
-    Txt lastTxt(APP_STATE.openEpubPath, "/.crosspoint");
+    Txt lastTxt(bookPath, "/.crosspoint");
     if (!lastTxt.load()) {
       LOG_ERR("SLP", "Failed to load last TXT");
-      return (this->*renderNoCoverSleepScreen)();
+      return false;
     }
 
     if (!lastTxt.generateCoverBmp()) {
       LOG_ERR("SLP", "No cover image found for TXT file");
-      return (this->*renderNoCoverSleepScreen)();
+      return false;
     }
-
-    coverBmpPath = lastTxt.getCoverBmpPath();
-  } else if (StringUtils::checkFileExtension(APP_STATE.openEpubPath, ".epub")) {
+    return true;
+  }
+  if (StringUtils::checkFileExtension(bookPath, ".epub")) {
     // Handle EPUB file
-    Epub lastEpub(APP_STATE.openEpubPath, "/.crosspoint");
+    Epub lastEpub(bookPath, "/.crosspoint");
     // Skip loading css since we only need metadata here
     if (!lastEpub.load(true, true)) {
       LOG_ERR("SLP", "Failed to load last epub");
-      return (this->*renderNoCoverSleepScreen)();
+      return false;
     }
 
     if (!lastEpub.generateCoverBmp(cropped)) {
       LOG_ERR("SLP", "Failed to generate cover bmp");
-      return (this->*renderNoCoverSleepScreen)();
+      return false;
     }
+    return true;
+  }
+  return false;
+}
+}  // namespace
 
-    coverBmpPath = lastEpub.getCoverBmpPath(cropped);
-  } else {
+void SleepActivity::onEnter() {
+  Activity::onEnter();
+  GUI.drawPopup(renderer, tr(STR_ENTERING_SLEEP));
+
+  switch (SETTINGS.sleepScreen) {
+    case (CrossPointSettings::SLEEP_SCREEN_MODE::BLANK):
+      return renderBlankSleepScreen();
+    case (CrossPointSettings::SLEEP_SCREEN_MODE::CUSTOM):
+      return renderCustomSleepScreen();
+    case (CrossPointSettings::SLEEP_SCREEN_MODE::COVER):
+    case (CrossPointSettings::SLEEP_SCREEN_MODE::COVER_CUSTOM):
+      return renderCoverSleepScreen();
+    default:
+      return renderDefaultSleepScreen();
+  }
+}
+
+void SleepActivity::renderCustomSleepScreen() const {
+  SleepImageManifest manifest;
+  if (manifest.load()) {
+    for (int attempt = 0; attempt < 2 && !manifest.getImages().empty(); attempt++) {
+      const auto& images = manifest.getImages();
+      const auto numFiles = images.size();
+      // Generate a random number between 1 and numFiles
+      auto randomFileIndex = random(numFiles);
+      // If we picked the same image as last time, reroll
+      while (numFiles > 1 && randomFileIndex == APP_STATE.lastSleepImage) {
+        randomFileIndex = random(numFiles);
+      }
+      APP_STATE.lastSleepImage = randomFileIndex;
+      APP_STATE.saveToFile();
+      const std::string filename = "/sleep/" + images[randomFileIndex].name;
+      LOG_DBG("SLP", "Randomly loading: %s", filename.c_str());
+      if (renderSleepImage(filename)) {
+        return;
+      }
+      // The listed image has gone or is no longer a valid BMP: list the directory again and pick from that
+      if (!manifest.load(true)) {
+        break;
+      }
+    }
+  }
+
+  // Look for sleep.bmp on the root of the sd card to determine if we should
+  // render a custom sleep screen instead of the default.
+  if (renderSleepImage("/sleep.bmp")) {
+    return;
+  }
+
+  renderDefaultSleepScreen();
+}
+
+bool SleepActivity::renderSleepImage(const std::string& imagePath) const {
+  FsFile file;
+  if (!Storage.openFileForRead("SLP", imagePath, file)) {
+    return false;
+  }
+  const uint32_t key = frameKey(imagePath, file, renderer);
+  const std::string framePath = SleepImageManifest::framePath(imagePath);
+  if (SleepFrame::show(renderer, framePath, key)) {
+    LOG_DBG("SLP", "Shown from sleep frame: %s", imagePath.c_str());
+    file.close();
+    return true;
+  }
+
+  delay(100);
+  Bitmap bitmap(file, true);
+  if (bitmap.parseHeaders() != BmpReaderError::Ok) {
+    file.close();
+    return false;
+  }
+  renderBitmapSleepScreen(bitmap, framePath, key);
+  file.close();
+  return true;
+}
+
+void SleepActivity::renderDefaultSleepScreen() const {
+  const auto pageWidth = renderer.getScreenWidth();
+  const auto pageHeight = renderer.getScreenHeight();
+
+  renderer.clearScreen();
+  renderer.drawImage(Logo120, (pageWidth - 120) / 2, (pageHeight - 120) / 2, 120, 120);
+  renderer.drawCenteredText(UI_10_FONT_ID, pageHeight / 2 + 70, tr(STR_CROSSPOINT), true, EpdFontFamily::BOLD);
+  renderer.drawCenteredText(SMALL_FONT_ID, pageHeight / 2 + 95, tr(STR_SLEEPING));
+
+  // Make sleep screen dark unless light is selected in settings
+  if (SETTINGS.sleepScreen != CrossPointSettings::SLEEP_SCREEN_MODE::LIGHT) {
+    renderer.invertScreen();
+  }
+
+  renderer.displayBuffer(HalDisplay::HALF_REFRESH);
+}
+
+void SleepActivity::renderBitmapSleepScreen(const Bitmap& bitmap, const std::string& framePath,
+                                            const uint32_t key) const {
+  std::unique_ptr<SleepFrame::Writer> frame;
+  if (!framePath.empty()) {
+    frame.reset(new SleepFrame::Writer(framePath, key, sleepFramePlanes(bitmap)));
+  }
+
+  drawSleepBitmap(renderer, bitmap, [this, &frame](const int plane) {
+    if (frame) frame->add(renderer);
+    switch (plane) {
+      case 0:
+        renderer.displayBuffer(HalDisplay::HALF_REFRESH);
+        break;
+      case 1:
+        renderer.copyGrayscaleLsbBuffers();
+        break;
+      default:
+        renderer.copyGrayscaleMsbBuffers();
+        renderer.displayGrayBuffer();
+        break;
+    }
+  });
+
+  if (frame && frame->finish()) {
+    LOG_DBG("SLP", "Saved sleep frame %s", framePath.c_str());
+  }
+}
+
+void SleepActivity::renderCoverSleepScreen() const {
+  void (SleepActivity::*renderNoCoverSleepScreen)() const;
+  switch (SETTINGS.sleepScreen) {
+    case (CrossPointSettings::SLEEP_SCREEN_MODE::COVER_CUSTOM):
+      renderNoCoverSleepScreen = &SleepActivity::renderCustomSleepScreen;
+      break;
+    default:
+      renderNoCoverSleepScreen = &SleepActivity::renderDefaultSleepScreen;
+      break;
+  }
+
+  const bool cropped = SETTINGS.sleepScreenCoverMode == CrossPointSettings::SLEEP_SCREEN_COVER_MODE::CROP;
+  std::string coverBmpPath;
+  std::string framePath;
+  if (APP_STATE.openEpubPath.empty() || !coverPaths(APP_STATE.openEpubPath, cropped, coverBmpPath, framePath)) {
     return (this->*renderNoCoverSleepScreen)();
   }
 
+  // Usually prepared in the background after the book was opened: then this is the only read
   FsFile file;
   if (Storage.openFileForRead("SLP", coverBmpPath, file)) {
+    const bool shown = SleepFrame::show(renderer, framePath, frameKey(coverBmpPath, file, renderer));
+    file.close();
+    if (shown) {
+      LOG_DBG("SLP", "Sleep cover shown from %s", framePath.c_str());
+      return;
+    }
+  }
+
+  if (!generateCoverBmp(APP_STATE.openEpubPath, cropped)) {
+    return (this->*renderNoCoverSleepScreen)();
+  }
+
+  if (Storage.openFileForRead("SLP", coverBmpPath, file)) {
+    const uint32_t key = frameKey(coverBmpPath, file, renderer);
     Bitmap bitmap(file);
     if (bitmap.parseHeaders() == BmpReaderError::Ok) {
       LOG_DBG("SLP", "Rendering sleep cover: %s", coverBmpPath.c_str());
-      renderBitmapSleepScreen(bitmap);
+      renderBitmapSleepScreen(bitmap, framePath, key);
+      file.close();
       return;
     }
+    file.close();
   }
 
   return (this->*renderNoCoverSleepScreen)();
 }
 
+bool SleepActivity::coverFrameWanted() {
+  if (SETTINGS.sleepScreen != CrossPointSettings::SLEEP_SCREEN_MODE::COVER &&
+      SETTINGS.sleepScreen != CrossPointSettings::SLEEP_SCREEN_MODE::COVER_CUSTOM) {
+    return false;
+  }
+  const std::string& bookPath = APP_STATE.openEpubPath;
+  if (bookPath.empty() || bookPath == coverFrameBook) {
+    return false;
+  }
+  // Decoding the cover and holding the reader's frame take about as much as a cached page. Without that much, it is
+  // tried again at the next idle moment.
+  return ESP.getFreeHeap() >= HalDisplay::BUFFER_SIZE + PageFrameCache::MIN_FREE_HEAP;
+}
+
+void SleepActivity::prepareCoverFrame(GfxRenderer& renderer) {
+  if (!coverFrameWanted()) {
+    return;
+  }
+  const std::string bookPath = APP_STATE.openEpubPath;
+  coverFrameBook = bookPath;
+
+  const bool cropped = SETTINGS.sleepScreenCoverMode == CrossPointSettings::SLEEP_SCREEN_COVER_MODE::CROP;
+  std::string coverBmpPath;
+  std::string framePath;
+  if (!coverPaths(bookPath, cropped, coverBmpPath, framePath) || !generateCoverBmp(bookPath, cropped)) {
+    return;
+  }
+
+  const uint32_t start = millis();
+  // Drawn in the orientation the sleep screen uses, over the screen's frame buffer, which is put back afterwards
+  const auto orientation = renderer.getOrientation();
+  renderer.setOrientation(GfxRenderer::Orientation::Portrait);
+  FsFile file;
+  if (!Storage.openFileForRead("SLP", coverBmpPath, file)) {
+    renderer.setOrientation(orientation);
+    return;
+  }
+  const uint32_t key = frameKey(coverBmpPath, file, renderer);
+  if (SleepFrame::isCurrent(framePath, key)) {
+    file.close();
+    renderer.setOrientation(orientation);
+    return;
+  }
+
+  GfxRenderer::FrameSnapshot screen;
+  Bitmap bitmap(file);
+  if (bitmap.parseHeaders() == BmpReaderError::Ok && renderer.storeFrame(screen)) {
+    const auto renderMode = renderer.getRenderMode();
+    SleepFrame::Writer frame(framePath, key, sleepFramePlanes(bitmap));
+    drawSleepBitmap(renderer, bitmap, [&renderer, &frame](int) { frame.add(renderer); });
+    const bool saved = frame.finish();
+    renderer.setRenderMode(renderMode);
+    renderer.restoreFrame(screen);
+    LOG_DBG("SLP", "Prepared sleep cover for %s in %lu ms: %s", bookPath.c_str(), millis() - start,
+            saved ? "ok" : "failed");
+  } else {
+    coverFrameBook.clear();  // Out of memory for the snapshot: try again later
+  }
+  file.close();
+  renderer.setOrientation(orientation);
+}
+
 void SleepActivity::renderBlankSleepScreen() const {
   renderer.clearScreen();
   renderer.displayBuffer(HalDisplay::HALF_REFRESH);
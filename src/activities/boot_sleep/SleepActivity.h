@@ -1,4 +1,6 @@
 #pragma once
+#include <string>
+
 #include "../Activity.h"
 
 class Bitmap;
@@ -9,10 +11,19 @@ class SleepActivity final : public Activity {
       : Activity("Sleep", renderer, mappedInput) {}
   void onEnter() override;
 
+  // In a cover sleep mode, draw the open book's sleep screen into its cache once, while the device is idle, so going
+  // to sleep only reads it back. The frame buffer is left as it was. Decoding the cover takes seconds, so it is run as
+  // a BackgroundJob when coverFrameWanted().
+  static bool coverFrameWanted();
+  static void prepareCoverFrame(GfxRenderer& renderer);
+
  private:
   void renderDefaultSleepScreen() const;
   void renderCustomSleepScreen() const;
   void renderCoverSleepScreen() const;
-  void renderBitmapSleepScreen(const Bitmap& bitmap) const;
+  // Show the BMP at imagePath from its SleepFrame, converting it first if there is no current one
+  bool renderSleepImage(const std::string& imagePath) const;
+  // With a framePath, the planes are also written there as a SleepFrame
+  void renderBitmapSleepScreen(const Bitmap& bitmap, const std::string& framePath = "", uint32_t key = 0) const;
   void renderBlankSleepScreen() const;
 };
@@ -2,29 +2,36 @@
 
 #include <Epub.h>
 #include <GfxRenderer.h>
+#include <HalStorage.h>
 #include <I18n.h>
 #include <Logging.h>
 #include <OpdsStream.h>
 #include <WiFi.h>
 
+#include <algorithm>
+
+#include "BookIngestQueue.h"
 #include "CrossPointSettings.h"
 #include "MappedInputManager.h"
 #include "activities/network/WifiSelectionActivity.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
 #include "network/HttpDownloader.h"
+#include "network/OpdsFeedCache.h"
 #include "util/StringUtils.h"
 #include "util/UrlUtils.h"
 
 namespace {
 constexpr int PAGE_ITEMS = 23;
+// Entries held in memory: the screen page with the selection and those around it
+constexpr size_t MAX_RESIDENT_ENTRIES = 4 * PAGE_ITEMS;
 }  // namespace
 
 void OpdsBookBrowserActivity::onEnter() {
   ActivityWithSubactivity::onEnter();
 
   state = BrowserState::CHECK_WIFI;
-  entries.clear();
+  clearFeed();
   navigationHistory.clear();
   currentPath = "";  // Root path - user provides full URL in settings
   selectorIndex = 0;
@@ -40,9 +47,10 @@ void OpdsBookBrowserActivity::onExit() {
   ActivityWithSubactivity::onExit();
 
   // Turn off WiFi when exiting
+  HttpDownloader::closeConnection();
   WiFi.mode(WIFI_OFF);
 
-  entries.clear();
+  clearFeed();
   navigationHistory.clear();
 }
 
@@ -99,12 +107,16 @@ void OpdsBookBrowserActivity::loop() {
   // Handle browsing state
   if (state == BrowserState::BROWSING) {
     if (mappedInput.wasReleased(MappedInputManager::Button::Confirm)) {
-      if (!entries.empty()) {
-        const auto& entry = entries[selectorIndex];
-        if (entry.type == OpdsEntryType::BOOK) {
-          downloadBook(entry);
+      // Pages of a catalog replace each other in the history: Back leaves the catalog
+      if (isPreviousPageRow(selectorIndex)) {
+        openPage(previousPagePath);
+      } else if (isNextPageRow(selectorIndex)) {
+        openPage(nextPagePath);
+      } else if (const auto* entry = entryAtRow(selectorIndex)) {
+        if (entry->type == OpdsEntryType::BOOK) {
+          downloadBook(*entry);
         } else {
-          navigateToEntry(entry);
+          navigateToEntry(*entry);
         }
       }
     } else if (mappedInput.wasReleased(MappedInputManager::Button::Back)) {
@@ -112,24 +124,28 @@ void OpdsBookBrowserActivity::loop() {
     }
 
     // Handle navigation
-    if (!entries.empty()) {
+    if (rowCount() > 0) {
       buttonNavigator.onNextRelease([this] {
-        selectorIndex = ButtonNavigator::nextIndex(selectorIndex, entries.size());
+        selectorIndex = ButtonNavigator::nextIndex(selectorIndex, rowCount());
+        showRow(selectorIndex);
         requestUpdate();
       });
 
       buttonNavigator.onPreviousRelease([this] {
-        selectorIndex = ButtonNavigator::previousIndex(selectorIndex, entries.size());
+        selectorIndex = ButtonNavigator::previousIndex(selectorIndex, rowCount());
+        showRow(selectorIndex);
         requestUpdate();
       });
 
       buttonNavigator.onNextContinuous([this] {
-        selectorIndex = ButtonNavigator::nextPageIndex(selectorIndex, entries.size(), PAGE_ITEMS);
+        selectorIndex = ButtonNavigator::nextPageIndex(selectorIndex, rowCount(), PAGE_ITEMS);
+        showRow(selectorIndex);
         requestUpdate();
       });
 
       buttonNavigator.onPreviousContinuous([this] {
-        selectorIndex = ButtonNavigator::previousPageIndex(selectorIndex, entries.size(), PAGE_ITEMS);
+        selectorIndex = ButtonNavigator::previousPageIndex(selectorIndex, rowCount(), PAGE_ITEMS);
+        showRow(selectorIndex);
         requestUpdate();
       });
     }
@@ -152,7 +168,7 @@ void OpdsBookBrowserActivity::render(Activity::RenderLock&&) {
     return;
   }
 
-  if (state == BrowserState::LOADING) {
+  if (state == BrowserState::LOADING && entries.empty()) {
     renderer.drawCenteredText(UI_10_FONT_ID, pageHeight / 2, statusMessage.c_str());
     const auto labels = mappedInput.mapLabels(tr(STR_BACK), "", "", "");
     GUI.drawButtonHints(renderer, labels.btn1, labels.btn2, labels.btn3, labels.btn4);
@@ -183,42 +199,62 @@ void OpdsBookBrowserActivity::render(Activity::RenderLock&&) {
     return;
   }
 
-  // Browsing state
-  // Show appropriate button hint based on selected entry type
-  const char* confirmLabel = tr(STR_OPEN);
-  if (!entries.empty() && entries[selectorIndex].type == OpdsEntryType::BOOK) {
-    confirmLabel = tr(STR_DOWNLOAD);
+  // Browsing state, or the first screen of a feed that is still loading
+  const bool loading = state == BrowserState::LOADING;
+  if (loading) {
+    renderer.drawCenteredText(SMALL_FONT_ID, 38, statusMessage.c_str());
+    const auto labels = mappedInput.mapLabels(tr(STR_BACK), "", "", "");
+    GUI.drawButtonHints(renderer, labels.btn1, labels.btn2, labels.btn3, labels.btn4);
+  } else {
+    if (showingSavedCopy) {
+      renderer.drawCenteredText(SMALL_FONT_ID, 38, tr(STR_OPDS_SAVED_COPY));
+    }
+    // Show appropriate button hint based on selected entry type
+    const char* confirmLabel = tr(STR_OPEN);
+    const auto* selected = entryAtRow(selectorIndex);
+    if (selected && selected->type == OpdsEntryType::BOOK) {
+      confirmLabel = tr(STR_DOWNLOAD);
+    }
+    const auto labels = mappedInput.mapLabels(tr(STR_BACK), confirmLabel, tr(STR_DIR_UP), tr(STR_DIR_DOWN));
+    GUI.drawButtonHints(renderer, labels.btn1, labels.btn2, labels.btn3, labels.btn4);
   }
-  const auto labels = mappedInput.mapLabels(tr(STR_BACK), confirmLabel, tr(STR_DIR_UP), tr(STR_DIR_DOWN));
-  GUI.drawButtonHints(renderer, labels.btn1, labels.btn2, labels.btn3, labels.btn4);
 
-  if (entries.empty()) {
+  const int rows = rowCount();
+  if (rows == 0) {
     renderer.drawCenteredText(UI_10_FONT_ID, pageHeight / 2, tr(STR_NO_ENTRIES));
     renderer.displayBuffer();
     return;
   }
 
   const auto pageStartIndex = selectorIndex / PAGE_ITEMS * PAGE_ITEMS;
-  renderer.fillRect(0, 60 + (selectorIndex % PAGE_ITEMS) * 30 - 2, pageWidth - 1, 30);
-
-  for (size_t i = pageStartIndex; i < entries.size() && i < static_cast<size_t>(pageStartIndex + PAGE_ITEMS); i++) {
-    const auto& entry = entries[i];
+  if (!loading) {
+    renderer.fillRect(0, 60 + (selectorIndex % PAGE_ITEMS) * 30 - 2, pageWidth - 1, 30);
+  }
 
+  for (int row = pageStartIndex; row < rows && row < pageStartIndex + PAGE_ITEMS; row++) {
     // Format display text with type indicator
     std::string displayText;
-    if (entry.type == OpdsEntryType::NAVIGATION) {
-      displayText = "> " + entry.title;  // Folder/navigation indicator
-    } else {
-      // Book: "Title - Author" or just "Title"
-      displayText = entry.title;
-      if (!entry.author.empty()) {
-        displayText += " - " + entry.author;
+    if (isPreviousPageRow(row)) {
+      displayText = tr(STR_OPDS_PREVIOUS_PAGE);
+    } else if (isNextPageRow(row)) {
+      displayText = tr(STR_OPDS_NEXT_PAGE);
+    } else if (const auto* entry = entryAtRow(row)) {
+      if (entry->type == OpdsEntryType::NAVIGATION) {
+        displayText = "> " + entry->title;  // Folder/navigation indicator
+      } else {
+        // Book: "Title - Author" or just "Title"
+        displayText = entry->title;
+        if (!entry->author.empty()) {
+          displayText += " - " + entry->author;
+        }
       }
+    } else {
+      continue;
     }
 
     auto item = renderer.truncatedText(UI_10_FONT_ID, displayText.c_str(), renderer.getScreenWidth() - 40);
-    renderer.drawText(UI_10_FONT_ID, 20, 60 + (i % PAGE_ITEMS) * 30, item.c_str(),
-                      i != static_cast<size_t>(selectorIndex));
+    renderer.drawText(UI_10_FONT_ID, 20, 60 + (row % PAGE_ITEMS) * 30, item.c_str(),
+                      loading || row != selectorIndex);
   }
 
   renderer.displayBuffer();
@@ -236,30 +272,105 @@ void OpdsBookBrowserActivity::fetchFeed(const std::string& path) {
   std::string url = UrlUtils::buildUrl(serverUrl, path);
   LOG_DBG("OPDS", "Fetching: %s", url.c_str());
 
+  {
+    RenderLock lock(*this);
+    clearFeed();
+  }
+  selectorIndex = 0;
+
+  // The feed is written to the card as it is parsed: the copy is revalidated next time, shown when the server can't
+  // be reached, and read again for entries outside the window
+  HttpDownloader::CacheValidators cached;
+  const bool haveCopy = OpdsFeedCache::lookup(url, cached);
+  const std::string tempPath = OpdsFeedCache::tempPathFor(url);
+  FsFile copyFile;
+  const bool copying = Storage.openFileForWrite("OPDS", tempPath, copyFile);
+
   OpdsParser parser;
+  size_t parsedEntries = 0;
+  parser.setEntryCallback([this, &parsedEntries](const OpdsEntry& entry) {
+    if (parsedEntries++ >= MAX_RESIDENT_ENTRIES) {
+      return;
+    }
+    RenderLock lock(*this);
+    entries.push_back(entry);
+    totalEntries = entries.size();
+    if (entries.size() == PAGE_ITEMS) {
+      requestUpdate();  // The first screen is shown while the rest of the feed arrives
+    }
+  });
 
+  HttpDownloader::CacheValidators received;
+  HttpDownloader::FetchResult result;
+  bool copyComplete;
   {
-    OpdsParserStream stream{parser};
-    if (!HttpDownloader::fetchUrl(url, stream)) {
+    OpdsParserStream stream{parser, copying ? &copyFile : nullptr};
+    result = HttpDownloader::fetchUrlIfModified(url, stream, cached, received);
+    copyComplete = copying && !stream.hasCopyFailed();
+  }
+  if (copying) {
+    copyFile.close();
+  }
+
+  if (result == HttpDownloader::FETCHED) {
+    if (!parser) {
+      Storage.remove(tempPath.c_str());
+      {
+        RenderLock lock(*this);
+        clearFeed();
+      }
       state = BrowserState::ERROR;
-      errorMessage = tr(STR_FETCH_FEED_FAILED);
+      errorMessage = tr(STR_PARSE_FEED_FAILED);
       requestUpdate();
       return;
     }
-  }
 
-  if (!parser) {
-    state = BrowserState::ERROR;
-    errorMessage = tr(STR_PARSE_FEED_FAILED);
-    requestUpdate();
-    return;
+    if (copyComplete && OpdsFeedCache::store(url, received)) {
+      feedCopyPath = OpdsFeedCache::pathFor(url);
+    } else if (copying) {
+      Storage.remove(tempPath.c_str());
+    }
+    if (feedCopyPath.empty() && parsedEntries > MAX_RESIDENT_ENTRIES) {
+      LOG_ERR("OPDS", "No copy of the feed, showing %zu of %zu entries", MAX_RESIDENT_ENTRIES, parsedEntries);
+    }
+
+    RenderLock lock(*this);
+    totalEntries = feedCopyPath.empty() ? entries.size() : parsedEntries;
+    previousPagePath = parser.getPreviousHref();
+    nextPagePath = parser.getNextHref();
+  } else {
+    if (copying) {
+      Storage.remove(tempPath.c_str());
+    }
+    // Unchanged since it was cached, or the server can't be reached
+    if (!haveCopy) {
+      {
+        RenderLock lock(*this);
+        clearFeed();
+      }
+      state = BrowserState::ERROR;
+      errorMessage = tr(STR_FETCH_FEED_FAILED);
+      requestUpdate();
+      return;
+    }
+    feedCopyPath = OpdsFeedCache::pathFor(url);
+    showingSavedCopy = result == HttpDownloader::FETCH_FAILED;
+    OpdsFeedCache::touch(url);
+    if (!readFeedCopy(0, true)) {
+      {
+        RenderLock lock(*this);
+        clearFeed();
+      }
+      state = BrowserState::ERROR;
+      errorMessage = tr(STR_PARSE_FEED_FAILED);
+      requestUpdate();
+      return;
+    }
   }
 
-  entries = std::move(parser).getEntries();
-  LOG_DBG("OPDS", "Found %d entries", entries.size());
-  selectorIndex = 0;
+  LOG_DBG("OPDS", "Found %zu entries%s", totalEntries, result == HttpDownloader::FETCHED ? "" : " (cached)");
 
-  if (entries.empty()) {
+  if (rowCount() == 0) {
     state = BrowserState::ERROR;
     errorMessage = tr(STR_NO_ENTRIES);
     requestUpdate();
@@ -270,36 +381,117 @@ void OpdsBookBrowserActivity::fetchFeed(const std::string& path) {
   requestUpdate();
 }
 
-void OpdsBookBrowserActivity::navigateToEntry(const OpdsEntry& entry) {
-  // Push current path to history before navigating
-  navigationHistory.push_back(currentPath);
-  currentPath = entry.href;
+bool OpdsBookBrowserActivity::readFeedCopy(const size_t start, const bool wholeFeed) {
+  FsFile file;
+  if (!Storage.openFileForRead("OPDS", feedCopyPath, file)) {
+    return false;
+  }
+
+  OpdsParser parser;
+  std::vector<OpdsEntry> window;
+  size_t count = 0;
+  parser.setEntryCallback([&](const OpdsEntry& entry) {
+    if (count++ >= start && window.size() < MAX_RESIDENT_ENTRIES) {
+      window.push_back(entry);
+    }
+  });
+
+  // Moving the window only needs the feed up to its last entry, not the rest of a long feed
+  const auto windowFull = [&] { return !wholeFeed && window.size() == MAX_RESIDENT_ENTRIES; };
+  uint8_t buffer[512];
+  int bytesRead;
+  while (!windowFull() && (bytesRead = file.read(buffer, sizeof(buffer))) > 0) {
+    parser.write(buffer, bytesRead);
+  }
+  file.close();
+  if (!windowFull()) {
+    parser.flush();
+  }
+  if (!parser) {
+    return false;
+  }
+
+  RenderLock lock(*this);
+  entries = std::move(window);
+  windowStart = start;
+  // A partial read saw only part of the feed: the count and pagination links from the whole read stand
+  if (wholeFeed) {
+    totalEntries = count;
+    previousPagePath = parser.getPreviousHref();
+    nextPagePath = parser.getNextHref();
+  }
+  return true;
+}
+
+void OpdsBookBrowserActivity::clearFeed() {
+  entries.clear();
+  entries.shrink_to_fit();
+  windowStart = 0;
+  totalEntries = 0;
+  previousPagePath.clear();
+  nextPagePath.clear();
+  feedCopyPath.clear();
+  showingSavedCopy = false;
+}
+
+int OpdsBookBrowserActivity::rowCount() const {
+  return static_cast<int>(totalEntries) + (previousPagePath.empty() ? 0 : 1) + (nextPagePath.empty() ? 0 : 1);
+}
+
+const OpdsEntry* OpdsBookBrowserActivity::entryAtRow(const int row) const {
+  const int index = row - (previousPagePath.empty() ? 0 : 1);
+  if (index < static_cast<int>(windowStart) || index >= static_cast<int>(windowStart + entries.size())) {
+    return nullptr;
+  }
+  return &entries[index - windowStart];
+}
+
+void OpdsBookBrowserActivity::showRow(const int row) {
+  if (feedCopyPath.empty()) {
+    return;
+  }
+  // Entries on the screen page of row
+  const int offset = previousPagePath.empty() ? 0 : 1;
+  const int pageStart = row / PAGE_ITEMS * PAGE_ITEMS;
+  const size_t first = std::max(pageStart - offset, 0);
+  const size_t last = std::min(static_cast<size_t>(std::max(pageStart + PAGE_ITEMS - offset, 0)), totalEntries);
+  if (first >= last || (first >= windowStart && last <= windowStart + entries.size())) {
+    return;
+  }
+  // Keep a page before it, for going back
+  const size_t start = first > static_cast<size_t>(PAGE_ITEMS) ? first - PAGE_ITEMS : 0;
+  LOG_DBG("OPDS", "Reading entries %zu+ from %s", start, feedCopyPath.c_str());
+  if (!readFeedCopy(start, false)) {
+    LOG_ERR("OPDS", "Failed to read %s", feedCopyPath.c_str());
+  }
+}
+
+void OpdsBookBrowserActivity::openPage(const std::string& path) {
+  currentPath = path;
 
   state = BrowserState::LOADING;
   statusMessage = tr(STR_LOADING);
-  entries.clear();
   selectorIndex = 0;
   requestUpdate();
 
   fetchFeed(currentPath);
 }
 
+void OpdsBookBrowserActivity::navigateToEntry(const OpdsEntry& entry) {
+  // Push current path to history before navigating
+  navigationHistory.push_back(currentPath);
+  openPage(entry.href);
+}
+
 void OpdsBookBrowserActivity::navigateBack() {
   if (navigationHistory.empty()) {
     // At root, go home
     onGoHome();
   } else {
     // Go back to previous catalog
-    currentPath = navigationHistory.back();
+    const std::string path = navigationHistory.back();
     navigationHistory.pop_back();
-
-    state = BrowserState::LOADING;
-    statusMessage = tr(STR_LOADING);
-    entries.clear();
-    selectorIndex = 0;
-    requestUpdate();
-
-    fetchFeed(currentPath);
+    openPage(path);
   }
 }
 
@@ -332,10 +524,12 @@ void OpdsBookBrowserActivity::downloadBook(const OpdsEntry& book) {
   if (result == HttpDownloader::OK) {
     LOG_DBG("OPDS", "Download complete: %s", filename.c_str());
 
-    // Invalidate any existing cache for this file to prevent stale metadata issues
-    Epub epub(filename, "/.crosspoint");
-    epub.clearCache();
-    LOG_DBG("OPDS", "Cleared cache for: %s", filename.c_str());
+    // Caches are keyed by content: a download may have replaced different content at the same path, so its key is
+    // recomputed on the next open. The old content's cache is left for the cache manager to trim.
+    BookCacheKeys::forget(filename, "/.crosspoint");
+    LOG_DBG("OPDS", "Forgot epub cache key for: %s", filename.c_str());
+    // Prepared while the user browses on, instead of when first opened
+    BOOK_INGEST.enqueue(filename);
 
     state = BrowserState::BROWSING;
     requestUpdate();
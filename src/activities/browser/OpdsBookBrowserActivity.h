@@ -12,6 +12,10 @@
  * Activity for browsing and downloading books from an OPDS server.
  * Supports navigation through catalog hierarchy and downloading EPUBs.
  * When WiFi connection fails, launches WiFi selection to let user connect.
+ *
+ * Feeds are parsed as they arrive and kept on the SD card (OpdsFeedCache): only a window of entries around the
+ * selection is held in memory, and the rest is read again from the card's copy. Paginated catalogs get rows for their
+ * previous and next pages.
  */
 class OpdsBookBrowserActivity final : public ActivityWithSubactivity {
  public:
@@ -36,10 +40,16 @@ class OpdsBookBrowserActivity final : public ActivityWithSubactivity {
  private:
   ButtonNavigator buttonNavigator;
   BrowserState state = BrowserState::LOADING;
-  std::vector<OpdsEntry> entries;
+  std::vector<OpdsEntry> entries;              // Resident window of the feed's entries
+  size_t windowStart = 0;                      // Index in the feed of entries[0]
+  size_t totalEntries = 0;                     // Entries in the feed
+  std::string previousPagePath;                // Pagination links of the feed, empty if none
+  std::string nextPagePath;
+  std::string feedCopyPath;                    // Copy of the feed on the SD card, empty if there is none
+  bool showingSavedCopy = false;               // The server couldn't be reached
   std::vector<std::string> navigationHistory;  // Stack of previous feed paths for back navigation
   std::string currentPath;                     // Current feed path being displayed
-  int selectorIndex = 0;
+  int selectorIndex = 0;                       // Row: previous page row, entries, next page row
   std::string errorMessage;
   std::string statusMessage;
   size_t downloadProgress = 0;
@@ -51,6 +61,19 @@ class OpdsBookBrowserActivity final : public ActivityWithSubactivity {
   void launchWifiSelection();
   void onWifiSelectionComplete(bool connected);
   void fetchFeed(const std::string& path);
+  // Read the window starting at entry start from the feed's copy on the SD card. With wholeFeed the entries are also
+  // counted and the pagination links picked up; otherwise reading stops as soon as the window is full.
+  bool readFeedCopy(size_t start, bool wholeFeed);
+  void clearFeed();
+  int rowCount() const;
+  bool isPreviousPageRow(int row) const { return row == 0 && !previousPagePath.empty(); }
+  bool isNextPageRow(int row) const { return row == rowCount() - 1 && !nextPagePath.empty(); }
+  // The entry shown on row, nullptr for a pagination row or an entry outside the window
+  const OpdsEntry* entryAtRow(int row) const;
+  // Move the window so the screen page holding row is in it
+  void showRow(int row);
+  // Show the feed at path, leaving the history as it is
+  void openPage(const std::string& path);
   void navigateToEntry(const OpdsEntry& entry);
   void navigateBack();
   void downloadBook(const OpdsEntry& book);
@@ -5,103 +5,117 @@
 #include <I18n.h>
 
 #include <algorithm>
+#include <cstring>
 
+#include "CrossPointSettings.h"
 #include "MappedInputManager.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
-#include "util/StringUtils.h"
 
 namespace {
 constexpr unsigned long GO_HOME_MS = 1000;
+// While the index fills in a long directory, the list is re-sorted at most this often rather than once per book
+constexpr unsigned long RESORT_INTERVAL_MS = 10000;
 }  // namespace
 
-void sortFileList(std::vector<std::string>& strs) {
-  std::sort(begin(strs), end(strs), [](const std::string& str1, const std::string& str2) {
-    // Directories first
-    bool isDir1 = str1.back() == '/';
-    bool isDir2 = str2.back() == '/';
-    if (isDir1 != isDir2) return isDir1;
-
-    // Start naive natural sort
-    const char* s1 = str1.c_str();
-    const char* s2 = str2.c_str();
-
-    // Iterate while both strings have characters
-    while (*s1 && *s2) {
-      // Check if both are at the start of a number
-      if (isdigit(*s1) && isdigit(*s2)) {
-        // Skip leading zeros and track them
-        const char* start1 = s1;
-        const char* start2 = s2;
-        while (*s1 == '0') s1++;
-        while (*s2 == '0') s2++;
-
-        // Count digits to compare lengths first
-        int len1 = 0, len2 = 0;
-        while (isdigit(s1[len1])) len1++;
-        while (isdigit(s2[len2])) len2++;
-
-        // Different length so return smaller integer value
-        if (len1 != len2) return len1 < len2;
-
-        // Same length so compare digit by digit
-        for (int i = 0; i < len1; i++) {
-          if (s1[i] != s2[i]) return s1[i] < s2[i];
-        }
-
-        // Numbers equal so advance pointers
-        s1 += len1;
-        s2 += len2;
-      } else {
-        // Regular case-insensitive character comparison
-        char c1 = tolower(*s1);
-        char c2 = tolower(*s2);
-        if (c1 != c2) return c1 < c2;
-        s1++;
-        s2++;
+// Natural, case-insensitive order: "Book 2" before "Book 10"
+bool naturalLess(const char* s1, const char* s2) {
+
+  // Iterate while both strings have characters
+  while (*s1 && *s2) {
+    // Check if both are at the start of a number
+    if (isdigit(*s1) && isdigit(*s2)) {
+      // Skip leading zeros and track them
+      while (*s1 == '0') s1++;
+      while (*s2 == '0') s2++;
+
+      // Count digits to compare lengths first
+      int len1 = 0, len2 = 0;
+      while (isdigit(s1[len1])) len1++;
+      while (isdigit(s2[len2])) len2++;
+
+      // Different length so return smaller integer value
+      if (len1 != len2) return len1 < len2;
+
+      // Same length so compare digit by digit
+      for (int i = 0; i < len1; i++) {
+        if (s1[i] != s2[i]) return s1[i] < s2[i];
       }
+
+      // Numbers equal so advance pointers
+      s1 += len1;
+      s2 += len2;
+    } else {
+      // Regular case-insensitive character comparison
+      char c1 = tolower(*s1);
+      char c2 = tolower(*s2);
+      if (c1 != c2) return c1 < c2;
+      s1++;
+      s2++;
     }
+  }
 
-    // One string is prefix of other
-    return *s1 == '\0' && *s2 != '\0';
-  });
+  // One string is prefix of other
+  return *s1 == '\0' && *s2 != '\0';
 }
 
-void MyLibraryActivity::loadFiles() {
-  files.clear();
+std::string getFileName(std::string filename) {
+  if (filename.back() == '/') {
+    return filename.substr(0, filename.length() - 1);
+  }
+  const auto pos = filename.rfind('.');
+  return filename.substr(0, pos);
+}
 
-  auto root = Storage.open(basepath.c_str());
-  if (!root || !root.isDirectory()) {
-    if (root) root.close();
-    return;
+// Title from the index, or the file name until the book has been indexed
+std::string displayTitle(const LibraryEntry& entry) {
+  return entry.title()[0] == '\0' ? getFileName(entry.name()) : entry.title();
+}
+
+const LibraryEntry& MyLibraryActivity::entryAt(const size_t index) const { return (*entries)[files[index]]; }
+
+void MyLibraryActivity::sortFiles() {
+  files.resize(entries->size());
+  for (size_t i = 0; i < files.size(); i++) {
+    files[i] = static_cast<uint16_t>(i);
   }
 
-  root.rewindDirectory();
+  const uint8_t sort = SETTINGS.librarySort;
+  // Books missing the sort field go after the ones that have it
+  const auto fieldLess = [](const char* a, const char* b) {
+    if ((a[0] == '\0') != (b[0] == '\0')) return b[0] == '\0';
+    return naturalLess(a, b);
+  };
+  std::sort(files.begin(), files.end(), [this, sort, &fieldLess](const uint16_t i1, const uint16_t i2) {
+    const LibraryEntry& e1 = (*entries)[i1];
+    const LibraryEntry& e2 = (*entries)[i2];
+    // Directories first
+    if (e1.isDirectory() != e2.isDirectory()) return e1.isDirectory();
+    if (e1.isDirectory() || sort == CrossPointSettings::SORT_FILE_NAME) return naturalLess(e1.name(), e2.name());
 
-  char name[500];
-  for (auto file = root.openNextFile(); file; file = root.openNextFile()) {
-    file.getName(name, sizeof(name));
-    if (name[0] == '.' || strcmp(name, "System Volume Information") == 0) {
-      file.close();
-      continue;
+    if (sort == CrossPointSettings::SORT_AUTHOR && strcmp(e1.author(), e2.author()) != 0) {
+      return fieldLess(e1.author(), e2.author());
     }
-
-    if (file.isDirectory()) {
-      files.emplace_back(std::string(name) + "/");
-    } else {
-      auto filename = std::string(name);
-      if (StringUtils::checkFileExtension(filename, ".epub") || StringUtils::checkFileExtension(filename, ".xtch") ||
-          StringUtils::checkFileExtension(filename, ".xtc") || StringUtils::checkFileExtension(filename, ".txt") ||
-          StringUtils::checkFileExtension(filename, ".md")) {
-        files.emplace_back(filename);
-      }
+    if (sort == CrossPointSettings::SORT_SERIES && strcmp(e1.series(), e2.series()) != 0) {
+      return fieldLess(e1.series(), e2.series());
     }
-    file.close();
-  }
-  root.close();
-  sortFileList(files);
+    const std::string title1 = displayTitle(e1);
+    const std::string title2 = displayTitle(e2);
+    if (title1 != title2) return naturalLess(title1.c_str(), title2.c_str());
+    return naturalLess(e1.name(), e2.name());
+  });
 }
 
+void MyLibraryActivity::loadFiles() {
+  RenderLock lock(*this);
+  entries = &LIBRARY_INDEX.listDirectory(basepath);
+  indexRevision = LIBRARY_INDEX.getRevision();
+  lastResort = millis();
+  sortFiles();
+}
+
+bool MyLibraryActivity::showsMetadata() const { return SETTINGS.librarySort != CrossPointSettings::SORT_FILE_NAME; }
+
 void MyLibraryActivity::onEnter() {
   Activity::onEnter();
 
@@ -114,9 +128,23 @@ void MyLibraryActivity::onEnter() {
 void MyLibraryActivity::onExit() {
   Activity::onExit();
   files.clear();
+  entries = nullptr;
+  LIBRARY_INDEX.release();
 }
 
 void MyLibraryActivity::loop() {
+  // Titles and authors the index read while the list was shown
+  if (showsMetadata() && LIBRARY_INDEX.getRevision() != indexRevision &&
+      (LIBRARY_INDEX.directoryComplete() || millis() - lastResort >= RESORT_INTERVAL_MS)) {
+    RenderLock lock(*this);
+    const std::string selected = files.empty() ? "" : entryAt(selectorIndex).name();
+    indexRevision = LIBRARY_INDEX.getRevision();
+    lastResort = millis();
+    sortFiles();
+    selectorIndex = findEntry(selected);
+    requestUpdate();
+  }
+
   // Long press BACK (1s+) goes to root folder
   if (mappedInput.isPressed(MappedInputManager::Button::Back) && mappedInput.getHeldTime() >= GO_HOME_MS &&
       basepath != "/") {
@@ -126,21 +154,23 @@ void MyLibraryActivity::loop() {
     return;
   }
 
-  const int pageItems = UITheme::getInstance().getNumberOfItemsPerPage(renderer, true, false, true, false);
+  const int pageItems = UITheme::getInstance().getNumberOfItemsPerPage(renderer, true, false, true, showsMetadata());
 
   if (mappedInput.wasReleased(MappedInputManager::Button::Confirm)) {
     if (files.empty()) {
       return;
     }
 
+    const LibraryEntry& entry = entryAt(selectorIndex);
     if (basepath.back() != '/') basepath += "/";
-    if (files[selectorIndex].back() == '/') {
-      basepath += files[selectorIndex].substr(0, files[selectorIndex].length() - 1);
+    if (entry.isDirectory()) {
+      const std::string name = entry.name();
+      basepath += name.substr(0, name.length() - 1);
       loadFiles();
       selectorIndex = 0;
       requestUpdate();
     } else {
-      onSelectBook(basepath + files[selectorIndex]);
+      onSelectBook(basepath + entry.name());
       return;
     }
   }
@@ -188,14 +218,6 @@ void MyLibraryActivity::loop() {
   });
 }
 
-std::string getFileName(std::string filename) {
-  if (filename.back() == '/') {
-    return filename.substr(0, filename.length() - 1);
-  }
-  const auto pos = filename.rfind('.');
-  return filename.substr(0, pos);
-}
-
 void MyLibraryActivity::render(Activity::RenderLock&&) {
   renderer.clearScreen();
 
@@ -210,11 +232,32 @@ void MyLibraryActivity::render(Activity::RenderLock&&) {
   const int contentHeight = pageHeight - contentTop - metrics.buttonHintsHeight - metrics.verticalSpacing;
   if (files.empty()) {
     renderer.drawText(UI_10_FONT_ID, metrics.contentSidePadding, contentTop + 20, tr(STR_NO_BOOKS_FOUND));
+  } else if (!showsMetadata()) {
+    GUI.drawList(
+        renderer, Rect{0, contentTop, pageWidth, contentHeight}, files.size(), selectorIndex,
+        [this](int index) { return getFileName(entryAt(index).name()); }, nullptr,
+        [this](int index) { return UITheme::getFileIcon(entryAt(index).name()); });
   } else {
     GUI.drawList(
         renderer, Rect{0, contentTop, pageWidth, contentHeight}, files.size(), selectorIndex,
-        [this](int index) { return getFileName(files[index]); }, nullptr,
-        [this](int index) { return UITheme::getFileIcon(files[index]); });
+        [this](int index) {
+          const LibraryEntry& entry = entryAt(index);
+          return entry.isDirectory() ? getFileName(entry.name()) : displayTitle(entry);
+        },
+        [this](int index) {
+          const LibraryEntry& entry = entryAt(index);
+          const std::string series = entry.series();
+          const std::string author = entry.author();
+          if (SETTINGS.librarySort == CrossPointSettings::SORT_SERIES && !series.empty()) {
+            return author.empty() ? series : series + " - " + author;
+          }
+          return author;
+        },
+        [this](int index) { return UITheme::getFileIcon(entryAt(index).name()); },
+        [this](int index) {
+          const LibraryEntry& entry = entryAt(index);
+          return entry.progress > 0 ? std::to_string(entry.progress) + "%" : std::string();
+        });
   }
 
   // Help text
@@ -227,6 +270,6 @@ void MyLibraryActivity::render(Activity::RenderLock&&) {
 
 size_t MyLibraryActivity::findEntry(const std::string& name) const {
   for (size_t i = 0; i < files.size(); i++)
-    if (files[i] == name) return i;
+    if (name == entryAt(i).name()) return i;
   return 0;
 }
\ No newline at end of file
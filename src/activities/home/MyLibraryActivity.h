@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "../Activity.h"
+#include "LibraryIndex.h"
 #include "RecentBooksStore.h"
 #include "util/ButtonNavigator.h"
 
@@ -15,7 +16,10 @@ class MyLibraryActivity final : public Activity {
 
   // Files state
   std::string basepath = "/";
-  std::vector<std::string> files;
+  const std::vector<LibraryEntry>* entries = nullptr;  // The library index's entries for basepath
+  std::vector<uint16_t> files;                         // Indices into entries, in display order
+  uint32_t indexRevision = 0;
+  unsigned long lastResort = 0;
 
   // Callbacks
   const std::function<void(const std::string& path)> onSelectBook;
@@ -23,7 +27,11 @@ class MyLibraryActivity final : public Activity {
 
   // Data loading
   void loadFiles();
+  void sortFiles();
+  const LibraryEntry& entryAt(size_t index) const;
   size_t findEntry(const std::string& name) const;
+  // Titles and authors instead of file names, for every order but the file name
+  bool showsMetadata() const;
 
  public:
   explicit MyLibraryActivity(GfxRenderer& renderer, MappedInputManager& mappedInput,
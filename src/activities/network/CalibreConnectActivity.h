@@ -20,7 +20,6 @@ class CalibreConnectActivity final : public ActivityWithSubactivity {
   std::unique_ptr<CrossPointWebServer> webServer;
   std::string connectedIP;
   std::string connectedSSID;
-  unsigned long lastHandleClientTime = 0;
   size_t lastProgressReceived = 0;
   size_t lastProgressTotal = 0;
   std::string currentUploadName;
@@ -42,6 +41,6 @@ class CalibreConnectActivity final : public ActivityWithSubactivity {
   void onExit() override;
   void loop() override;
   void render(Activity::RenderLock&&) override;
-  bool skipLoopDelay() override { return webServer && webServer->isRunning(); }
   bool preventAutoSleep() override { return webServer && webServer->isRunning(); }
+  bool usesStorageInBackground() override { return webServer && webServer->isRunning(); }
 };
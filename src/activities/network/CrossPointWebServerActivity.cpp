@@ -5,17 +5,18 @@
 #include <GfxRenderer.h>
 #include <I18n.h>
 #include <WiFi.h>
-#include <esp_task_wdt.h>
 #include <qrcode.h>
 
 #include <cstddef>
 
+#include "LibraryIndex.h"
 #include "MappedInputManager.h"
 #include "NetworkModeSelectionActivity.h"
 #include "WifiSelectionActivity.h"
 #include "activities/network/CalibreConnectActivity.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
+#include "util/SleepImageManifest.h"
 
 namespace {
 // AP Mode configuration
@@ -63,6 +64,9 @@ void CrossPointWebServerActivity::onExit() {
 
   // Stop the web server first (before disconnecting WiFi)
   stopWebServer();
+  // Books and sleep images may have been uploaded, moved or deleted
+  LIBRARY_INDEX.requestCrawl();
+  SleepImageManifest::invalidate();
 
   // Stop mDNS
   MDNS.end();
@@ -293,44 +297,7 @@ void CrossPointWebServerActivity::loop() {
       }
     }
 
-    // Handle web server requests - maximize throughput with watchdog safety
-    if (webServer && webServer->isRunning()) {
-      const unsigned long timeSinceLastHandleClient = millis() - lastHandleClientTime;
-
-      // Log if there's a significant gap between handleClient calls (>100ms)
-      if (lastHandleClientTime > 0 && timeSinceLastHandleClient > 100) {
-        LOG_DBG("WEBACT", "WARNING: %lu ms gap since last handleClient", timeSinceLastHandleClient);
-      }
-
-      // Reset watchdog BEFORE processing - HTTP header parsing can be slow
-      esp_task_wdt_reset();
-
-      // Process HTTP requests in tight loop for maximum throughput
-      // More iterations = more data processed per main loop cycle
-      constexpr int MAX_ITERATIONS = 500;
-      for (int i = 0; i < MAX_ITERATIONS && webServer->isRunning(); i++) {
-        webServer->handleClient();
-        // Reset watchdog every 32 iterations
-        if ((i & 0x1F) == 0x1F) {
-          esp_task_wdt_reset();
-        }
-        // Yield and check for exit button every 64 iterations
-        if ((i & 0x3F) == 0x3F) {
-          yield();
-          // Force trigger an update of which buttons are being pressed so be have accurate state
-          // for back button checking
-          mappedInput.update();
-          // Check for exit button inside loop for responsiveness
-          if (mappedInput.wasPressed(MappedInputManager::Button::Back)) {
-            onGoBack();
-            return;
-          }
-        }
-      }
-      lastHandleClientTime = millis();
-    }
-
-    // Handle exit on Back button (also check outside loop)
+    // Requests are served by the web server's own task
     if (mappedInput.wasPressed(MappedInputManager::Button::Back)) {
       onGoBack();
       return;
@@ -24,7 +24,7 @@ enum class WebServerActivityState {
  * - For STA mode: Launches WifiSelectionActivity to connect to an existing network
  * - For AP mode: Creates an Access Point that clients can connect to
  * - Starts the CrossPointWebServer when connected
- * - Handles client requests in its loop() function
+ * - Leaves client requests to the server's own task
  * - Cleans up the server and shuts down WiFi on exit
  */
 class CrossPointWebServerActivity final : public ActivityWithSubactivity {
@@ -42,9 +42,6 @@ class CrossPointWebServerActivity final : public ActivityWithSubactivity {
   std::string connectedIP;
   std::string connectedSSID;  // For STA mode: network name, For AP mode: AP name
 
-  // Performance monitoring
-  unsigned long lastHandleClientTime = 0;
-
   void renderServerRunning() const;
 
   void onNetworkModeSelected(NetworkMode mode);
@@ -61,6 +58,6 @@ class CrossPointWebServerActivity final : public ActivityWithSubactivity {
   void onExit() override;
   void loop() override;
   void render(Activity::RenderLock&&) override;
-  bool skipLoopDelay() override { return webServer && webServer->isRunning(); }
   bool preventAutoSleep() override { return webServer && webServer->isRunning(); }
+  bool usesStorageInBackground() override { return webServer && webServer->isRunning(); }
 };
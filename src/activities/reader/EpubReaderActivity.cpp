@@ -6,17 +6,21 @@
 #include <HalStorage.h>
 #include <I18n.h>
 #include <Logging.h>
+#include <Profiler.h>
 
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "BookIngestQueue.h"
+#include "CacheManager.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "EpubReaderChapterSelectionActivity.h"
 #include "EpubReaderPercentSelectionActivity.h"
 #include "KOReaderCredentialStore.h"
 #include "KOReaderSyncActivity.h"
+#include "LibraryIndex.h"
 #include "MappedInputManager.h"
 #include "RecentBooksStore.h"
 #include "components/UITheme.h"
@@ -31,6 +35,11 @@ constexpr unsigned long formattingToggleMs = 500;
 // New constant for double click speed
 constexpr unsigned long doubleClickMs = 400;
 
+// Progress is written once this many page turns or this much time has piled up, or the reader has been idle this long
+constexpr int progressFlushPages = 10;
+constexpr unsigned long progressFlushMs = 60000;
+constexpr unsigned long progressIdleFlushMs = 5000;
+
 // --- HIGHLIGHT MODE ---
 constexpr unsigned long highlightDoubleTapMs = 350;  // Double-tap Power window
 constexpr unsigned long highlightLongPressMs = 500;  // Long-press Back to cancel
@@ -72,6 +81,24 @@ void applyReaderOrientation(GfxRenderer& renderer, const uint8_t orientation) {
   }
 }
 
+// Space around the page text in the renderer's current orientation: screen margin, plus the status bar at the bottom
+void getContentMargins(const GfxRenderer& renderer, int& top, int& right, int& bottom, int& left) {
+  renderer.getOrientedViewableTRBL(&top, &right, &bottom, &left);
+  top += SETTINGS.screenMargin;
+  left += SETTINGS.screenMargin;
+  right += SETTINGS.screenMargin;
+  bottom += SETTINGS.screenMargin;
+
+  if (SETTINGS.statusBar != CrossPointSettings::STATUS_BAR_MODE::NONE) {
+    const bool showProgressBar = SETTINGS.statusBar == CrossPointSettings::STATUS_BAR_MODE::BOOK_PROGRESS_BAR ||
+                                 SETTINGS.statusBar == CrossPointSettings::STATUS_BAR_MODE::ONLY_BOOK_PROGRESS_BAR ||
+                                 SETTINGS.statusBar == CrossPointSettings::STATUS_BAR_MODE::CHAPTER_PROGRESS_BAR;
+    bottom += statusBarMargin - SETTINGS.screenMargin +
+              (showProgressBar ? (UITheme::getInstance().getMetrics().bookProgressBarHeight + progressBarMarginTop)
+                               : 0);
+  }
+}
+
 // Enum for cleaner alignment logic
 enum class BoxAlign { LEFT, RIGHT, CENTER };
 
@@ -220,19 +247,27 @@ void EpubReaderActivity::onEnter() {
     }
   }
 
-  if (Storage.openFileForRead("ERS", epub->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[6];
-    int dataSize = f.read(data, 6);
-    if (dataSize == 4 || dataSize == 6) {
+  progressJournal.reset(new RecordJournal(epub->getCachePath() + "/progress", epub->getCachePath() + "/progress.bin"));
+  std::string progress;
+  if (progressJournal->load(progress)) {
+    const auto* data = reinterpret_cast<const uint8_t*>(progress.data());
+    const int dataSize = static_cast<int>(progress.size());
+    if (dataSize == 4 || dataSize == 6 || dataSize == 12) {
       currentSpineIndex = data[0] + (data[1] << 8);
       nextPageNumber = data[2] + (data[3] << 8);
       cachedSpineIndex = currentSpineIndex;
       LOG_DBG("ERS", "Loaded cache: %d, %d", currentSpineIndex, nextPageNumber);
     }
-    if (dataSize == 6) {
+    if (dataSize >= 6) {
       cachedChapterTotalPageCount = data[4] + (data[5] << 8);
     }
-    f.close();
+    if (dataSize == 12) {
+      currentPageAnchor.sourceOffset =
+          data[6] | (data[7] << 8) | (data[8] << 16) | (static_cast<uint32_t>(data[9]) << 24);
+      currentPageAnchor.wordIndex = data[10] + (data[11] << 8);
+      currentPageAnchorValid = true;
+    }
+    progressRecord = std::move(progress);
   }
 
   if (currentSpineIndex == 0) {
@@ -246,6 +281,10 @@ void EpubReaderActivity::onEnter() {
   APP_STATE.openEpubPath = epub->getPath();
   APP_STATE.saveToFile();
   RECENT_BOOKS.addBook(epub->getPath(), epub->getTitle(), epub->getAuthor(), epub->getThumbBmpPath());
+  LIBRARY_INDEX.updateBook(epub->getPath(), epub->getTitle(), epub->getAuthor(), epub->getSeries(),
+                           epub->getLanguage(), epub->getThumbBmpPath());
+  CACHE_MANAGER.touch(epub->getCachePath());
+  BOOK_INGEST.bookOpened(epub->getPath());
 
   // Trigger first update
   requestUpdate();
@@ -253,14 +292,28 @@ void EpubReaderActivity::onEnter() {
 
 void EpubReaderActivity::onExit() {
   ActivityWithSubactivity::onExit();
+  BOOK_INGEST.bookClosed();
 
   renderer.setOrientation(GfxRenderer::Orientation::Portrait);
 
   // --- HIGHLIGHT MODE ---
   highlightState.reset();
   highlightCachedPage = -1;
+  if (epub) {
+    HighlightStore::exportIfDirty(epub->getTitle());
+  }
   // --- HIGHLIGHT MODE ---
 
+  flushProgress();
+  progressJournal.reset();
+  if (epub && epub->getBookSize() > 0) {
+    const float chapterProgress =
+        section && section->pageCount > 0
+            ? static_cast<float>(section->currentPage) / static_cast<float>(section->pageCount)
+            : 0.0f;
+    const float bookProgress = epub->calculateProgress(currentSpineIndex, chapterProgress) * 100.0f;
+    LIBRARY_INDEX.setProgress(epub->getPath(), clampPercent(static_cast<int>(bookProgress + 0.5f)));
+  }
   APP_STATE.readerActivityLoadCount = 0;
   APP_STATE.saveToFile();
   section.reset();
@@ -277,6 +330,11 @@ void EpubReaderActivity::loop() {
     requestUpdate();
   }
 
+  if (pendingProgressPages > 0 && millis() - lastProgressChange > progressIdleFlushMs) {
+    RenderLock lock(*this);
+    flushProgress();
+  }
+
   // --- HELP OVERLAY INTERCEPTION ---
   if (showHelpOverlay) {
     if (mappedInput.wasReleased(MappedInputManager::Button::Confirm) ||
@@ -300,6 +358,11 @@ void EpubReaderActivity::loop() {
   static bool waitingForFormatInc = false;
 
   if (subActivity) {
+    // Sub-activities (menu, chapter list, sync) need the heap more than the page frames do
+    if (!pageFrames.empty()) {
+      RenderLock lock(*this);
+      pageFrames.clear();
+    }
     subActivity->loop();
     if (pendingSubactivityExit) {
       pendingSubactivityExit = false;
@@ -1638,11 +1701,15 @@ void EpubReaderActivity::onReaderMenuConfirm(EpubReaderMenuActivity::MenuAction
             exitActivity();
             requestUpdate();
           },
-          [this](const int newSpineIndex) {
-            if (currentSpineIndex != newSpineIndex) {
-              currentSpineIndex = newSpineIndex;
-              nextPageNumber = 0;
-              section.reset();
+          [this](const int newSpineIndex, const std::string& anchor) {
+            {
+              RenderLock lock(*this);
+              if (currentSpineIndex != newSpineIndex) {
+                currentSpineIndex = newSpineIndex;
+                nextPageNumber = 0;
+                section.reset();
+              }
+              pendingAnchor = anchor;
             }
             exitActivity();
             requestUpdate();
@@ -1701,7 +1768,10 @@ void EpubReaderActivity::onReaderMenuConfirm(EpubReaderMenuActivity::MenuAction
           // 4. RESTORE: Re-setup the directory and rewrite the progress file
           epub->setupCacheDir();
 
+          progressJournal.reset(new RecordJournal(epub->getCachePath() + "/progress"));
+          progressRecord.clear();
           saveProgress(backupSpine, backupPage, backupPageCount);
+          flushProgress();
         }
       }
       // Defer go home to avoid race condition with display task
@@ -1773,12 +1843,24 @@ void EpubReaderActivity::applyOrientation(const uint8_t orientation) {
   }
 }
 
+void EpubReaderActivity::getSectionViewport(GfxRenderer& renderer, uint16_t& width, uint16_t& height) {
+  const auto orientation = renderer.getOrientation();
+  applyReaderOrientation(renderer, SETTINGS.orientation);
+  int marginTop, marginRight, marginBottom, marginLeft;
+  getContentMargins(renderer, marginTop, marginRight, marginBottom, marginLeft);
+  width = renderer.getScreenWidth() - marginLeft - marginRight;
+  height = renderer.getScreenHeight() - marginTop - marginBottom;
+  renderer.setOrientation(orientation);
+}
+
 // TODO: Failure handling
 void EpubReaderActivity::render(Activity::RenderLock&& lock) {
   if (!epub) {
     return;
   }
 
+  PROFILE_PAGE_BEGIN();
+
   if (currentSpineIndex < 0) {
     currentSpineIndex = 0;
   }
@@ -1794,24 +1876,10 @@ void EpubReaderActivity::render(Activity::RenderLock&& lock) {
   }
 
   int orientedMarginTop, orientedMarginRight, orientedMarginBottom, orientedMarginLeft;
-  renderer.getOrientedViewableTRBL(&orientedMarginTop, &orientedMarginRight, &orientedMarginBottom,
-                                   &orientedMarginLeft);
-  orientedMarginTop += SETTINGS.screenMargin;
-  orientedMarginLeft += SETTINGS.screenMargin;
-  orientedMarginRight += SETTINGS.screenMargin;
-  orientedMarginBottom += SETTINGS.screenMargin;
-
-  auto metrics = UITheme::getInstance().getMetrics();
-
-  if (SETTINGS.statusBar != CrossPointSettings::STATUS_BAR_MODE::NONE) {
-    const bool showProgressBar = SETTINGS.statusBar == CrossPointSettings::STATUS_BAR_MODE::BOOK_PROGRESS_BAR ||
-                                 SETTINGS.statusBar == CrossPointSettings::STATUS_BAR_MODE::ONLY_BOOK_PROGRESS_BAR ||
-                                 SETTINGS.statusBar == CrossPointSettings::STATUS_BAR_MODE::CHAPTER_PROGRESS_BAR;
-    orientedMarginBottom += statusBarMargin - SETTINGS.screenMargin +
-                            (showProgressBar ? (metrics.bookProgressBarHeight + progressBarMarginTop) : 0);
-  }
+  getContentMargins(renderer, orientedMarginTop, orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
 
   if (!section) {
+    PROFILE_SCOPE(profiler::SECTION_LOAD);
     const auto filepath = epub->getSpineItem(currentSpineIndex).href;
     LOG_DBG("ERS", "Loading file: %s, index: %d", filepath.c_str(), currentSpineIndex);
     section = std::unique_ptr<Section>(new Section(epub, currentSpineIndex, renderer));
@@ -1856,9 +1924,15 @@ void EpubReaderActivity::render(Activity::RenderLock&& lock) {
     }
 
     if (cachedChapterTotalPageCount > 0) {
-      if (currentSpineIndex == cachedSpineIndex && section->pageCount != cachedChapterTotalPageCount) {
-        float progress = static_cast<float>(section->currentPage) / static_cast<float>(cachedChapterTotalPageCount);
-        section->currentPage = static_cast<int>(progress * section->pageCount);
+      if (currentSpineIndex == cachedSpineIndex) {
+        // Same paragraph as before the reflow; sections without anchors fall back to the same fraction of the chapter
+        const int anchorPage = currentPageAnchorValid ? section->findPageForContentAnchor(currentPageAnchor) : -1;
+        if (anchorPage >= 0) {
+          section->currentPage = anchorPage;
+        } else if (section->pageCount != cachedChapterTotalPageCount) {
+          float progress = static_cast<float>(section->currentPage) / static_cast<float>(cachedChapterTotalPageCount);
+          section->currentPage = static_cast<int>(progress * section->pageCount);
+        }
       }
       cachedChapterTotalPageCount = 0;
     }
@@ -1873,6 +1947,14 @@ void EpubReaderActivity::render(Activity::RenderLock&& lock) {
     }
   }
 
+  if (!pendingAnchor.empty()) {
+    const int anchorPage = section->findPageForAnchor(pendingAnchor);
+    if (anchorPage >= 0) {
+      section->currentPage = anchorPage;
+    }
+    pendingAnchor.clear();
+  }
+
   renderer.clearScreen();
 
   if (section->pageCount == 0) {
@@ -1892,7 +1974,11 @@ void EpubReaderActivity::render(Activity::RenderLock&& lock) {
   }
 
   {
-    auto p = section->loadPageFromSectionFile();
+    std::unique_ptr<Page> p;
+    {
+      PROFILE_SCOPE(profiler::PAGE_DESERIALIZE);
+      p = section->loadPageFromSectionFile();
+    }
     if (!p) {
       LOG_ERR("ERS", "Failed to load page from SD - clearing section cache");
       section->clearCache();
@@ -1901,30 +1987,146 @@ void EpubReaderActivity::render(Activity::RenderLock&& lock) {
       // TODO: prevent infinite loop if the page keeps failing to load for some reason
       return;
     }
+    currentPageAnchor = p->anchor;
+    currentPageAnchorValid = true;
     const auto start = millis();
     renderContents(std::move(p), orientedMarginTop, orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
     LOG_DBG("ERS", "Rendered page in %dms", millis() - start);
     renderer.clearFontCache();
+    PROFILE_PAGE_END(currentSpineIndex, section->currentPage);
   }
   saveProgress(currentSpineIndex, section->currentPage, section->pageCount);
+  prerenderAdjacentPages(orientedMarginTop, orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
 }
 
 void EpubReaderActivity::saveProgress(int spineIndex, int currentPage, int pageCount) {
-  FsFile f;
-  if (Storage.openFileForWrite("ERS", epub->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[6];
-    data[0] = currentSpineIndex & 0xFF;
-    data[1] = (currentSpineIndex >> 8) & 0xFF;
-    data[2] = currentPage & 0xFF;
-    data[3] = (currentPage >> 8) & 0xFF;
-    data[4] = pageCount & 0xFF;
-    data[5] = (pageCount >> 8) & 0xFF;
-    f.write(data, 6);
-    f.close();
-    LOG_DBG("ERS", "Progress saved: Chapter %d, Page %d", spineIndex, currentPage);
+  uint8_t data[12];
+  data[0] = currentSpineIndex & 0xFF;
+  data[1] = (currentSpineIndex >> 8) & 0xFF;
+  data[2] = currentPage & 0xFF;
+  data[3] = (currentPage >> 8) & 0xFF;
+  data[4] = pageCount & 0xFF;
+  data[5] = (pageCount >> 8) & 0xFF;
+  // Content anchor of the page, so the position survives a settings change that reflows the chapter
+  data[6] = currentPageAnchor.sourceOffset & 0xFF;
+  data[7] = (currentPageAnchor.sourceOffset >> 8) & 0xFF;
+  data[8] = (currentPageAnchor.sourceOffset >> 16) & 0xFF;
+  data[9] = (currentPageAnchor.sourceOffset >> 24) & 0xFF;
+  data[10] = currentPageAnchor.wordIndex & 0xFF;
+  data[11] = (currentPageAnchor.wordIndex >> 8) & 0xFF;
+  std::string record(reinterpret_cast<const char*>(data), currentPageAnchorValid ? 12 : 6);
+  if (record == progressRecord) {
+    return;  // Re-render of the same page
+  }
+
+  const unsigned long now = millis();
+  if (pendingProgressPages == 0) {
+    pendingProgressSince = now;
+  }
+  progressRecord = std::move(record);
+  pendingProgressPages++;
+  lastProgressChange = now;
+  LOG_DBG("ERS", "Progress pending: Chapter %d, Page %d", spineIndex, currentPage);
+
+  if (pendingProgressPages >= progressFlushPages || now - pendingProgressSince >= progressFlushMs) {
+    flushProgress();
+  }
+}
+
+void EpubReaderActivity::flushProgress() {
+  if (pendingProgressPages == 0 || !progressJournal) {
+    return;
+  }
+  if (progressJournal->append(progressRecord)) {
+    LOG_DBG("ERS", "Progress saved after %d page(s)", pendingProgressPages);
   } else {
     LOG_ERR("ERS", "Could not save progress!");
   }
+  pendingProgressPages = 0;
+}
+
+PageFrameCache::Key EpubReaderActivity::pageFrameKey(const int pageIndex) const {
+  // FNV-1a over everything that changes the pixels of a page (the section's page count covers a rebuilt layout)
+  uint32_t layout = 2166136261u;
+  const auto mix = [&layout](const uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+      layout = (layout ^ ((value >> shift) & 0xFF)) * 16777619u;
+    }
+  };
+  mix(static_cast<uint32_t>(SETTINGS.getReaderFontId()));
+  mix(static_cast<uint32_t>(SETTINGS.getReaderLineCompression() * 1000));
+  mix(SETTINGS.extraParagraphSpacing | SETTINGS.paragraphAlignment << 8 | SETTINGS.hyphenationEnabled << 16 |
+      SETTINGS.embeddedStyle << 24);
+  mix(SETTINGS.forceBoldText | SETTINGS.screenMargin << 8 | SETTINGS.orientation << 16 | SETTINGS.statusBar << 24);
+  mix(SETTINGS.hideBatteryPercentage | SETTINGS.uiTheme << 8 | SETTINGS.highlightModeEnabled << 16 |
+      (isNightMode ? 1u : 0u) << 24);
+  mix(section ? section->pageCount : 0);
+  return {layout, currentSpineIndex, pageIndex};
+}
+
+void EpubReaderActivity::prerenderAdjacentPages(const int orientedMarginTop, const int orientedMarginRight,
+                                                const int orientedMarginBottom, const int orientedMarginLeft) {
+  if (!section || highlightState.mode != HighlightState::INACTIVE || showHelpOverlay) {
+    return;
+  }
+
+  const int currentPage = section->currentPage;
+  const PageFrameCache::Key window[] = {pageFrameKey(currentPage - 1), pageFrameKey(currentPage),
+                                        pageFrameKey(currentPage + 1)};
+  pageFrames.retain(window, 3);
+
+  // The displayed page has to be put back into the frame buffer afterwards (popups draw on top of it)
+  if (!pageFrames.contains(window[1]) && (!frameBufferHoldsPage || !pageFrames.store(window[1]))) {
+    return;
+  }
+
+  bool clobbered = false;
+  // Next page first: reading forward is by far the common case
+  for (const int pageIndex : {currentPage + 1, currentPage - 1}) {
+    if (hasPendingUpdate()) {
+      break;  // The user has moved on, don't hold up the next render
+    }
+    if (pageIndex < 0 || pageIndex >= section->pageCount || pageFrames.contains(pageFrameKey(pageIndex))) {
+      continue;
+    }
+    if (!prerenderPage(pageIndex, orientedMarginTop, orientedMarginRight, orientedMarginBottom, orientedMarginLeft)) {
+      continue;
+    }
+    clobbered = true;
+    if (!pageFrames.store(pageFrameKey(pageIndex))) {
+      break;  // Out of heap, the other side won't fit either
+    }
+    LOG_DBG("ERS", "Pre-rendered page %d", pageIndex);
+  }
+
+  if (clobbered) {
+    renderer.clearFontCache();
+    pageFrames.restore(window[1]);
+  }
+}
+
+bool EpubReaderActivity::prerenderPage(const int pageIndex, const int orientedMarginTop, const int orientedMarginRight,
+                                       const int orientedMarginBottom, const int orientedMarginLeft) {
+  // Pages with images use the two-step image refresh and pages with saved highlights need their bars drawn;
+  // both are left to the normal render path.
+  if (SETTINGS.highlightModeEnabled &&
+      !HighlightStore::loadHighlightsForPage(epub->getTitle(), currentSpineIndex, pageIndex).empty()) {
+    return false;
+  }
+  const auto page = section->loadPage(pageIndex);
+  if (!page || page->hasImages()) {
+    return false;
+  }
+
+  renderer.clearScreen();
+  EpdFontFamily::globalForceBold = (SETTINGS.forceBoldText == 1);
+  page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop);
+  EpdFontFamily::globalForceBold = false;
+  renderStatusBar(orientedMarginRight, orientedMarginBottom, orientedMarginLeft, pageIndex);
+  if (isNightMode) {
+    renderer.invertScreen();
+  }
+  return true;
 }
 
 void EpubReaderActivity::renderContents(std::unique_ptr<Page> page, const int orientedMarginTop,
@@ -1952,6 +2154,19 @@ void EpubReaderActivity::renderContents(std::unique_ptr<Page> page, const int or
     }
   }
 
+  // --- PRE-RENDERED FRAME ---
+  // Frames rendered ahead while idle already contain the text, status bar and night mode inversion.
+  // Highlight mode can change saved highlights behind the cache's back, so drop it instead.
+  frameBufferHoldsPage = false;
+  bool usedPrerendered = false;
+  if (inHighlightMode) {
+    pageFrames.clear();
+  } else if (!showHelpOverlay && pageFrames.restore(pageFrameKey(currentPageIdx))) {
+    usedPrerendered = true;
+    usedCache = true;
+    LOG_DBG("ERS", "Using pre-rendered frame for page %d", currentPageIdx);
+  }
+
   // Force special handling for pages with images when anti-aliasing is on
   bool imagePageWithAA = !usedCache && page->hasImages() && SETTINGS.textAntiAliasing;
 
@@ -2116,7 +2331,8 @@ void EpubReaderActivity::renderContents(std::unique_ptr<Page> page, const int or
   // --- HIGHLIGHT MODE ---
 
   // --- HIGHLIGHT MODE --- Draw saved (persisted) highlights
-  if (SETTINGS.highlightModeEnabled && section) {
+  // (pages with saved highlights are never pre-rendered)
+  if (SETTINGS.highlightModeEnabled && section && !usedPrerendered) {
     const int fontId = SETTINGS.getReaderFontId();
     int currentPageIdx = section->currentPage;
     auto savedHighlights = HighlightStore::loadHighlightsForPage(epub->getTitle(), currentSpineIndex, currentPageIdx);
@@ -2309,6 +2525,16 @@ void EpubReaderActivity::renderContents(std::unique_ptr<Page> page, const int or
     }
   }
 
+  // Input that arrived while this page was being drawn (or while the previous page was still refreshing) makes it
+  // stale. Drop it so several quick page turns cost one panel refresh; the pending update renders the final page.
+  if (!inHighlightMode && !showHelpOverlay) {
+    renderer.waitForDisplayIdle();
+    if (hasPendingUpdate()) {
+      LOG_DBG("ERS", "Skipping refresh of stale page");
+      return;
+    }
+  }
+
   // --- STANDARD or IMAGE REFRESH ---
   // In highlight mode, use displayHighlightBuffer() (lut_bw_fast: 4-frame A2-like LUT, ~3× faster
   // than OTP FAST_REFRESH) — the overlay is BW-only so grayscale quality doesn't matter.
@@ -2352,10 +2578,12 @@ void EpubReaderActivity::renderContents(std::unique_ptr<Page> page, const int or
   // In highlight mode, the BW buffer is used as a page cache for fast cursor moves.
   // Skip the AA store/restore cycle — AA is already disabled during highlight mode.
   if (!inHighlightMode) {
-    renderer.storeBwBuffer();
+    const bool storedBw = renderer.storeBwBuffer();
+    bool ranGrayscale = false;
 
-    // Anti-aliasing grayscale passes
-    if (SETTINGS.textAntiAliasing && !showHelpOverlay && !isNightMode) {
+    // Anti-aliasing grayscale passes (skipped when the user has already moved on)
+    if (SETTINGS.textAntiAliasing && !showHelpOverlay && !isNightMode && !hasPendingUpdate()) {
+      ranGrayscale = true;
       renderer.clearScreen(0x00);
 
       // TURN ON BOLD FOR GRAYSCALE PASSES
@@ -2380,18 +2608,25 @@ void EpubReaderActivity::renderContents(std::unique_ptr<Page> page, const int or
       renderer.setRenderMode(GfxRenderer::BW);
     }
     renderer.restoreBwBuffer();
+
+    // Only a plain text page whose BW frame survived the grayscale passes can seed the frame cache
+    frameBufferHoldsPage = !showHelpOverlay && !drewHighlights && !page->hasImages() && (storedBw || !ranGrayscale);
   }
   // If anti-aliasing ran, it wiped highlights from the display. The BW buffer (restored above)
   // still has the highlights — do one fast refresh to put them back on screen.
   // (This path is only reached when !inHighlightMode, so drewHighlights here means persisted
   // saved-highlight bars drawn over regular reading — not the active cursor/selection overlay.)
-  if (drewHighlights && SETTINGS.textAntiAliasing && !showHelpOverlay && !isNightMode && !inHighlightMode) {
+  if (drewHighlights && SETTINGS.textAntiAliasing && !showHelpOverlay && !isNightMode && !inHighlightMode &&
+      !hasPendingUpdate()) {
     renderer.displayBuffer(HalDisplay::FAST_REFRESH);
   }
 }
 
 void EpubReaderActivity::renderStatusBar(const int orientedMarginRight, const int orientedMarginBottom,
-                                         const int orientedMarginLeft) const {
+                                         const int orientedMarginLeft, int pageIndex) const {
+  if (pageIndex < 0) {
+    pageIndex = section->currentPage;
+  }
   auto metrics = UITheme::getInstance().getMetrics();
 
   const bool showProgressPercentage = SETTINGS.statusBar == CrossPointSettings::STATUS_BAR_MODE::FULL;
@@ -2416,19 +2651,19 @@ void EpubReaderActivity::renderStatusBar(const int orientedMarginRight, const in
   const auto textY = screenHeight - orientedMarginBottom - 4;
   int progressTextWidth = 0;
 
-  const float sectionChapterProg = static_cast<float>(section->currentPage) / section->pageCount;
+  const float sectionChapterProg = static_cast<float>(pageIndex) / section->pageCount;
   const float bookProgress = epub->calculateProgress(currentSpineIndex, sectionChapterProg) * 100;
 
   if (showProgressText || showProgressPercentage || showBookPercentage) {
     char progressStr[32];
 
     if (showProgressPercentage) {
-      snprintf(progressStr, sizeof(progressStr), "%d/%d  %.0f%%", section->currentPage + 1, section->pageCount,
+      snprintf(progressStr, sizeof(progressStr), "%d/%d  %.0f%%", pageIndex + 1, section->pageCount,
                bookProgress);
     } else if (showBookPercentage) {
       snprintf(progressStr, sizeof(progressStr), "%.0f%%", bookProgress);
     } else {
-      snprintf(progressStr, sizeof(progressStr), "%d/%d", section->currentPage + 1, section->pageCount);
+      snprintf(progressStr, sizeof(progressStr), "%d/%d", pageIndex + 1, section->pageCount);
     }
 
     progressTextWidth = renderer.getTextWidth(SMALL_FONT_ID, progressStr);
@@ -2442,7 +2677,7 @@ void EpubReaderActivity::renderStatusBar(const int orientedMarginRight, const in
 
   if (showChapterProgressBar) {
     const float chapterProgress =
-        (section->pageCount > 0) ? (static_cast<float>(section->currentPage + 1) / section->pageCount) * 100 : 0;
+        (section->pageCount > 0) ? (static_cast<float>(pageIndex + 1) / section->pageCount) * 100 : 0;
     GUI.drawReadingProgressBar(renderer, static_cast<size_t>(chapterProgress));
   }
 
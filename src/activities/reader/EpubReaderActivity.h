@@ -1,9 +1,11 @@
 #pragma once
 #include <Epub.h>
 #include <Epub/Section.h>
+#include <RecordJournal.h>
 
 #include "EpubReaderMenuActivity.h"
 #include "activities/ActivityWithSubactivity.h"
+#include "util/PageFrameCache.h"
 
 // --- HIGHLIGHT MODE ---
 struct HighlightState {
@@ -40,12 +42,25 @@ class EpubReaderActivity final : public ActivityWithSubactivity {
   int pagesUntilFullRefresh = 0;
   int cachedSpineIndex = 0;
   int cachedChapterTotalPageCount = 0;
+  // Layout-independent position of the last page shown (or read from the progress journal), used to find the same place
+  // again after a setting change rebuilds the section
+  ContentAnchor currentPageAnchor;
+  bool currentPageAnchorValid = false;
+  // Position records are held back and appended to the journal in batches: after a few pages or seconds, when the
+  // reader goes idle, or on exit (which also covers going to sleep)
+  std::unique_ptr<RecordJournal> progressJournal;
+  std::string progressRecord;    // Newest position, written or not
+  int pendingProgressPages = 0;  // Page turns since progressRecord was last written
+  unsigned long pendingProgressSince = 0;
+  unsigned long lastProgressChange = 0;
   size_t totalBookBytes = 0;
   // Signals that the next render should reposition within the newly loaded section
   // based on a cross-book percentage jump.
   bool pendingPercentJump = false;
   // Normalized 0.0-1.0 progress within the target spine item, computed from book percentage.
   float pendingSpineProgress = 0.0f;
+  // TOC fragment to jump to once the target section is loaded, looked up in the section's anchor table
+  std::string pendingAnchor;
   bool pendingSubactivityExit = false;  // Defer subactivity exit to avoid use-after-free
   bool pendingGoHome = false;           // Defer go home to avoid race condition with display task
   bool skipNextButtonCheck = false;     // Skip button processing for one frame after subactivity exit
@@ -54,13 +69,24 @@ class EpubReaderActivity final : public ActivityWithSubactivity {
   int previousSpineIndex = -1;   // Track spine changes for force-exit
   int highlightCachedPage = -1;  // Page index cached in BW buffer for fast cursor moves
   // --- HIGHLIGHT MODE ---
+  // Pre-rendered BW frames of the pages around the current one, filled while the reader is idle
+  PageFrameCache pageFrames;
+  bool frameBufferHoldsPage = false;  // Frame buffer still has the last displayed page after renderContents()
   const std::function<void()> onGoBack;
   const std::function<void()> onGoHome;
 
   void renderContents(std::unique_ptr<Page> page, int orientedMarginTop, int orientedMarginRight,
                       int orientedMarginBottom, int orientedMarginLeft);
-  void renderStatusBar(int orientedMarginRight, int orientedMarginBottom, int orientedMarginLeft) const;
+  // pageIndex < 0 means the section's current page
+  void renderStatusBar(int orientedMarginRight, int orientedMarginBottom, int orientedMarginLeft,
+                       int pageIndex = -1) const;
+  PageFrameCache::Key pageFrameKey(int pageIndex) const;
+  void prerenderAdjacentPages(int orientedMarginTop, int orientedMarginRight, int orientedMarginBottom,
+                              int orientedMarginLeft);
+  bool prerenderPage(int pageIndex, int orientedMarginTop, int orientedMarginRight, int orientedMarginBottom,
+                     int orientedMarginLeft);
   void saveProgress(int spineIndex, int currentPage, int pageCount);
+  void flushProgress();
   // Jump to a percentage of the book (0-100), mapping it to spine and page.
   void jumpToPercent(int percent);
   void onReaderMenuBack(uint8_t orientation);
@@ -72,10 +98,14 @@ class EpubReaderActivity final : public ActivityWithSubactivity {
                               const std::function<void()>& onGoBack, const std::function<void()>& onGoHome)
       : ActivityWithSubactivity("EpubReader", renderer, mappedInput),
         epub(std::move(epub)),
+        pageFrames(renderer),
         onGoBack(onGoBack),
         onGoHome(onGoHome) {}
   void onEnter() override;
   void onExit() override;
   void loop() override;
   void render(Activity::RenderLock&& lock) override;
+
+  // Size of the text area in the reader's orientation with the current settings: what sections are laid out for
+  static void getSectionViewport(GfxRenderer& renderer, uint16_t& width, uint16_t& height);
 };
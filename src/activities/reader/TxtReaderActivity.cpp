@@ -6,8 +6,13 @@
 #include <Serialization.h>
 #include <Utf8.h>
 
+#include <algorithm>
+
+#include "BookIngestQueue.h"
+#include "CacheManager.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
+#include "LibraryIndex.h"
 #include "MappedInputManager.h"
 #include "RecentBooksStore.h"
 #include "components/UITheme.h"
@@ -57,6 +62,9 @@ void TxtReaderActivity::onEnter() {
   APP_STATE.openEpubPath = filePath;
   APP_STATE.saveToFile();
   RECENT_BOOKS.addBook(filePath, fileName, "", "");
+  LIBRARY_INDEX.updateBook(filePath, fileName, "", "", "", "");
+  CACHE_MANAGER.touch(txt->getCachePath());
+  BOOK_INGEST.bookOpened(txt->getPath());
 
   // Trigger first update
   requestUpdate();
@@ -64,10 +72,14 @@ void TxtReaderActivity::onEnter() {
 
 void TxtReaderActivity::onExit() {
   ActivityWithSubactivity::onExit();
+  BOOK_INGEST.bookClosed();
 
   // Reset orientation back to portrait for the rest of the UI
   renderer.setOrientation(GfxRenderer::Orientation::Portrait);
 
+  if (txt && totalPages > 0) {
+    LIBRARY_INDEX.setProgress(txt->getPath(), std::min((currentPage + 1) * 100 / totalPages, 100));
+  }
   pageOffsets.clear();
   currentPageLines.clear();
   APP_STATE.readerActivityLoadCount = 0;
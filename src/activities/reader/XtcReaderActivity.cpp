@@ -12,8 +12,13 @@
 #include <HalStorage.h>
 #include <I18n.h>
 
+#include <algorithm>
+
+#include "BookIngestQueue.h"
+#include "CacheManager.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
+#include "LibraryIndex.h"
 #include "MappedInputManager.h"
 #include "RecentBooksStore.h"
 #include "XtcReaderChapterSelectionActivity.h"
@@ -41,6 +46,9 @@ void XtcReaderActivity::onEnter() {
   APP_STATE.openEpubPath = xtc->getPath();
   APP_STATE.saveToFile();
   RECENT_BOOKS.addBook(xtc->getPath(), xtc->getTitle(), xtc->getAuthor(), xtc->getThumbBmpPath());
+  LIBRARY_INDEX.updateBook(xtc->getPath(), xtc->getTitle(), xtc->getAuthor(), "", "", xtc->getThumbBmpPath());
+  CACHE_MANAGER.touch(xtc->getCachePath());
+  BOOK_INGEST.bookOpened(xtc->getPath());
 
   // Trigger first update
   requestUpdate();
@@ -48,7 +56,12 @@ void XtcReaderActivity::onEnter() {
 
 void XtcReaderActivity::onExit() {
   ActivityWithSubactivity::onExit();
+  BOOK_INGEST.bookClosed();
 
+  if (xtc && xtc->getPageCount() > 0) {
+    const uint32_t percent = std::min<uint32_t>((currentPage + 1) * 100 / xtc->getPageCount(), 100);
+    LIBRARY_INDEX.setProgress(xtc->getPath(), static_cast<uint8_t>(percent));
+  }
   APP_STATE.readerActivityLoadCount = 0;
   APP_STATE.saveToFile();
   xtc.reset();
@@ -1,3 +1,4 @@
+#include <AllocTracker.h>
 #include <Arduino.h>
 #include <Epub.h>
 #include <FontDecompressor.h>
@@ -8,15 +9,20 @@
 #include <HalStorage.h>
 #include <I18n.h>
 #include <Logging.h>
+#include <Profiler.h>
 #include <SPI.h>
 #include <builtinFonts/all.h>
 
 #include <cstring>
 
+#include "BackgroundJob.h"
 #include "Battery.h"
+#include "BookIngestQueue.h"
+#include "CacheManager.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "KOReaderCredentialStore.h"
+#include "LibraryIndex.h"
 #include "MappedInputManager.h"
 #include "RecentBooksStore.h"
 #include "activities/boot_sleep/BootActivity.h"
@@ -348,6 +354,8 @@ void setup() {
 
   APP_STATE.loadFromFile();
   RECENT_BOOKS.loadFromFile();
+  CACHE_MANAGER.loadFromFile();
+  BOOK_INGEST.loadFromFile();
 
   // Boot to home screen if no book is open, last sleep was not from reader, back button is held, or reader activity
   // crashed (indicated by readerActivityLoadCount > 0)
@@ -377,11 +385,19 @@ void loop() {
   renderer.setFadingFix(SETTINGS.fadingFix);
 
   if (Serial && millis() - lastMemPrint >= 10000) {
-    LOG_INF("MEM", "Free: %d bytes, Total: %d bytes, Min Free: %d bytes", ESP.getFreeHeap(), ESP.getHeapSize(),
-            ESP.getMinFreeHeap());
+    LOG_INF("MEM", "Free: %d bytes, Total: %d bytes, Min Free: %d bytes, Max Alloc: %d bytes", ESP.getFreeHeap(),
+            ESP.getHeapSize(), ESP.getMinFreeHeap(), ESP.getMaxAllocHeap());
     lastMemPrint = millis();
   }
 
+#ifdef ENABLE_ALLOC_TRACKER
+  static unsigned long lastAllocSample = 0;
+  if (millis() - lastAllocSample >= 250) {
+    ALLOC_TRACK_SAMPLE();
+    lastAllocSample = millis();
+  }
+#endif
+
   // Handle incoming serial commands,
   // nb: we use logSerial from logging to avoid deprecation warnings
   if (logSerial.available() > 0) {
@@ -395,12 +411,36 @@ void loop() {
         logSerial.write(buf, HalDisplay::BUFFER_SIZE);
         logSerial.printf("SCREENSHOT_END\n");
       }
+#ifdef ENABLE_PROFILER
+      if (cmd == "PROFILE") {
+        profiler::dumpToSerial();
+      }
+#endif
+#ifdef ENABLE_ALLOC_TRACKER
+      if (cmd == "ALLOC") {
+        alloctracker::dump([](const char* trackerLine) {
+          logSerial.print(trackerLine);
+          logSerial.print("\n");
+        });
+      }
+#endif
     }
   }
 
-  // Check for any user activity (button press or release) or active background work
+  // While a background job runs, the activity is left alone; a button press waits for the job to end
+  if (BACKGROUND_JOB.isRunning()) {
+    if (!gpio.wasAnyPressed() && !gpio.wasAnyReleased()) {
+      delay(10);
+      return;
+    }
+    BACKGROUND_JOB.wait();
+  }
+
+  // Check for any user activity (button press or release) or active background work.
+  // A refresh still running on the display task counts too: the CPU clock must not drop mid-transfer.
   static unsigned long lastActivityTime = millis();
-  if (gpio.wasAnyPressed() || gpio.wasAnyReleased() || (currentActivity && currentActivity->preventAutoSleep())) {
+  if (gpio.wasAnyPressed() || gpio.wasAnyReleased() || display.isBusy() ||
+      (currentActivity && currentActivity->preventAutoSleep())) {
     lastActivityTime = millis();         // Reset inactivity timer
     powerManager.setPowerSaving(false);  // Restore normal CPU frequency on user activity
   }
@@ -425,6 +465,26 @@ void loop() {
   }
   const unsigned long activityDuration = millis() - activityStartTime;
 
+  // Sleep cover, preparing new books, cache housekeeping and library indexing once the user has paused. Holding the
+  // render lock keeps them off the SD card and the frame buffer while the activity's render task uses them; web server
+  // activities write to the card from their server task, so they are left alone. Decoding a cover, preparing a book
+  // and reading an EPUB's metadata take seconds, so they run as background jobs and the buttons are still read.
+  if (currentActivity && !currentActivity->skipLoopDelay() && !currentActivity->usesStorageInBackground() &&
+      !display.isBusy() && millis() - lastActivityTime >= CacheManager::IDLE_DELAY_MS) {
+    if (SleepActivity::coverFrameWanted()) {
+      BACKGROUND_JOB.start(*currentActivity, [] { SleepActivity::prepareCoverFrame(renderer); });
+    } else if (BOOK_INGEST.hasWork(true)) {
+      BACKGROUND_JOB.start(*currentActivity, [] { BOOK_INGEST.step(&renderer); });
+    } else if (LIBRARY_INDEX.nextStepReadsEpub()) {
+      BACKGROUND_JOB.start(*currentActivity, [] { LIBRARY_INDEX.step(); });
+    } else {
+      Activity::RenderLock lock(currentActivity->renderingActivity());
+      if (!CACHE_MANAGER.step()) {
+        LIBRARY_INDEX.step();
+      }
+    }
+  }
+
   const unsigned long loopDuration = millis() - loopStartTime;
   if (loopDuration > maxLoopDuration) {
     maxLoopDuration = loopDuration;
@@ -434,7 +494,7 @@ void loop() {
   }
 
   // Add delay at the end of the loop to prevent tight spinning
-  // When an activity requests skip loop delay (e.g., webserver running), use yield() for faster response
+  // When an activity requests skip loop delay (e.g., OTA update running), use yield() for faster response
   // Otherwise, use longer delay to save power
   if (currentActivity && currentActivity->skipLoopDelay()) {
     powerManager.setPowerSaving(false);  // Make sure we're at full performance when skipLoopDelay is requested
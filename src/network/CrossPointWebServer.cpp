@@ -9,8 +9,12 @@
 #include <esp_task_wdt.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 
+#include "BookIngestQueue.h"
 #include "CrossPointSettings.h"
+#include "HttpRange.h"
 #include "SettingsList.h"
 #include "html/FilesPageHtml.generated.h"
 #include "html/HomePageHtml.generated.h"
@@ -29,23 +33,24 @@ constexpr uint16_t LOCAL_UDP_PORT = 8134;
 CrossPointWebServer* wsInstance = nullptr;
 
 // WebSocket upload state
-FsFile wsUploadFile;
 String wsUploadFileName;
 String wsUploadPath;
 size_t wsUploadSize = 0;
 size_t wsUploadReceived = 0;
 unsigned long wsUploadStartTime = 0;
 bool wsUploadInProgress = false;
+uint8_t wsUploadClient = 0;  // The WebSocket client sending the upload in progress
+bool wsUploadResumable = false;  // Started with RESUME: frames carry their offset and CRC
+bool wsResendRequested = false;
+size_t wsLastProgressSent = 0;
 String wsLastCompleteName;
 size_t wsLastCompleteSize = 0;
 unsigned long wsLastCompleteAt = 0;
 
-// Helper function to clear epub cache after upload
-void clearEpubCacheIfNeeded(const String& filePath) {
-  // Only clear cache for .epub files
-  if (StringUtils::checkFileExtension(filePath, ".epub")) {
-    Epub(filePath.c_str(), "/.crosspoint").clearCache();
-    LOG_DBG("WEB", "Cleared epub cache for: %s", filePath.c_str());
+// A moved or renamed epub keeps its content, so its cache stays valid under the new path
+void moveEpubCacheKeyIfNeeded(const String& fromPath, const String& toPath) {
+  if (StringUtils::checkFileExtension(fromPath, ".epub")) {
+    BookCacheKeys::rename(fromPath.c_str(), toPath.c_str(), "/.crosspoint");
   }
 }
 
@@ -67,6 +72,14 @@ String normalizeWebPath(const String& inputPath) {
   return result;
 }
 
+// Downloads are read in chunks of 16 KB, a whole cluster on most FAT32 cards, so each read is one contiguous run of
+// sectors that SdFat transfers straight into the buffer instead of one sector at a time through its cache. The smaller
+// size is the fallback when the heap is fragmented.
+constexpr size_t DOWNLOAD_BUFFER_SIZE = 16 * 1024;
+constexpr size_t DOWNLOAD_BUFFER_MIN_SIZE = 4 * 1024;
+constexpr size_t SD_SECTOR_SIZE = 512;
+constexpr unsigned long DOWNLOAD_STALL_TIMEOUT_MS = 10000;
+
 bool isProtectedItemName(const String& name) {
   if (name.startsWith(".")) {
     return true;
@@ -78,15 +91,63 @@ bool isProtectedItemName(const String& name) {
   }
   return false;
 }
+
+// Where an upload of name into dir goes; empty if the name can't be used
+String uploadTargetPath(const String& dir, const String& name) {
+  if (name.isEmpty() || name.indexOf('/') >= 0 || isProtectedItemName(name)) {
+    return "";
+  }
+  String path = normalizeWebPath(dir);
+  if (!path.endsWith("/")) path += "/";
+  return path + name;
+}
+
+// The client's id for a resumable upload, which tells a retry of the same file from another file uploaded under the
+// same name. It is stored in the upload's manifest.
+bool isValidUploadId(const String& id) {
+  if (id.isEmpty() || id.length() > ResumableUpload::MAX_ID_LENGTH) {
+    return false;
+  }
+  for (size_t i = 0; i < id.length(); i++) {
+    const char c = id[i];
+    if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool parseUint32(const String& text, uint32_t& value, const int base = 10) {
+  if (text.isEmpty() || text.length() > 10) {
+    return false;
+  }
+  char* end = nullptr;
+  const unsigned long parsed = strtoul(text.c_str(), &end, base);
+  if (*end != '\0' || parsed > UINT32_MAX) {
+    return false;
+  }
+  value = static_cast<uint32_t>(parsed);
+  return true;
+}
+
+uint32_t readLe32(const uint8_t* bytes) {
+  return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 |
+         static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+}
 }  // namespace
 
 // File listing page template - now using generated headers:
 // - HomePageHtml (from html/HomePage.html)
 // - FilesPageHeaderHtml (from html/FilesPageHeader.html)
 // - FilesPageFooterHtml (from html/FilesPageFooter.html)
-CrossPointWebServer::CrossPointWebServer() {}
+CrossPointWebServer::CrossPointWebServer()
+    : serverTaskStopped(xSemaphoreCreateBinary()), statusMutex(xSemaphoreCreateMutex()) {}
 
-CrossPointWebServer::~CrossPointWebServer() { stop(); }
+CrossPointWebServer::~CrossPointWebServer() {
+  stop();
+  if (serverTaskStopped) vSemaphoreDelete(serverTaskStopped);
+  if (statusMutex) vSemaphoreDelete(statusMutex);
+}
 
 void CrossPointWebServer::begin() {
   if (running) {
@@ -132,31 +193,85 @@ void CrossPointWebServer::begin() {
   server->on("/", HTTP_GET, [this] { handleRoot(); });
   server->on("/files", HTTP_GET, [this] { handleFileList(); });
 
+  // Handlers that use the SD card first wait for the upload writer task to finish what is queued: the card is never
+  // used from two tasks at once. Only a WebSocket upload can be in progress while they run.
+  // Handlers that change the card also drop the cached directory listing.
   server->on("/api/status", HTTP_GET, [this] { handleStatus(); });
-  server->on("/api/files", HTTP_GET, [this] { handleFileListData(); });
-  server->on("/download", HTTP_GET, [this] { handleDownload(); });
+  server->on("/api/files", HTTP_GET, [this] {
+    uploadWriter.drain();
+    handleFileListData();
+  });
+  server->on("/download", HTTP_GET, [this] {
+    uploadWriter.drain();
+    handleDownload();
+  });
 
   // Upload endpoint with special handling for multipart form data
-  server->on("/upload", HTTP_POST, [this] { handleUploadPost(upload); }, [this] { handleUpload(upload); });
+  server->on(
+      "/upload", HTTP_POST,
+      [this] {
+        listingCache.invalidate();
+        handleUploadPost(upload);
+      },
+      [this] { handleUpload(upload); });
+
+  // Resumable uploads: where an interrupted upload continues, and one CRC-checked chunk per request
+  server->on("/api/upload/resume", HTTP_GET, [this] {
+    uploadWriter.drain();
+    handleUploadResumeOffset();
+  });
+  server->on(
+      "/upload/chunk", HTTP_POST,
+      [this] {
+        if (chunkUpload.done) listingCache.invalidate();
+        handleChunkUploadPost(chunkUpload);
+      },
+      [this] { handleChunkUpload(chunkUpload); });
 
   // Create folder endpoint
-  server->on("/mkdir", HTTP_POST, [this] { handleCreateFolder(); });
+  server->on("/mkdir", HTTP_POST, [this] {
+    uploadWriter.drain();
+    listingCache.invalidate();
+    handleCreateFolder();
+  });
 
   // Rename file endpoint
-  server->on("/rename", HTTP_POST, [this] { handleRename(); });
+  server->on("/rename", HTTP_POST, [this] {
+    uploadWriter.drain();
+    listingCache.invalidate();
+    fileEtags.treeChanged();
+    handleRename();
+  });
 
   // Move file endpoint
-  server->on("/move", HTTP_POST, [this] { handleMove(); });
+  server->on("/move", HTTP_POST, [this] {
+    uploadWriter.drain();
+    listingCache.invalidate();
+    fileEtags.treeChanged();
+    handleMove();
+  });
 
   // Delete file/folder endpoint
-  server->on("/delete", HTTP_POST, [this] { handleDelete(); });
+  server->on("/delete", HTTP_POST, [this] {
+    uploadWriter.drain();
+    listingCache.invalidate();
+    fileEtags.treeChanged();
+    handleDelete();
+  });
 
   // Settings endpoints
   server->on("/settings", HTTP_GET, [this] { handleSettingsPage(); });
   server->on("/api/settings", HTTP_GET, [this] { handleGetSettings(); });
-  server->on("/api/settings", HTTP_POST, [this] { handlePostSettings(); });
+  server->on("/api/settings", HTTP_POST, [this] {
+    uploadWriter.drain();
+    handlePostSettings();
+  });
 
   server->onNotFound([this] { handleNotFound(); });
+
+  // Request headers are dropped unless named here: ranges for downloads, ETags for downloads and pages
+  const char* requestHeaders[] = {"Range", "If-Range", "If-None-Match"};
+  server->collectHeaders(requestHeaders, sizeof(requestHeaders) / sizeof(requestHeaders[0]));
   LOG_DBG("WEB", "[MEM] Free heap after route setup: %d bytes", ESP.getFreeHeap());
 
   server->begin();
@@ -173,6 +288,11 @@ void CrossPointWebServer::begin() {
   LOG_DBG("WEB", "Discovery UDP %s on port %d", udpActive ? "enabled" : "failed", LOCAL_UDP_PORT);
 
   running = true;
+  if (!startServerTask()) {
+    LOG_ERR("WEB", "Failed to create web server task!");
+    stop();
+    return;
+  }
 
   LOG_DBG("WEB", "Web server started on port %d", port);
   // Show the correct IP based on network mode
@@ -184,20 +304,19 @@ void CrossPointWebServer::begin() {
 
 void CrossPointWebServer::stop() {
   if (!running || !server) {
-    LOG_DBG("WEB", "stop() called but already stopped (running=%d, server=%p)", running, server.get());
+    LOG_DBG("WEB", "stop() called but already stopped (running=%d, server=%p)", running.load(), server.get());
     return;
   }
 
-  LOG_DBG("WEB", "STOP INITIATED - setting running=false first");
-  running = false;  // Set this FIRST to prevent handleClient from using server
+  // The request being served completes first; after this nothing else touches the server
+  LOG_DBG("WEB", "STOP INITIATED - stopping server task");
+  stopServerTask();
+  running = false;
 
   LOG_DBG("WEB", "[MEM] Free heap before stop: %d bytes", ESP.getFreeHeap());
 
-  // Close any in-progress WebSocket upload
-  if (wsUploadInProgress && wsUploadFile) {
-    wsUploadFile.close();
-    wsUploadInProgress = false;
-  }
+  // Drop any in-progress WebSocket upload, keeping a resumable one for later
+  cancelWsUpload();
 
   // Stop WebSocket server
   if (wsServer) {
@@ -213,9 +332,6 @@ void CrossPointWebServer::stop() {
     udpActive = false;
   }
 
-  // Brief delay to allow any in-flight handleClient() calls to complete
-  delay(20);
-
   server->stop();
   LOG_DBG("WEB", "[MEM] Free heap after server->stop(): %d bytes", ESP.getFreeHeap());
 
@@ -223,6 +339,9 @@ void CrossPointWebServer::stop() {
   delay(10);
 
   server.reset();
+  free(downloadBuffer);
+  downloadBuffer = nullptr;
+  downloadBufferSize = 0;
   LOG_DBG("WEB", "Web server stopped and deleted");
   LOG_DBG("WEB", "[MEM] Free heap after delete server: %d bytes", ESP.getFreeHeap());
 
@@ -231,6 +350,75 @@ void CrossPointWebServer::stop() {
   LOG_DBG("WEB", "[MEM] Free heap final: %d bytes", ESP.getFreeHeap());
 }
 
+bool CrossPointWebServer::startServerTask() {
+  if (!serverTaskStopped || !statusMutex) {
+    return false;
+  }
+  stopRequested = false;
+  publishWsUploadStatus();
+  xTaskCreate(&serverTaskTrampoline, "WebServer",
+              8192,              // Stack size: the request handlers used to run on the loop task, which has as much
+              this,              // Parameters
+              1,                 // Priority: same as the main loop
+              &serverTaskHandle  // Task handle
+  );
+  return serverTaskHandle != nullptr;
+}
+
+void CrossPointWebServer::stopServerTask() {
+  if (!serverTaskHandle) {
+    return;
+  }
+  stopRequested = true;
+  // An HTTP upload in progress is finished first, which can take a while
+  while (xSemaphoreTake(serverTaskStopped, pdMS_TO_TICKS(100)) != pdTRUE) {
+    esp_task_wdt_reset();
+  }
+  serverTaskHandle = nullptr;
+}
+
+void CrossPointWebServer::serverTaskTrampoline(void* param) {
+  auto* self = static_cast<CrossPointWebServer*>(param);
+  self->serverTaskLoop();
+}
+
+void CrossPointWebServer::serverTaskLoop() {
+  // Request handlers reset the watchdog during long transfers, as they did on the loop task
+  esp_task_wdt_add(nullptr);
+  while (!stopRequested) {
+    // WebServer::handleClient() waits 1 ms when no client is connected, so an idle server doesn't spin
+    handleClient();
+    publishWsUploadStatus();
+    if ((server && server->client().connected()) || wsUploadInProgress || uploadWriter.isOpen() ||
+        resumableUpload.isActive()) {
+      lastBusyAt = millis();
+    } else if (millis() - lastBusyAt >= INGEST_IDLE_MS && BOOK_INGEST.hasWork(false)) {
+      // Uploaded books are prepared while no one is using the server: metadata, CSS and thumbnail. Laying out text
+      // needs the renderer, which the activity's render task may be using, so first sections wait for the main loop.
+      // A step takes up to a few seconds, longer than the watchdog allows.
+      esp_task_wdt_delete(nullptr);
+      BOOK_INGEST.step(nullptr);
+      esp_task_wdt_add(nullptr);
+    }
+    esp_task_wdt_reset();
+  }
+  esp_task_wdt_delete(nullptr);
+  xSemaphoreGive(serverTaskStopped);
+  vTaskDelete(nullptr);
+}
+
+// Epub caches are keyed by content (see BookCacheKeys). An uploaded file may have replaced different content at the
+// same path, so its key is recomputed on the next open; the old content's cache is left for the cache manager to trim.
+void CrossPointWebServer::onFileUploaded(const String& filePath) {
+  lastBusyAt = millis();
+  fileEtags.fileChanged(normalizeWebPath(filePath).c_str());
+  if (StringUtils::checkFileExtension(filePath, ".epub")) {
+    BookCacheKeys::forget(filePath.c_str(), "/.crosspoint");
+    LOG_DBG("WEB", "Forgot epub cache key for: %s", filePath.c_str());
+    BOOK_INGEST.enqueue(filePath.c_str());
+  }
+}
+
 void CrossPointWebServer::handleClient() {
   static unsigned long lastDebugPrint = 0;
 
@@ -281,19 +469,42 @@ void CrossPointWebServer::handleClient() {
   }
 }
 
+void CrossPointWebServer::publishWsUploadStatus() {
+  // Cheap checks first: this runs after every pass of the server task
+  if (publishedStatus.inProgress == wsUploadInProgress && publishedStatus.received == wsUploadReceived &&
+      publishedStatus.total == wsUploadSize && publishedStatus.lastCompleteAt == wsLastCompleteAt) {
+    return;
+  }
+  xSemaphoreTake(statusMutex, portMAX_DELAY);
+  publishedStatus.inProgress = wsUploadInProgress;
+  publishedStatus.received = wsUploadReceived;
+  publishedStatus.total = wsUploadSize;
+  publishedStatus.filename = wsUploadFileName.c_str();
+  publishedStatus.lastCompleteName = wsLastCompleteName.c_str();
+  publishedStatus.lastCompleteSize = wsLastCompleteSize;
+  publishedStatus.lastCompleteAt = wsLastCompleteAt;
+  xSemaphoreGive(statusMutex);
+}
+
 CrossPointWebServer::WsUploadStatus CrossPointWebServer::getWsUploadStatus() const {
-  WsUploadStatus status;
-  status.inProgress = wsUploadInProgress;
-  status.received = wsUploadReceived;
-  status.total = wsUploadSize;
-  status.filename = wsUploadFileName.c_str();
-  status.lastCompleteName = wsLastCompleteName.c_str();
-  status.lastCompleteSize = wsLastCompleteSize;
-  status.lastCompleteAt = wsLastCompleteAt;
+  if (!statusMutex) {
+    return {};
+  }
+  xSemaphoreTake(statusMutex, portMAX_DELAY);
+  WsUploadStatus status = publishedStatus;
+  xSemaphoreGive(statusMutex);
   return status;
 }
 
+// The pages are gzipped at build time and only change with the firmware, so a browser that has one gets a 304
 static void sendHtmlContent(WebServer* server, const char* data, size_t len) {
+  const String etag = "\"" CROSSPOINT_VERSION "-" + String(static_cast<unsigned long>(len), HEX) + "\"";
+  server->sendHeader("ETag", etag);
+  server->sendHeader("Cache-Control", "no-cache");
+  if (server->header("If-None-Match") == etag) {
+    server->send(304);
+    return;
+  }
   server->sendHeader("Content-Encoding", "gzip");
   server->send_P(200, "text/html", data, len);
 }
@@ -326,7 +537,7 @@ void CrossPointWebServer::handleStatus() const {
   server->send(200, "application/json", json);
 }
 
-void CrossPointWebServer::scanFiles(const char* path, const std::function<void(FileInfo)>& callback) const {
+void CrossPointWebServer::scanFiles(const char* path, const std::function<bool(const FileInfo&)>& callback) const {
   FsFile root = Storage.open(path);
   if (!root) {
     LOG_DBG("WEB", "Failed to open directory: %s", path);
@@ -373,7 +584,10 @@ void CrossPointWebServer::scanFiles(const char* path, const std::function<void(F
         info.isEpub = isEpubFile(info.name);
       }
 
-      callback(info);
+      if (!callback(info)) {
+        file.close();
+        break;
+      }
     }
 
     file.close();
@@ -394,7 +608,7 @@ void CrossPointWebServer::handleFileList() const {
   sendHtmlContent(server.get(), FilesPageHtml, sizeof(FilesPageHtml));
 }
 
-void CrossPointWebServer::handleFileListData() const {
+void CrossPointWebServer::handleFileListData() {
   // Get current path from query string (default to root)
   String currentPath = "/";
   if (server->hasArg("path")) {
@@ -409,6 +623,51 @@ void CrossPointWebServer::handleFileListData() const {
     }
   }
 
+  // Optional paging and sorting
+  uint32_t offset = 0;
+  uint32_t limit = UINT32_MAX;
+  if ((server->hasArg("offset") && !parseUint32(server->arg("offset"), offset)) ||
+      (server->hasArg("limit") && !parseUint32(server->arg("limit"), limit))) {
+    server->send(400, "text/plain", "Invalid offset or limit");
+    return;
+  }
+  using SortKey = DirectoryListingCache::SortKey;
+  const String sortArg = server->arg("sort");
+  SortKey sortKey = SortKey::None;
+  if (sortArg == "name") {
+    sortKey = SortKey::Name;
+  } else if (sortArg == "type") {
+    sortKey = SortKey::Type;
+  } else if (sortArg == "size") {
+    sortKey = SortKey::Size;
+  } else if (!sortArg.isEmpty()) {
+    server->send(400, "text/plain", "Invalid sort key");
+    return;
+  }
+
+  // Nothing but this server changes the card while it runs, so the listing version covers every directory
+  server->sendHeader("ETag", listingCache.getEtag());
+  server->sendHeader("Cache-Control", "no-cache");
+  if (server->header("If-None-Match") == listingCache.getEtag()) {
+    server->send(304);
+    return;
+  }
+
+  const std::string path = currentPath.c_str();
+  if (!listingCache.isCached(path) && !listingCache.isTooLarge(path)) {
+    listingCache.begin(path);
+    scanFiles(currentPath.c_str(), [this](const FileInfo& info) {
+      return listingCache.add(info.name.c_str(), info.size, info.isDirectory, info.isEpub);
+    });
+    listingCache.end();
+  }
+  const bool cached = listingCache.isCached(path);
+  if (cached) {
+    listingCache.sort(sortKey, server->arg("order") == "desc");
+    // The web UI reads this to show the folder's totals before the last page is in
+    server->sendHeader("X-Total-Count", String(listingCache.size()));
+  }
+
   server->setContentLength(CONTENT_LENGTH_UNKNOWN);
   server->send(200, "application/json", "");
   server->sendContent("[");
@@ -416,18 +675,18 @@ void CrossPointWebServer::handleFileListData() const {
   constexpr size_t outputSize = sizeof(output);
   bool seenFirst = false;
   JsonDocument doc;
-
-  scanFiles(currentPath.c_str(), [this, &output, &doc, seenFirst](const FileInfo& info) mutable {
+  const auto sendEntry = [this, &output, &doc, &seenFirst](const char* name, const size_t size, const bool isDirectory,
+                                                            const bool isEpub) {
     doc.clear();
-    doc["name"] = info.name;
-    doc["size"] = info.size;
-    doc["isDirectory"] = info.isDirectory;
-    doc["isEpub"] = info.isEpub;
+    doc["name"] = name;
+    doc["size"] = size;
+    doc["isDirectory"] = isDirectory;
+    doc["isEpub"] = isEpub;
 
     const size_t written = serializeJson(doc, output, outputSize);
     if (written >= outputSize) {
       // JSON output truncated; skip this entry to avoid sending malformed JSON
-      LOG_DBG("WEB", "Skipping file entry with oversized JSON for name: %s", info.name.c_str());
+      LOG_DBG("WEB", "Skipping file entry with oversized JSON for name: %s", name);
       return;
     }
 
@@ -437,14 +696,31 @@ void CrossPointWebServer::handleFileListData() const {
       seenFirst = true;
     }
     server->sendContent(output);
-  });
+  };
+
+  const uint32_t end = limit > UINT32_MAX - offset ? UINT32_MAX : offset + limit;
+  if (cached) {
+    for (size_t i = offset; i < listingCache.size() && i < end; i++) {
+      const DirectoryListingCache::Entry& entry = listingCache.at(i);
+      sendEntry(listingCache.getName(entry), entry.size, entry.isDirectory, entry.isEpub);
+    }
+  } else {
+    // Too large to keep: straight from the card, in card order
+    uint32_t index = 0;
+    scanFiles(currentPath.c_str(), [&](const FileInfo& info) {
+      if (index >= offset) {
+        sendEntry(info.name.c_str(), info.size, info.isDirectory, info.isEpub);
+      }
+      return ++index < end;
+    });
+  }
   server->sendContent("]");
   // End of streamed response, empty chunk to signal client
   server->sendContent("");
-  LOG_DBG("WEB", "Served file listing page for path: %s", currentPath.c_str());
+  LOG_DBG("WEB", "Served file listing page for path: %s (%s)", currentPath.c_str(), cached ? "cached" : "from card");
 }
 
-void CrossPointWebServer::handleDownload() const {
+void CrossPointWebServer::handleDownload() {
   if (!server->hasArg("path")) {
     server->send(400, "text/plain", "Missing path");
     return;
@@ -498,40 +774,109 @@ void CrossPointWebServer::handleDownload() const {
     filename = nameBuf;
   }
 
-  server->setContentLength(file.size());
+  const size_t size = file.size();
+  const String etag = fileEtags.etagFor(normalizeWebPath(itemPath).c_str(), size).c_str();
+  server->sendHeader("Accept-Ranges", "bytes");
+  server->sendHeader("ETag", etag);
+  // Cached copies are revalidated every time: a file can be replaced under the same path
+  server->sendHeader("Cache-Control", "no-cache");
+
+  if (server->hasHeader("If-None-Match")) {
+    const String ifNoneMatch = server->header("If-None-Match");
+    if (ifNoneMatch == "*" || ifNoneMatch.indexOf(etag) >= 0) {
+      file.close();
+      server->send(304);
+      return;
+    }
+  }
+
+  // A resumed download only gets the rest if the file is still the one it started on (If-Range)
+  size_t first = 0;
+  size_t last = 0;
+  HttpRange::Result range = HttpRange::Result::Whole;
+  if (server->hasHeader("Range") && (!server->hasHeader("If-Range") || server->header("If-Range") == etag)) {
+    range = HttpRange::parse(server->header("Range").c_str(), size, first, last);
+  }
+  if (range == HttpRange::Result::Unsatisfiable) {
+    file.close();
+    server->sendHeader("Content-Range", "bytes */" + String(size));
+    server->send(416, "text/plain", "Range not satisfiable");
+    return;
+  }
+  if (range == HttpRange::Result::Whole) {
+    first = 0;
+  }
+  const size_t length = range == HttpRange::Result::Partial ? last - first + 1 : size;
+
+  server->setContentLength(length);
   server->sendHeader("Content-Disposition", "attachment; filename=\"" + filename + "\"");
-  server->send(200, contentType.c_str(), "");
+  if (range == HttpRange::Result::Partial) {
+    server->sendHeader("Content-Range", "bytes " + String(first) + "-" + String(last) + "/" + String(size));
+  }
+  server->send(range == HttpRange::Result::Partial ? 206 : 200, contentType.c_str(), "");
 
-  WiFiClient client = server->client();
-  client.write(file);
+  const unsigned long start = millis();
+  const bool complete = sendFileData(file, first, length);
   file.close();
+  const unsigned long elapsed = millis() - start;
+  LOG_DBG("WEB", "[DOWNLOAD] %s %s: %u of %u bytes from %u in %lu ms (%.1f KB/s)", itemPath.c_str(),
+          complete ? "sent" : "cut short", length, size, first, elapsed,
+          elapsed > 0 ? (length / 1024.0) / (elapsed / 1000.0) : 0.0);
 }
 
-// Diagnostic counters for upload performance analysis
-static unsigned long uploadStartTime = 0;
-static unsigned long totalWriteTime = 0;
-static size_t writeCount = 0;
-
-static bool flushUploadBuffer(CrossPointWebServer::UploadState& state) {
-  if (state.bufferPos > 0 && state.file) {
-    esp_task_wdt_reset();  // Reset watchdog before potentially slow SD write
-    const unsigned long writeStart = millis();
-    const size_t written = state.file.write(state.buffer.data(), state.bufferPos);
-    totalWriteTime += millis() - writeStart;
-    writeCount++;
-    esp_task_wdt_reset();  // Reset watchdog after SD write
-
-    if (written != state.bufferPos) {
-      LOG_DBG("WEB", "[UPLOAD] Buffer flush failed: expected %d, wrote %d", state.bufferPos, written);
-      state.bufferPos = 0;
+bool CrossPointWebServer::sendFileData(FsFile& file, size_t offset, size_t length) {
+  if (!downloadBuffer) {
+    for (size_t bufferSize = DOWNLOAD_BUFFER_SIZE; !downloadBuffer && bufferSize >= DOWNLOAD_BUFFER_MIN_SIZE;
+         bufferSize /= 2) {
+      downloadBuffer = static_cast<uint8_t*>(malloc(bufferSize));
+      downloadBufferSize = downloadBuffer ? bufferSize : 0;
+    }
+    if (!downloadBuffer) {
+      LOG_ERR("WEB", "[DOWNLOAD] No memory for a read buffer");
+      return false;
+    }
+  }
+  if (!file.seek(offset)) {
+    LOG_ERR("WEB", "[DOWNLOAD] Seek to %u failed", offset);
+    return false;
+  }
+
+  WiFiClient client = server->client();
+  unsigned long lastSent = millis();
+  while (length > 0) {
+    esp_task_wdt_reset();
+    // A range starting mid-sector: the first read ends on a sector boundary, so the following ones are aligned
+    const size_t toRead = std::min(length, downloadBufferSize - offset % SD_SECTOR_SIZE);
+    const int bytesRead = file.read(downloadBuffer, toRead);
+    if (bytesRead <= 0) {
+      LOG_ERR("WEB", "[DOWNLOAD] Read failed at %u", offset);
       return false;
     }
-    state.bufferPos = 0;
+    size_t sent = 0;
+    while (sent < static_cast<size_t>(bytesRead)) {
+      const size_t written = client.write(downloadBuffer + sent, bytesRead - sent);
+      if (written > 0) {
+        sent += written;
+        lastSent = millis();
+        continue;
+      }
+      // Send buffer full: wait for the client to acknowledge, unless it is gone
+      if (!client.connected() || millis() - lastSent > DOWNLOAD_STALL_TIMEOUT_MS) {
+        return false;
+      }
+      esp_task_wdt_reset();
+      delay(1);
+    }
+    offset += bytesRead;
+    length -= bytesRead;
   }
   return true;
 }
 
-void CrossPointWebServer::handleUpload(UploadState& state) const {
+// Diagnostic counter for upload performance analysis
+static unsigned long uploadStartTime = 0;
+
+void CrossPointWebServer::handleUpload(UploadState& state) {
   static size_t lastLoggedSize = 0;
 
   // Reset watchdog at start of every upload callback - HTTP parsing can be slow
@@ -555,9 +900,6 @@ void CrossPointWebServer::handleUpload(UploadState& state) const {
     state.error = "";
     uploadStartTime = millis();
     lastLoggedSize = 0;
-    state.bufferPos = 0;
-    totalWriteTime = 0;
-    writeCount = 0;
 
     // Get upload path from query parameter (defaults to root if not specified)
     // Note: We use query parameter instead of form data because multipart form
@@ -579,53 +921,32 @@ void CrossPointWebServer::handleUpload(UploadState& state) const {
     LOG_DBG("WEB", "[UPLOAD] START: %s to path: %s", state.fileName.c_str(), state.path.c_str());
     LOG_DBG("WEB", "[UPLOAD] Free heap: %d bytes", ESP.getFreeHeap());
 
+    if (uploadWriter.isOpen()) {
+      state.error = "Another upload is in progress";
+      LOG_DBG("WEB", "[UPLOAD] Rejected, %s is still being uploaded", uploadWriter.getPath().c_str());
+      return;
+    }
+
     // Create file path
     String filePath = state.path;
     if (!filePath.endsWith("/")) filePath += "/";
     filePath += state.fileName;
 
-    // Check if file already exists - SD operations can be slow
-    esp_task_wdt_reset();
-    if (Storage.exists(filePath.c_str())) {
-      LOG_DBG("WEB", "[UPLOAD] Overwriting existing file: %s", filePath.c_str());
-      esp_task_wdt_reset();
-      Storage.remove(filePath.c_str());
-    }
-
-    // Open file for writing - this can be slow due to FAT cluster allocation
-    esp_task_wdt_reset();
-    if (!Storage.openFileForWrite("WEB", filePath, state.file)) {
+    fileEtags.fileChanged(normalizeWebPath(filePath).c_str());
+    if (!uploadWriter.open(filePath.c_str())) {
       state.error = "Failed to create file on SD card";
       LOG_DBG("WEB", "[UPLOAD] FAILED to create file: %s", filePath.c_str());
       return;
     }
-    esp_task_wdt_reset();
 
     LOG_DBG("WEB", "[UPLOAD] File created successfully: %s", filePath.c_str());
   } else if (upload.status == UPLOAD_FILE_WRITE) {
-    if (state.file && state.error.isEmpty()) {
-      // Buffer incoming data and flush when buffer is full
-      // This reduces SD card write operations and improves throughput
-      const uint8_t* data = upload.buf;
-      size_t remaining = upload.currentSize;
-
-      while (remaining > 0) {
-        const size_t space = UploadState::UPLOAD_BUFFER_SIZE - state.bufferPos;
-        const size_t toCopy = (remaining < space) ? remaining : space;
-
-        memcpy(state.buffer.data() + state.bufferPos, data, toCopy);
-        state.bufferPos += toCopy;
-        data += toCopy;
-        remaining -= toCopy;
-
-        // Flush buffer when full
-        if (state.bufferPos >= UploadState::UPLOAD_BUFFER_SIZE) {
-          if (!flushUploadBuffer(state)) {
-            state.error = "Failed to write to SD card - disk may be full";
-            state.file.close();
-            return;
-          }
-        }
+    if (uploadWriter.isOpen() && state.error.isEmpty()) {
+      // Copied into the writer's buffers; the SD writes happen on its task while the next data arrives
+      if (!uploadWriter.write(upload.buf, upload.currentSize)) {
+        state.error = "Failed to write to SD card - disk may be full";
+        uploadWriter.abort();
+        return;
       }
 
       state.size += upload.currentSize;
@@ -634,45 +955,38 @@ void CrossPointWebServer::handleUpload(UploadState& state) const {
       if (state.size - lastLoggedSize >= 102400) {
         const unsigned long elapsed = millis() - uploadStartTime;
         const float kbps = (elapsed > 0) ? (state.size / 1024.0) / (elapsed / 1000.0) : 0;
-        LOG_DBG("WEB", "[UPLOAD] %d bytes (%.1f KB), %.1f KB/s, %d writes", state.size, state.size / 1024.0, kbps,
-                writeCount);
+        LOG_DBG("WEB", "[UPLOAD] %d bytes (%.1f KB), %.1f KB/s, %lu ms waiting for the card", state.size,
+                state.size / 1024.0, kbps, uploadWriter.getStats().stallMs);
         lastLoggedSize = state.size;
       }
     }
   } else if (upload.status == UPLOAD_FILE_END) {
-    if (state.file) {
-      // Flush any remaining buffered data
-      if (!flushUploadBuffer(state)) {
+    if (uploadWriter.isOpen() && state.error.isEmpty()) {
+      // Write what is still buffered and wait for the card
+      if (!uploadWriter.close()) {
         state.error = "Failed to write final data to SD card";
-      }
-      state.file.close();
-
-      if (state.error.isEmpty()) {
+      } else {
         state.success = true;
+        const UploadWriter::Stats& stats = uploadWriter.getStats();
         const unsigned long elapsed = millis() - uploadStartTime;
         const float avgKbps = (elapsed > 0) ? (state.size / 1024.0) / (elapsed / 1000.0) : 0;
-        const float writePercent = (elapsed > 0) ? (totalWriteTime * 100.0 / elapsed) : 0;
+        const float writePercent = (elapsed > 0) ? (stats.writeMs * 100.0 / elapsed) : 0;
         LOG_DBG("WEB", "[UPLOAD] Complete: %s (%d bytes in %lu ms, avg %.1f KB/s)", state.fileName.c_str(), state.size,
                 elapsed, avgKbps);
-        LOG_DBG("WEB", "[UPLOAD] Diagnostics: %d writes, total write time: %lu ms (%.1f%%)", writeCount, totalWriteTime,
-                writePercent);
+        LOG_DBG("WEB", "[UPLOAD] Diagnostics: %d writes, total write time: %lu ms (%.1f%%), stalled %lu ms",
+                stats.writes, stats.writeMs, writePercent, stats.stallMs);
 
-        // Clear epub cache to prevent stale metadata issues when overwriting files
+        // Overwritten files must not keep the previous content's cache key
         String filePath = state.path;
         if (!filePath.endsWith("/")) filePath += "/";
         filePath += state.fileName;
-        clearEpubCacheIfNeeded(filePath);
+        onFileUploaded(filePath);
       }
     }
   } else if (upload.status == UPLOAD_FILE_ABORTED) {
-    state.bufferPos = 0;  // Discard buffered data
-    if (state.file) {
-      state.file.close();
-      // Try to delete the incomplete file
-      String filePath = state.path;
-      if (!filePath.endsWith("/")) filePath += "/";
-      filePath += state.fileName;
-      Storage.remove(filePath.c_str());
+    if (uploadWriter.isOpen() && state.error.isEmpty()) {
+      // Discard buffered data and delete the incomplete file
+      uploadWriter.abort();
     }
     state.error = "Upload aborted";
     LOG_DBG("WEB", "Upload aborted");
@@ -688,6 +1002,121 @@ void CrossPointWebServer::handleUploadPost(UploadState& state) const {
   }
 }
 
+void CrossPointWebServer::handleUploadResumeOffset() {
+  const String targetPath = uploadTargetPath(server->arg("path"), server->arg("name"));
+  const String id = server->arg("id");
+  uint32_t size = 0;
+  if (targetPath.isEmpty() || !isValidUploadId(id) || !parseUint32(server->arg("size"), size)) {
+    server->send(400, "text/plain", "Invalid upload");
+    return;
+  }
+
+  JsonDocument doc;
+  doc["offset"] = ResumableUpload::resumeOffset(targetPath.c_str(), id.c_str(), size);
+  String json;
+  serializeJson(doc, json);
+  server->send(200, "application/json", json);
+}
+
+// Resumable upload of one chunk: POST /upload/chunk?path=&name=&size=&id=&offset=&crc= with the chunk as the file
+// part of a multipart body. The chunk must start where the upload stands; crc is the hex CRC-32 of its data.
+void CrossPointWebServer::handleChunkUpload(ChunkUploadState& state) {
+  esp_task_wdt_reset();
+  if (!running || !server) {
+    return;
+  }
+
+  const HTTPUpload& upload = server->upload();
+
+  if (upload.status == UPLOAD_FILE_START) {
+    state = ChunkUploadState();
+    const String targetPath = uploadTargetPath(server->arg("path"), server->arg("name"));
+    const String id = server->arg("id");
+    uint32_t size = 0;
+    uint32_t offset = 0;
+    uint32_t crc = 0;
+    if (targetPath.isEmpty() || !isValidUploadId(id) || !parseUint32(server->arg("size"), size) ||
+        !parseUint32(server->arg("offset"), offset) || !parseUint32(server->arg("crc"), crc, 16)) {
+      state.error = "Invalid chunk upload";
+      return;
+    }
+    if (uploadWriter.isOpen()) {
+      state.error = "Another upload is in progress";
+      return;
+    }
+    if (!resumableUpload.begin(targetPath.c_str(), id.c_str(), size)) {
+      state.error = "Failed to create file on SD card";
+      return;
+    }
+    if (resumableUpload.isComplete()) {
+      // Everything arrived before, only moving it into place failed
+      state.offset = size;
+      state.done = resumableUpload.finish();
+      if (state.done) {
+        onFileUploaded(targetPath);
+      } else {
+        state.error = "Failed to move the upload into place";
+      }
+      return;
+    }
+    if (!resumableUpload.beginChunk(offset)) {
+      // Not where the upload stands: the client continues from the offset in the reply
+      LOG_DBG("WEB", "[CHUNK] %s: chunk at %u, expected %u", targetPath.c_str(), offset,
+              resumableUpload.getReceived());
+      state.offset = resumableUpload.getReceived();
+      resumableUpload.suspend();
+    }
+  } else if (upload.status == UPLOAD_FILE_WRITE) {
+    if (resumableUpload.isActive() && state.error.isEmpty() &&
+        !resumableUpload.appendChunk(upload.buf, upload.currentSize)) {
+      state.result = ResumableUpload::ChunkResult::Failed;
+      state.error = "Failed to write to SD card - disk may be full";
+      resumableUpload.suspend();
+    }
+  } else if (upload.status == UPLOAD_FILE_END) {
+    if (!resumableUpload.isActive() || !state.error.isEmpty()) {
+      return;
+    }
+    uint32_t crc = 0;
+    parseUint32(server->arg("crc"), crc, 16);
+    state.result = resumableUpload.endChunk(crc);
+    state.offset = resumableUpload.getReceived();
+    if (state.result == ResumableUpload::ChunkResult::Failed) {
+      state.error = "Failed to write to SD card - disk may be full";
+    } else if (resumableUpload.isComplete()) {
+      const String targetPath = resumableUpload.getTargetPath().c_str();
+      state.done = resumableUpload.finish();
+      if (state.done) {
+        LOG_DBG("WEB", "[CHUNK] Upload complete: %s", targetPath.c_str());
+        onFileUploaded(targetPath);
+      } else {
+        state.error = "Failed to move the upload into place";
+      }
+    }
+    // Record what is in so far; the next chunk is a new request
+    resumableUpload.suspend();
+  } else if (upload.status == UPLOAD_FILE_ABORTED) {
+    if (resumableUpload.isActive() && state.error.isEmpty()) {
+      resumableUpload.suspend();
+    }
+    state.error = "Upload aborted";
+  }
+}
+
+void CrossPointWebServer::handleChunkUploadPost(const ChunkUploadState& state) const {
+  if (!state.error.isEmpty()) {
+    server->send(400, "text/plain", state.error);
+    return;
+  }
+  JsonDocument doc;
+  doc["offset"] = state.offset;
+  doc["done"] = state.done;
+  String json;
+  serializeJson(doc, json);
+  // 409: the chunk wasn't at the upload's offset or failed its CRC check; send again from "offset"
+  server->send(state.result == ResumableUpload::ChunkResult::Rejected ? 409 : 200, "application/json", json);
+}
+
 void CrossPointWebServer::handleCreateFolder() const {
   // Get folder name from form data
   if (!server->hasArg("name")) {
@@ -807,11 +1236,11 @@ void CrossPointWebServer::handleRename() const {
     return;
   }
 
-  clearEpubCacheIfNeeded(itemPath);
   const bool success = file.rename(newPath.c_str());
   file.close();
 
   if (success) {
+    moveEpubCacheKeyIfNeeded(itemPath, newPath);
     LOG_DBG("WEB", "Renamed file: %s -> %s", itemPath.c_str(), newPath.c_str());
     server->send(200, "text/plain", "Renamed successfully");
   } else {
@@ -900,11 +1329,11 @@ void CrossPointWebServer::handleMove() const {
     return;
   }
 
-  clearEpubCacheIfNeeded(itemPath);
   const bool success = file.rename(newPath.c_str());
   file.close();
 
   if (success) {
+    moveEpubCacheKeyIfNeeded(itemPath, newPath);
     LOG_DBG("WEB", "Moved file: %s -> %s", itemPath.c_str(), newPath.c_str());
     server->send(200, "text/plain", "Moved successfully");
   } else {
@@ -1164,30 +1593,81 @@ void CrossPointWebServer::wsEventCallback(uint8_t num, WStype_t type, uint8_t* p
   }
 }
 
+void CrossPointWebServer::cancelWsUpload() {
+  if (!wsUploadInProgress) {
+    return;
+  }
+  if (wsUploadResumable) {
+    resumableUpload.suspend();
+  } else {
+    // Deletes the incomplete file
+    uploadWriter.abort();
+    listingCache.invalidate();
+  }
+  wsUploadInProgress = false;
+  wsUploadResumable = false;
+}
+
+void CrossPointWebServer::completeWsUpload(const uint8_t num) {
+  const bool resumable = wsUploadResumable;
+  wsUploadInProgress = false;
+  wsUploadResumable = false;
+  wsLastProgressSent = 0;
+  listingCache.invalidate();
+  if (!(resumable ? resumableUpload.finish() : uploadWriter.close())) {
+    wsServer->sendTXT(num, "ERROR:Write failed - disk full?");
+    return;
+  }
+
+  wsLastCompleteName = wsUploadFileName;
+  wsLastCompleteSize = wsUploadSize;
+  wsLastCompleteAt = millis();
+
+  unsigned long elapsed = millis() - wsUploadStartTime;
+  float kbps = (elapsed > 0) ? (wsUploadSize / 1024.0) / (elapsed / 1000.0) : 0;
+
+  LOG_DBG("WS", "Upload complete: %s (%d bytes in %lu ms, %.1f KB/s, %lu ms waiting for the card)",
+          wsUploadFileName.c_str(), wsUploadSize, elapsed, kbps, uploadWriter.getStats().stallMs);
+
+  // Overwritten files must not keep the previous content's cache key
+  String filePath = wsUploadPath;
+  if (!filePath.endsWith("/")) filePath += "/";
+  filePath += wsUploadFileName;
+  onFileUploaded(filePath);
+
+  wsServer->sendTXT(num, "DONE");
+}
+
 // WebSocket event handler for fast binary uploads
 // Protocol:
 //   1. Client sends TEXT message: "START:<filename>:<size>:<path>"
 //   2. Client sends BINARY messages with file data chunks
 //   3. Server sends TEXT "PROGRESS:<received>:<total>" after each chunk
 //   4. Server sends TEXT "DONE" or "ERROR:<message>" when complete
+// Resumable variant (see ResumableUpload):
+//   1. Client sends TEXT "RESUME:<filename>:<size>:<id>:<path>", id naming the file's content
+//   2. Server sends TEXT "OFFSET:<received>": the client sends the file from there
+//   3. Each BINARY message is a uint32 offset, the uint32 CRC-32 of the data (little-endian) and the data
+//   4. Server sends TEXT "RESEND:<offset>" for a frame at the wrong offset or with a bad CRC, and ignores the frames
+//      after it until the one at that offset arrives. PROGRESS, DONE and ERROR are as above.
+//   A dropped connection keeps what was received; RESUME with the same id continues it.
 void CrossPointWebServer::onWebSocketEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length) {
   switch (type) {
     case WStype_DISCONNECTED:
       LOG_DBG("WS", "Client %u disconnected", num);
-      // Clean up any in-progress upload
-      if (wsUploadInProgress && wsUploadFile) {
-        wsUploadFile.close();
-        // Delete incomplete file
-        String filePath = wsUploadPath;
-        if (!filePath.endsWith("/")) filePath += "/";
-        filePath += wsUploadFileName;
-        Storage.remove(filePath.c_str());
-        LOG_DBG("WS", "Deleted incomplete upload: %s", filePath.c_str());
+      // Clean up the client's in-progress upload, deleting the incomplete file unless it is resumable
+      if (num == wsUploadClient) {
+        cancelWsUpload();
       }
-      wsUploadInProgress = false;
       break;
 
     case WStype_CONNECTED: {
+      // Uploads go one at a time; each extra socket only costs heap
+      if (wsServer->connectedClients() > MAX_WS_CLIENTS) {
+        LOG_DBG("WS", "Client %u refused, %u already connected", num, MAX_WS_CLIENTS);
+        wsServer->disconnect(num);
+        break;
+      }
       LOG_DBG("WS", "Client %u connected", num);
       break;
     }
@@ -1203,101 +1683,151 @@ void CrossPointWebServer::onWebSocketEvent(uint8_t num, WStype_t type, uint8_t*
         int secondColon = msg.indexOf(':', firstColon + 1);
 
         if (firstColon > 0 && secondColon > 0) {
-          wsUploadFileName = msg.substring(6, firstColon);
-          wsUploadSize = msg.substring(firstColon + 1, secondColon).toInt();
-          wsUploadPath = msg.substring(secondColon + 1);
-          wsUploadReceived = 0;
-          wsUploadStartTime = millis();
+          const String fileName = msg.substring(6, firstColon);
+          const int size = msg.substring(firstColon + 1, secondColon).toInt();
+          String path = msg.substring(secondColon + 1);
 
           // Ensure path is valid
-          if (!wsUploadPath.startsWith("/")) wsUploadPath = "/" + wsUploadPath;
-          if (wsUploadPath.length() > 1 && wsUploadPath.endsWith("/")) {
-            wsUploadPath = wsUploadPath.substring(0, wsUploadPath.length() - 1);
+          if (!path.startsWith("/")) path = "/" + path;
+          if (path.length() > 1 && path.endsWith("/")) {
+            path = path.substring(0, path.length() - 1);
           }
 
           // Build file path
-          String filePath = wsUploadPath;
+          String filePath = path;
           if (!filePath.endsWith("/")) filePath += "/";
-          filePath += wsUploadFileName;
+          filePath += fileName;
 
-          LOG_DBG("WS", "Starting upload: %s (%d bytes) to %s", wsUploadFileName.c_str(), wsUploadSize,
-                  filePath.c_str());
+          LOG_DBG("WS", "Starting upload: %s (%d bytes) to %s", fileName.c_str(), size, filePath.c_str());
 
-          // Check if file exists and remove it
-          esp_task_wdt_reset();
-          if (Storage.exists(filePath.c_str())) {
-            Storage.remove(filePath.c_str());
+          // A new START on the same connection replaces the upload that was cut short; another client's is left alone
+          if (num == wsUploadClient) {
+            cancelWsUpload();
+          }
+          if (wsUploadInProgress || uploadWriter.isOpen()) {
+            wsServer->sendTXT(num, "ERROR:Another upload is in progress");
+            return;
           }
 
-          // Open file for writing
-          esp_task_wdt_reset();
-          if (!Storage.openFileForWrite("WS", filePath, wsUploadFile)) {
+          // Replaces any existing file
+          fileEtags.fileChanged(normalizeWebPath(filePath).c_str());
+          if (!uploadWriter.open(filePath.c_str())) {
             wsServer->sendTXT(num, "ERROR:Failed to create file");
-            wsUploadInProgress = false;
             return;
           }
-          esp_task_wdt_reset();
 
+          wsUploadFileName = fileName;
+          wsUploadSize = size;
+          wsUploadPath = path;
+          wsUploadReceived = 0;
+          wsUploadStartTime = millis();
           wsUploadInProgress = true;
+          wsUploadClient = num;
+          wsLastProgressSent = 0;
           wsServer->sendTXT(num, "READY");
         } else {
           wsServer->sendTXT(num, "ERROR:Invalid START format");
         }
+      } else if (msg.startsWith("RESUME:")) {
+        // Parse: RESUME:<filename>:<size>:<id>:<path> (FAT names can't contain ':')
+        const int firstColon = msg.indexOf(':', 7);
+        const int secondColon = firstColon > 0 ? msg.indexOf(':', firstColon + 1) : -1;
+        const int thirdColon = secondColon > 0 ? msg.indexOf(':', secondColon + 1) : -1;
+        uint32_t size = 0;
+        const String id = thirdColon > 0 ? msg.substring(secondColon + 1, thirdColon) : String();
+        const String fileName = firstColon > 0 ? msg.substring(7, firstColon) : String();
+        const String path = thirdColon > 0 ? normalizeWebPath(msg.substring(thirdColon + 1)) : String();
+        const String targetPath = uploadTargetPath(path, fileName);
+        if (thirdColon < 0 || !parseUint32(msg.substring(firstColon + 1, secondColon), size) ||
+            !isValidUploadId(id) || targetPath.isEmpty()) {
+          wsServer->sendTXT(num, "ERROR:Invalid RESUME format");
+          break;
+        }
+
+        if (num == wsUploadClient) {
+          cancelWsUpload();
+        }
+        if (wsUploadInProgress || uploadWriter.isOpen()) {
+          wsServer->sendTXT(num, "ERROR:Another upload is in progress");
+          break;
+        }
+        if (!resumableUpload.begin(targetPath.c_str(), id.c_str(), size)) {
+          wsServer->sendTXT(num, "ERROR:Failed to create file");
+          break;
+        }
+
+        wsUploadFileName = fileName;
+        wsUploadPath = path;
+        wsUploadSize = size;
+        wsUploadReceived = resumableUpload.getReceived();
+        wsUploadStartTime = millis();
+        wsUploadInProgress = true;
+        wsUploadClient = num;
+        wsUploadResumable = true;
+        wsResendRequested = false;
+        wsLastProgressSent = wsUploadReceived;
+        LOG_DBG("WS", "Resumable upload: %s (%d bytes) from %d", targetPath.c_str(), wsUploadSize, wsUploadReceived);
+        wsServer->sendTXT(num, "OFFSET:" + String(wsUploadReceived));
+        if (resumableUpload.isComplete()) {
+          // Everything arrived before, only moving it into place failed
+          completeWsUpload(num);
+        }
       }
       break;
     }
 
     case WStype_BIN: {
-      if (!wsUploadInProgress || !wsUploadFile) {
+      if (!wsUploadInProgress || num != wsUploadClient || !uploadWriter.isOpen()) {
         wsServer->sendTXT(num, "ERROR:No upload in progress");
         return;
       }
 
-      // Write binary data directly to file
-      esp_task_wdt_reset();
-      size_t written = wsUploadFile.write(payload, length);
-      esp_task_wdt_reset();
-
-      if (written != length) {
-        wsUploadFile.close();
-        wsUploadInProgress = false;
-        wsServer->sendTXT(num, "ERROR:Write failed - disk full?");
-        return;
+      if (wsUploadResumable) {
+        constexpr size_t FRAME_HEADER_SIZE = 2 * sizeof(uint32_t);
+        const uint32_t offset = length >= FRAME_HEADER_SIZE ? readLe32(payload) : UINT32_MAX;
+        const ResumableUpload::ChunkResult result =
+            length >= FRAME_HEADER_SIZE
+                ? resumableUpload.addChunk(offset, payload + FRAME_HEADER_SIZE, length - FRAME_HEADER_SIZE,
+                                           readLe32(payload + sizeof(uint32_t)))
+                : ResumableUpload::ChunkResult::Rejected;
+        if (result == ResumableUpload::ChunkResult::Failed) {
+          cancelWsUpload();
+          wsServer->sendTXT(num, "ERROR:Write failed - disk full?");
+          return;
+        }
+        if (result == ResumableUpload::ChunkResult::Rejected) {
+          // Asked for once; the frames already on the way after the bad one are dropped. A bad re-sent frame is
+          // asked for again.
+          if (!wsResendRequested || offset == resumableUpload.getReceived()) {
+            wsResendRequested = true;
+            wsServer->sendTXT(num, "RESEND:" + String(resumableUpload.getReceived()));
+          }
+          return;
+        }
+        wsResendRequested = false;
+        wsUploadReceived = resumableUpload.getReceived();
+      } else {
+        // Queued for the writer task, which writes to the card while the next frames arrive
+        if (!uploadWriter.write(payload, length)) {
+          uploadWriter.abort();
+          listingCache.invalidate();
+          wsUploadInProgress = false;
+          wsServer->sendTXT(num, "ERROR:Write failed - disk full?");
+          return;
+        }
+        wsUploadReceived += length;
       }
 
-      wsUploadReceived += written;
-
       // Send progress update (every 64KB or at end)
-      static size_t lastProgressSent = 0;
-      if (wsUploadReceived - lastProgressSent >= 65536 || wsUploadReceived >= wsUploadSize) {
+      if (wsUploadReceived - wsLastProgressSent >= 65536 || wsUploadReceived >= wsUploadSize) {
         String progress = "PROGRESS:" + String(wsUploadReceived) + ":" + String(wsUploadSize);
         wsServer->sendTXT(num, progress);
-        lastProgressSent = wsUploadReceived;
+        wsLastProgressSent = wsUploadReceived;
       }
 
       // Check if upload complete
       if (wsUploadReceived >= wsUploadSize) {
-        wsUploadFile.close();
-        wsUploadInProgress = false;
-
-        wsLastCompleteName = wsUploadFileName;
-        wsLastCompleteSize = wsUploadSize;
-        wsLastCompleteAt = millis();
-
-        unsigned long elapsed = millis() - wsUploadStartTime;
-        float kbps = (elapsed > 0) ? (wsUploadSize / 1024.0) / (elapsed / 1000.0) : 0;
-
-        LOG_DBG("WS", "Upload complete: %s (%d bytes in %lu ms, %.1f KB/s)", wsUploadFileName.c_str(), wsUploadSize,
-                elapsed, kbps);
-
-        // Clear epub cache to prevent stale metadata issues when overwriting files
-        String filePath = wsUploadPath;
-        if (!filePath.endsWith("/")) filePath += "/";
-        filePath += wsUploadFileName;
-        clearEpubCacheIfNeeded(filePath);
-
-        wsServer->sendTXT(num, "DONE");
-        lastProgressSent = 0;
+        completeWsUpload(num);
       }
       break;
     }
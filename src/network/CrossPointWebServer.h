@@ -4,11 +4,20 @@
 #include <WebServer.h>
 #include <WebSocketsServer.h>
 #include <WiFiUdp.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "DirectoryListingCache.h"
+#include "FileEtags.h"
+#include "ResumableUpload.h"
+#include "UploadWriter.h"
+
 // Structure to hold file information
 struct FileInfo {
   String name;
@@ -17,6 +26,11 @@ struct FileInfo {
   bool isDirectory;
 };
 
+/*
+HTTP, WebSocket and discovery server for file transfer. Requests are served by a task of its own, so they don't share
+the main loop with input handling and rendering: the owning activity only starts and stops the server and polls
+getWsUploadStatus(). Everything else in the class runs on the server task.
+*/
 class CrossPointWebServer {
  public:
   struct WsUploadStatus {
@@ -31,38 +45,26 @@ class CrossPointWebServer {
 
   // Used by POST upload handler
   struct UploadState {
-    FsFile file;
     String fileName;
     String path = "/";
     size_t size = 0;
     bool success = false;
     String error = "";
-
-    // Upload write buffer - batches small writes into larger SD card operations
-    // 4KB is a good balance: large enough to reduce syscall overhead, small enough
-    // to keep individual write times short and avoid watchdog issues
-    static constexpr size_t UPLOAD_BUFFER_SIZE = 4096;  // 4KB buffer
-    std::vector<uint8_t> buffer;
-    size_t bufferPos = 0;
-
-    UploadState() { buffer.resize(UPLOAD_BUFFER_SIZE); }
   } upload;
 
   CrossPointWebServer();
   ~CrossPointWebServer();
 
-  // Start the web server (call after WiFi is connected)
+  // Start the web server and its task (call after WiFi is connected)
   void begin();
 
-  // Stop the web server
+  // Stop the web server, once the request being served (if any) is complete
   void stop();
 
-  // Call this periodically to handle client requests
-  void handleClient();
-
   // Check if server is running
   bool isRunning() const { return running; }
 
+  // Safe to call from any task
   WsUploadStatus getWsUploadStatus() const;
 
   // Get the port number
@@ -71,19 +73,66 @@ class CrossPointWebServer {
  private:
   std::unique_ptr<WebServer> server = nullptr;
   std::unique_ptr<WebSocketsServer> wsServer = nullptr;
-  bool running = false;
+  std::atomic<bool> running{false};
   bool apMode = false;  // true when running in AP mode, false for STA mode
   uint16_t port = 80;
   uint16_t wsPort = 81;  // WebSocket port
   WiFiUDP udp;
   bool udpActive = false;
 
+  // Server task
+  static constexpr uint8_t MAX_WS_CLIENTS = 2;
+  TaskHandle_t serverTaskHandle = nullptr;
+  SemaphoreHandle_t serverTaskStopped = nullptr;  // Given by the task just before it exits
+  std::atomic<bool> stopRequested{false};
+  // Copy of the WebSocket upload status for other tasks, updated by the server task when it changes
+  mutable SemaphoreHandle_t statusMutex = nullptr;
+  WsUploadStatus publishedStatus;
+
+  // The one upload in progress, over HTTP or WebSocket
+  UploadWriter uploadWriter;
+  // Writes through uploadWriter when the upload is resumable
+  ResumableUpload resumableUpload{uploadWriter};
+  // Used by the resumable chunk upload handler
+  struct ChunkUploadState {
+    ResumableUpload::ChunkResult result = ResumableUpload::ChunkResult::Rejected;
+    uint32_t offset = 0;  // Where the client continues
+    bool done = false;
+    String error;
+  } chunkUpload;
+  // Listing of the last directory requested; every handler that changes the card invalidates it
+  DirectoryListingCache listingCache;
+  // ETags of downloads; every handler that writes, renames, moves or deletes a file tells it
+  FileEtags fileEtags;
+  // Uploaded books are prepared for reading (see BookIngestQueue) once the server has been idle this long
+  static constexpr unsigned long INGEST_IDLE_MS = 5000;
+  unsigned long lastBusyAt = 0;  // Last time a request or upload was in progress
+  // Read buffer for downloads, allocated by the first one and kept until stop()
+  uint8_t* downloadBuffer = nullptr;
+  size_t downloadBufferSize = 0;
+
+  bool startServerTask();
+  // Waits for the request in progress, then for the task to exit
+  void stopServerTask();
+  static void serverTaskTrampoline(void* param);
+  void serverTaskLoop();
+  // Serve whatever is pending on the HTTP, WebSocket and discovery sockets
+  void handleClient();
+  void publishWsUploadStatus();
+  // A file was written to filePath by an upload
+  void onFileUploaded(const String& filePath);
+
   // WebSocket upload state
   void onWebSocketEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length);
+  // Stop the WebSocket upload, keeping what was received if it is resumable
+  void cancelWsUpload();
+  // Last byte of a WebSocket upload received: close it and tell the client
+  void completeWsUpload(uint8_t num);
   static void wsEventCallback(uint8_t num, WStype_t type, uint8_t* payload, size_t length);
 
   // File scanning
-  void scanFiles(const char* path, const std::function<void(FileInfo)>& callback) const;
+  // Calls callback for each visible entry of path until it returns false
+  void scanFiles(const char* path, const std::function<bool(const FileInfo&)>& callback) const;
   String formatFileSize(size_t bytes) const;
   bool isEpubFile(const String& filename) const;
 
@@ -92,10 +141,15 @@ class CrossPointWebServer {
   void handleNotFound() const;
   void handleStatus() const;
   void handleFileList() const;
-  void handleFileListData() const;
-  void handleDownload() const;
-  void handleUpload(UploadState& state) const;
+  void handleFileListData();
+  void handleDownload();
+  // Send length bytes of file from offset to the client, after the headers. False if the client went away.
+  bool sendFileData(FsFile& file, size_t offset, size_t length);
+  void handleUpload(UploadState& state);
   void handleUploadPost(UploadState& state) const;
+  void handleUploadResumeOffset();
+  void handleChunkUpload(ChunkUploadState& state);
+  void handleChunkUploadPost(const ChunkUploadState& state) const;
   void handleCreateFolder() const;
   void handleRename() const;
   void handleMove() const;
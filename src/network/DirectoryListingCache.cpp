@@ -0,0 +1,132 @@
+#include "DirectoryListingCache.h"
+
+#include <Logging.h>
+#include <esp_system.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+namespace {
+// Folders first, then EPUBs, then other files
+int typeRank(const DirectoryListingCache::Entry& entry) {
+  if (entry.isDirectory) return 0;
+  return entry.isEpub ? 1 : 2;
+}
+}  // namespace
+
+DirectoryListingCache::DirectoryListingCache() : version(esp_random()) { updateEtag(); }
+
+void DirectoryListingCache::begin(const std::string& path) {
+  clear();
+  cachedPath = path;
+  filling = true;
+}
+
+bool DirectoryListingCache::add(const char* name, const uint32_t size, const bool isDirectory, const bool isEpub) {
+  if (!filling) {
+    return false;
+  }
+  const size_t nameLength = strlen(name) + 1;
+  const bool newBlock = lastBlockUsed + nameLength > NAME_BLOCK_SIZE;
+  // Entries with their place in a sort order, and the name blocks
+  const size_t needed = (entries.size() + 1) * (sizeof(Entry) + sizeof(uint16_t)) +
+                        (nameBlocks.size() + (newBlock ? 1 : 0)) * NAME_BLOCK_SIZE;
+  if (needed > MAX_BYTES || nameLength > NAME_BLOCK_SIZE || entries.size() >= UINT16_MAX) {
+    LOG_DBG("WEB", "Listing of %s is too large to cache", cachedPath.c_str());
+    oversizePath = cachedPath;
+    clear();
+    return false;
+  }
+  if (newBlock) {
+    char* block = new (std::nothrow) char[NAME_BLOCK_SIZE];
+    if (!block) {
+      LOG_ERR("WEB", "Not enough memory to cache the listing of %s", cachedPath.c_str());
+      oversizePath = cachedPath;
+      clear();
+      return false;
+    }
+    nameBlocks.emplace_back(block);
+    lastBlockUsed = 0;
+  }
+  const uint32_t nameRef = static_cast<uint32_t>(nameBlocks.size() - 1) << NAME_BLOCK_BITS | lastBlockUsed;
+  memcpy(nameBlocks.back().get() + lastBlockUsed, name, nameLength);
+  lastBlockUsed += nameLength;
+  entries.push_back({nameRef, size, isDirectory, isEpub});
+  return true;
+}
+
+void DirectoryListingCache::end() {
+  if (!filling) {
+    return;
+  }
+  filling = false;
+  valid = true;
+  entries.shrink_to_fit();
+  LOG_DBG("WEB", "Cached listing of %s: %u entries, %u name blocks", cachedPath.c_str(), entries.size(),
+          nameBlocks.size());
+}
+
+void DirectoryListingCache::sort(const SortKey key, const bool descending) {
+  if (key == sortedBy && (descending == sortedDescending || key == SortKey::None)) {
+    return;
+  }
+  sortedBy = key;
+  sortedDescending = descending;
+  if (key == SortKey::None) {
+    order.clear();
+    order.shrink_to_fit();
+    return;
+  }
+
+  order.resize(entries.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = static_cast<uint16_t>(i);
+  }
+  std::stable_sort(order.begin(), order.end(), [this, key, descending](const uint16_t left, const uint16_t right) {
+    const Entry& a = entries[left];
+    const Entry& b = entries[right];
+    // Folders stay first in either direction
+    if (a.isDirectory != b.isDirectory) {
+      return a.isDirectory;
+    }
+    int result = 0;
+    if (key == SortKey::Type) {
+      result = typeRank(a) - typeRank(b);
+    } else if (key == SortKey::Size && !a.isDirectory) {
+      result = a.size < b.size ? -1 : (a.size > b.size ? 1 : 0);
+    }
+    if (result == 0) {
+      result = strcasecmp(getName(a), getName(b));
+    }
+    return descending ? result > 0 : result < 0;
+  });
+}
+
+void DirectoryListingCache::invalidate() {
+  clear();
+  cachedPath.clear();
+  oversizePath.clear();
+  version++;
+  updateEtag();
+}
+
+void DirectoryListingCache::clear() {
+  valid = false;
+  filling = false;
+  entries.clear();
+  entries.shrink_to_fit();
+  nameBlocks.clear();
+  nameBlocks.shrink_to_fit();
+  lastBlockUsed = NAME_BLOCK_SIZE;
+  order.clear();
+  order.shrink_to_fit();
+  sortedBy = SortKey::None;
+  sortedDescending = false;
+}
+
+void DirectoryListingCache::updateEtag() {
+  snprintf(etag, sizeof(etag), "\"dir-%08lx\"", static_cast<unsigned long>(version));
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+The last directory listed by /api/files, kept in memory so paging through it, sorting it or listing it again doesn't
+open every entry on the card again. While the web server runs it is the only thing changing the card, so every change
+it makes calls invalidate(), which also moves on the version used as the listings' ETag. The version starts from a
+random value, so an ETag from before a restart of the server doesn't match.
+
+Names are packed into 4KB blocks next to fixed-size entries, so a large listing needs no large contiguous allocation.
+A directory that doesn't fit in MAX_BYTES is not kept: it is listed from the card each time, in card order.
+*/
+class DirectoryListingCache {
+ public:
+  static constexpr size_t MAX_BYTES = 48 * 1024;
+
+  enum class SortKey {
+    None,  // Card order
+    Name,  // Folders first, then by name
+    Type,  // Folders, EPUBs, other files, each by name (the web UI's order)
+    Size,  // Folders by name, then files by size
+  };
+
+  struct Entry {
+    uint32_t nameRef;  // Block index and offset in it
+    uint32_t size;
+    bool isDirectory;
+    bool isEpub;
+  };
+
+  DirectoryListingCache();
+
+  bool isCached(const std::string& path) const { return valid && path == cachedPath; }
+  // path was scanned and didn't fit
+  bool isTooLarge(const std::string& path) const { return path == oversizePath; }
+
+  // Fill the cache from a scan of path: begin(), add() for each entry, end(). add() returns false once the listing
+  // doesn't fit, and the scan can stop.
+  void begin(const std::string& path);
+  bool add(const char* name, uint32_t size, bool isDirectory, bool isEpub);
+  void end();
+
+  void sort(SortKey key, bool descending);
+  size_t size() const { return entries.size(); }
+  // The index-th entry in the order of the last sort()
+  const Entry& at(size_t index) const { return order.empty() ? entries[index] : entries[order[index]]; }
+  const char* getName(const Entry& entry) const {
+    return nameBlocks[entry.nameRef >> NAME_BLOCK_BITS].get() + (entry.nameRef & (NAME_BLOCK_SIZE - 1));
+  }
+
+  // The card changed: drop the listing
+  void invalidate();
+  // Quoted ETag for listings until the next invalidate()
+  const char* getEtag() const { return etag; }
+
+ private:
+  static constexpr uint32_t NAME_BLOCK_BITS = 12;
+  static constexpr size_t NAME_BLOCK_SIZE = 1 << NAME_BLOCK_BITS;
+
+  std::string cachedPath;
+  std::string oversizePath;
+  bool valid = false;
+  bool filling = false;
+  std::vector<Entry> entries;
+  std::vector<std::unique_ptr<char[]>> nameBlocks;
+  size_t lastBlockUsed = NAME_BLOCK_SIZE;  // Bytes used in the last name block
+  std::vector<uint16_t> order;             // Indices into entries, empty in card order
+  SortKey sortedBy = SortKey::None;
+  bool sortedDescending = false;
+  uint32_t version = 0;
+  char etag[24] = {};
+
+  void clear();
+  void updateEtag();
+};
@@ -0,0 +1,28 @@
+#include "FileEtags.h"
+
+#include <esp_system.h>
+
+#include <cstdio>
+
+FileEtags::FileEtags() : counter(esp_random()), treeGeneration(counter) {}
+
+void FileEtags::fileChanged(const std::string& path) {
+  if (fileGenerations.size() >= MAX_FILES && fileGenerations.find(path) == fileGenerations.end()) {
+    treeChanged();
+  }
+  fileGenerations[path] = ++counter;
+}
+
+void FileEtags::treeChanged() {
+  treeGeneration = ++counter;
+  fileGenerations.clear();
+}
+
+std::string FileEtags::etagFor(const std::string& path, const size_t size) const {
+  const auto it = fileGenerations.find(path);
+  const uint32_t generation = it == fileGenerations.end() ? treeGeneration : it->second;
+  char etag[32];
+  snprintf(etag, sizeof(etag), "\"%08lx-%lx\"", static_cast<unsigned long>(generation),
+           static_cast<unsigned long>(size));
+  return etag;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/*
+Entity tags for the files the web server sends. The card's timestamps can't tell two versions of a file apart: there
+is no clock, so every file the device writes gets the same modification time. The server counts its own changes
+instead. While it runs it is the only thing changing the card, and every write to a file moves that file on to a new
+generation; renames, moves and deletes move every file on. The counter starts from a random value, so an ETag from
+before a restart of the server doesn't match.
+
+Up to MAX_FILES written files are told apart; past that, a write moves every file on, as a delete would.
+*/
+class FileEtags {
+ public:
+  static constexpr size_t MAX_FILES = 64;
+
+  FileEtags();
+
+  // The file at path is being or was rewritten
+  void fileChanged(const std::string& path);
+  // Files were renamed, moved or deleted
+  void treeChanged();
+
+  // Quoted strong ETag for the file at path, now size bytes long
+  std::string etagFor(const std::string& path, size_t size) const;
+
+ private:
+  uint32_t counter;
+  uint32_t treeGeneration;
+  std::map<std::string, uint32_t> fileGenerations;
+};
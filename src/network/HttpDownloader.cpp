@@ -1,56 +1,236 @@
 #include "HttpDownloader.h"
 
+#include <BufferedFile.h>
 #include <HTTPClient.h>
 #include <Logging.h>
+#include <Serialization.h>
 #include <StreamString.h>
 #include <WiFiClient.h>
 #include <WiFiClientSecure.h>
 #include <base64.h>
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
 #include <memory>
 
 #include "CrossPointSettings.h"
+#include "UploadWriter.h"
 #include "util/UrlUtils.h"
 
-bool HttpDownloader::fetchUrl(const std::string& url, Stream& outContent) {
-  // Use WiFiClientSecure for HTTPS, regular WiFiClient for HTTP
+struct HttpDownloader::Connection {
   std::unique_ptr<WiFiClient> client;
-  if (UrlUtils::isHttpsUrl(url)) {
-    auto* secureClient = new WiFiClientSecure();
-    secureClient->setInsecure();
-    client.reset(secureClient);
-  } else {
-    client.reset(new WiFiClient());
+  HTTPClient http;     // Kept with the client: destroying it closes the connection
+  std::string origin;  // scheme://host[:port] the client is for
+};
+
+std::unique_ptr<HttpDownloader::Connection> HttpDownloader::connection;
+
+namespace {
+constexpr uint8_t DOWNLOAD_MANIFEST_VERSION = 1;
+constexpr char CACHE_DIR[] = "/.crosspoint";
+constexpr char DOWNLOAD_PART_FILE[] = "/.crosspoint/download.part";
+constexpr char DOWNLOAD_MANIFEST_FILE[] = "/.crosspoint/download.man";
+
+// "bytes first-last/total"
+bool parseContentRange(const String& header, uint32_t& first, uint32_t& total) {
+  unsigned long start = 0;
+  unsigned long last = 0;
+  unsigned long size = 0;
+  if (sscanf(header.c_str(), "bytes %lu-%lu/%lu", &start, &last, &size) != 3) {
+    return false;
   }
-  HTTPClient http;
+  first = start;
+  total = size;
+  return true;
+}
+}  // namespace
+
+// The partial file of a download and what is known about it, kept in a manifest next to it
+struct HttpDownloader::PartialDownload {
+  std::string url;
+  std::string destPath;
+  std::string validator;   // Strong ETag or Last-Modified of the file, for If-Range; empty if the server sent neither
+  uint32_t totalSize = 0;  // 0 if unknown
+  uint32_t received = 0;   // On the card, from the start of the file
+
+  // The manifest's download, if it is this one and its partial file has what it claims
+  bool load() {
+    BufferedFile file;
+    if (!file.openForRead("HTTP", DOWNLOAD_MANIFEST_FILE)) {
+      return false;
+    }
+    PartialDownload saved;
+    uint8_t version = 0;
+    serialization::readPod(file, version);
+    if (version != DOWNLOAD_MANIFEST_VERSION) {
+      LOG_ERR("HTTP", "Deserialization failed: Unknown version %u", version);
+      file.close();
+      return false;
+    }
+    serialization::readString(file, saved.url);
+    serialization::readString(file, saved.destPath);
+    serialization::readString(file, saved.validator);
+    serialization::readPod(file, saved.totalSize);
+    serialization::readPod(file, saved.received);
+    const bool complete = file.position() <= file.size();
+    file.close();
+    if (!complete || saved.url != url || saved.destPath != destPath ||
+        (saved.totalSize > 0 && saved.received > saved.totalSize)) {
+      return false;
+    }
 
-  LOG_DBG("HTTP", "Fetching: %s", url.c_str());
+    FsFile part;
+    if (!Storage.openFileForRead("HTTP", DOWNLOAD_PART_FILE, part)) {
+      return false;
+    }
+    const uint32_t partSize = part.size();
+    part.close();
+    if (partSize < saved.received) {
+      return false;
+    }
+    *this = std::move(saved);
+    return true;
+  }
 
-  http.begin(*client, url.c_str());
-  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-  http.addHeader("User-Agent", "CrossPoint-ESP32-" CROSSPOINT_VERSION);
+  bool save() const {
+    BufferedFile file;
+    if (!file.openForWrite("HTTP", DOWNLOAD_MANIFEST_FILE)) {
+      return false;
+    }
+    serialization::writePod(file, DOWNLOAD_MANIFEST_VERSION);
+    serialization::writeString(file, url);
+    serialization::writeString(file, destPath);
+    serialization::writeString(file, validator);
+    serialization::writePod(file, totalSize);
+    serialization::writePod(file, received);
+    file.close();
+    return true;
+  }
+
+  // Start again from the first byte
+  void reset() {
+    validator.clear();
+    totalSize = 0;
+    received = 0;
+  }
+
+  static void remove() {
+    Storage.remove(DOWNLOAD_PART_FILE);
+    Storage.remove(DOWNLOAD_MANIFEST_FILE);
+  }
+};
+
+int HttpDownloader::get(const std::string& url, const std::function<void(HTTPClient&)>& setup) {
+  const std::string origin = UrlUtils::extractHost(url);
+  for (int attempt = 0;; attempt++) {
+    if (!connection || connection->origin != origin) {
+      closeConnection();
+      connection.reset(new Connection());
+      // Use WiFiClientSecure for HTTPS, regular WiFiClient for HTTP
+      if (UrlUtils::isHttpsUrl(url)) {
+        auto* secureClient = new WiFiClientSecure();
+        secureClient->setInsecure();
+        connection->client.reset(secureClient);
+      } else {
+        connection->client.reset(new WiFiClient());
+      }
+      connection->origin = origin;
+    }
+    const bool reusing = connection->client->connected();
+
+    HTTPClient& http = connection->http;
+    http.begin(*connection->client, url.c_str());
+    http.setReuse(true);
+    http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+    http.addHeader("User-Agent", "CrossPoint-ESP32-" CROSSPOINT_VERSION);
+
+    // Add Basic HTTP auth if credentials are configured
+    if (strlen(SETTINGS.opdsUsername) > 0 && strlen(SETTINGS.opdsPassword) > 0) {
+      std::string credentials = std::string(SETTINGS.opdsUsername) + ":" + SETTINGS.opdsPassword;
+      String encoded = base64::encode(credentials.c_str());
+      http.addHeader("Authorization", "Basic " + encoded);
+    }
+    if (setup) {
+      setup(http);
+    }
 
-  // Add Basic HTTP auth if credentials are configured
-  if (strlen(SETTINGS.opdsUsername) > 0 && strlen(SETTINGS.opdsPassword) > 0) {
-    std::string credentials = std::string(SETTINGS.opdsUsername) + ":" + SETTINGS.opdsPassword;
-    String encoded = base64::encode(credentials.c_str());
-    http.addHeader("Authorization", "Basic " + encoded);
+    const int httpCode = http.GET();
+    if (httpCode >= 0 || !reusing || attempt > 0) {
+      return httpCode;
+    }
+    // The server closed the kept connection while it was idle
+    LOG_DBG("HTTP", "Kept connection failed (%d), reconnecting", httpCode);
+    endRequest(false);
   }
+}
 
-  const int httpCode = http.GET();
+void HttpDownloader::endRequest(const bool reusable) {
+  if (!connection) {
+    return;
+  }
+  HTTPClient& http = connection->http;
+  // After a redirect the connection may be to another server than origin
+  if (!reusable || http.getLocation().length() > 0) {
+    http.setReuse(false);
+  }
+  http.end();
+}
+
+void HttpDownloader::closeConnection() {
+  if (!connection) {
+    return;
+  }
+  connection->http.end();
+  connection->client->stop();
+  connection.reset();
+}
+
+bool HttpDownloader::fetchUrl(const std::string& url, Stream& outContent) {
+  CacheValidators received;
+  return fetchUrlIfModified(url, outContent, CacheValidators{}, received) == FETCHED;
+}
+
+HttpDownloader::FetchResult HttpDownloader::fetchUrlIfModified(const std::string& url, Stream& outContent,
+                                                               const CacheValidators& cached,
+                                                               CacheValidators& received) {
+  LOG_DBG("HTTP", "Fetching: %s", url.c_str());
+
+  const int httpCode = get(url, [&cached](HTTPClient& http) {
+    if (!cached.etag.empty()) {
+      http.addHeader("If-None-Match", cached.etag.c_str());
+    }
+    if (!cached.lastModified.empty()) {
+      http.addHeader("If-Modified-Since", cached.lastModified.c_str());
+    }
+    const char* responseHeaders[] = {"ETag", "Last-Modified"};
+    http.collectHeaders(responseHeaders, sizeof(responseHeaders) / sizeof(responseHeaders[0]));
+  });
+  HTTPClient& http = connection->http;
+
+  if (httpCode == HTTP_CODE_NOT_MODIFIED && (!cached.etag.empty() || !cached.lastModified.empty())) {
+    LOG_DBG("HTTP", "Not modified");
+    endRequest(true);
+    return NOT_MODIFIED;
+  }
   if (httpCode != HTTP_CODE_OK) {
     LOG_ERR("HTTP", "Fetch failed: %d", httpCode);
-    http.end();
-    return false;
+    endRequest(false);
+    return FETCH_FAILED;
   }
 
-  http.writeToStream(&outContent);
+  received.etag = http.header("ETag").c_str();
+  received.lastModified = http.header("Last-Modified").c_str();
+  const int written = http.writeToStream(&outContent);
 
-  http.end();
+  endRequest(written >= 0);
 
+  if (written < 0) {
+    LOG_ERR("HTTP", "Fetch failed while reading: %d", written);
+    return FETCH_FAILED;
+  }
   LOG_DBG("HTTP", "Fetch success");
-  return true;
+  return FETCHED;
 }
 
 bool HttpDownloader::fetchUrl(const std::string& url, std::string& outContent) {
@@ -62,112 +242,208 @@ bool HttpDownloader::fetchUrl(const std::string& url, std::string& outContent) {
   return true;
 }
 
-HttpDownloader::DownloadError HttpDownloader::downloadToFile(const std::string& url, const std::string& destPath,
-                                                             ProgressCallback progress) {
-  // Use WiFiClientSecure for HTTPS, regular WiFiClient for HTTP
-  std::unique_ptr<WiFiClient> client;
-  if (UrlUtils::isHttpsUrl(url)) {
-    auto* secureClient = new WiFiClientSecure();
-    secureClient->setInsecure();
-    client.reset(secureClient);
+HttpDownloader::DownloadError HttpDownloader::continueDownload(PartialDownload& download, UploadWriter& writer,
+                                                               const ProgressCallback& progress, bool& retry) {
+  retry = false;
+  const uint32_t resumeAt = download.received;
+  const int httpCode = get(download.url, [&download, resumeAt](HTTPClient& http) {
+    if (resumeAt > 0) {
+      http.addHeader("Range", ("bytes=" + std::to_string(resumeAt) + "-").c_str());
+      if (!download.validator.empty()) {
+        http.addHeader("If-Range", download.validator.c_str());
+      }
+    }
+    const char* responseHeaders[] = {"ETag", "Last-Modified", "Content-Range"};
+    http.collectHeaders(responseHeaders, sizeof(responseHeaders) / sizeof(responseHeaders[0]));
+  });
+  HTTPClient& http = connection->http;
+
+  uint32_t start = 0;
+  if (httpCode == HTTP_CODE_PARTIAL_CONTENT && resumeAt > 0) {
+    uint32_t first = 0;
+    uint32_t total = 0;
+    if (!parseContentRange(http.header("Content-Range"), first, total) || first != resumeAt ||
+        (download.totalSize > 0 && total != download.totalSize)) {
+      LOG_ERR("HTTP", "Unexpected range \"%s\", starting over", http.header("Content-Range").c_str());
+      endRequest(false);
+      download.reset();
+      retry = true;
+      return HTTP_ERROR;
+    }
+    download.totalSize = total;
+    start = resumeAt;
+  } else if (httpCode == HTTP_CODE_OK) {
+    // The whole file: a new download, or the file changed since the partial one started
+    if (resumeAt > 0) {
+      LOG_DBG("HTTP", "Server sent the whole file, starting over");
+    }
+    download.reset();
+    const int size = http.getSize();
+    download.totalSize = size > 0 ? size : 0;
+    // A weak ETag can't be used with If-Range
+    const String etag = http.header("ETag");
+    download.validator =
+        !etag.isEmpty() && !etag.startsWith("W/") ? etag.c_str() : http.header("Last-Modified").c_str();
+  } else if (httpCode == HTTP_CODE_RANGE_NOT_SATISFIABLE && resumeAt > 0) {
+    LOG_DBG("HTTP", "Partial file doesn't match the file on the server, starting over");
+    endRequest(false);
+    download.reset();
+    retry = true;
+    return HTTP_ERROR;
   } else {
-    client.reset(new WiFiClient());
-  }
-  HTTPClient http;
-
-  LOG_DBG("HTTP", "Downloading: %s", url.c_str());
-  LOG_DBG("HTTP", "Destination: %s", destPath.c_str());
-
-  http.begin(*client, url.c_str());
-  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-  http.addHeader("User-Agent", "CrossPoint-ESP32-" CROSSPOINT_VERSION);
-
-  // Add Basic HTTP auth if credentials are configured
-  if (strlen(SETTINGS.opdsUsername) > 0 && strlen(SETTINGS.opdsPassword) > 0) {
-    std::string credentials = std::string(SETTINGS.opdsUsername) + ":" + SETTINGS.opdsPassword;
-    String encoded = base64::encode(credentials.c_str());
-    http.addHeader("Authorization", "Basic " + encoded);
-  }
-
-  const int httpCode = http.GET();
-  if (httpCode != HTTP_CODE_OK) {
     LOG_ERR("HTTP", "Download failed: %d", httpCode);
-    http.end();
+    endRequest(false);
+    // No response at all: the connection failed
+    retry = httpCode < 0;
     return HTTP_ERROR;
   }
+  LOG_DBG("HTTP", "Content-Length: %d, from byte %u", http.getSize(), start);
 
-  const size_t contentLength = http.getSize();
-  LOG_DBG("HTTP", "Content-Length: %zu", contentLength);
-
-  // Remove existing file if present
-  if (Storage.exists(destPath.c_str())) {
-    Storage.remove(destPath.c_str());
-  }
-
-  // Open file for writing
-  FsFile file;
-  if (!Storage.openFileForWrite("HTTP", destPath.c_str(), file)) {
-    LOG_ERR("HTTP", "Failed to open file for writing");
-    http.end();
-    return FILE_ERROR;
+  // Records the validator and size before any data is written
+  if (!download.save() || !writer.open(DOWNLOAD_PART_FILE, start)) {
+    LOG_ERR("HTTP", "Failed to open the partial file");
+    endRequest(false);
+    if (start == 0) {
+      return FILE_ERROR;
+    }
+    download.reset();
+    retry = true;
+    return HTTP_ERROR;
   }
 
   // Get the stream for chunked reading
   WiFiClient* stream = http.getStreamPtr();
   if (!stream) {
     LOG_ERR("HTTP", "Failed to get stream");
-    file.close();
-    Storage.remove(destPath.c_str());
-    http.end();
+    writer.close();
+    endRequest(false);
     return HTTP_ERROR;
   }
 
-  // Download in chunks
+  // Read in chunks; the writer task puts them on the card while the next ones arrive
   uint8_t buffer[DOWNLOAD_CHUNK_SIZE];
-  size_t downloaded = 0;
-  const size_t total = contentLength > 0 ? contentLength : 0;
+  const uint32_t total = download.totalSize;
+  uint32_t received = start;
+  bool writeFailed = false;
+  bool timedOut = false;
+  unsigned long lastDataAt = millis();
+  if (progress && total > 0) {
+    progress(received, total);
+  }
 
-  while (http.connected() && (contentLength == 0 || downloaded < contentLength)) {
+  while (http.connected() && (total == 0 || received < total)) {
     const size_t available = stream->available();
     if (available == 0) {
+      if (millis() - lastDataAt > READ_TIMEOUT_MS) {
+        timedOut = true;
+        break;
+      }
       delay(1);
       continue;
     }
 
-    const size_t toRead = available < DOWNLOAD_CHUNK_SIZE ? available : DOWNLOAD_CHUNK_SIZE;
+    size_t toRead = std::min(available, DOWNLOAD_CHUNK_SIZE);
+    if (total > 0) {
+      toRead = std::min<size_t>(toRead, total - received);
+    }
     const size_t bytesRead = stream->readBytes(buffer, toRead);
-
     if (bytesRead == 0) {
       break;
     }
+    lastDataAt = millis();
 
-    const size_t written = file.write(buffer, bytesRead);
-    if (written != bytesRead) {
-      LOG_ERR("HTTP", "Write failed: wrote %zu of %zu bytes", written, bytesRead);
-      file.close();
-      Storage.remove(destPath.c_str());
-      http.end();
-      return FILE_ERROR;
+    if (!writer.write(buffer, bytesRead)) {
+      writeFailed = true;
+      break;
+    }
+    received += bytesRead;
+
+    // Never claims data that isn't on the card yet
+    if (received - download.received >= CHECKPOINT_BYTES) {
+      if (!writer.flush()) {
+        writeFailed = true;
+        break;
+      }
+      download.received = received;
+      download.save();
     }
-
-    downloaded += bytesRead;
 
     if (progress && total > 0) {
-      progress(downloaded, total);
+      progress(received, total);
     }
   }
 
-  file.close();
-  http.end();
+  const bool complete = !writeFailed && !timedOut && (total == 0 || received == total);
+  endRequest(complete);
 
-  LOG_DBG("HTTP", "Downloaded %zu bytes", downloaded);
+  const bool closed = writer.close();
+  if (writeFailed || !closed) {
+    LOG_ERR("HTTP", "Write failed at %u bytes", received);
+    return FILE_ERROR;
+  }
+  download.received = received;
 
-  // Verify download size if known
-  if (contentLength > 0 && downloaded != contentLength) {
-    LOG_ERR("HTTP", "Size mismatch: got %zu, expected %zu", downloaded, contentLength);
-    Storage.remove(destPath.c_str());
+  if (!complete) {
+    LOG_ERR("HTTP", "Connection lost at %u of %u bytes%s", received, total, timedOut ? " (timed out)" : "");
+    download.save();
+    retry = true;
     return HTTP_ERROR;
   }
+  LOG_DBG("HTTP", "Downloaded %u bytes", received);
+  return OK;
+}
+
+HttpDownloader::DownloadError HttpDownloader::downloadToFile(const std::string& url, const std::string& destPath,
+                                                             ProgressCallback progress) {
+  LOG_DBG("HTTP", "Downloading: %s", url.c_str());
+  LOG_DBG("HTTP", "Destination: %s", destPath.c_str());
+
+  Storage.mkdir(CACHE_DIR);
+  PartialDownload download;
+  download.url = url;
+  download.destPath = destPath;
+  if (download.load()) {
+    LOG_DBG("HTTP", "Resuming at %u of %u bytes", download.received, download.totalSize);
+  } else {
+    // Only the last interrupted download is kept
+    PartialDownload::remove();
+  }
 
+  UploadWriter writer;
+  DownloadError result = HTTP_ERROR;
+  bool retry = false;
+  for (int attempt = 1; attempt <= DOWNLOAD_ATTEMPTS; attempt++) {
+    if (attempt > 1) {
+      LOG_DBG("HTTP", "Attempt %d of %d, from byte %u", attempt, DOWNLOAD_ATTEMPTS, download.received);
+      delay(RETRY_DELAY_MS * (attempt - 1));
+    }
+    result = continueDownload(download, writer, progress, retry);
+    if (result == OK || !retry) {
+      break;
+    }
+  }
+
+  if (result != OK) {
+    if (retry) {
+      LOG_DBG("HTTP", "Keeping %u bytes to resume later", download.received);
+    } else {
+      PartialDownload::remove();
+    }
+    return result;
+  }
+
+  // Remove existing file if present
+  if (Storage.exists(destPath.c_str())) {
+    Storage.remove(destPath.c_str());
+  }
+  FsFile part = Storage.open(DOWNLOAD_PART_FILE);
+  const bool moved = part && part.rename(destPath.c_str());
+  if (part) part.close();
+  if (!moved) {
+    LOG_ERR("HTTP", "Failed to move the download to %s", destPath.c_str());
+    PartialDownload::remove();
+    return FILE_ERROR;
+  }
+  Storage.remove(DOWNLOAD_MANIFEST_FILE);
   return OK;
 }
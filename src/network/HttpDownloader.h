@@ -1,12 +1,21 @@
 #pragma once
 #include <HalStorage.h>
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 
+class HTTPClient;
+class UploadWriter;
+
 /**
  * HTTP client utility for fetching content and downloading files.
  * Wraps WiFiClientSecure and HTTPClient for HTTPS requests.
+ *
+ * Requests go over one connection that is kept open between them (HTTP keep-alive), so a series of requests to the
+ * same server, like browsing a catalog and downloading from it, only pays for the TCP and TLS handshakes once. Call
+ * closeConnection() when done. Not thread-safe: one task makes all requests.
  */
 class HttpDownloader {
  public:
@@ -19,6 +28,18 @@ class HttpDownloader {
     ABORTED,
   };
 
+  enum FetchResult {
+    FETCHED = 0,
+    NOT_MODIFIED,  // The copy the validators came from is still current
+    FETCH_FAILED,
+  };
+
+  // What identifies a version of a resource: sent with a request for a cached copy, and returned by the server
+  struct CacheValidators {
+    std::string etag;
+    std::string lastModified;
+  };
+
   /**
    * Fetch text content from a URL.
    * @param url The URL to fetch
@@ -29,8 +50,25 @@ class HttpDownloader {
 
   static bool fetchUrl(const std::string& url, Stream& stream);
 
+  /**
+   * Fetch a URL of which a copy is cached, unless the copy is still current.
+   * @param url The URL to fetch
+   * @param stream Receives the content when the result is FETCHED
+   * @param cached Validators of the cached copy (empty if there is none)
+   * @param received Validators of the fetched content
+   */
+  static FetchResult fetchUrlIfModified(const std::string& url, Stream& stream, const CacheValidators& cached,
+                                        CacheValidators& received);
+
   /**
    * Download a file to the SD card.
+   *
+   * The file is written to a partial file in /.crosspoint, through UploadWriter so SD writes overlap with receiving,
+   * and moved to destPath when complete. A dropped connection is resumed with a Range request, up to
+   * DOWNLOAD_ATTEMPTS times. If it still fails, the partial file is kept, and downloading the same URL to the same
+   * path later continues from it (only the last interrupted download is kept). If-Range makes the server send the
+   * whole file instead if it changed meanwhile.
+   *
    * @param url The URL to download
    * @param destPath The destination path on SD card
    * @param progress Optional progress callback
@@ -39,6 +77,30 @@ class HttpDownloader {
   static DownloadError downloadToFile(const std::string& url, const std::string& destPath,
                                       ProgressCallback progress = nullptr);
 
+  // Close the connection kept for the next request, e.g. before WiFi is turned off
+  static void closeConnection();
+
  private:
   static constexpr size_t DOWNLOAD_CHUNK_SIZE = 1024;
+  static constexpr int DOWNLOAD_ATTEMPTS = 4;
+  static constexpr unsigned long RETRY_DELAY_MS = 1000;
+  // No data for this long drops the connection
+  static constexpr unsigned long READ_TIMEOUT_MS = 15000;
+  // The manifest of a partial download is updated after this much more is on the card
+  static constexpr uint32_t CHECKPOINT_BYTES = 256 * 1024;
+
+  struct Connection;
+  static std::unique_ptr<Connection> connection;
+  struct PartialDownload;
+
+  // GET url on the kept connection (TLS for https), with the user agent and OPDS credentials set, and the headers
+  // setup adds. A kept connection the server closed while idle is replaced once. The response is read from
+  // connection->http; call endRequest() after.
+  static int get(const std::string& url, const std::function<void(HTTPClient&)>& setup);
+  // The response was read to the end when reusable; otherwise the connection is closed
+  static void endRequest(bool reusable);
+  // One request for the rest of download. Sets retry when trying again can help (the connection dropped, or the
+  // partial file turned out unusable and was reset).
+  static DownloadError continueDownload(PartialDownload& download, UploadWriter& writer,
+                                        const ProgressCallback& progress, bool& retry);
 };
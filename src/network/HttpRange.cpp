@@ -0,0 +1,64 @@
+#include "HttpRange.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+bool parseNumber(const char* begin, const char* end, size_t& value) {
+  if (begin == end) {
+    return false;
+  }
+  value = 0;
+  for (const char* c = begin; c < end; c++) {
+    if (*c < '0' || *c > '9') {
+      return false;
+    }
+    const size_t digit = *c - '0';
+    if (value > (SIZE_MAX - digit) / 10) {
+      return false;
+    }
+    value = value * 10 + digit;
+  }
+  return true;
+}
+}  // namespace
+
+HttpRange::Result HttpRange::parse(const char* header, const size_t size, size_t& first, size_t& last) {
+  constexpr char UNIT[] = "bytes=";
+  if (strncmp(header, UNIT, sizeof(UNIT) - 1) != 0 || strchr(header, ',')) {
+    return Result::Whole;
+  }
+  const char* spec = header + sizeof(UNIT) - 1;
+  const char* end = spec + strlen(spec);
+  const char* dash = strchr(spec, '-');
+  if (!dash) {
+    return Result::Whole;
+  }
+  size_t from = 0;
+  size_t to = 0;
+  const bool hasFrom = parseNumber(spec, dash, from);
+  const bool hasTo = parseNumber(dash + 1, end, to);
+
+  if (hasFrom) {
+    if ((dash + 1 != end && !hasTo) || (hasTo && to < from)) {
+      return Result::Whole;
+    }
+    if (from >= size) {
+      return Result::Unsatisfiable;
+    }
+    first = from;
+    last = hasTo ? std::min(to, size - 1) : size - 1;
+    return Result::Partial;
+  }
+  if (spec != dash || !hasTo) {
+    return Result::Whole;
+  }
+  // Suffix: the last "to" bytes
+  if (to == 0 || size == 0) {
+    return Result::Unsatisfiable;
+  }
+  first = to >= size ? 0 : size - to;
+  last = size - 1;
+  return Result::Partial;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+The Range header of a download request (RFC 9110, section 14). Only a single range in bytes is served; anything else
+(several ranges, other units, malformed) is answered with the whole file, as the RFC allows.
+*/
+namespace HttpRange {
+
+enum class Result {
+  Whole,          // Send the whole file (200)
+  Partial,        // Send bytes first..last (206)
+  Unsatisfiable,  // The range starts past the end of the file (416)
+};
+
+// "bytes=first-last", "bytes=first-" or "bytes=-suffixLength" for a file of size bytes. last is clamped to the end of
+// the file. first and last are only set for Partial.
+Result parse(const char* header, size_t size, size_t& first, size_t& last);
+
+}  // namespace HttpRange
@@ -0,0 +1,130 @@
+#include "OpdsFeedCache.h"
+
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+constexpr uint8_t FEED_INDEX_FILE_VERSION = 1;
+constexpr char FEED_CACHE_DIR[] = "/.crosspoint/opds";
+constexpr char FEED_INDEX_FILE[] = "/.crosspoint/opds/index.bin";
+
+struct CachedFeed {
+  std::string url;
+  HttpDownloader::CacheValidators validators;
+};
+
+// Most recently used first
+std::vector<CachedFeed> loadIndex() {
+  std::vector<CachedFeed> feeds;
+  FsFile inputFile;
+  if (!Storage.exists(FEED_INDEX_FILE) || !Storage.openFileForRead("OFC", FEED_INDEX_FILE, inputFile)) {
+    return feeds;
+  }
+  uint8_t version = 0;
+  uint8_t count = 0;
+  serialization::readPod(inputFile, version);
+  if (version != FEED_INDEX_FILE_VERSION) {
+    LOG_ERR("OFC", "Deserialization failed: Unknown version %u", version);
+    inputFile.close();
+    return feeds;
+  }
+  serialization::readPod(inputFile, count);
+  for (uint8_t i = 0; i < count && i < OpdsFeedCache::MAX_FEEDS; i++) {
+    CachedFeed feed;
+    serialization::readString(inputFile, feed.url);
+    serialization::readString(inputFile, feed.validators.etag);
+    serialization::readString(inputFile, feed.validators.lastModified);
+    feeds.push_back(std::move(feed));
+  }
+  inputFile.close();
+  return feeds;
+}
+
+bool saveIndex(const std::vector<CachedFeed>& feeds) {
+  FsFile outputFile;
+  if (!Storage.openFileForWrite("OFC", FEED_INDEX_FILE, outputFile)) {
+    return false;
+  }
+  serialization::writePod(outputFile, FEED_INDEX_FILE_VERSION);
+  serialization::writePod(outputFile, static_cast<uint8_t>(feeds.size()));
+  for (const auto& feed : feeds) {
+    serialization::writeString(outputFile, feed.url);
+    serialization::writeString(outputFile, feed.validators.etag);
+    serialization::writeString(outputFile, feed.validators.lastModified);
+  }
+  outputFile.close();
+  return true;
+}
+
+std::vector<CachedFeed>::iterator findFeed(std::vector<CachedFeed>& feeds, const std::string& url) {
+  return std::find_if(feeds.begin(), feeds.end(), [&](const CachedFeed& feed) { return feed.url == url; });
+}
+}  // namespace
+
+std::string OpdsFeedCache::pathFor(const std::string& url) {
+  uint32_t hash = 2166136261u;
+  for (const char c : url) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  char name[16];
+  snprintf(name, sizeof(name), "/%08lx.xml", static_cast<unsigned long>(hash));
+  return FEED_CACHE_DIR + std::string(name);
+}
+
+std::string OpdsFeedCache::tempPathFor(const std::string& url) {
+  Storage.mkdir(FEED_CACHE_DIR);
+  return pathFor(url) + ".tmp";
+}
+
+bool OpdsFeedCache::lookup(const std::string& url, HttpDownloader::CacheValidators& validators) {
+  auto feeds = loadIndex();
+  const auto it = findFeed(feeds, url);
+  if (it == feeds.end() || !Storage.exists(pathFor(url).c_str())) {
+    return false;
+  }
+  validators = it->validators;
+  return true;
+}
+
+bool OpdsFeedCache::store(const std::string& url, const HttpDownloader::CacheValidators& validators) {
+  const std::string path = pathFor(url);
+  const std::string tempPath = tempPathFor(url);
+  if (Storage.exists(path.c_str())) {
+    Storage.remove(path.c_str());
+  }
+  FsFile temp = Storage.open(tempPath.c_str());
+  const bool moved = temp && temp.rename(path.c_str());
+  if (temp) temp.close();
+  if (!moved) {
+    LOG_ERR("OFC", "Failed to move %s into place", tempPath.c_str());
+    Storage.remove(tempPath.c_str());
+    return false;
+  }
+
+  auto feeds = loadIndex();
+  const auto it = findFeed(feeds, url);
+  if (it != feeds.end()) {
+    feeds.erase(it);
+  }
+  feeds.insert(feeds.begin(), CachedFeed{url, validators});
+  while (feeds.size() > MAX_FEEDS) {
+    Storage.remove(pathFor(feeds.back().url).c_str());
+    feeds.pop_back();
+  }
+  return saveIndex(feeds);
+}
+
+void OpdsFeedCache::touch(const std::string& url) {
+  auto feeds = loadIndex();
+  const auto it = findFeed(feeds, url);
+  if (it == feeds.end() || it == feeds.begin()) {
+    return;
+  }
+  std::rotate(feeds.begin(), it, it + 1);
+  saveIndex(feeds);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "HttpDownloader.h"
+
+/*
+OPDS feed pages kept on the SD card in /.crosspoint/opds, one file per URL, with the ETag and Last-Modified the server
+sent for them. A page is requested again with those, so an unchanged page costs a 304 instead of its download, and the
+copy is still there to show when the server can't be reached. The browser also reads the copy again instead of holding
+a large page in memory.
+
+An index file lists the cached URLs, most recently used first. Storing a page beyond MAX_FEEDS removes the least
+recently used one.
+*/
+class OpdsFeedCache {
+ public:
+  static constexpr size_t MAX_FEEDS = 32;
+
+  // Where the copy of url is kept
+  static std::string pathFor(const std::string& url);
+  // Temporary file for a new copy of url, moved into place by store(). Creates the cache directory.
+  static std::string tempPathFor(const std::string& url);
+
+  // Validators of the cached copy of url; false if there is no copy
+  static bool lookup(const std::string& url, HttpDownloader::CacheValidators& validators);
+  // A new copy of url was written to tempPathFor(url): move it into place
+  static bool store(const std::string& url, const HttpDownloader::CacheValidators& validators);
+  // The cached copy of url was used: keep it longest
+  static void touch(const std::string& url);
+};
@@ -0,0 +1,352 @@
+#include "ResumableUpload.h"
+
+#include <BufferedFile.h>
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+#include <esp_task_wdt.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "util/StringUtils.h"
+
+namespace {
+constexpr uint8_t UPLOAD_MANIFEST_VERSION = 2;
+constexpr char UPLOADS_DIR[] = "/.crosspoint/uploads";
+constexpr char PART_EXTENSION[] = ".part";
+constexpr char MANIFEST_EXTENSION[] = ".man";
+
+struct Manifest {
+  std::string targetPath;
+  std::string id;
+  uint32_t totalSize = 0;
+  uint32_t received = 0;
+  uint32_t sequence = 0;  // When the manifest was last written, see nextSequence()
+};
+
+// The card's timestamps can't order the partial uploads (there is no clock, every file gets the same modification
+// time), so each manifest records a sequence number instead, one higher than any manifest written before it
+uint32_t lastSequence = 0;
+bool lastSequenceKnown = false;
+
+// Partial file and manifest paths without their extensions
+std::string uploadBasePath(const std::string& targetPath) {
+  uint32_t hash = 2166136261u;
+  for (const char c : targetPath) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  char name[12];
+  snprintf(name, sizeof(name), "/%08lx", static_cast<unsigned long>(hash));
+  return UPLOADS_DIR + std::string(name);
+}
+
+bool loadManifest(const std::string& path, Manifest& manifest) {
+  BufferedFile file;
+  if (!file.openForRead("RUP", path)) {
+    return false;
+  }
+  uint8_t version = 0;
+  serialization::readPod(file, version);
+  if (version != UPLOAD_MANIFEST_VERSION) {
+    LOG_ERR("RUP", "Deserialization failed: Unknown version %u", version);
+    file.close();
+    return false;
+  }
+  serialization::readString(file, manifest.targetPath);
+  serialization::readString(file, manifest.id);
+  serialization::readPod(file, manifest.totalSize);
+  serialization::readPod(file, manifest.received);
+  serialization::readPod(file, manifest.sequence);
+  const bool complete = file.position() <= file.size();
+  file.close();
+  return complete;
+}
+
+// Bytes of the partial file at base that can be continued from: 0 unless its manifest is for this very file
+uint32_t resumableBytes(const std::string& base, const std::string& targetPath, const std::string& id,
+                        const uint32_t totalSize) {
+  Manifest manifest;
+  if (!loadManifest(base + MANIFEST_EXTENSION, manifest) || manifest.targetPath != targetPath || manifest.id != id ||
+      manifest.totalSize != totalSize || manifest.received > totalSize) {
+    return 0;
+  }
+  FsFile part;
+  if (!Storage.openFileForRead("RUP", base + PART_EXTENSION, part)) {
+    return 0;
+  }
+  const uint32_t partSize = part.size();
+  part.close();
+  return partSize >= manifest.received ? manifest.received : 0;
+}
+
+// The sequence number of every partial upload in the uploads directory, except the one at skipBase. A partial file
+// without a valid manifest can't be resumed and comes first, with 0.
+std::vector<std::pair<uint32_t, std::string>> listPartials(const std::string& skipBase) {
+  std::vector<std::pair<uint32_t, std::string>> partials;
+  auto dir = Storage.open(UPLOADS_DIR);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return partials;
+  }
+  char name[32];
+  for (auto file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    file.getName(name, sizeof(name));
+    file.close();
+    const std::string fileName = name;
+    if (StringUtils::checkFileExtension(fileName, PART_EXTENSION)) {
+      const std::string base =
+          std::string(UPLOADS_DIR) + "/" + fileName.substr(0, fileName.size() - strlen(PART_EXTENSION));
+      if (base != skipBase) {
+        partials.emplace_back(0, base);
+      }
+    }
+  }
+  dir.close();
+  for (auto& partial : partials) {
+    Manifest manifest;
+    if (loadManifest(partial.second + MANIFEST_EXTENSION, manifest)) {
+      partial.first = manifest.sequence;
+    }
+  }
+  return partials;
+}
+
+uint32_t nextSequence() {
+  if (!lastSequenceKnown) {
+    for (const auto& partial : listPartials("")) {
+      lastSequence = std::max(lastSequence, partial.first);
+    }
+    lastSequenceKnown = true;
+  }
+  return ++lastSequence;
+}
+
+// Make room for one more partial upload besides the one at base by removing the least recently written ones
+void removeOldestPartials(const std::string& base, const size_t keep) {
+  auto partials = listPartials(base);
+  for (const auto& partial : partials) {
+    lastSequence = std::max(lastSequence, partial.first);
+  }
+  // The manifest at base was removed before, so these are all there are
+  lastSequenceKnown = true;
+  if (partials.size() <= keep) {
+    return;
+  }
+  std::sort(partials.begin(), partials.end());
+  for (size_t i = 0; i < partials.size() - keep; i++) {
+    const std::string& oldBase = partials[i].second;
+    LOG_DBG("RUP", "Removing interrupted upload %s", oldBase.c_str());
+    Storage.remove((oldBase + PART_EXTENSION).c_str());
+    Storage.remove((oldBase + MANIFEST_EXTENSION).c_str());
+  }
+}
+}  // namespace
+
+bool ResumableUpload::begin(const std::string& path, const std::string& uploadId, const uint32_t size) {
+  if (active) {
+    suspend();
+  }
+  const std::string base = uploadBasePath(path);
+  targetPath = path;
+  id = uploadId;
+  totalSize = size;
+  partPath = base + PART_EXTENSION;
+  manifestPath = base + MANIFEST_EXTENSION;
+
+  esp_task_wdt_reset();
+  received = resumableBytes(base, targetPath, id, totalSize);
+  if (received == 0) {
+    Storage.mkdir(UPLOADS_DIR);
+    Storage.remove(manifestPath.c_str());
+    removeOldestPartials(base, MAX_PARTIAL_UPLOADS - 1);
+  }
+  if (!writer.open(partPath, received)) {
+    if (received == 0) {
+      reset();
+      return false;
+    }
+    // The partial file can't be continued: start over
+    received = 0;
+    if (!writer.open(partPath)) {
+      reset();
+      return false;
+    }
+  }
+  checkpointed = received;
+  active = true;
+  LOG_DBG("RUP", "%s %s at %u of %u bytes", received > 0 ? "Resuming" : "Starting", targetPath.c_str(), received,
+          totalSize);
+  return true;
+}
+
+ResumableUpload::ChunkResult ResumableUpload::addChunk(const uint32_t offset, const uint8_t* data, const size_t length,
+                                                       const uint32_t crc) {
+  if (!active || chunkOpen || offset != received || length > totalSize - received ||
+      mz_crc32(MZ_CRC32_INIT, data, length) != crc) {
+    return ChunkResult::Rejected;
+  }
+  if (!writer.write(data, length)) {
+    return ChunkResult::Failed;
+  }
+  received += length;
+  if (received - checkpointed >= CHECKPOINT_BYTES && !checkpoint()) {
+    return ChunkResult::Failed;
+  }
+  return ChunkResult::Written;
+}
+
+bool ResumableUpload::beginChunk(const uint32_t offset) {
+  if (!active || chunkOpen || offset != received) {
+    return false;
+  }
+  chunkOpen = true;
+  chunkOverflow = false;
+  chunkLength = 0;
+  chunkCrc = MZ_CRC32_INIT;
+  return true;
+}
+
+bool ResumableUpload::appendChunk(const uint8_t* data, const size_t length) {
+  if (!chunkOpen) {
+    return false;
+  }
+  if (chunkOverflow || length > totalSize - received - chunkLength) {
+    // Longer than the rest of the file: rejected at the end
+    chunkOverflow = true;
+    return true;
+  }
+  chunkCrc = mz_crc32(chunkCrc, data, length);
+  chunkLength += length;
+  return writer.write(data, length);
+}
+
+ResumableUpload::ChunkResult ResumableUpload::endChunk(const uint32_t crc) {
+  if (!chunkOpen) {
+    return ChunkResult::Rejected;
+  }
+  chunkOpen = false;
+  if (!chunkOverflow && chunkCrc == crc) {
+    received += chunkLength;
+    if (received - checkpointed >= CHECKPOINT_BYTES && !checkpoint()) {
+      return ChunkResult::Failed;
+    }
+    return ChunkResult::Written;
+  }
+
+  LOG_ERR("RUP", "Chunk at %u of %s rejected (%s)", received, targetPath.c_str(),
+          chunkOverflow ? "too long" : "CRC mismatch");
+  if (chunkLength > 0) {
+    // Cut the chunk off the partial file again
+    if (!writer.close() || !writer.open(partPath, received)) {
+      received = checkpointed;
+      return ChunkResult::Failed;
+    }
+  }
+  return ChunkResult::Rejected;
+}
+
+bool ResumableUpload::finish() {
+  if (!isComplete() || chunkOpen) {
+    return false;
+  }
+  if (!writer.close()) {
+    LOG_ERR("RUP", "Final write of %s failed", targetPath.c_str());
+    received = checkpointed;
+    saveManifest();
+    reset();
+    return false;
+  }
+  checkpointed = received;
+
+  esp_task_wdt_reset();
+  if (Storage.exists(targetPath.c_str())) {
+    Storage.remove(targetPath.c_str());
+  }
+  FsFile part = Storage.open(partPath.c_str());
+  const bool moved = part && part.rename(targetPath.c_str());
+  if (part) part.close();
+  if (!moved) {
+    // Kept as complete: resuming it tries the move again
+    LOG_ERR("RUP", "Failed to move %s to %s", partPath.c_str(), targetPath.c_str());
+    saveManifest();
+    reset();
+    return false;
+  }
+  Storage.remove(manifestPath.c_str());
+  LOG_DBG("RUP", "Upload of %s complete (%u bytes)", targetPath.c_str(), totalSize);
+  reset();
+  return true;
+}
+
+void ResumableUpload::suspend() {
+  if (!active) {
+    return;
+  }
+  // A chunk cut short is not part of the received range; resuming cuts it off the partial file
+  chunkOpen = false;
+  if (writer.isOpen() && writer.close()) {
+    checkpointed = received;
+  } else {
+    received = checkpointed;
+  }
+  saveManifest();
+  LOG_DBG("RUP", "Suspended %s at %u of %u bytes", targetPath.c_str(), received, totalSize);
+  reset();
+}
+
+void ResumableUpload::discard() {
+  if (!active) {
+    return;
+  }
+  chunkOpen = false;
+  if (writer.isOpen()) {
+    writer.abort();
+  }
+  Storage.remove(partPath.c_str());
+  Storage.remove(manifestPath.c_str());
+  reset();
+}
+
+uint32_t ResumableUpload::resumeOffset(const std::string& targetPath, const std::string& id, const uint32_t totalSize) {
+  return resumableBytes(uploadBasePath(targetPath), targetPath, id, totalSize);
+}
+
+bool ResumableUpload::checkpoint() {
+  if (!writer.flush() || !saveManifest()) {
+    return false;
+  }
+  checkpointed = received;
+  return true;
+}
+
+bool ResumableUpload::saveManifest() const {
+  BufferedFile file;
+  if (!file.openForWrite("RUP", manifestPath)) {
+    return false;
+  }
+  serialization::writePod(file, UPLOAD_MANIFEST_VERSION);
+  serialization::writeString(file, targetPath);
+  serialization::writeString(file, id);
+  serialization::writePod(file, totalSize);
+  serialization::writePod(file, received);
+  serialization::writePod(file, nextSequence());
+  file.close();
+  return true;
+}
+
+void ResumableUpload::reset() {
+  active = false;
+  chunkOpen = false;
+  targetPath.clear();
+  id.clear();
+  partPath.clear();
+  manifestPath.clear();
+  totalSize = 0;
+  received = 0;
+  checkpointed = 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "UploadWriter.h"
+
+/*
+An upload that survives a dropped connection. The data goes to a partial file in /.crosspoint/uploads, and a manifest
+next to it records the target path, the client's id for the file, the total size and the range received so far: bytes
+0 to received, checked and on the card. A client that reconnects asks for that offset and sends the rest. When the last
+byte is in, the partial file is moved into place.
+
+Each chunk carries the CRC-32 of its data, so a chunk corrupted on the way is sent again, instead of the damage being
+found (or not) once the whole file is in. Chunks must arrive in order, which keeps the received range a single prefix
+of the file.
+
+The manifest is updated every CHECKPOINT_BYTES and when the connection drops, after flushing the partial file, so it
+never claims data that isn't on the card. After a power cut the upload resumes from the last checkpoint.
+*/
+class ResumableUpload {
+ public:
+  static constexpr uint32_t CHECKPOINT_BYTES = 256 * 1024;
+  // Interrupted uploads kept for resuming; starting a new one beyond this removes the least recently written
+  static constexpr size_t MAX_PARTIAL_UPLOADS = 4;
+  static constexpr size_t MAX_ID_LENGTH = 64;
+
+  enum class ChunkResult {
+    Written,
+    Rejected,  // Not the next offset, or the CRC didn't match: nothing was written, send again from getReceived()
+    Failed,    // SD card error: the upload can't continue
+  };
+
+  explicit ResumableUpload(UploadWriter& writer) : writer(writer) {}
+  ~ResumableUpload() { suspend(); }
+  ResumableUpload(const ResumableUpload&) = delete;
+  ResumableUpload& operator=(const ResumableUpload&) = delete;
+
+  // Start or continue the upload of totalSize bytes to targetPath. It continues from the partial file when its
+  // manifest has the same id and size, and starts over otherwise. False if the partial file can't be opened.
+  bool begin(const std::string& targetPath, const std::string& id, uint32_t totalSize);
+  bool isActive() const { return active; }
+  const std::string& getTargetPath() const { return targetPath; }
+  uint32_t getReceived() const { return received; }
+  uint32_t getTotalSize() const { return totalSize; }
+  bool isComplete() const { return active && received == totalSize; }
+
+  // A chunk in one piece (a WebSocket frame), checked before it is written
+  ChunkResult addChunk(uint32_t offset, const uint8_t* data, size_t length, uint32_t crc);
+
+  // A chunk that arrives in pieces (an HTTP request body): it is written as it comes and cut off the partial file
+  // again if the CRC doesn't match at the end
+  bool beginChunk(uint32_t offset);
+  bool appendChunk(const uint8_t* data, size_t length);
+  ChunkResult endChunk(uint32_t crc);
+
+  // All data is in: close the partial file and move it to the target path
+  bool finish();
+  // The connection is gone: keep what was received for a later begin() with the same id
+  void suspend();
+  // Give up on the upload and remove its partial file
+  void discard();
+
+  // Where an upload of this file would continue, without starting it (0 if there is nothing to continue)
+  static uint32_t resumeOffset(const std::string& targetPath, const std::string& id, uint32_t totalSize);
+
+ private:
+  UploadWriter& writer;
+  bool active = false;
+  std::string targetPath;
+  std::string id;
+  std::string partPath;
+  std::string manifestPath;
+  uint32_t totalSize = 0;
+  uint32_t received = 0;
+  uint32_t checkpointed = 0;
+  // Chunk arriving in pieces
+  bool chunkOpen = false;
+  bool chunkOverflow = false;
+  uint32_t chunkLength = 0;
+  uint32_t chunkCrc = 0;
+
+  bool checkpoint();
+  bool saveManifest() const;
+  void reset();
+};
@@ -0,0 +1,279 @@
+#include "UploadWriter.h"
+
+#include <Arduino.h>
+#include <Logging.h>
+#include <esp_task_wdt.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+UploadWriter::~UploadWriter() {
+  if (fileOpen) {
+    abort();
+  }
+  stopTask();
+  freeBuffers();
+}
+
+bool UploadWriter::open(const std::string& filePath, const size_t resumeAt) {
+  if (fileOpen) {
+    abort();
+  }
+  path = filePath;
+  stats = {};
+  failed = false;
+  writeMs = 0;
+  writes = 0;
+  current = STOP_INDEX;
+  currentLength = 0;
+
+  // Removing and creating can be slow due to FAT cluster allocation
+  esp_task_wdt_reset();
+  if (resumeAt > 0) {
+    file = Storage.open(path.c_str(), O_RDWR);
+    if (!file || file.size() < resumeAt || !file.truncate(resumeAt) || !file.seekEnd()) {
+      LOG_ERR("UPW", "Can't resume %s at %zu", path.c_str(), resumeAt);
+      if (file) file.close();
+      return false;
+    }
+  } else {
+    if (Storage.exists(path.c_str())) {
+      LOG_DBG("UPW", "Overwriting existing file: %s", path.c_str());
+      Storage.remove(path.c_str());
+    }
+    esp_task_wdt_reset();
+    if (!Storage.openFileForWrite("UPW", path, file)) {
+      return false;
+    }
+  }
+  esp_task_wdt_reset();
+
+  if (!startTask()) {
+    LOG_DBG("UPW", "Writer task unavailable (heap %lu), writing synchronously",
+            static_cast<unsigned long>(ESP.getMaxAllocHeap()));
+  }
+  if (!buffers[0]) {
+    LOG_ERR("UPW", "No memory for an upload buffer");
+    file.close();
+    if (resumeAt == 0) {
+      Storage.remove(path.c_str());
+    }
+    return false;
+  }
+  fileOpen = true;
+  return true;
+}
+
+bool UploadWriter::write(const uint8_t* data, size_t length) {
+  if (!fileOpen || failed) {
+    return false;
+  }
+  stats.bytes += length;
+  while (length > 0) {
+    if (current == STOP_INDEX && !takeFreeBuffer()) {
+      return false;
+    }
+    const size_t toCopy = std::min(length, BUFFER_SIZE - currentLength);
+    memcpy(buffers[current] + currentLength, data, toCopy);
+    currentLength += toCopy;
+    data += toCopy;
+    length -= toCopy;
+    if (currentLength == BUFFER_SIZE) {
+      submitCurrent();
+    }
+  }
+  return !failed;
+}
+
+bool UploadWriter::close() {
+  if (!fileOpen) {
+    return false;
+  }
+  if (currentLength > 0) {
+    submitCurrent();
+  }
+  drain();
+  stopTask();
+  freeBuffers();
+  esp_task_wdt_reset();
+  file.close();
+  fileOpen = false;
+  stats.writes = writes;
+  stats.writeMs = writeMs;
+  return !failed;
+}
+
+void UploadWriter::abort() {
+  if (!fileOpen) {
+    return;
+  }
+  currentLength = 0;
+  failed = true;  // The writer task skips whatever is still queued
+  drain();
+  stopTask();
+  freeBuffers();
+  file.close();
+  fileOpen = false;
+  Storage.remove(path.c_str());
+  LOG_DBG("UPW", "Removed incomplete upload: %s", path.c_str());
+}
+
+void UploadWriter::drain() {
+  while (inFlight.load() > 0) {
+    esp_task_wdt_reset();
+    vTaskDelay(1);
+  }
+}
+
+bool UploadWriter::flush() {
+  if (!fileOpen) {
+    return false;
+  }
+  if (currentLength > 0) {
+    submitCurrent();
+  }
+  drain();
+  esp_task_wdt_reset();
+  file.flush();
+  return !failed;
+}
+
+bool UploadWriter::takeFreeBuffer() {
+  if (!async()) {
+    current = 0;
+    return true;
+  }
+  const unsigned long start = millis();
+  Chunk chunk;
+  while (xQueueReceive(freeQueue, &chunk, pdMS_TO_TICKS(100)) != pdTRUE) {
+    // Backpressure: the card is behind the network. TCP flow control holds the sender back meanwhile.
+    esp_task_wdt_reset();
+    if (millis() - start >= STALL_TIMEOUT_MS) {
+      LOG_ERR("UPW", "SD card stalled for %lu ms, giving up on %s", millis() - start, path.c_str());
+      failed = true;
+      return false;
+    }
+  }
+  stats.stallMs += millis() - start;
+  current = chunk.index;
+  currentLength = 0;
+  return true;
+}
+
+void UploadWriter::submitCurrent() {
+  if (!async()) {
+    // Synchronous fallback: write here, on the network task
+    esp_task_wdt_reset();
+    const unsigned long start = millis();
+    const size_t written = file.write(buffers[0], currentLength);
+    writeMs += millis() - start;
+    ++writes;
+    esp_task_wdt_reset();
+    if (written != currentLength) {
+      LOG_ERR("UPW", "Write failed: expected %zu, wrote %zu", currentLength, written);
+      failed = true;
+    }
+    currentLength = 0;
+    current = STOP_INDEX;
+    return;
+  }
+  const Chunk chunk{current, static_cast<uint16_t>(currentLength)};
+  ++inFlight;
+  // The queue holds every buffer, so this never waits
+  xQueueSend(filledQueue, &chunk, portMAX_DELAY);
+  current = STOP_INDEX;
+  currentLength = 0;
+}
+
+bool UploadWriter::startTask() {
+  for (auto& buffer : buffers) {
+    if (!buffer) {
+      buffer = static_cast<uint8_t*>(malloc(BUFFER_SIZE));
+    }
+  }
+  filledQueue = xQueueCreate(BUFFER_COUNT + 1, sizeof(Chunk));
+  freeQueue = xQueueCreate(BUFFER_COUNT + 1, sizeof(Chunk));
+  const bool allocated = std::all_of(std::begin(buffers), std::end(buffers), [](const uint8_t* b) { return b; });
+  if (allocated && filledQueue && freeQueue) {
+    xTaskCreate(&taskTrampoline, "UploadWriter",
+                4096,         // Stack size
+                this,         // Parameters
+                1,            // Priority: same as the network loop, so they share the CPU while both have work
+                &taskHandle   // Task handle
+    );
+  }
+  if (!taskHandle) {
+    stopTask();
+    // One buffer is enough to write synchronously
+    for (uint8_t i = 1; i < BUFFER_COUNT; i++) {
+      free(buffers[i]);
+      buffers[i] = nullptr;
+    }
+    return false;
+  }
+  for (uint8_t i = 0; i < BUFFER_COUNT; i++) {
+    const Chunk chunk{i, 0};
+    xQueueSend(freeQueue, &chunk, 0);
+  }
+  return true;
+}
+
+void UploadWriter::stopTask() {
+  if (taskHandle) {
+    // The task sends the stop chunk back just before it deletes itself
+    const Chunk stop{STOP_INDEX, 0};
+    xQueueSend(filledQueue, &stop, portMAX_DELAY);
+    Chunk chunk;
+    do {
+      xQueueReceive(freeQueue, &chunk, portMAX_DELAY);
+    } while (chunk.index != STOP_INDEX);
+    taskHandle = nullptr;
+  }
+  if (filledQueue) {
+    vQueueDelete(filledQueue);
+    filledQueue = nullptr;
+  }
+  if (freeQueue) {
+    vQueueDelete(freeQueue);
+    freeQueue = nullptr;
+  }
+}
+
+void UploadWriter::freeBuffers() {
+  for (auto& buffer : buffers) {
+    free(buffer);
+    buffer = nullptr;
+  }
+  current = STOP_INDEX;
+  currentLength = 0;
+}
+
+void UploadWriter::taskTrampoline(void* param) {
+  auto* self = static_cast<UploadWriter*>(param);
+  self->taskLoop();
+  vTaskDelete(nullptr);
+}
+
+void UploadWriter::taskLoop() {
+  Chunk chunk;
+  while (true) {
+    xQueueReceive(filledQueue, &chunk, portMAX_DELAY);
+    if (chunk.index == STOP_INDEX) {
+      xQueueSend(freeQueue, &chunk, portMAX_DELAY);
+      return;
+    }
+    if (!failed) {
+      const unsigned long start = millis();
+      const size_t written = file.write(buffers[chunk.index], chunk.length);
+      writeMs += millis() - start;
+      ++writes;
+      if (written != chunk.length) {
+        LOG_ERR("UPW", "Write failed: expected %u, wrote %zu", chunk.length, written);
+        failed = true;
+      }
+    }
+    --inFlight;
+    xQueueSend(freeQueue, &chunk, portMAX_DELAY);
+  }
+}
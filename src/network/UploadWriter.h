@@ -0,0 +1,98 @@
+#pragma once
+
+#include <HalStorage.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+Writes an upload (or an HTTP download) to the SD card from its own task, so receiving the next data from the network
+overlaps with writing the last to the card. An SD write stall no longer stops TCP receive straight away, only once every
+buffer is full.
+
+The network side copies data into one of BUFFER_COUNT buffers and hands it to the writer task when it is full. When
+none is free, write() waits for one (backpressure), giving up after STALL_TIMEOUT_MS. After a failed write, the
+writer discards everything queued behind it and write()/close() return false, so the caller can report the error.
+
+The card is not shared between tasks: the writer only runs while buffers are queued. Anything else on the network
+task that touches the card calls drain() first, which also happens in open(), close() and abort().
+
+If the buffers or the task can't be allocated, the upload is written synchronously through one buffer, as before.
+*/
+class UploadWriter {
+ public:
+  static constexpr size_t BUFFER_SIZE = 8 * 1024;
+  static constexpr uint8_t BUFFER_COUNT = 4;
+  static constexpr unsigned long STALL_TIMEOUT_MS = 10000;
+
+  struct Stats {
+    size_t bytes = 0;
+    size_t writes = 0;
+    unsigned long writeMs = 0;  // Spent in SD writes, on the writer task
+    unsigned long stallMs = 0;  // The network side spent waiting for a free buffer
+  };
+
+  UploadWriter() = default;
+  ~UploadWriter();
+  UploadWriter(const UploadWriter&) = delete;
+  UploadWriter& operator=(const UploadWriter&) = delete;
+
+  // Create path (replacing any file there) and start an upload to it. With resumeAt, the file is kept, cut back to
+  // resumeAt bytes and written from there on.
+  bool open(const std::string& path, size_t resumeAt = 0);
+  bool isOpen() const { return fileOpen; }
+  // False once anything failed to reach the card; the rest of the upload is dropped
+  bool write(const uint8_t* data, size_t length);
+  // Write what is left and close the file. False if any write failed.
+  bool close();
+  // Close and remove the partial file
+  void abort();
+  // Wait until every queued buffer is on the card
+  void drain();
+  // Write everything so far, including a partly filled buffer, and flush the file. False if any write failed.
+  bool flush();
+
+  const std::string& getPath() const { return path; }
+  const Stats& getStats() const { return stats; }
+
+ private:
+  struct Chunk {
+    uint8_t index;
+    uint16_t length;  // 0 with STOP_INDEX tells the task to exit
+  };
+  static constexpr uint8_t STOP_INDEX = 0xFF;
+
+  FsFile file;
+  std::string path;
+  bool fileOpen = false;
+  Stats stats;
+
+  uint8_t* buffers[BUFFER_COUNT] = {};
+  uint8_t current = STOP_INDEX;  // Buffer being filled, STOP_INDEX if none
+  size_t currentLength = 0;
+  QueueHandle_t filledQueue = nullptr;  // Network -> writer
+  QueueHandle_t freeQueue = nullptr;    // Writer -> network
+  TaskHandle_t taskHandle = nullptr;
+  std::atomic<int> inFlight{0};
+  std::atomic<bool> failed{false};
+  std::atomic<unsigned long> writeMs{0};
+  std::atomic<size_t> writes{0};
+
+  // Allocate the buffers, queues and task for one upload; false leaves the writer synchronous (one buffer, if any)
+  bool startTask();
+  void stopTask();
+  bool async() const { return taskHandle != nullptr; }
+  void freeBuffers();
+  // Hand the current buffer to the writer task (or write it here in synchronous mode)
+  void submitCurrent();
+  bool takeFreeBuffer();
+
+  static void taskTrampoline(void* param);
+  // Returns when it gets the stop chunk
+  void taskLoop();
+};
@@ -1,10 +1,15 @@
 // --- HIGHLIGHT MODE ---
 #include "HighlightStore.h"
 
+#include <BufferedFile.h>
 #include <GfxRenderer.h>
 #include <Logging.h>
+#include <Serialization.h>
 
 #include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <tuple>
 
 #include "StringUtils.h"
 
@@ -214,120 +219,22 @@ static std::string bookFilePath(const std::string& title) {
 static constexpr const char* HIGHLIGHT_DELIM_OLD = "=== HIGHLIGHT ===";
 static constexpr const char* HIGHLIGHT_DELIM_PREFIX = "=== HIGHLIGHT [";
 
-bool saveHighlight(const std::string& title, const std::string& author, int spineIndex, const std::string& chapterName,
-                   int startPage, int endPage, int totalPages, float progressPercent,
-                   const std::string& highlightedText, const std::vector<std::string>& imagePaths) {
-  if (!ensureDir()) {
-    LOG_ERR("HLS", "Failed to create highlights directory");
-    return false;
-  }
-
-  std::string filePath = bookFilePath(title);
-
-  // Chapter display: use TOC name if available, else "Chapter N"
-  String chapterDisplay;
-  if (!chapterName.empty()) {
-    chapterDisplay = chapterName.c_str();
-  } else {
-    chapterDisplay = "Chapter ";
-    chapterDisplay += String(spineIndex);
-  }
-
-  // Build the new highlight block — human-readable format
-  // Internal ref is embedded in the delimiter line for parser use (not visually prominent)
-  String newBlock;
-  newBlock += "=== HIGHLIGHT [";
-  newBlock += String(spineIndex);
-  newBlock += ".";
-  newBlock += String(startPage);
-  newBlock += "-";
-  newBlock += String(endPage);
-  newBlock += "] ===\n";
-  newBlock += chapterDisplay;
-  newBlock += " | Page ";
-  newBlock += String(startPage + 1);
-  if (endPage != startPage) {
-    newBlock += "-";
-    newBlock += String(endPage + 1);
-  }
-  newBlock += " / ";
-  newBlock += String(totalPages);
-  newBlock += " | ";
-  newBlock += String(static_cast<int>(progressPercent + 0.5f));
-  newBlock += "%\n";
-  newBlock += "\n";
-  newBlock += highlightedText.c_str();
-  newBlock += "\n\n";
-
-  // Read existing file (if any) and append; otherwise write book header + first highlight
-  String existing = Storage.readFile(filePath.c_str());
-  String content;
-
-  if (existing.length() == 0) {
-    // First highlight for this book — write header
-    content += "Book: ";
-    content += title.c_str();
-    content += "\n";
-    content += "Author: ";
-    content += author.c_str();
-    content += "\n\n";
-  } else {
-    content = existing;
-  }
-
-  content += newBlock;
-
-  if (!Storage.writeFile(filePath.c_str(), content)) {
-    LOG_ERR("HLS", "Failed to write highlight to %s", filePath.c_str());
-    return false;
-  }
-
-  LOG_DBG("HLS", "Highlight appended to %s (%d bytes total)", filePath.c_str(), content.length());
-
-  // Copy any images from an image-page highlight to /highlights/images/
-  // Uses a predictable filename: {sanitizedTitle}-s{spine}-p{startPage}-img{N}.{ext}
-  if (!imagePaths.empty()) {
-    if (!ensureImagesDir()) {
-      LOG_ERR("HLS", "Failed to create highlighted images directory");
-    } else {
-      std::string baseName = StringUtils::sanitizeFilename(title, 30);
-      int imgIdx = 0;
-      for (const auto& srcPath : imagePaths) {
-        // Preserve original file extension
-        std::string ext;
-        size_t dotPos = srcPath.rfind('.');
-        if (dotPos != std::string::npos) ext = srcPath.substr(dotPos);  // includes "."
-
-        char destName[128];
-        snprintf(destName, sizeof(destName), "%s/%s-s%d-p%d-img%d%s", HIGHLIGHT_IMAGES_DIR, baseName.c_str(),
-                 spineIndex, startPage, imgIdx, ext.c_str());
-        if (copyFile(srcPath.c_str(), destName)) {
-          LOG_DBG("HLS", "Saved highlighted image: %s", destName);
-        } else {
-          LOG_ERR("HLS", "Failed to copy image %s -> %s", srcPath.c_str(), destName);
-        }
-        imgIdx++;
-      }
-    }
-  }
-
-  return true;
-}
-
-std::vector<SavedHighlight> loadHighlightsForPage(const std::string& title, int spineIndex, int page) {
-  std::vector<SavedHighlight> results;
-
-  std::string filePath = bookFilePath(title);
-  String raw = Storage.readFile(filePath.c_str());
-  if (raw.length() == 0) {
-    return results;
-  }
-
-  std::string content(raw.c_str());
+// One highlight block of the text file
+struct ParsedBlock {
+  int spineIndex = -1;
+  int startPage = -1;
+  int endPage = -1;
+  std::string display;  // "Chapter | Page X / N | P%" line
+  std::string text;
+};
+
+// Split the human-readable highlights file into its blocks (old and new delimiter formats).
+// Returns the preamble before the first block (the "Book:" / "Author:" header).
+static std::string parseTextFile(const std::string& content, std::vector<ParsedBlock>& blocks) {
   const std::string delimPrefix = std::string(HIGHLIGHT_DELIM_PREFIX);
   const std::string delimOld = std::string(HIGHLIGHT_DELIM_OLD) + "\n";
+  std::string preamble;
 
-  // Split content on highlight delimiter lines (supports old and new format)
   size_t searchPos = 0;
   while (true) {
     // Find next highlight block — try new format first, then old
@@ -345,6 +252,7 @@ std::vector<SavedHighlight> loadHighlightsForPage(const std::string& title, int
       isNewFormat = (delimPos <= delimOldPos);
       if (!isNewFormat) delimPos = delimOldPos;
     }
+    if (searchPos == 0) preamble = content.substr(0, delimPos);
 
     // Find end of delimiter line
     size_t delimLineEnd = content.find('\n', delimPos);
@@ -363,10 +271,7 @@ std::vector<SavedHighlight> loadHighlightsForPage(const std::string& title, int
 
     searchPos = blockStart;
 
-    int parsedSpine = -1;
-    int parsedStartPage = -1;
-    int parsedEndPage = -1;
-    std::string parsedText;
+    ParsedBlock parsed;
     bool inText = false;
 
     // New format: parse ref from delimiter line "=== HIGHLIGHT [N.S-E] ==="
@@ -377,21 +282,20 @@ std::vector<SavedHighlight> loadHighlightsForPage(const std::string& title, int
         std::string ref = content.substr(bracketStart + 1, bracketEnd - bracketStart - 1);
         size_t dotPos = ref.find('.');
         if (dotPos != std::string::npos) {
-          parsedSpine = atoi(ref.substr(0, dotPos).c_str());
+          parsed.spineIndex = atoi(ref.substr(0, dotPos).c_str());
           size_t dashPos = ref.find('-', dotPos + 1);
           if (dashPos != std::string::npos) {
-            parsedStartPage = atoi(ref.substr(dotPos + 1, dashPos - dotPos - 1).c_str());
-            parsedEndPage = atoi(ref.substr(dashPos + 1).c_str());
+            parsed.startPage = atoi(ref.substr(dotPos + 1, dashPos - dotPos - 1).c_str());
+            parsed.endPage = atoi(ref.substr(dashPos + 1).c_str());
           } else {
-            parsedStartPage = atoi(ref.substr(dotPos + 1).c_str());
-            parsedEndPage = parsedStartPage;
+            parsed.startPage = atoi(ref.substr(dotPos + 1).c_str());
+            parsed.endPage = parsed.startPage;
           }
         }
       }
     }
 
     size_t pos = 0;
-    int headerLinesRead = 0;
     while (pos < block.size()) {
       size_t eol = block.find('\n', pos);
       if (eol == std::string::npos) eol = block.size();
@@ -402,61 +306,457 @@ std::vector<SavedHighlight> loadHighlightsForPage(const std::string& title, int
       if (!isNewFormat && line.rfind("Ref: ", 0) == 0) {
         size_t dotPos = line.find('.', 5);
         if (dotPos != std::string::npos) {
-          parsedSpine = atoi(line.substr(5, dotPos - 5).c_str());
+          parsed.spineIndex = atoi(line.substr(5, dotPos - 5).c_str());
           size_t dashPos = line.find('-', dotPos + 1);
           if (dashPos != std::string::npos) {
-            parsedStartPage = atoi(line.substr(dotPos + 1, dashPos - dotPos - 1).c_str());
-            parsedEndPage = atoi(line.substr(dashPos + 1).c_str());
+            parsed.startPage = atoi(line.substr(dotPos + 1, dashPos - dotPos - 1).c_str());
+            parsed.endPage = atoi(line.substr(dashPos + 1).c_str());
           } else {
-            parsedStartPage = atoi(line.substr(dotPos + 1).c_str());
-            parsedEndPage = parsedStartPage;
+            parsed.startPage = atoi(line.substr(dotPos + 1).c_str());
+            parsed.endPage = parsed.startPage;
           }
         }
-        headerLinesRead++;
         continue;
       }
 
-      // The display line (chapter | page | progress) — skip for parsing
+      // The display line (chapter | page | progress)
       if (!inText && line.find(" | Page ") != std::string::npos) {
-        headerLinesRead++;
+        parsed.display = line;
         continue;
       }
 
       // Blank line after header signals start of text
-      if (!inText && line.empty() && headerLinesRead >= 0) {
+      if (!inText && line.empty()) {
         inText = true;
         continue;
       }
 
       if (inText) {
-        if (!parsedText.empty()) parsedText += '\n';
-        parsedText += line;
+        if (!parsed.text.empty()) parsed.text += '\n';
+        parsed.text += line;
       }
     }
 
-    // Match on spine index only — don't filter by page number. Font size or layout
-    // changes reflow text to different pages, so the saved page numbers may be stale.
-    // The caller uses findHighlightBounds() to check if the text actually appears on
-    // the current page, so returning extra candidates here is safe.
-    if (parsedSpine == spineIndex) {
-      // Trim trailing whitespace/newlines from text
-      while (!parsedText.empty() && (parsedText.back() == '\n' || parsedText.back() == ' ')) {
-        parsedText.pop_back();
+    // Trim trailing whitespace/newlines from text
+    while (!parsed.text.empty() && (parsed.text.back() == '\n' || parsed.text.back() == ' ')) {
+      parsed.text.pop_back();
+    }
+    if (parsed.spineIndex >= 0) {
+      blocks.push_back(std::move(parsed));
+    }
+  }
+
+  if (blocks.empty()) preamble = content;
+  return preamble;
+}
+
+// --- Binary index ---
+// /.crosspoint/highlights/<title>.idx is an append-only log of the book's highlights:
+//   header: uint8 version, uint32 exportedRecords, uint32 exportedTextSize, string preamble
+//   record: uint8 op, int16 spine, int16 startPage, int16 endPage, then for ADD: string text, string display
+// It is replayed once when a book's highlights are first needed, leaving a table of live highlights sorted by
+// (spine, startPage, endPage) in memory. A page lookup is then a binary search plus one read per match, and saving
+// or deleting appends a single record. The .txt in /highlights is regenerated from the log by exportIfDirty();
+// exportedRecords/exportedTextSize describe what that export covered, so a .txt edited on a computer is imported
+// again instead of being overwritten.
+
+static constexpr const char* HIGHLIGHT_INDEX_DIR = "/.crosspoint/highlights";
+static constexpr uint8_t INDEX_VERSION = 1;
+static constexpr uint32_t INDEX_EXPORT_STATE_OFFSET = sizeof(uint8_t);
+static constexpr uint32_t INDEX_HEADER_FIXED_SIZE = sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint32_t);
+static constexpr uint32_t INDEX_RECORD_KEY_SIZE = sizeof(uint8_t) + 3 * sizeof(int16_t);
+static constexpr uint8_t INDEX_OP_ADD = 1;
+static constexpr uint8_t INDEX_OP_DELETE = 2;
+// Export compacts the log once it holds at least this many dead records and they outnumber the live ones
+static constexpr uint32_t INDEX_COMPACT_MIN_DEAD = 32;
+
+struct IndexEntry {
+  int16_t spineIndex;
+  int16_t startPage;
+  int16_t endPage;
+  uint32_t seq;     // Record number in the log, so exports keep the order the highlights were made in
+  uint32_t offset;  // File offset of the entry's text (its display line follows)
+
+  bool operator<(const IndexEntry& other) const {
+    return std::tie(spineIndex, startPage, endPage, seq) <
+           std::tie(other.spineIndex, other.startPage, other.endPage, other.seq);
+  }
+};
+
+// Index of the book whose highlights were last touched (the one open in the reader)
+struct LoadedIndex {
+  bool loaded = false;
+  std::string title;
+  std::vector<IndexEntry> entries;  // Live highlights, sorted
+  uint32_t records = 0;             // ADD and DELETE records in the log
+  uint32_t size = 0;                // Log length in bytes, 0 if there is no log yet
+  uint32_t exportedRecords = 0;
+  uint32_t exportedTextSize = 0;
+};
+static LoadedIndex loadedIndex;
+
+static std::string indexFilePath(const std::string& title) {
+  return std::string(HIGHLIGHT_INDEX_DIR) + "/" + StringUtils::sanitizeFilename(title, 40) + ".idx";
+}
+
+static uint32_t fileSizeOf(const std::string& path) {
+  if (!Storage.exists(path.c_str())) return 0;
+  FsFile file;
+  if (!Storage.openFileForRead("HLS", path, file)) return 0;
+  const uint32_t size = file.size();
+  file.close();
+  return size;
+}
+
+static std::string encodeHeader(const uint32_t exportedRecords, const uint32_t exportedTextSize,
+                                const std::string& preamble) {
+  std::ostringstream out;
+  serialization::writePod(out, INDEX_VERSION);
+  serialization::writePod(out, exportedRecords);
+  serialization::writePod(out, exportedTextSize);
+  serialization::writeString(out, preamble);
+  return out.str();
+}
+
+static std::string encodeRecord(const uint8_t op, const int spineIndex, const int startPage, const int endPage,
+                                const std::string& text = "", const std::string& display = "") {
+  std::ostringstream out;
+  serialization::writePod(out, op);
+  serialization::writePod(out, static_cast<int16_t>(spineIndex));
+  serialization::writePod(out, static_cast<int16_t>(startPage));
+  serialization::writePod(out, static_cast<int16_t>(endPage));
+  if (op == INDEX_OP_ADD) {
+    serialization::writeString(out, text);
+    serialization::writeString(out, display);
+  }
+  return out.str();
+}
+
+// Append encoded bytes to the log in one write and update the in-memory size. A short write is cut off again, so
+// the next append doesn't land after a partial record that a later replay would stop at.
+static bool appendToIndex(const std::string& path, const std::string& bytes) {
+  if (!Storage.ensureDirectoryExists(HIGHLIGHT_INDEX_DIR)) return false;
+  FsFile file = Storage.open(path.c_str(), O_RDWR | O_CREAT | O_AT_END);
+  if (!file) {
+    LOG_ERR("HLS", "Failed to open %s for append", path.c_str());
+    return false;
+  }
+  const size_t written = file.write(bytes.data(), bytes.size());
+  if (written != bytes.size()) {
+    LOG_ERR("HLS", "Short append to %s: %zu of %zu bytes", path.c_str(), written, bytes.size());
+    if (!file.truncate(loadedIndex.size)) {
+      // Replay before the next append: it trims the partial record (or re-imports over a partial header)
+      LOG_ERR("HLS", "Failed to trim %s back to %lu bytes", path.c_str(), static_cast<unsigned long>(loadedIndex.size));
+      loadedIndex.loaded = false;
+    }
+    file.close();
+    return false;
+  }
+  file.close();
+  loadedIndex.size += bytes.size();
+  return true;
+}
+
+// Rebuild the in-memory table from the log. A torn record at the end (power lost mid-append) is cut off.
+static bool replayIndex(const std::string& path) {
+  BufferedFile file;
+  if (!file.openForRead("HLS", path)) return false;
+  const uint32_t size = file.size();
+
+  uint8_t version = 0;
+  uint32_t preambleLen = 0;
+  serialization::readPod(file, version);
+  serialization::readPod(file, loadedIndex.exportedRecords);
+  serialization::readPod(file, loadedIndex.exportedTextSize);
+  serialization::readPod(file, preambleLen);
+  if (version != INDEX_VERSION || size < INDEX_HEADER_FIXED_SIZE + sizeof(uint32_t) ||
+      preambleLen > size - INDEX_HEADER_FIXED_SIZE - sizeof(uint32_t)) {
+    LOG_ERR("HLS", "Unusable highlight index %s (version %u)", path.c_str(), version);
+    return false;
+  }
+  file.seek(file.position() + preambleLen);
+
+  loadedIndex.entries.clear();
+  loadedIndex.records = 0;
+  uint32_t goodEnd = file.position();
+  while (size - goodEnd >= INDEX_RECORD_KEY_SIZE) {
+    uint8_t op;
+    int16_t spineIndex, startPage, endPage;
+    serialization::readPod(file, op);
+    serialization::readPod(file, spineIndex);
+    serialization::readPod(file, startPage);
+    serialization::readPod(file, endPage);
+
+    if (op == INDEX_OP_ADD) {
+      const uint32_t offset = file.position();
+      bool complete = true;
+      for (int field = 0; field < 2 && complete; field++) {
+        uint32_t len = 0;
+        complete = size - file.position() >= sizeof(len);
+        if (complete) {
+          serialization::readPod(file, len);
+          complete = len <= size - file.position();
+          file.seek(file.position() + len);
+        }
       }
-      if (!parsedText.empty()) {
-        SavedHighlight hl;
-        hl.spineIndex = parsedSpine;
-        hl.startPage = parsedStartPage;
-        hl.endPage = parsedEndPage;
-        hl.text = parsedText;
-        results.push_back(hl);
+      if (!complete) break;
+      loadedIndex.entries.push_back({spineIndex, startPage, endPage, loadedIndex.records, offset});
+    } else if (op == INDEX_OP_DELETE) {
+      // Deletes always remove the oldest live highlight with that ref
+      const auto it = std::find_if(loadedIndex.entries.begin(), loadedIndex.entries.end(), [&](const IndexEntry& e) {
+        return e.spineIndex == spineIndex && e.startPage == startPage && e.endPage == endPage;
+      });
+      if (it != loadedIndex.entries.end()) loadedIndex.entries.erase(it);
+    } else {
+      break;
+    }
+    loadedIndex.records++;
+    goodEnd = file.position();
+  }
+  file.close();
+
+  if (goodEnd != size) {
+    LOG_ERR("HLS", "Dropping %lu torn bytes at the end of %s", static_cast<unsigned long>(size - goodEnd),
+            path.c_str());
+    FsFile raw = Storage.open(path.c_str(), O_RDWR);
+    if (!raw || !raw.truncate(goodEnd)) return false;
+    raw.close();
+  }
+  loadedIndex.size = goodEnd;
+  std::sort(loadedIndex.entries.begin(), loadedIndex.entries.end());
+  return true;
+}
+
+// Replace the log with the contents of the text file (first use after upgrading, an edit made on a computer, or
+// compaction right after an export). No text file means no highlights.
+static bool importTextFile(const std::string& title, const uint32_t textSize) {
+  const std::string indexPath = indexFilePath(title);
+  if (Storage.exists(indexPath.c_str())) Storage.remove(indexPath.c_str());
+  loadedIndex.entries.clear();
+  loadedIndex.records = 0;
+  loadedIndex.size = 0;
+  loadedIndex.exportedRecords = 0;
+  loadedIndex.exportedTextSize = 0;
+  if (textSize == 0) return true;
+
+  std::vector<ParsedBlock> blocks;
+  std::string preamble;
+  {
+    String raw = Storage.readFile(bookFilePath(title).c_str());
+    preamble = parseTextFile(std::string(raw.c_str()), blocks);
+  }
+
+  if (!Storage.ensureDirectoryExists(HIGHLIGHT_INDEX_DIR)) return false;
+  BufferedFile file;
+  if (!file.openForWrite("HLS", indexPath)) return false;
+  const std::string header = encodeHeader(blocks.size(), textSize, preamble);
+  file.write(header.data(), header.size());
+  for (const auto& block : blocks) {
+    const std::string record =
+        encodeRecord(INDEX_OP_ADD, block.spineIndex, block.startPage, block.endPage, block.text, block.display);
+    file.write(record.data(), record.size());
+  }
+  if (!file.flush()) return false;
+  file.close();
+
+  LOG_DBG("HLS", "Indexed %d highlight(s) from %s", static_cast<int>(blocks.size()), bookFilePath(title).c_str());
+  return replayIndex(indexPath);
+}
+
+// Make `loadedIndex` describe `title`. Cheap when it already does.
+static bool loadIndex(const std::string& title) {
+  if (loadedIndex.loaded && loadedIndex.title == title) return true;
+  loadedIndex = LoadedIndex();
+  loadedIndex.title = title;
+
+  const std::string indexPath = indexFilePath(title);
+  const uint32_t textSize = fileSizeOf(bookFilePath(title));
+  bool ok = Storage.exists(indexPath.c_str()) && replayIndex(indexPath);
+  if (ok && loadedIndex.exportedRecords == loadedIndex.records && loadedIndex.exportedTextSize != textSize) {
+    LOG_DBG("HLS", "%s changed outside the reader, re-importing", bookFilePath(title).c_str());
+    ok = false;
+  }
+  if (!ok) {
+    ok = importTextFile(title, textSize);
+  }
+  loadedIndex.loaded = ok;
+  return ok;
+}
+
+bool saveHighlight(const std::string& title, const std::string& author, int spineIndex, const std::string& chapterName,
+                   int startPage, int endPage, int totalPages, float progressPercent,
+                   const std::string& highlightedText, const std::vector<std::string>& imagePaths) {
+  if (!ensureDir()) {
+    LOG_ERR("HLS", "Failed to create highlights directory");
+    return false;
+  }
+  if (!loadIndex(title)) {
+    LOG_ERR("HLS", "Failed to load highlight index for %s", title.c_str());
+    return false;
+  }
+
+  // Display line: "<chapter> | Page S[-E] / N | P%", chapter from the TOC if available, else "Chapter N"
+  std::string display = chapterName.empty() ? "Chapter " + std::to_string(spineIndex) : chapterName;
+  display += " | Page " + std::to_string(startPage + 1);
+  if (endPage != startPage) {
+    display += "-" + std::to_string(endPage + 1);
+  }
+  display += " / " + std::to_string(totalPages) + " | " + std::to_string(static_cast<int>(progressPercent + 0.5f)) +
+             "%";
+
+  std::string text = highlightedText;
+  while (!text.empty() && (text.back() == '\n' || text.back() == ' ')) {
+    text.pop_back();
+  }
+
+  // First highlight for this book starts the log with the text file's header
+  std::string bytes;
+  if (loadedIndex.size == 0) {
+    bytes = encodeHeader(0, 0, "Book: " + title + "\nAuthor: " + author + "\n\n");
+  }
+  const uint32_t textOffset = loadedIndex.size + bytes.size() + INDEX_RECORD_KEY_SIZE;
+  bytes += encodeRecord(INDEX_OP_ADD, spineIndex, startPage, endPage, text, display);
+
+  const std::string indexPath = indexFilePath(title);
+  if (!appendToIndex(indexPath, bytes)) {
+    LOG_ERR("HLS", "Failed to write highlight to %s", indexPath.c_str());
+    return false;
+  }
+  const IndexEntry entry{static_cast<int16_t>(spineIndex), static_cast<int16_t>(startPage),
+                         static_cast<int16_t>(endPage), loadedIndex.records++, textOffset};
+  loadedIndex.entries.insert(std::upper_bound(loadedIndex.entries.begin(), loadedIndex.entries.end(), entry), entry);
+
+  LOG_DBG("HLS", "Highlight %d.%d-%d appended to %s (%d total)", spineIndex, startPage, endPage, indexPath.c_str(),
+          static_cast<int>(loadedIndex.entries.size()));
+
+  // Copy any images from an image-page highlight to /highlights/images/
+  // Uses a predictable filename: {sanitizedTitle}-s{spine}-p{startPage}-img{N}.{ext}
+  if (!imagePaths.empty()) {
+    if (!ensureImagesDir()) {
+      LOG_ERR("HLS", "Failed to create highlighted images directory");
+    } else {
+      std::string baseName = StringUtils::sanitizeFilename(title, 30);
+      int imgIdx = 0;
+      for (const auto& srcPath : imagePaths) {
+        // Preserve original file extension
+        std::string ext;
+        size_t dotPos = srcPath.rfind('.');
+        if (dotPos != std::string::npos) ext = srcPath.substr(dotPos);  // includes "."
+
+        char destName[128];
+        snprintf(destName, sizeof(destName), "%s/%s-s%d-p%d-img%d%s", HIGHLIGHT_IMAGES_DIR, baseName.c_str(),
+                 spineIndex, startPage, imgIdx, ext.c_str());
+        if (copyFile(srcPath.c_str(), destName)) {
+          LOG_DBG("HLS", "Saved highlighted image: %s", destName);
+        } else {
+          LOG_ERR("HLS", "Failed to copy image %s -> %s", srcPath.c_str(), destName);
+        }
+        imgIdx++;
       }
     }
   }
 
+  return true;
+}
+
+std::vector<SavedHighlight> loadHighlightsForPage(const std::string& title, int spineIndex, int page) {
+  std::vector<SavedHighlight> results;
+  if (!loadIndex(title)) {
+    return results;
+  }
+
+  // Match on spine index only — don't filter by page number. Font size or layout
+  // changes reflow text to different pages, so the saved page numbers may be stale.
+  // The caller uses findHighlightBounds() to check if the text actually appears on
+  // the current page, so returning extra candidates here is safe.
+  const auto first = std::lower_bound(loadedIndex.entries.begin(), loadedIndex.entries.end(), spineIndex,
+                                      [](const IndexEntry& e, const int spine) { return e.spineIndex < spine; });
+  const auto last = std::upper_bound(first, loadedIndex.entries.end(), spineIndex,
+                                     [](const int spine, const IndexEntry& e) { return spine < e.spineIndex; });
+  if (first == last) {
+    return results;
+  }
+
+  BufferedFile file;
+  if (!file.openForRead("HLS", indexFilePath(title))) {
+    return results;
+  }
+  for (auto it = first; it != last; ++it) {
+    SavedHighlight hl;
+    hl.spineIndex = it->spineIndex;
+    hl.startPage = it->startPage;
+    hl.endPage = it->endPage;
+    file.seek(it->offset);
+    serialization::readString(file, hl.text);
+    if (!hl.text.empty()) {
+      results.push_back(std::move(hl));
+    }
+  }
   return results;
 }
 
+bool exportIfDirty(const std::string& title) {
+  if (!loadIndex(title)) return false;
+  if (loadedIndex.exportedRecords == loadedIndex.records) return true;
+  if (!ensureDir()) return false;
+
+  const std::string indexPath = indexFilePath(title);
+  const std::string textPath = bookFilePath(title);
+  BufferedFile in;
+  BufferedFile out;
+  if (!in.openForRead("HLS", indexPath) || !out.openForWrite("HLS", textPath)) {
+    LOG_ERR("HLS", "Failed to export highlights to %s", textPath.c_str());
+    return false;
+  }
+
+  std::string preamble, text, display;
+  in.seek(INDEX_HEADER_FIXED_SIZE);
+  serialization::readString(in, preamble);
+  out.write(preamble.data(), preamble.size());
+
+  // Same layout saveHighlight used to write directly, in the order the highlights were made
+  std::vector<IndexEntry> ordered = loadedIndex.entries;
+  std::sort(ordered.begin(), ordered.end(), [](const IndexEntry& a, const IndexEntry& b) { return a.seq < b.seq; });
+  for (const auto& entry : ordered) {
+    in.seek(entry.offset);
+    serialization::readString(in, text);
+    serialization::readString(in, display);
+    char delim[48];
+    snprintf(delim, sizeof(delim), "%s%d.%d-%d] ===\n", HIGHLIGHT_DELIM_PREFIX, entry.spineIndex, entry.startPage,
+             entry.endPage);
+    out.write(delim, strlen(delim));
+    out.write(display.data(), display.size());
+    out.write("\n\n", 2);
+    out.write(text.data(), text.size());
+    out.write("\n\n", 2);
+  }
+  in.close();
+  if (!out.flush()) {
+    LOG_ERR("HLS", "Failed to write %s", textPath.c_str());
+    return false;
+  }
+  const uint32_t textSize = out.size();
+  out.close();
+
+  FsFile header = Storage.open(indexPath.c_str(), O_RDWR);
+  if (!header || !header.seek(INDEX_EXPORT_STATE_OFFSET)) {
+    return false;
+  }
+  serialization::writePod(header, loadedIndex.records);
+  serialization::writePod(header, textSize);
+  header.close();
+  loadedIndex.exportedRecords = loadedIndex.records;
+  loadedIndex.exportedTextSize = textSize;
+  LOG_DBG("HLS", "Exported %d highlight(s) to %s", static_cast<int>(ordered.size()), textPath.c_str());
+
+  const uint32_t dead = loadedIndex.records - loadedIndex.entries.size();
+  if (dead >= INDEX_COMPACT_MIN_DEAD && dead > loadedIndex.entries.size()) {
+    LOG_DBG("HLS", "Compacting %s (%lu dead records)", indexPath.c_str(), static_cast<unsigned long>(dead));
+    loadedIndex.loaded = importTextFile(title, textSize);
+  }
+  return true;
+}
+
 bool findHighlightBounds(const Page& page, const std::string& text, HighlightPageRole role, int& outStartLine,
                          int& outStartChar, int& outEndLine, int& outEndChar) {
   auto lines = getTextLines(page);
@@ -580,65 +880,27 @@ bool findHighlightBounds(const Page& page, const std::string& text, HighlightPag
 }
 
 bool deleteHighlight(const std::string& title, int spineIndex, int startPage, int endPage) {
-  std::string filePath = bookFilePath(title);
-  String raw = Storage.readFile(filePath.c_str());
-  if (raw.length() == 0) return false;
-
-  std::string content(raw.c_str());
-
-  // Build ref patterns for both old and new format
-  char refNewBuf[64];
-  snprintf(refNewBuf, sizeof(refNewBuf), "[%d.%d-%d]", spineIndex, startPage, endPage);
-  const std::string refNew(refNewBuf);
-  char refOldBuf[64];
-  snprintf(refOldBuf, sizeof(refOldBuf), "Ref: %d.%d-%d\n", spineIndex, startPage, endPage);
-  const std::string refOld(refOldBuf);
-
-  // Scan for highlight blocks and remove the matching one
-  // Look for either delimiter format
-  size_t searchPos = 0;
-  while (true) {
-    size_t newPos = content.find(HIGHLIGHT_DELIM_PREFIX, searchPos);
-    size_t oldPos = content.find(std::string(HIGHLIGHT_DELIM_OLD) + "\n", searchPos);
-    size_t delimPos;
-    if (newPos == std::string::npos && oldPos == std::string::npos) break;
-    if (newPos == std::string::npos)
-      delimPos = oldPos;
-    else if (oldPos == std::string::npos)
-      delimPos = newPos;
-    else
-      delimPos = std::min(newPos, oldPos);
-
-    // Find end of this block (next delimiter of either type)
-    size_t delimLineEnd = content.find('\n', delimPos);
-    if (delimLineEnd == std::string::npos) break;
-    size_t blockContentStart = delimLineEnd + 1;
-
-    size_t nextNew = content.find(HIGHLIGHT_DELIM_PREFIX, blockContentStart);
-    size_t nextOld = content.find(std::string(HIGHLIGHT_DELIM_OLD) + "\n", blockContentStart);
-    size_t blockEnd = std::string::npos;
-    if (nextNew != std::string::npos) blockEnd = nextNew;
-    if (nextOld != std::string::npos && nextOld < blockEnd) blockEnd = nextOld;
-    if (blockEnd == std::string::npos) blockEnd = content.size();
-
-    // Check if this block's delimiter line or content contains our ref
-    std::string delimLine = content.substr(delimPos, delimLineEnd - delimPos);
-    std::string blockContent = content.substr(blockContentStart, blockEnd - blockContentStart);
-    if (delimLine.find(refNew) != std::string::npos || blockContent.find(refOld) != std::string::npos) {
-      std::string newContent = content.substr(0, delimPos) + content.substr(blockEnd);
-      if (!Storage.writeFile(filePath.c_str(), String(newContent.c_str()))) {
-        LOG_ERR("HLS", "Failed to write highlights file after delete");
-        return false;
-      }
-      LOG_DBG("HLS", "Deleted highlight %d.%d-%d from %s", spineIndex, startPage, endPage, filePath.c_str());
-      return true;
-    }
-
-    searchPos = blockContentStart;
+  if (!loadIndex(title)) return false;
+
+  // The oldest live highlight with this ref sorts first
+  const IndexEntry key{static_cast<int16_t>(spineIndex), static_cast<int16_t>(startPage),
+                       static_cast<int16_t>(endPage), 0, 0};
+  const auto it = std::lower_bound(loadedIndex.entries.begin(), loadedIndex.entries.end(), key);
+  if (it == loadedIndex.entries.end() || it->spineIndex != key.spineIndex || it->startPage != key.startPage ||
+      it->endPage != key.endPage) {
+    LOG_ERR("HLS", "deleteHighlight: no match for %d.%d-%d", spineIndex, startPage, endPage);
+    return false;
   }
 
-  LOG_ERR("HLS", "deleteHighlight: no match for %d.%d-%d", spineIndex, startPage, endPage);
-  return false;
+  const std::string indexPath = indexFilePath(title);
+  if (!appendToIndex(indexPath, encodeRecord(INDEX_OP_DELETE, spineIndex, startPage, endPage))) {
+    LOG_ERR("HLS", "Failed to record highlight delete in %s", indexPath.c_str());
+    return false;
+  }
+  loadedIndex.entries.erase(it);
+  loadedIndex.records++;
+  LOG_DBG("HLS", "Deleted highlight %d.%d-%d from %s", spineIndex, startPage, endPage, indexPath.c_str());
+  return true;
 }
 
 }  // namespace HighlightStore
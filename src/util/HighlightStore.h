@@ -37,7 +37,7 @@ enum class HighlightPageRole {
 bool ensureDir();
 
 /**
- * Save a highlight to the SD card.
+ * Save a highlight to the SD card (appended to the book's index; the .txt follows on exportIfDirty()).
  *
  * @param title      Book title
  * @param author     Book author
@@ -66,18 +66,26 @@ bool findHighlightBounds(const Page& page, const std::string& text, HighlightPag
                          int& outStartChar, int& outEndLine, int& outEndChar);
 
 /**
- * Load highlights for a specific page of a book.
- * Reads all .txt files in /highlights/ and returns those matching title+spineIndex+page.
+ * Load highlight candidates for a specific page of a book.
+ * Looks the chapter up in the book's binary index (built from the .txt on first use) and returns every
+ * highlight saved in spineIndex; callers confirm placement with findHighlightBounds().
  */
 std::vector<SavedHighlight> loadHighlightsForPage(const std::string& title, int spineIndex, int page);
 
 /**
- * Delete a specific saved highlight from the book's highlight file.
- * Identified by spineIndex + startPage + endPage (matches the stored Ref: line).
+ * Delete a specific saved highlight from the book's highlight index.
+ * Identified by spineIndex + startPage + endPage (matches the stored [N.S-E] ref).
  * Returns true if the highlight was found and removed.
  */
 bool deleteHighlight(const std::string& title, int spineIndex, int startPage, int endPage);
 
+/**
+ * Rewrite /highlights/HIGHLIGHTS - <title>.txt if highlights were saved or deleted since it was last written.
+ * Saving and deleting only append to the binary index; the text file is the export and is brought up to date here.
+ * Returns true if the text file is current.
+ */
+bool exportIfDirty(const std::string& title);
+
 /**
  * Count the number of text lines (PageLine elements) on a page.
  */
@@ -0,0 +1,80 @@
+#include "PageFrameCache.h"
+
+#include <Arduino.h>
+#include <Logging.h>
+
+PageFrameCache::Entry* PageFrameCache::find(const Key& key) {
+  for (auto& entry : entries) {
+    if (entry.frame.isStored() && entry.key == key) {
+      if (millis() - entry.storedAt > MAX_AGE_MS) {
+        entry.frame.release();
+        return nullptr;
+      }
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+bool PageFrameCache::contains(const Key& key) { return find(key) != nullptr; }
+
+bool PageFrameCache::store(const Key& key) {
+  Entry* slot = find(key);
+  if (!slot) {
+    // Prefer an empty slot, otherwise recycle the oldest frame
+    for (auto& entry : entries) {
+      if (!entry.frame.isStored()) {
+        slot = &entry;
+        break;
+      }
+      if (!slot || entry.storedAt < slot->storedAt) {
+        slot = &entry;
+      }
+    }
+    // Recycling keeps the chunks allocated, so only a fresh slot needs the heap check
+    if (!slot->frame.isStored() && ESP.getFreeHeap() < HalDisplay::BUFFER_SIZE + MIN_FREE_HEAP) {
+      LOG_DBG("PFC", "Not caching page %d: free heap %lu", key.pageIndex,
+              static_cast<unsigned long>(ESP.getFreeHeap()));
+      return false;
+    }
+  }
+
+  if (!renderer.storeFrame(slot->frame)) {
+    return false;
+  }
+  slot->key = key;
+  slot->storedAt = millis();
+  return true;
+}
+
+bool PageFrameCache::restore(const Key& key) {
+  const Entry* entry = find(key);
+  return entry && renderer.restoreFrame(entry->frame);
+}
+
+void PageFrameCache::retain(const Key* keep, const size_t count) {
+  for (auto& entry : entries) {
+    bool wanted = false;
+    for (size_t i = 0; i < count && !wanted; i++) {
+      wanted = entry.key == keep[i];
+    }
+    if (!wanted) {
+      entry.frame.release();
+    }
+  }
+}
+
+void PageFrameCache::clear() {
+  for (auto& entry : entries) {
+    entry.frame.release();
+  }
+}
+
+bool PageFrameCache::empty() const {
+  for (const auto& entry : entries) {
+    if (entry.frame.isStored()) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <GfxRenderer.h>
+
+#include <cstdint>
+
+/**
+ * Finished BW frames for the reader pages around the current one (previous, current, next), so a page turn can
+ * restore a frame instead of rasterizing it. Frames are plain GfxRenderer::FrameSnapshots (8KB chunks), keyed by
+ * spine/page plus a layout key that changes whenever anything affecting the pixels does (font, spacing, margins,
+ * orientation, status bar, night mode...). A key mismatch is simply a miss.
+ *
+ * Everything here is best effort: a frame is only stored while enough heap is left for the rest of the reader
+ * (grayscale BW buffer, font decompression), and frames older than MAX_AGE_MS are dropped so the battery indicator
+ * in the status bar doesn't go stale.
+ */
+class PageFrameCache final {
+ public:
+  static constexpr size_t MAX_FRAMES = 3;
+  // Free heap that must remain after storing a frame (room for storeBwBuffer's 48KB plus headroom)
+  static constexpr uint32_t MIN_FREE_HEAP = 64 * 1024;
+  static constexpr unsigned long MAX_AGE_MS = 5 * 60 * 1000;
+
+  struct Key {
+    uint32_t layout = 0;
+    int spineIndex = -1;
+    int pageIndex = -1;
+
+    bool operator==(const Key& other) const {
+      return layout == other.layout && spineIndex == other.spineIndex && pageIndex == other.pageIndex;
+    }
+  };
+
+ private:
+  struct Entry {
+    Key key;
+    GfxRenderer::FrameSnapshot frame;
+    unsigned long storedAt = 0;
+  };
+
+  GfxRenderer& renderer;
+  Entry entries[MAX_FRAMES];
+
+  Entry* find(const Key& key);
+
+ public:
+  explicit PageFrameCache(GfxRenderer& renderer) : renderer(renderer) {}
+
+  [[nodiscard]] bool contains(const Key& key);
+  // Snapshot the renderer's current frame buffer under `key`. Returns false if the heap is too low.
+  bool store(const Key& key);
+  // Copy the frame for `key` into the renderer's frame buffer. Returns false on a miss.
+  bool restore(const Key& key);
+  // Drop every frame whose key isn't one of `keep`
+  void retain(const Key* keep, size_t count);
+  void clear();
+  [[nodiscard]] bool empty() const;
+};
@@ -0,0 +1,115 @@
+#include "SleepFrame.h"
+
+#include <Logging.h>
+
+#include <cstring>
+
+namespace {
+constexpr uint32_t SLEEP_FRAME_MAGIC = 0x4D524653;  // "SFRM"
+constexpr uint8_t SLEEP_FRAME_VERSION = 1;
+constexpr size_t HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint8_t);
+
+// Plane count if the file is a complete frame for key, 0 otherwise
+uint8_t readHeader(FsFile& file, const uint32_t key) {
+  uint8_t header[HEADER_SIZE];
+  if (file.read(header, HEADER_SIZE) != static_cast<int>(HEADER_SIZE)) {
+    return 0;
+  }
+  uint32_t magic;
+  uint32_t frameKey;
+  memcpy(&magic, header, sizeof(magic));
+  memcpy(&frameKey, header + 5, sizeof(frameKey));
+  const uint8_t version = header[4];
+  const uint8_t planes = header[9];
+  if (magic != SLEEP_FRAME_MAGIC || version != SLEEP_FRAME_VERSION || frameKey != key ||
+      (planes != SleepFrame::BW_PLANES && planes != SleepFrame::GRAYSCALE_PLANES)) {
+    return 0;
+  }
+  if (file.size() != HEADER_SIZE + static_cast<size_t>(planes) * HalDisplay::BUFFER_SIZE) {
+    return 0;
+  }
+  return planes;
+}
+}  // namespace
+
+SleepFrame::Writer::Writer(const std::string& path, const uint32_t key, const uint8_t planes) : expected(planes) {
+  Storage.mkdir(path.substr(0, path.find_last_of('/')).c_str());
+  if (!Storage.openFileForWrite("SFR", path, file)) {
+    return;
+  }
+  uint8_t header[HEADER_SIZE];
+  memcpy(header, &SLEEP_FRAME_MAGIC, sizeof(SLEEP_FRAME_MAGIC));
+  header[4] = SLEEP_FRAME_VERSION;
+  memcpy(header + 5, &key, sizeof(key));
+  header[9] = planes;
+  ok = file.write(header, HEADER_SIZE) == HEADER_SIZE;
+}
+
+SleepFrame::Writer::~Writer() {
+  if (file) {
+    file.close();
+  }
+}
+
+void SleepFrame::Writer::add(const GfxRenderer& renderer) {
+  if (!ok || added >= expected) {
+    ok = false;
+    return;
+  }
+  ok = file.write(renderer.getFrameBuffer(), HalDisplay::BUFFER_SIZE) == HalDisplay::BUFFER_SIZE;
+  added++;
+}
+
+bool SleepFrame::Writer::finish() {
+  if (file) {
+    file.close();
+  }
+  if (!ok || added != expected) {
+    LOG_ERR("SFR", "Sleep frame incomplete: %u of %u planes", added, expected);
+    return false;
+  }
+  return true;
+}
+
+bool SleepFrame::show(GfxRenderer& renderer, const std::string& path, const uint32_t key) {
+  FsFile file;
+  if (!Storage.openFileForRead("SFR", path, file)) {
+    return false;
+  }
+  const uint8_t planes = readHeader(file, key);
+  if (planes == 0) {
+    file.close();
+    return false;
+  }
+
+  uint8_t* frameBuffer = renderer.getFrameBuffer();
+  if (file.read(frameBuffer, HalDisplay::BUFFER_SIZE) != static_cast<int>(HalDisplay::BUFFER_SIZE)) {
+    LOG_ERR("SFR", "Short read from %s", path.c_str());
+    file.close();
+    return false;
+  }
+  renderer.displayBuffer(HalDisplay::HALF_REFRESH);
+
+  if (planes == GRAYSCALE_PLANES) {
+    // The BW frame is already up: a failed read from here on only loses the gray levels
+    if (file.read(frameBuffer, HalDisplay::BUFFER_SIZE) == static_cast<int>(HalDisplay::BUFFER_SIZE)) {
+      renderer.copyGrayscaleLsbBuffers();
+      if (file.read(frameBuffer, HalDisplay::BUFFER_SIZE) == static_cast<int>(HalDisplay::BUFFER_SIZE)) {
+        renderer.copyGrayscaleMsbBuffers();
+        renderer.displayGrayBuffer();
+      }
+    }
+  }
+  file.close();
+  return true;
+}
+
+bool SleepFrame::isCurrent(const std::string& path, const uint32_t key) {
+  FsFile file;
+  if (!Storage.openFileForRead("SFR", path, file)) {
+    return false;
+  }
+  const bool current = readHeader(file, key) != 0;
+  file.close();
+  return current;
+}
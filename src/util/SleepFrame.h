@@ -0,0 +1,45 @@
+#pragma once
+
+#include <GfxRenderer.h>
+#include <HalStorage.h>
+
+#include <cstdint>
+#include <string>
+
+/**
+ * A finished sleep screen stored in the panel's own buffer layout, so showing it is a sequential read straight into
+ * the frame buffer instead of decoding and scaling a BMP.
+ *
+ * File: uint32 magic, uint8 version, uint32 key, uint8 plane count, then the planes, HalDisplay::BUFFER_SIZE bytes
+ * each: the BW frame as displayed, followed for grayscale images by the LSB and MSB planes. The key identifies the
+ * source image and every setting that changes the pixels; a frame whose key or size doesn't match is ignored (a write
+ * cut short leaves a file that is too small).
+ */
+class SleepFrame final {
+ public:
+  static constexpr uint8_t BW_PLANES = 1;
+  static constexpr uint8_t GRAYSCALE_PLANES = 3;
+
+  // Collects the planes as they are rendered: add() after each one is in the frame buffer
+  class Writer final {
+    FsFile file;
+    uint8_t expected = 0;
+    uint8_t added = 0;
+    bool ok = false;
+
+   public:
+    Writer(const std::string& path, uint32_t key, uint8_t planes);
+    ~Writer();
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    void add(const GfxRenderer& renderer);
+    // True if every plane was written
+    bool finish();
+  };
+
+  // Show the frame at path if its key matches. Returns false, leaving the screen alone, if there is no such frame.
+  static bool show(GfxRenderer& renderer, const std::string& path, uint32_t key);
+  // The frame at path exists and was made for key
+  static bool isCurrent(const std::string& path, uint32_t key);
+};
@@ -0,0 +1,182 @@
+#include "SleepImageManifest.h"
+
+#include <Bitmap.h>
+#include <BufferedFile.h>
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "util/StringUtils.h"
+
+namespace {
+constexpr uint8_t SLEEP_MANIFEST_FILE_VERSION = 1;
+constexpr char SLEEP_DIR[] = "/sleep";
+constexpr char SLEEP_CACHE_DIR[] = "/.crosspoint/sleep";
+constexpr char SLEEP_MANIFEST_FILE[] = "/.crosspoint/sleep/manifest.bin";
+constexpr char FRAME_EXTENSION[] = ".frm";
+// Index of the last image shown is a uint8_t in CrossPointState
+constexpr size_t MAX_IMAGES = 255;
+
+uint32_t modifiedTime(FsFile& file) {
+  uint16_t date = 0;
+  uint16_t time = 0;
+  file.getModifyDateTime(&date, &time);
+  return static_cast<uint32_t>(date) << 16 | time;
+}
+}  // namespace
+
+std::string SleepImageManifest::framePath(const std::string& imagePath) {
+  uint32_t hash = 2166136261u;
+  for (const char c : imagePath) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  char name[20];
+  snprintf(name, sizeof(name), "/%08lx%s", static_cast<unsigned long>(hash), FRAME_EXTENSION);
+  return SLEEP_CACHE_DIR + std::string(name);
+}
+
+void SleepImageManifest::invalidate() {
+  if (Storage.exists(SLEEP_MANIFEST_FILE)) {
+    Storage.remove(SLEEP_MANIFEST_FILE);
+  }
+}
+
+bool SleepImageManifest::load(const bool forceRebuild) {
+  auto dir = Storage.open(SLEEP_DIR);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    images.clear();
+    return false;
+  }
+  const uint32_t modified = modifiedTime(dir);
+  dir.close();
+
+  if (!forceRebuild && loadFromFile() && dirModified == modified) {
+    return true;
+  }
+  rebuild(modified);
+  return true;
+}
+
+bool SleepImageManifest::loadFromFile() {
+  BufferedFile file;
+  if (!file.openForRead("SLM", SLEEP_MANIFEST_FILE)) {
+    return false;
+  }
+  uint8_t version = 0;
+  serialization::readPod(file, version);
+  if (version != SLEEP_MANIFEST_FILE_VERSION) {
+    LOG_ERR("SLM", "Deserialization failed: Unknown version %u", version);
+    file.close();
+    return false;
+  }
+  uint16_t count = 0;
+  serialization::readPod(file, dirModified);
+  serialization::readPod(file, count);
+  const uint32_t fileSize = file.size();
+  images.clear();
+  images.reserve(std::min<size_t>(count, MAX_IMAGES));
+  for (uint16_t i = 0; i < count && i < MAX_IMAGES; i++) {
+    Image image;
+    serialization::readString(file, image.name);
+    serialization::readPod(file, image.size);
+    serialization::readPod(file, image.modified);
+    if (file.position() > fileSize) {
+      file.close();
+      return false;  // Cut short: rebuild
+    }
+    images.push_back(std::move(image));
+  }
+  file.close();
+  return true;
+}
+
+bool SleepImageManifest::saveToFile() const {
+  Storage.mkdir(SLEEP_CACHE_DIR);
+  BufferedFile file;
+  if (!file.openForWrite("SLM", SLEEP_MANIFEST_FILE)) {
+    return false;
+  }
+  serialization::writePod(file, SLEEP_MANIFEST_FILE_VERSION);
+  serialization::writePod(file, dirModified);
+  serialization::writePod(file, static_cast<uint16_t>(images.size()));
+  for (const auto& image : images) {
+    serialization::writeString(file, image.name);
+    serialization::writePod(file, image.size);
+    serialization::writePod(file, image.modified);
+  }
+  file.close();
+  return true;
+}
+
+void SleepImageManifest::rebuild(const uint32_t modified) {
+  const uint32_t start = millis();
+  dirModified = modified;
+  images.clear();
+
+  auto dir = Storage.open(SLEEP_DIR);
+  char name[500];
+  for (auto file = dir.openNextFile(); file && images.size() < MAX_IMAGES; file = dir.openNextFile()) {
+    if (file.isDirectory()) {
+      file.close();
+      continue;
+    }
+    file.getName(name, sizeof(name));
+    if (name[0] == '.') {
+      file.close();
+      continue;
+    }
+    if (!StringUtils::checkFileExtension(std::string(name), ".bmp")) {
+      LOG_DBG("SLM", "Skipping non-.bmp file name: %s", name);
+      file.close();
+      continue;
+    }
+    Bitmap bitmap(file);
+    if (bitmap.parseHeaders() != BmpReaderError::Ok) {
+      LOG_DBG("SLM", "Skipping invalid BMP file: %s", name);
+      file.close();
+      continue;
+    }
+    images.push_back({name, static_cast<uint32_t>(file.size()), modifiedTime(file)});
+    file.close();
+  }
+  dir.close();
+
+  saveToFile();
+  removeStaleFrames();
+  LOG_DBG("SLM", "Listed %zu sleep images in %lu ms", images.size(), millis() - start);
+}
+
+void SleepImageManifest::removeStaleFrames() const {
+  auto dir = Storage.open(SLEEP_CACHE_DIR);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return;
+  }
+  std::vector<std::string> keep;
+  keep.reserve(images.size() + 1);
+  for (const auto& image : images) {
+    keep.push_back(framePath(std::string(SLEEP_DIR) + "/" + image.name));
+  }
+  keep.push_back(framePath("/sleep.bmp"));
+
+  std::vector<std::string> stale;
+  char name[64];
+  for (auto file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    file.getName(name, sizeof(name));
+    file.close();
+    const std::string path = std::string(SLEEP_CACHE_DIR) + "/" + name;
+    if (StringUtils::checkFileExtension(std::string(name), FRAME_EXTENSION) &&
+        std::find(keep.begin(), keep.end(), path) == keep.end()) {
+      stale.push_back(path);
+    }
+  }
+  dir.close();
+  for (const auto& path : stale) {
+    Storage.remove(path.c_str());
+  }
+}
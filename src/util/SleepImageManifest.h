@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * The valid BMPs in /sleep, kept in /.crosspoint/sleep/manifest.bin so going to sleep doesn't walk the directory and
+ * parse every image's headers. The list is rebuilt when the directory's modification time differs from the one it was
+ * built at, when a listed image has gone, or after invalidate() (the web server calls it, since not every host updates
+ * a FAT directory's time).
+ *
+ * Each image also has a SleepFrame next to the manifest, made the first time it is shown; a rebuild removes the
+ * frames of images that are no longer listed.
+ */
+class SleepImageManifest final {
+ public:
+  struct Image {
+    std::string name;  // File name in /sleep
+    uint32_t size = 0;
+    uint32_t modified = 0;  // FAT date << 16 | time
+  };
+
+ private:
+  uint32_t dirModified = 0;
+  std::vector<Image> images;
+
+  bool loadFromFile();
+  bool saveToFile() const;
+  // Walk /sleep and check every BMP's headers
+  void rebuild(uint32_t modified);
+  void removeStaleFrames() const;
+
+ public:
+  // Up-to-date list of images, rebuilt if forceRebuild. Returns false if there is no /sleep directory.
+  bool load(bool forceRebuild = false);
+  static void invalidate();
+
+  const std::vector<Image>& getImages() const { return images; }
+  // SleepFrame file for the image at path (e.g. "/sleep/a.bmp" or "/sleep.bmp")
+  static std::string framePath(const std::string& imagePath);
+};
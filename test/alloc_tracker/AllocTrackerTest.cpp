@@ -0,0 +1,105 @@
+#include <AllocTracker.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> reportLines;
+
+void collectLine(const char* line) { reportLines.emplace_back(line); }
+
+int failures = 0;
+
+void expect(const bool condition, const std::string& what) {
+  if (!condition) {
+    std::cerr << "FAIL: " << what << "\n";
+    failures++;
+  }
+}
+
+// Scripted activity lifecycle resembling opening a book from Home:
+// Home -> Reader -> EpubReader (sub-activity) -> back to Home.
+void runLifecycle() {
+  alloctracker::enterActivity("Home");
+  alloctracker::onAlloc(alloctracker::FDC, 2048, true);
+  alloctracker::exitActivity("Home");
+
+  alloctracker::enterActivity("Reader");
+  alloctracker::onAlloc(alloctracker::ZIP, 32768, true);
+  alloctracker::onAlloc(alloctracker::ZIP, 1024, true);
+
+  alloctracker::enterActivity("EpubReader");
+  alloctracker::onAlloc(alloctracker::EHP, 1024, true);
+  alloctracker::onAlloc(alloctracker::CSS, 40, true);
+  alloctracker::onAlloc(alloctracker::CSS, 49152, false);
+  for (int i = 0; i < 6; i++) {
+    alloctracker::onAlloc(alloctracker::GFX, 8000, true);
+  }
+  alloctracker::onAlloc(alloctracker::IMG, 120, true);
+  alloctracker::exitActivity("EpubReader");
+  alloctracker::exitActivity("Reader");
+
+  alloctracker::enterActivity("Home");
+  alloctracker::onAlloc(alloctracker::FDC, 4096, true);
+  alloctracker::exitActivity("Home");
+}
+
+const alloctracker::ActivityStats* findActivity(const char* name) {
+  const alloctracker::ActivityStats* table = nullptr;
+  const size_t count = alloctracker::activityStats(&table);
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(table[i].name, name) == 0) {
+      return &table[i];
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+int main() {
+  runLifecycle();
+
+  const auto& zip = alloctracker::tagStats(alloctracker::ZIP);
+  expect(zip.allocCount == 2 && zip.allocBytes == 33792 && zip.largestRequest == 32768, "ZIP tag totals");
+  const auto& css = alloctracker::tagStats(alloctracker::CSS);
+  expect(css.allocCount == 2 && css.failures == 1, "CSS refusal counted as failure");
+  const auto& gfx = alloctracker::tagStats(alloctracker::GFX);
+  expect(gfx.allocCount == 6 && gfx.allocBytes == 48000, "GFX BW buffer chunks");
+
+  const auto* home = findActivity("Home");
+  expect(home && home->visits == 2 && home->allocs.allocBytes == 6144, "Home aggregated over two visits");
+  const auto* reader = findActivity("Reader");
+  expect(reader && reader->allocs.allocCount == 2, "Reader excludes sub-activity allocations");
+  const auto* epubReader = findActivity("EpubReader");
+  expect(epubReader && epubReader->allocs.allocCount == 10 && epubReader->allocs.largestRequest == 49152,
+         "EpubReader sub-activity totals");
+
+  // Allocations outside any activity still count towards the tag
+  alloctracker::onAlloc(alloctracker::IMG, 64, true);
+  expect(alloctracker::tagStats(alloctracker::IMG).allocCount == 2, "untracked-activity allocation");
+
+  // The report must be identical run to run so it can be diffed in CI
+  alloctracker::dump(collectLine);
+  const auto firstReport = reportLines;
+  reportLines.clear();
+  alloctracker::reset();
+  runLifecycle();
+  alloctracker::onAlloc(alloctracker::IMG, 64, true);
+  alloctracker::dump(collectLine);
+  expect(firstReport == reportLines, "report is deterministic");
+
+  for (const auto& line : reportLines) {
+    std::cout << line << "\n";
+  }
+
+  if (failures > 0) {
+    std::cerr << failures << " check(s) failed\n";
+    return 1;
+  }
+  std::cout << "All allocation tracker checks passed\n";
+  return 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+// Host-side reader shared by the golden-frame test and the serialization benchmark: the reader's default font and
+// margins, and books opened and laid out through the reader's own Epub and Section (ChapterHtmlSlimParser, images
+// included), with their caches in a directory on the host filesystem.
+
+#include <EpdFont.h>
+#include <EpdFontFamily.h>
+#include <Epub.h>
+#include <Epub/Section.h>
+#include <FontDecompressor.h>
+#include <GfxRenderer.h>
+#include <builtinFonts/bookerly_14_bold.h>
+#include <builtinFonts/bookerly_14_bolditalic.h>
+#include <builtinFonts/bookerly_14_italic.h>
+#include <builtinFonts/bookerly_14_regular.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+constexpr int FONT_ID = 1;
+// CrossPointSettings defaults: Bookerly medium, normal spacing, 5px margin, justified, extra paragraph spacing on,
+// embedded style on
+constexpr float LINE_COMPRESSION = 1.0f;
+constexpr int SCREEN_MARGIN = 5;
+constexpr bool EXTRA_PARAGRAPH_SPACING = true;
+constexpr uint8_t PARAGRAPH_ALIGNMENT = 0;
+constexpr bool HYPHENATION_ENABLED = false;
+constexpr bool EMBEDDED_STYLE = true;
+constexpr bool FORCE_BOLD_TEXT = false;
+
+// Bookerly 14 registered under FONT_ID. Must outlive every render through the renderer it was installed into.
+struct ReaderFonts {
+  FontDecompressor decompressor;
+  EpdFont regular{&bookerly_14_regular};
+  EpdFont bold{&bookerly_14_bold};
+  EpdFont italic{&bookerly_14_italic};
+  EpdFont boldItalic{&bookerly_14_bolditalic};
+
+  void install(GfxRenderer& renderer) {
+    decompressor.init();
+    renderer.setFontDecompressor(&decompressor);
+    renderer.insertFont(FONT_ID, EpdFontFamily(&regular, &bold, &italic, &boldItalic));
+  }
+};
+
+struct ReaderViewport {
+  int marginTop;
+  int marginRight;
+  int marginBottom;
+  int marginLeft;
+  int width;
+  int height;
+};
+
+inline ReaderViewport readerViewport(const GfxRenderer& renderer) {
+  ReaderViewport v{};
+  renderer.getOrientedViewableTRBL(&v.marginTop, &v.marginRight, &v.marginBottom, &v.marginLeft);
+  v.marginTop += SCREEN_MARGIN;
+  v.marginRight += SCREEN_MARGIN;
+  v.marginBottom += SCREEN_MARGIN;
+  v.marginLeft += SCREEN_MARGIN;
+  v.width = renderer.getScreenWidth() - v.marginLeft - v.marginRight;
+  v.height = renderer.getScreenHeight() - v.marginTop - v.marginBottom;
+  return v;
+}
+
+inline std::string readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+// Opens a book like ReaderActivity::loadEpub, building its metadata and CSS caches under cacheDir on first use
+inline std::shared_ptr<Epub> openBook(const std::string& path, const std::string& cacheDir) {
+  auto epub = std::make_shared<Epub>(path, cacheDir);
+  if (!epub->load(true, !EMBEDDED_STYLE)) {
+    return nullptr;
+  }
+  return epub;
+}
+
+// A chapter's pages with the reader defaults, like EpubReaderActivity: the cached section file if it matches,
+// otherwise laid out again (from the chapter IR when one was recorded). Null if the chapter can't be laid out.
+inline std::unique_ptr<Section> layoutSection(const std::shared_ptr<Epub>& epub, const int spineIndex,
+                                              GfxRenderer& renderer, const ReaderViewport& viewport) {
+  auto section = std::make_unique<Section>(epub, spineIndex, renderer);
+  const auto width = static_cast<uint16_t>(viewport.width);
+  const auto height = static_cast<uint16_t>(viewport.height);
+  if (!section->loadSectionFile(FONT_ID, LINE_COMPRESSION, EXTRA_PARAGRAPH_SPACING, PARAGRAPH_ALIGNMENT, width, height,
+                                HYPHENATION_ENABLED, EMBEDDED_STYLE, FORCE_BOLD_TEXT) &&
+      !section->createSectionFile(FONT_ID, LINE_COMPRESSION, EXTRA_PARAGRAPH_SPACING, PARAGRAPH_ALIGNMENT, width,
+                                  height, HYPHENATION_ENABLED, EMBEDDED_STYLE, FORCE_BOLD_TEXT)) {
+    return nullptr;
+  }
+  return section;
+}
@@ -0,0 +1,349 @@
+// Golden-frame rendering test. Opens each EPUB through the reader's Epub and Section with the default settings, so
+// chapters go through ChapterHtmlSlimParser, the section file and the image decoders as on device, renders the first
+// pages through GfxRenderer into the in-memory panel (test/host/EInkDisplay.h) exactly like EpubReaderActivity does
+// (BW pass, then LSB/MSB anti-aliasing passes), and compares a hash of every frame against golden.txt. Frames are also
+// written out as PBM (1-bit) and PGM (2-bit) for inspection, and per-page render times are reported so raster/layout
+// optimizations can show both "output unchanged" and "faster".
+//
+// Each chapter is then laid out a second time from its chapter IR (the re-flow path) and must render the same frames,
+// every page's content anchor must lead back to it, and every TOC fragment must resolve to a page.
+//
+// The allocation tracker is compiled in, with opening and laying out books, rendering and re-flowing each counted as
+// an activity, and its report is printed at the end (heap figures read 0 on host, the counts are deterministic).
+
+#include <AllocTracker.h>
+#include <Epub/Page.h>
+#include <GfxRenderer.h>
+#include <HalDisplay.h>
+#include <HalStorage.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BookLayout.h"
+
+namespace {
+
+constexpr int MAX_PAGES_PER_BOOK = 4;
+
+struct FrameResult {
+  std::string name;
+  uint64_t bwHash;
+  uint64_t grayHash;
+  double renderMs;
+};
+
+struct Frame {
+  std::vector<uint8_t> pbm;
+  std::vector<uint8_t> pgm;
+};
+
+uint64_t fnv1a(const std::vector<uint8_t>& data) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const uint8_t b : data) {
+    hash ^= b;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+bool isBlack(const uint8_t* buffer, const int phyX, const int phyY) {
+  return (buffer[phyY * HalDisplay::DISPLAY_WIDTH_BYTES + phyX / 8] & (0x80 >> (phyX % 8))) == 0;
+}
+
+bool isMarked(const uint8_t* plane, const int phyX, const int phyY) {
+  return (plane[phyY * HalDisplay::DISPLAY_WIDTH_BYTES + phyX / 8] & (0x80 >> (phyX % 8))) != 0;
+}
+
+// Both images are produced in logical portrait orientation (480x800). Portrait maps logical (x, y) to panel
+// (y, DISPLAY_HEIGHT - 1 - x); see rotateCoordinates in GfxRenderer.cpp.
+constexpr int LOGICAL_WIDTH = HalDisplay::DISPLAY_HEIGHT;
+constexpr int LOGICAL_HEIGHT = HalDisplay::DISPLAY_WIDTH;
+
+std::vector<uint8_t> toPbm(const uint8_t* bw) {
+  std::ostringstream header;
+  header << "P4\n" << LOGICAL_WIDTH << " " << LOGICAL_HEIGHT << "\n";
+  const std::string h = header.str();
+  std::vector<uint8_t> out(h.begin(), h.end());
+  const size_t rowBytes = (LOGICAL_WIDTH + 7) / 8;
+  for (int y = 0; y < LOGICAL_HEIGHT; y++) {
+    std::vector<uint8_t> row(rowBytes, 0);
+    for (int x = 0; x < LOGICAL_WIDTH; x++) {
+      if (isBlack(bw, y, HalDisplay::DISPLAY_HEIGHT - 1 - x)) {
+        row[x / 8] |= 0x80 >> (x % 8);
+      }
+    }
+    out.insert(out.end(), row.begin(), row.end());
+  }
+  return out;
+}
+
+// 2-bit frame as the panel shows it after the grayscale passes: 0 black, 1 dark gray, 2 light gray, 3 white
+std::vector<uint8_t> toPgm(const uint8_t* bw, const uint8_t* lsb, const uint8_t* msb) {
+  std::ostringstream header;
+  header << "P5\n" << LOGICAL_WIDTH << " " << LOGICAL_HEIGHT << "\n3\n";
+  const std::string h = header.str();
+  std::vector<uint8_t> out(h.begin(), h.end());
+  out.reserve(out.size() + LOGICAL_WIDTH * LOGICAL_HEIGHT);
+  for (int y = 0; y < LOGICAL_HEIGHT; y++) {
+    for (int x = 0; x < LOGICAL_WIDTH; x++) {
+      const int phyX = y;
+      const int phyY = HalDisplay::DISPLAY_HEIGHT - 1 - x;
+      uint8_t level = 3;
+      if (isBlack(bw, phyX, phyY)) {
+        level = isMarked(lsb, phyX, phyY) ? 1 : isMarked(msb, phyX, phyY) ? 2 : 0;
+      }
+      out.push_back(level);
+    }
+  }
+  return out;
+}
+
+bool writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+  std::ofstream out(path, std::ios::binary);
+  out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+  return out.good();
+}
+
+Frame renderFrame(GfxRenderer& renderer, const Page& page, const int marginLeft, const int marginTop) {
+  renderer.clearScreen();
+  page.render(renderer, FONT_ID, marginLeft, marginTop);
+  renderer.displayBuffer();
+  const std::vector<uint8_t> bw(renderer.getFrameBuffer(), renderer.getFrameBuffer() + HalDisplay::BUFFER_SIZE);
+
+  renderer.storeBwBuffer();
+  renderer.clearScreen(0x00);
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_LSB);
+  page.render(renderer, FONT_ID, marginLeft, marginTop);
+  renderer.copyGrayscaleLsbBuffers();
+  renderer.clearScreen(0x00);
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_MSB);
+  page.render(renderer, FONT_ID, marginLeft, marginTop);
+  renderer.copyGrayscaleMsbBuffers();
+  renderer.displayGrayBuffer();
+  renderer.setRenderMode(GfxRenderer::BW);
+  renderer.restoreBwBuffer();
+  renderer.clearFontCache();
+
+  return {toPbm(bw.data()), toPgm(bw.data(), EInkDisplay::lsbPlane().data(), EInkDisplay::msbPlane().data())};
+}
+
+std::map<std::string, std::pair<uint64_t, uint64_t>> loadGolden(const std::string& path) {
+  std::map<std::string, std::pair<uint64_t, uint64_t>> golden;
+  std::istringstream in(readFile(path));
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream record(line);
+    std::string name, bw, gray;
+    if (record >> name >> bw >> gray) {
+      golden[name] = {std::stoull(bw, nullptr, 16), std::stoull(gray, nullptr, 16)};
+    }
+  }
+  return golden;
+}
+
+std::string hex(const uint64_t value) {
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(value));
+  return buf;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string goldenPath = "test/golden_frames/golden.txt";
+  std::string outDir = "build/golden_frames/frames";
+  std::string cacheDir = "build/golden_frames/cache";
+  bool update = false;
+  std::vector<std::string> books;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--update") {
+      update = true;
+    } else if (arg == "--golden" && i + 1 < argc) {
+      goldenPath = argv[++i];
+    } else if (arg == "--out" && i + 1 < argc) {
+      outDir = argv[++i];
+    } else if (arg == "--cache" && i + 1 < argc) {
+      cacheDir = argv[++i];
+    } else {
+      books.push_back(arg);
+    }
+  }
+  if (books.empty()) {
+    std::cerr << "Usage: GoldenFrameTest [--update] [--golden file] [--out dir] [--cache dir] <book.epub>...\n";
+    return 1;
+  }
+
+  HalDisplay display;
+  display.begin();
+  GfxRenderer renderer(display);
+  renderer.begin();
+
+  ReaderFonts fonts;
+  fonts.install(renderer);
+  const ReaderViewport viewport = readerViewport(renderer);
+  const int marginTop = viewport.marginTop;
+  const int marginLeft = viewport.marginLeft;
+  Storage.removeDir(cacheDir.c_str());
+  Storage.mkdir(cacheDir.c_str());
+
+  std::vector<FrameResult> results;
+  int checkFailures = 0;
+  const auto checkFailed = [&checkFailures](const std::string& what) {
+    std::cerr << what << "\n";
+    checkFailures++;
+  };
+  for (const auto& bookPath : books) {
+    const size_t nameStart = bookPath.find_last_of('/') + 1;
+    const std::string bookName = bookPath.substr(nameStart, bookPath.find_last_of('.') - nameStart);
+    const auto layoutStart = std::chrono::steady_clock::now();
+    ALLOC_TRACK_ACTIVITY_ENTER("layout");
+    const auto epub = openBook(bookPath, cacheDir);
+    ALLOC_TRACK_ACTIVITY_EXIT("layout");
+    if (!epub) {
+      checkFailed(bookName + ": failed to open");
+      continue;
+    }
+
+    int pageTotal = 0;
+    unsigned frameIndex = 0;
+    for (int spine = 0; spine < epub->getSpineItemsCount(); spine++) {
+      ALLOC_TRACK_ACTIVITY_ENTER("layout");
+      auto section = layoutSection(epub, spine, renderer, viewport);
+      ALLOC_TRACK_ACTIVITY_EXIT("layout");
+      if (!section) {
+        checkFailed(bookName + ": failed to lay out spine item " + std::to_string(spine));
+        continue;
+      }
+      pageTotal += section->pageCount;
+
+      for (int tocIndex = 0; tocIndex < epub->getTocItemsCount(); tocIndex++) {
+        const auto toc = epub->getTocItem(tocIndex);
+        if (toc.spineIndex == spine && !toc.anchor.empty() && section->findPageForAnchor(toc.anchor) < 0) {
+          checkFailed(bookName + ": TOC anchor #" + toc.anchor + " not found in spine item " + std::to_string(spine));
+        }
+      }
+
+      std::vector<Frame> frames;
+      for (int p = 0; p < section->pageCount && frameIndex < MAX_PAGES_PER_BOOK; p++, frameIndex++) {
+        const auto page = section->loadPage(p);
+        if (!page) {
+          checkFailed(bookName + ": failed to load page " + std::to_string(p));
+          break;
+        }
+        const int anchoredPage = section->findPageForContentAnchor(page->anchor);
+        const auto anchored = section->loadPage(anchoredPage);
+        if (!anchored || !(anchored->anchor == page->anchor)) {
+          checkFailed(bookName + ": content anchor of page " + std::to_string(p) + " leads to page " +
+                      std::to_string(anchoredPage));
+        }
+
+        ALLOC_TRACK_ACTIVITY_ENTER("render");
+        const auto start = std::chrono::steady_clock::now();
+        frames.push_back(renderFrame(renderer, *page, marginLeft, marginTop));
+        const double renderMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ALLOC_TRACK_ACTIVITY_EXIT("render");
+
+        char pageName[16];
+        snprintf(pageName, sizeof(pageName), "page%03u", frameIndex);
+        writeFile(outDir + "/" + bookName + "_" + pageName + ".pbm", frames.back().pbm);
+        writeFile(outDir + "/" + bookName + "_" + pageName + ".pgm", frames.back().pgm);
+        results.push_back({bookName + "/" + pageName, fnv1a(frames.back().pbm), fnv1a(frames.back().pgm), renderMs});
+      }
+
+      // Re-flow: the section file goes, the chapter IR stays, and the pages built from it must look the same
+      const uint16_t parsedPages = section->pageCount;
+      section->clearCache();
+      ALLOC_TRACK_ACTIVITY_ENTER("reflow");
+      section = layoutSection(epub, spine, renderer, viewport);
+      ALLOC_TRACK_ACTIVITY_EXIT("reflow");
+      if (!section || section->pageCount != parsedPages) {
+        checkFailed(bookName + ": re-flow of spine item " + std::to_string(spine) + " changed its page count");
+        continue;
+      }
+      for (size_t p = 0; p < frames.size(); p++) {
+        const auto page = section->loadPage(static_cast<int>(p));
+        const Frame frame = page ? renderFrame(renderer, *page, marginLeft, marginTop) : Frame{};
+        if (frame.pbm != frames[p].pbm || frame.pgm != frames[p].pgm) {
+          checkFailed(bookName + ": page " + std::to_string(p) + " of spine item " + std::to_string(spine) +
+                      " renders differently after re-flow");
+        }
+      }
+    }
+    const double layoutMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - layoutStart).count();
+    std::cout << bookName << ": " << epub->getSpineItemsCount() << " chapters, " << pageTotal << " pages, " << layoutMs
+              << " ms\n";
+  }
+
+  std::ofstream timings(outDir + "/timings.csv");
+  timings << "frame,render_ms\n";
+  for (const auto& r : results) {
+    timings << r.name << "," << r.renderMs << "\n";
+  }
+#ifdef ENABLE_ALLOC_TRACKER
+  alloctracker::dump([](const char* line) { puts(line); });
+#endif
+
+  if (update) {
+    std::ofstream golden(goldenPath);
+    golden << "# Golden frame hashes (FNV-1a 64 of the PBM / PGM). "
+              "Regenerate with: test/run_golden_frames.sh --update\n";
+    for (const auto& r : results) {
+      golden << r.name << " " << hex(r.bwHash) << " " << hex(r.grayHash) << "\n";
+    }
+    std::cout << "Updated " << goldenPath << " with " << results.size() << " frames\n";
+    return checkFailures == 0 ? 0 : 1;
+  }
+
+  const auto golden = loadGolden(goldenPath);
+  int failures = 0;
+  double totalMs = 0;
+  for (const auto& r : results) {
+    totalMs += r.renderMs;
+    const auto it = golden.find(r.name);
+    const char* status = "ok";
+    if (it == golden.end()) {
+      status = "NEW";
+      failures++;
+    } else if (it->second.first != r.bwHash || it->second.second != r.grayHash) {
+      status = it->second.first != r.bwHash ? "BW DIFF" : "GRAY DIFF";
+      failures++;
+    }
+    printf("%-32s %8.2f ms  %s\n", r.name.c_str(), r.renderMs, status);
+  }
+  for (const auto& [name, hashes] : golden) {
+    if (std::none_of(results.begin(), results.end(), [&](const FrameResult& r) { return r.name == name; })) {
+      printf("%-32s %11s  MISSING\n", name.c_str(), "");
+      failures++;
+    }
+  }
+  printf("%zu frames, %.2f ms total, %.2f ms/page\n", results.size(), totalMs,
+         results.empty() ? 0.0 : totalMs / results.size());
+
+  if (checkFailures > 0) {
+    std::cerr << checkFailures << " re-flow/anchor check(s) failed\n";
+  }
+  if (failures > 0) {
+    std::cerr << failures << " frame(s) differ from " << goldenPath << "; frames are in " << outDir
+              << " (run with --update to accept)\n";
+    return 1;
+  }
+  if (checkFailures > 0) {
+    return 1;
+  }
+  std::cout << "All golden frames match\n";
+  return 0;
+}
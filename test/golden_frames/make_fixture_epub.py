@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""
+Pack a single XHTML page into a one-chapter EPUB, so GoldenFrameTest can open it through the reader's Epub class.
+
+Stylesheets and images the page links with relative paths are packed next to it under the same names.
+
+Usage: make_fixture_epub.py <page.xhtml> <output.epub>
+"""
+
+import sys
+import zipfile
+from html.parser import HTMLParser
+from pathlib import Path
+
+MEDIA_TYPES = {
+    ".css": "text/css",
+    ".jpg": "image/jpeg",
+    ".jpeg": "image/jpeg",
+    ".png": "image/png",
+}
+
+
+def linked_resources(document):
+    resources = []
+
+    class LinkFinder(HTMLParser):
+        def handle_starttag(self, tag, attrs):
+            a = dict(attrs)
+            if tag == "link" and "stylesheet" in (a.get("rel") or "") and a.get("href"):
+                resources.append(a["href"])
+            elif tag == "img" and a.get("src"):
+                resources.append(a["src"])
+
+        handle_startendtag = handle_starttag
+
+    LinkFinder().feed(document)
+    return list(dict.fromkeys(resources))
+
+
+def pack(source, output):
+    document = source.read_text(encoding="utf-8")
+    resources = linked_resources(document)
+    title = source.stem
+
+    manifest = ['<item id="page" href="page.xhtml" media-type="application/xhtml+xml"/>']
+    for i, href in enumerate(resources):
+        media_type = MEDIA_TYPES.get(Path(href).suffix.lower(), "application/octet-stream")
+        manifest.append(f'<item id="res{i}" href="{href}" media-type="{media_type}"/>')
+
+    output.parent.mkdir(parents=True, exist_ok=True)
+    with zipfile.ZipFile(output, "w", zipfile.ZIP_DEFLATED) as epub:
+        epub.writestr(zipfile.ZipInfo("mimetype"), "application/epub+zip", compress_type=zipfile.ZIP_STORED)
+        epub.writestr(
+            "META-INF/container.xml",
+            '<?xml version="1.0"?>\n'
+            '<container version="1.0" xmlns="urn:oasis:names:tc:opendocument:xmlns:container">'
+            '<rootfiles><rootfile full-path="OEBPS/content.opf" media-type="application/oebps-package+xml"/>'
+            "</rootfiles></container>",
+        )
+        epub.writestr(
+            "OEBPS/content.opf",
+            '<?xml version="1.0" encoding="UTF-8"?>\n'
+            '<package xmlns="http://www.idpf.org/2007/opf" version="2.0" unique-identifier="id">'
+            '<metadata xmlns:dc="http://purl.org/dc/elements/1.1/">'
+            f'<dc:title>{title}</dc:title><dc:identifier id="id">fixture-{title}</dc:identifier>'
+            "<dc:language>en</dc:language></metadata>"
+            f"<manifest>{''.join(manifest)}</manifest>"
+            '<spine><itemref idref="page"/></spine></package>',
+        )
+        epub.writestr("OEBPS/page.xhtml", document)
+        for href in resources:
+            epub.write(source.parent / href, f"OEBPS/{href}")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        print(__doc__)
+        sys.exit(1)
+    pack(Path(sys.argv[1]), Path(sys.argv[2]))
@@ -0,0 +1,33 @@
+#pragma once
+
+// Host (Linux) stand-in for the Arduino core, just enough for the library code exercised by the tests in test/.
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+inline unsigned long millis() {
+  using namespace std::chrono;
+  static const auto start = steady_clock::now();
+  return static_cast<unsigned long>(duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
+
+inline unsigned long micros() {
+  using namespace std::chrono;
+  static const auto start = steady_clock::now();
+  return static_cast<unsigned long>(duration_cast<microseconds>(steady_clock::now() - start).count());
+}
+
+inline void delay(unsigned long) {}
+
+struct HostEsp {
+  // Report a comfortable heap so low-memory guards (e.g. CssParser) never trip on host
+  uint32_t getFreeHeap() const { return 200 * 1024; }
+  uint32_t getMaxAllocHeap() const { return 100 * 1024; }
+};
+
+inline HostEsp ESP;
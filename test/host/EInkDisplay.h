@@ -0,0 +1,82 @@
+#pragma once
+
+// Host stand-in for the SDK's EInkDisplay driver. Keeps the BW frame buffer and the two grayscale planes in memory
+// so tests can inspect exactly what would have been sent to the panel. There is only ever one panel, so the
+// captured planes and counters are exposed through static accessors.
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+class EInkDisplay {
+ public:
+  enum RefreshMode { FULL_REFRESH, HALF_REFRESH, FAST_REFRESH };
+
+  static constexpr uint16_t DISPLAY_WIDTH = 800;
+  static constexpr uint16_t DISPLAY_HEIGHT = 480;
+  static constexpr uint32_t BUFFER_SIZE = DISPLAY_WIDTH / 8 * DISPLAY_HEIGHT;
+
+  EInkDisplay(int8_t, int8_t, int8_t, int8_t, int8_t, int8_t) : frameBuffer(BUFFER_SIZE, 0xFF) {
+    lsbPlane().assign(BUFFER_SIZE, 0x00);
+    msbPlane().assign(BUFFER_SIZE, 0x00);
+  }
+
+  void begin() {}
+  void clearScreen(const uint8_t color = 0xFF) const { memset(frameBuffer.data(), color, BUFFER_SIZE); }
+  void drawImage(const uint8_t* imageData, uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool = false) const {
+    blit(imageData, x, y, w, h, false);
+  }
+  void drawImageTransparent(const uint8_t* imageData, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                            bool = false) const {
+    blit(imageData, x, y, w, h, true);
+  }
+
+  void displayBuffer(RefreshMode = FAST_REFRESH, bool = false) { counters().bwFrames++; }
+  void displayHighlightBuffer(bool = false) { counters().bwFrames++; }
+  void refreshDisplay(RefreshMode = FAST_REFRESH, bool = false) {}
+  void deepSleep() {}
+
+  uint8_t* getFrameBuffer() const { return frameBuffer.data(); }
+
+  void copyGrayscaleBuffers(const uint8_t* lsbBuffer, const uint8_t* msbBuffer) {
+    copyGrayscaleLsbBuffers(lsbBuffer);
+    copyGrayscaleMsbBuffers(msbBuffer);
+  }
+  void copyGrayscaleLsbBuffers(const uint8_t* lsbBuffer) { memcpy(lsbPlane().data(), lsbBuffer, BUFFER_SIZE); }
+  void copyGrayscaleMsbBuffers(const uint8_t* msbBuffer) { memcpy(msbPlane().data(), msbBuffer, BUFFER_SIZE); }
+  void cleanupGrayscaleBuffers(const uint8_t*) {}
+  void displayGrayBuffer(bool = false) { counters().grayFrames++; }
+
+  // --- Host-only inspection ---
+  struct Counters {
+    uint32_t bwFrames = 0;
+    uint32_t grayFrames = 0;
+  };
+  static std::vector<uint8_t>& lsbPlane() {
+    static std::vector<uint8_t> plane;
+    return plane;
+  }
+  static std::vector<uint8_t>& msbPlane() {
+    static std::vector<uint8_t> plane;
+    return plane;
+  }
+  static Counters& counters() {
+    static Counters c;
+    return c;
+  }
+
+ private:
+  mutable std::vector<uint8_t> frameBuffer;
+
+  void blit(const uint8_t* imageData, const uint16_t x, const uint16_t y, const uint16_t w, const uint16_t h,
+            const bool transparent) const {
+    const uint16_t widthBytes = w / 8;
+    for (uint16_t row = 0; row < h && y + row < DISPLAY_HEIGHT; row++) {
+      for (uint16_t col = 0; col < widthBytes && x / 8 + col < DISPLAY_WIDTH / 8; col++) {
+        uint8_t& dst = frameBuffer[(y + row) * (DISPLAY_WIDTH / 8) + x / 8 + col];
+        const uint8_t src = imageData[row * widthBytes + col];
+        dst = transparent ? (dst & src) : src;
+      }
+    }
+  }
+};
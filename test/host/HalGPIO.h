@@ -0,0 +1,10 @@
+#pragma once
+
+// Host stand-in for lib/hal/HalGPIO.h: only the display pin numbers HalDisplay.cpp needs.
+
+#define EPD_SCLK 8
+#define EPD_MOSI 10
+#define EPD_CS 21
+#define EPD_DC 4
+#define EPD_RST 5
+#define EPD_BUSY 6
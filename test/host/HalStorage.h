@@ -0,0 +1,178 @@
+#pragma once
+
+// Host stand-in for lib/hal/HalStorage.h. FsFile is backed by stdio and paths are used as-is on the host
+// filesystem, so library code that persists caches can be exercised against a temporary directory. Every call that
+// would be an SD transaction on device is counted in FsFile::counters() so tests can measure I/O patterns.
+
+#include <Print.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+class FsFile : public Print {
+  std::shared_ptr<FILE> fp;
+  std::string path;
+
+ public:
+  FsFile() = default;
+
+  bool openPath(const char* path, const char* mode) {
+    FILE* raw = fopen(path, mode);
+    if (!raw) {
+      fp.reset();
+      return false;
+    }
+    fp.reset(raw, fclose);
+    this->path = path;
+    return true;
+  }
+
+  explicit operator bool() const { return fp != nullptr; }
+  bool isOpen() const { return fp != nullptr; }
+
+  int read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+  }
+  int read(void* buf, const size_t count) {
+    if (!fp) return -1;
+    const size_t n = fread(buf, 1, count, fp.get());
+    counters().reads++;
+    counters().bytesRead += n;
+    return static_cast<int>(n);
+  }
+  size_t write(const uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, const size_t count) override { return write(static_cast<const void*>(buf), count); }
+  size_t write(const void* buf, const size_t count) {
+    if (!fp) return 0;
+    int64_t& limit = writeLimit();
+    const size_t allowed = limit < 0 ? count : std::min(count, static_cast<size_t>(limit));
+    const size_t n = fwrite(buf, 1, allowed, fp.get());
+    if (limit >= 0) limit -= static_cast<int64_t>(n);
+    counters().writes++;
+    counters().bytesWritten += n;
+    return n;
+  }
+
+  uint32_t position() const { return fp ? static_cast<uint32_t>(ftell(fp.get())) : 0; }
+  uint32_t size() const {
+    if (!fp) return 0;
+    struct stat st{};
+    fflush(fp.get());
+    return fstat(fileno(fp.get()), &st) == 0 ? static_cast<uint32_t>(st.st_size) : 0;
+  }
+  int available() const { return fp ? static_cast<int>(size() - position()) : 0; }
+  bool seek(const uint32_t pos) { return seekSet(pos); }
+  bool seekSet(const uint32_t pos) {
+    counters().seeks++;
+    return fp && fseek(fp.get(), static_cast<long>(pos), SEEK_SET) == 0;
+  }
+  bool seekCur(const int32_t offset) {
+    counters().seeks++;
+    return fp && fseek(fp.get(), offset, SEEK_CUR) == 0;
+  }
+  void flush() {
+    if (fp) fflush(fp.get());
+  }
+  bool sync() {
+    flush();
+    return fp != nullptr;
+  }
+  void close() { fp.reset(); }
+
+  bool isDirectory() const { return std::filesystem::is_directory(path); }
+  // FAT date and time words, as SdFat reports them
+  bool getModifyDateTime(uint16_t* date, uint16_t* time) const {
+    struct stat st{};
+    if (stat(path.c_str(), &st) != 0) {
+      return false;
+    }
+    struct tm t{};
+    localtime_r(&st.st_mtime, &t);
+    *date = static_cast<uint16_t>((t.tm_year - 80) << 9 | (t.tm_mon + 1) << 5 | t.tm_mday);
+    *time = static_cast<uint16_t>(t.tm_hour << 11 | t.tm_min << 5 | t.tm_sec / 2);
+    return true;
+  }
+  bool rename(const char* newPath) {
+    if (::rename(path.c_str(), newPath) != 0) {
+      return false;
+    }
+    path = newPath;
+    return true;
+  }
+
+  // --- Host-only inspection ---
+  struct Counters {
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t seeks = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+  };
+  static Counters& counters() {
+    static Counters c;
+    return c;
+  }
+  // Bytes all later writes may still store, negative for no limit. A write past it stores what fits and comes up
+  // short, like a full or failing card.
+  static int64_t& writeLimit() {
+    static int64_t limit = -1;
+    return limit;
+  }
+};
+
+class HalStorage {
+ public:
+  bool begin() { return true; }
+  bool ready() const { return true; }
+
+  bool exists(const char* path) {
+    struct stat st{};
+    return stat(path, &st) == 0;
+  }
+  bool remove(const char* path) { return ::remove(path) == 0; }
+  bool mkdir(const char* path, bool = true) { return ::mkdir(path, 0755) == 0 || exists(path); }
+  bool rmdir(const char* path) { return ::rmdir(path) == 0; }
+  bool removeDir(const char* path) {
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);
+    return !ec;
+  }
+  // Directories open too (read-only), for stat-like use
+  FsFile open(const char* path) {
+    FsFile file;
+    file.openPath(path, "rb");
+    return file;
+  }
+  bool ensureDirectoryExists(const char* path) { return mkdir(path); }
+
+  bool openFileForRead(const char*, const char* path, FsFile& file) { return file.openPath(path, "rb"); }
+  bool openFileForRead(const char* moduleName, const std::string& path, FsFile& file) {
+    return openFileForRead(moduleName, path.c_str(), file);
+  }
+  // Read-write like the device's O_RDWR, so BufferedFile can read back a block it seeks into
+  bool openFileForWrite(const char*, const char* path, FsFile& file) { return file.openPath(path, "w+b"); }
+  bool openFileForWrite(const char* moduleName, const std::string& path, FsFile& file) {
+    return openFileForWrite(moduleName, path.c_str(), file);
+  }
+  bool openFileForAppend(const char*, const std::string& path, FsFile& file) {
+    if (!file.openPath(path.c_str(), "r+b") && !file.openPath(path.c_str(), "w+b")) {
+      return false;
+    }
+    file.seekSet(file.size());
+    return true;
+  }
+
+  static HalStorage& getInstance() {
+    static HalStorage instance;
+    return instance;
+  }
+};
+
+#define Storage HalStorage::getInstance()
@@ -0,0 +1,11 @@
+#pragma once
+
+// Host stand-in for lib/Logging: nothing is printed, as in a build without ENABLE_SERIAL_LOG. The arguments still go
+// to a no-op so values computed only for a log line (durations, sizes) don't trip -Wunused on host.
+
+template <typename... Args>
+inline void hostLogDiscard(const char*, const char*, const Args&...) {}
+
+#define LOG_ERR(origin, format, ...) hostLogDiscard(origin, format __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_INF(origin, format, ...) hostLogDiscard(origin, format __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_DBG(origin, format, ...) hostLogDiscard(origin, format __VA_OPT__(, ) __VA_ARGS__)
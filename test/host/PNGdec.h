@@ -0,0 +1,225 @@
+#pragma once
+
+// Host stand-in for bitbank2/PNGdec, which has no host build. Implements the subset PngToFramebufferConverter uses
+// with the same contract: the draw callback gets each unfiltered scanline as stored in the file (packed below 8 bits
+// per sample), with the palette in RGB triplets followed by 256 alpha values. Decodes with the vendored miniz.
+// Interlaced images are rejected, as PNGdec does.
+
+#include <miniz.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifndef PNG_MAX_BUFFERED_PIXELS
+#define PNG_MAX_BUFFERED_PIXELS ((320 * 4 + 1) * 2)
+#endif
+
+enum {
+  PNG_SUCCESS = 0,
+  PNG_INVALID_PARAMETER,
+  PNG_DECODE_ERROR,
+  PNG_MEM_ERROR,
+  PNG_NO_BUFFER,
+  PNG_UNSUPPORTED_FEATURE,
+  PNG_INVALID_FILE,
+  PNG_TOO_BIG,
+  PNG_QUIT_EARLY,
+};
+
+enum {
+  PNG_PIXEL_GRAYSCALE = 0,
+  PNG_PIXEL_TRUECOLOR = 2,
+  PNG_PIXEL_INDEXED = 3,
+  PNG_PIXEL_GRAY_ALPHA = 4,
+  PNG_PIXEL_TRUECOLOR_ALPHA = 6,
+};
+
+struct PNGFILE {
+  int32_t iPos;
+  int32_t iSize;
+  void* fHandle;
+};
+
+struct PNGDRAW {
+  int y;
+  int iWidth;
+  int iPitch;
+  int iPixelType;
+  int iBpp;
+  int iHasAlpha;
+  void* pUser;
+  uint8_t* pPalette;
+  uint8_t* pPixels;
+};
+
+typedef void*(PNG_OPEN_CALLBACK)(const char* filename, int32_t* size);
+typedef void(PNG_CLOSE_CALLBACK)(void* handle);
+typedef int32_t(PNG_READ_CALLBACK)(PNGFILE* file, uint8_t* buffer, int32_t length);
+typedef int32_t(PNG_SEEK_CALLBACK)(PNGFILE* file, int32_t position);
+typedef int(PNG_DRAW_CALLBACK)(PNGDRAW* draw);
+
+class PNG {
+  PNGFILE file{};
+  PNG_CLOSE_CALLBACK* closeFn = nullptr;
+  PNG_DRAW_CALLBACK* drawFn = nullptr;
+  std::vector<uint8_t> idat;
+  uint8_t palette[768 + 256] = {};
+  int width = 0;
+  int height = 0;
+  int bpp = 0;
+  int pixelType = 0;
+  int alpha = 0;
+  int lastError = PNG_SUCCESS;
+
+  static uint32_t be32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 8 |
+           p[3];
+  }
+
+  int channels() const {
+    switch (pixelType) {
+      case PNG_PIXEL_TRUECOLOR:
+        return 3;
+      case PNG_PIXEL_GRAY_ALPHA:
+        return 2;
+      case PNG_PIXEL_TRUECOLOR_ALPHA:
+        return 4;
+      default:
+        return 1;
+    }
+  }
+
+  static uint8_t paeth(const int a, const int b, const int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+  }
+
+  int fail(const int error) {
+    lastError = error;
+    return error;
+  }
+
+ public:
+  int open(const char* filename, PNG_OPEN_CALLBACK* openFn, PNG_CLOSE_CALLBACK* close, PNG_READ_CALLBACK* readFn,
+           PNG_SEEK_CALLBACK*, PNG_DRAW_CALLBACK* draw) {
+    closeFn = close;
+    drawFn = draw;
+    idat.clear();
+    memset(palette, 0xFF, sizeof(palette));
+    file = PNGFILE{};
+    file.fHandle = openFn(filename, &file.iSize);
+    if (!file.fHandle) {
+      return fail(PNG_INVALID_FILE);
+    }
+
+    std::vector<uint8_t> data(static_cast<size_t>(file.iSize));
+    if (file.iSize < 8 || readFn(&file, data.data(), file.iSize) != file.iSize ||
+        memcmp(data.data(), "\x89PNG\r\n\x1a\n", 8) != 0) {
+      return fail(PNG_INVALID_FILE);
+    }
+    size_t pos = 8;
+    bool haveHeader = false;
+    while (pos + 12 <= data.size()) {
+      const uint32_t length = be32(&data[pos]);
+      const uint8_t* type = &data[pos + 4];
+      const uint8_t* body = &data[pos + 8];
+      if (length > data.size() - pos - 12) {
+        return fail(PNG_INVALID_FILE);
+      }
+      if (memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+        width = static_cast<int>(be32(body));
+        height = static_cast<int>(be32(body + 4));
+        bpp = body[8];
+        pixelType = body[9];
+        alpha = pixelType == PNG_PIXEL_GRAY_ALPHA || pixelType == PNG_PIXEL_TRUECOLOR_ALPHA;
+        if (body[12] != 0) {
+          return fail(PNG_UNSUPPORTED_FEATURE);
+        }
+        haveHeader = true;
+      } else if (memcmp(type, "PLTE", 4) == 0) {
+        memcpy(palette, body, length < 768 ? length : 768);
+      } else if (memcmp(type, "tRNS", 4) == 0 && pixelType == PNG_PIXEL_INDEXED) {
+        memcpy(palette + 768, body, length < 256 ? length : 256);
+        alpha = 1;
+      } else if (memcmp(type, "IDAT", 4) == 0) {
+        idat.insert(idat.end(), body, body + length);
+      } else if (memcmp(type, "IEND", 4) == 0) {
+        break;
+      }
+      pos += 12 + length;
+    }
+    return fail(haveHeader && !idat.empty() ? PNG_SUCCESS : PNG_INVALID_FILE);
+  }
+
+  void close() {
+    if (closeFn && file.fHandle) {
+      closeFn(file.fHandle);
+    }
+    file.fHandle = nullptr;
+    idat.clear();
+  }
+
+  int decode(void* user, int) {
+    const int bytesPerPixel = (channels() * bpp + 7) / 8;
+    const size_t pitch = (static_cast<size_t>(width) * channels() * bpp + 7) / 8;
+    std::vector<uint8_t> raw((pitch + 1) * height);
+    mz_ulong rawSize = raw.size();
+    if (mz_uncompress(raw.data(), &rawSize, idat.data(), idat.size()) != MZ_OK || rawSize != raw.size()) {
+      return fail(PNG_DECODE_ERROR);
+    }
+
+    std::vector<uint8_t> previous(pitch, 0);
+    PNGDRAW draw{};
+    draw.iWidth = width;
+    draw.iPitch = static_cast<int>(pitch);
+    draw.iPixelType = pixelType;
+    draw.iBpp = bpp;
+    draw.iHasAlpha = alpha;
+    draw.pUser = user;
+    draw.pPalette = palette;
+    for (int y = 0; y < height; y++) {
+      const uint8_t filter = raw[y * (pitch + 1)];
+      uint8_t* line = &raw[y * (pitch + 1) + 1];
+      for (size_t i = 0; i < pitch; i++) {
+        const int left = i >= static_cast<size_t>(bytesPerPixel) ? line[i - bytesPerPixel] : 0;
+        const int up = previous[i];
+        const int upLeft = i >= static_cast<size_t>(bytesPerPixel) ? previous[i - bytesPerPixel] : 0;
+        switch (filter) {
+          case 1:
+            line[i] += left;
+            break;
+          case 2:
+            line[i] += up;
+            break;
+          case 3:
+            line[i] += (left + up) / 2;
+            break;
+          case 4:
+            line[i] += paeth(left, up, upLeft);
+            break;
+          default:
+            break;
+        }
+      }
+      memcpy(previous.data(), line, pitch);
+      draw.y = y;
+      draw.pPixels = line;
+      if (!drawFn(&draw)) {
+        return fail(PNG_QUIT_EARLY);
+      }
+    }
+    return fail(PNG_SUCCESS);
+  }
+
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+  int getBpp() const { return bpp; }
+  int getPixelType() const { return pixelType; }
+  int hasAlpha() const { return alpha; }
+  int getLastError() const { return lastError; }
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+// Host stand-in for the Arduino core's Print: the byte sink ZipFile and Epub stream entries into.
+
+#include <cstddef>
+#include <cstdint>
+
+class Print {
+ public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (n < size && write(buffer[n]) == 1) {
+      n++;
+    }
+    return n;
+  }
+};
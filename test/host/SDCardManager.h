@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stand-in for the SDK's SDCardManager: library code only needs FsFile from it, which HalStorage.h provides.
+
+#include <HalStorage.h>
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stand-in for SdFat: FsFile comes from HalStorage.h.
+
+#include <HalStorage.h>
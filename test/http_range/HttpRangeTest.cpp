@@ -0,0 +1,118 @@
+// Checks the download handler's Range parsing (src/network/HttpRange) against the cases of RFC 9110, section 14.
+// Usage: HttpRangeTest
+
+#include <HttpRange.h>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace {
+
+using HttpRange::Result;
+
+int failures = 0;
+
+const char* name(const Result result) {
+  switch (result) {
+    case Result::Whole:
+      return "Whole";
+    case Result::Partial:
+      return "Partial";
+    case Result::Unsatisfiable:
+      return "Unsatisfiable";
+  }
+  return "?";
+}
+
+void expectResult(const char* header, const size_t size, const Result expected) {
+  size_t first = 0;
+  size_t last = 0;
+  const Result result = HttpRange::parse(header, size, first, last);
+  if (result != expected) {
+    std::cerr << "FAIL: \"" << header << "\" of " << size << " bytes: " << name(result) << ", expected "
+              << name(expected) << "\n";
+    failures++;
+  }
+}
+
+void expectPartial(const char* header, const size_t size, const size_t expectedFirst, const size_t expectedLast) {
+  size_t first = SIZE_MAX;
+  size_t last = SIZE_MAX;
+  const Result result = HttpRange::parse(header, size, first, last);
+  if (result != Result::Partial || first != expectedFirst || last != expectedLast) {
+    std::cerr << "FAIL: \"" << header << "\" of " << size << " bytes: " << name(result) << " " << first << "-" << last
+              << ", expected Partial " << expectedFirst << "-" << expectedLast << "\n";
+    failures++;
+  }
+}
+
+void testSingleRanges() {
+  expectPartial("bytes=0-99", 1000, 0, 99);
+  expectPartial("bytes=100-199", 1000, 100, 199);
+  expectPartial("bytes=999-999", 1000, 999, 999);
+  expectPartial("bytes=500-", 1000, 500, 999);
+  expectPartial("bytes=0-", 1000, 0, 999);
+  // The end is clamped to the file
+  expectPartial("bytes=900-5000", 1000, 900, 999);
+}
+
+void testSuffixRanges() {
+  expectPartial("bytes=-100", 1000, 900, 999);
+  expectPartial("bytes=-1", 1000, 999, 999);
+  // Longer than the file: all of it
+  expectPartial("bytes=-5000", 1000, 0, 999);
+  expectResult("bytes=-0", 1000, Result::Unsatisfiable);
+  expectResult("bytes=-10", 0, Result::Unsatisfiable);
+}
+
+void testUnsatisfiable() {
+  expectResult("bytes=1000-", 1000, Result::Unsatisfiable);
+  expectResult("bytes=1000-1999", 1000, Result::Unsatisfiable);
+  expectResult("bytes=0-", 0, Result::Unsatisfiable);
+}
+
+// Everything that isn't a single range in bytes gets the whole file
+void testWholeFile() {
+  expectResult("", 1000, Result::Whole);
+  expectResult("bytes=", 1000, Result::Whole);
+  expectResult("bytes=-", 1000, Result::Whole);
+  expectResult("bytes=100", 1000, Result::Whole);
+  expectResult("bytes=200-100", 1000, Result::Whole);
+  expectResult("bytes=0-99,200-299", 1000, Result::Whole);
+  expectResult("bytes=0-99, 200-", 1000, Result::Whole);
+  expectResult("items=0-99", 1000, Result::Whole);
+  expectResult("Bytes=0-99", 1000, Result::Whole);
+  expectResult("bytes= 0-99", 1000, Result::Whole);
+  expectResult("bytes=0-99 ", 1000, Result::Whole);
+  expectResult("bytes=a-99", 1000, Result::Whole);
+  expectResult("bytes=0-9x", 1000, Result::Whole);
+  expectResult("bytes=+1-99", 1000, Result::Whole);
+  expectResult("bytes=1--2", 1000, Result::Whole);
+}
+
+void testOverflow() {
+  const std::string huge = "bytes=" + std::to_string(SIZE_MAX) + "0-";
+  expectResult(huge.c_str(), 1000, Result::Whole);
+  const std::string hugeEnd = "bytes=0-" + std::to_string(SIZE_MAX) + "0";
+  expectResult(hugeEnd.c_str(), 1000, Result::Whole);
+  const std::string max = "bytes=0-" + std::to_string(SIZE_MAX);
+  expectPartial(max.c_str(), 1000, 0, 999);
+}
+
+}  // namespace
+
+int main() {
+  testSingleRanges();
+  testSuffixRanges();
+  testUnsatisfiable();
+  testWholeFile();
+  testOverflow();
+
+  if (failures > 0) {
+    std::cerr << failures << " failure(s)\n";
+    return 1;
+  }
+  std::cout << "HttpRange: all cases passed\n";
+  return 0;
+}
@@ -0,0 +1,260 @@
+// Cuts RecordJournal writes short at every byte offset, as a power loss would, and checks that the newest complete
+// record is always the one recovered; also fails writes while the journal keeps running. Usage: RecordJournalTest
+// --work <dir>
+
+#include <HalStorage.h>
+#include <RecordJournal.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Magic, sequence and length before the payload, CRC-32 after it
+constexpr size_t RECORD_OVERHEAD = 2 + 4 + 2 + 4;
+
+int failures = 0;
+
+void expect(const bool condition, const std::string& what) {
+  if (!condition) {
+    std::cerr << "FAIL: " << what << "\n";
+    failures++;
+  }
+}
+
+// Payloads of varying length so records straddle the rotation point at different offsets
+std::string payloadFor(const int k) {
+  std::string payload = "record " + std::to_string(k) + ":";
+  payload.append(20 + (k * 37) % 380, static_cast<char>('a' + k % 26));
+  return payload;
+}
+
+struct Snapshot {
+  bool exists = false;
+  std::string data;
+};
+
+Snapshot readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return {};
+  }
+  return {true, std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>())};
+}
+
+void restoreFile(const std::string& path, const Snapshot& snapshot) {
+  if (!snapshot.exists) {
+    ::remove(path.c_str());
+    return;
+  }
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << snapshot.data;
+}
+
+void clearJournal(const RecordJournal& journal) {
+  ::remove(journal.filePath(0).c_str());
+  ::remove(journal.filePath(1).c_str());
+}
+
+std::string loadFresh(const std::string& base, bool* found = nullptr) {
+  RecordJournal journal(base);
+  std::string payload;
+  const bool ok = journal.load(payload);
+  if (found) *found = ok;
+  return ok ? payload : std::string();
+}
+
+// For every append of a long run, replay it from the state before and cut the record short at each byte: truncated
+// (the file size never got updated) and padded with junk (the size did, the data didn't).
+void testPowerLossSweep(const std::string& work) {
+  const std::string base = work + "/sweep";
+  RecordJournal journal(base);
+  clearJournal(journal);
+
+  constexpr int APPENDS = 120;  // ~28KB of records: both files fill and rotate
+  int cutsChecked = 0;
+  for (int k = 0; k < APPENDS; k++) {
+    const Snapshot before[2] = {readFile(journal.filePath(0)), readFile(journal.filePath(1))};
+    const std::string payload = payloadFor(k);
+
+    // Which file and where the record lands, from an uninterrupted append
+    {
+      RecordJournal probe(base);
+      expect(probe.append(payload), "append " + std::to_string(k));
+    }
+    const Snapshot after[2] = {readFile(journal.filePath(0)), readFile(journal.filePath(1))};
+    int target = -1;
+    for (int i = 0; i < 2; i++) {
+      if (after[i].data != before[i].data) target = i;
+    }
+    if (target < 0) {
+      expect(false, "append " + std::to_string(k) + " changed no file");
+      return;
+    }
+    const size_t recordSize = RECORD_OVERHEAD + payload.size();
+    const size_t recordStart = after[target].data.size() - recordSize;
+    expect(after[target].data.size() >= recordSize, "record " + std::to_string(k) + " fits its file");
+
+    // Every byte for the first appends, the ones that switch files and a regular sample; the ends and the middle of
+    // the rest (a full sweep of all of them takes over a minute)
+    const bool switched = !before[target].exists || after[target].data.size() == recordSize;
+    const bool fullSweep = k < 4 || switched || k % 10 == 0;
+    std::vector<size_t> cuts = {0, 1, recordSize / 2, recordSize - 1, recordSize};
+    if (fullSweep) {
+      cuts.clear();
+      for (size_t cut = 0; cut <= recordSize; cut++) cuts.push_back(cut);
+    }
+    for (const size_t cut : cuts) {
+      for (const bool junk : {false, true}) {
+        if (junk && cut == recordSize) continue;
+        restoreFile(journal.filePath(target), after[target]);
+        restoreFile(journal.filePath(target ^ 1), after[target ^ 1]);
+        const std::string path = journal.filePath(target);
+        if (::truncate(path.c_str(), static_cast<off_t>(recordStart + cut)) != 0) {
+          expect(false, "truncate " + path);
+          return;
+        }
+        if (junk) {
+          // Inverted, so no junk byte can happen to be the one that was meant to be there
+          std::string tail = after[target].data.substr(recordStart + cut);
+          for (char& c : tail) c = static_cast<char>(~c);
+          std::ofstream(path, std::ios::binary | std::ios::app) << tail;
+        }
+
+        const std::string label = "append " + std::to_string(k) + " cut at " + std::to_string(cut) + "/" +
+                                  std::to_string(recordSize) + (junk ? " + junk" : "");
+        bool found = false;
+        const std::string recovered = loadFresh(base, &found);
+        if (cut == recordSize) {
+          expect(found && recovered == payload, label + ": complete record recovered");
+        } else if (k == 0) {
+          expect(!found, label + ": nothing recovered");
+        } else {
+          expect(found && recovered == payloadFor(k - 1), label + ": previous record recovered");
+        }
+
+        // Saving goes on after the torn record and its result wins
+        {
+          RecordJournal next(base);
+          expect(next.append("after"), label + ": append after recovery");
+        }
+        expect(loadFresh(base) == "after", label + ": record after recovery recovered");
+        cutsChecked++;
+      }
+    }
+
+    restoreFile(journal.filePath(0), after[0]);
+    restoreFile(journal.filePath(1), after[1]);
+  }
+  std::cout << "power loss: " << cutsChecked << " cut points over " << APPENDS << " appends\n";
+}
+
+// One journal instance saving many times, as the reader does: files stay bounded and the newest record wins
+void testLongRun(const std::string& work) {
+  RecordJournal journal(work + "/run");
+  clearJournal(journal);
+  for (int k = 0; k < 1000; k++) {
+    expect(journal.append(payloadFor(k)), "long run append " + std::to_string(k));
+  }
+  for (int i = 0; i < 2; i++) {
+    expect(readFile(journal.filePath(i)).data.size() <= RecordJournal::MAX_FILE_SIZE, "file size bounded");
+  }
+  expect(loadFresh(work + "/run") == payloadFor(999), "long run newest record");
+}
+
+// Writes that come up short inside the process (full or failing card), twice in a row after every record, so the
+// failures hit appends, rotations and the retry after a failed rotation. The newest saved record must survive them.
+void testFailedWrites(const std::string& work) {
+  RecordJournal journal(work + "/failing");
+  clearJournal(journal);
+  int failedWrites = 0;
+  for (int k = 0; k < 120; k++) {
+    const std::string label = "append " + std::to_string(k);
+    expect(journal.append(payloadFor(k)), label);
+    for (const int64_t stored : {0, 5, 30}) {
+      FsFile::writeLimit() = stored;
+      expect(!journal.append(payloadFor(1000 + k)), label + ": short write reported");
+      expect(!journal.append(payloadFor(2000 + k)), label + ": second short write reported");
+      FsFile::writeLimit() = -1;
+      failedWrites += 2;
+      expect(loadFresh(work + "/failing") == payloadFor(k), label + ": survives " + std::to_string(stored) +
+                                                                 "-byte short writes");
+    }
+  }
+  for (int i = 0; i < 2; i++) {
+    expect(readFile(journal.filePath(i)).data.size() <= RecordJournal::MAX_FILE_SIZE, "file size bounded");
+  }
+  expect(journal.append("after"), "append after failed writes");
+  expect(loadFresh(work + "/failing") == "after", "record after failed writes recovered");
+  std::cout << "failed writes: " << failedWrites << " over 120 appends\n";
+}
+
+void testCorruptCrc(const std::string& work) {
+  RecordJournal journal(work + "/crc");
+  clearJournal(journal);
+  journal.append("one");
+  journal.append("two");
+  journal.append("three");
+
+  Snapshot file = readFile(journal.filePath(0));
+  file.data[file.data.size() - 6] ^= 0x01;  // Inside "three"
+  restoreFile(journal.filePath(0), file);
+  expect(loadFresh(work + "/crc") == "two", "record with a bad CRC is skipped");
+
+  RecordJournal next(work + "/crc");
+  next.append("four");
+  expect(loadFresh(work + "/crc") == "four", "append after a bad CRC");
+}
+
+void testLegacy(const std::string& work) {
+  const std::string legacy = work + "/legacy.bin";
+  RecordJournal journal(work + "/legacy", legacy);
+  clearJournal(journal);
+  std::ofstream(legacy, std::ios::binary | std::ios::trunc) << std::string("old\0state", 9);
+
+  std::string payload;
+  expect(journal.load(payload) && payload == std::string("old\0state", 9), "legacy file loaded whole");
+  expect(journal.append("new"), "append over legacy");
+  expect(!readFile(legacy).exists, "legacy file removed after the first save");
+  RecordJournal reopened(work + "/legacy", legacy);
+  expect(reopened.load(payload) && payload == "new", "journal wins over legacy");
+}
+
+void testLimits(const std::string& work) {
+  RecordJournal journal(work + "/limits");
+  clearJournal(journal);
+  std::string payload;
+  expect(!journal.load(payload), "empty journal loads nothing");
+  expect(!journal.append(std::string(RecordJournal::MAX_PAYLOAD + 1, 'x')), "oversized payload refused");
+  expect(journal.append(std::string()), "empty payload");
+  expect(journal.load(payload) && payload.empty(), "empty payload recovered");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string work = ".";
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--work") == 0 && i + 1 < argc) {
+      work = argv[++i];
+    }
+  }
+
+  testLimits(work);
+  testLegacy(work);
+  testCorruptCrc(work);
+  testLongRun(work);
+  testFailedWrites(work);
+  testPowerLossSweep(work);
+
+  if (failures > 0) {
+    std::cerr << failures << " failure(s)\n";
+    return 1;
+  }
+  std::cout << "All record journal tests passed\n";
+  return 0;
+}
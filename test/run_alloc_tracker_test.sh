@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+BUILD_DIR="$ROOT_DIR/build/alloc_tracker"
+BINARY="$BUILD_DIR/AllocTrackerTest"
+
+mkdir -p "$BUILD_DIR"
+
+SOURCES=(
+  "$ROOT_DIR/test/alloc_tracker/AllocTrackerTest.cpp"
+  "$ROOT_DIR/lib/AllocTracker/AllocTracker.cpp"
+)
+
+CXXFLAGS=(
+  -std=c++20
+  -O2
+  -Wall
+  -Wextra
+  -pedantic
+  -DENABLE_ALLOC_TRACKER
+  -I"$ROOT_DIR/lib/AllocTracker"
+)
+
+c++ "${CXXFLAGS[@]}" "${SOURCES[@]}" -o "$BINARY"
+
+"$BINARY" "$@"
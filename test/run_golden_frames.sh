@@ -0,0 +1,127 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Renders test/epubs/*.epub and test/golden_frames/fixtures/*.xhtml on the host and compares every frame against
+# test/golden_frames/golden.txt. Pass --update to accept the current output as the new golden set.
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+BUILD_DIR="$ROOT_DIR/build/golden_frames"
+BINARY="$BUILD_DIR/GoldenFrameTest"
+
+mkdir -p "$BUILD_DIR/obj" "$BUILD_DIR/books" "$BUILD_DIR/frames"
+
+BOOKS=("$ROOT_DIR"/test/epubs/*.epub)
+for source in "$ROOT_DIR"/test/golden_frames/fixtures/*.xhtml; do
+  book="$BUILD_DIR/books/$(basename "${source%.*}").epub"
+  python3 "$ROOT_DIR/test/golden_frames/make_fixture_epub.py" "$source" "$book"
+  BOOKS+=("$book")
+done
+
+SOURCES=(
+  "$ROOT_DIR/test/golden_frames/GoldenFrameTest.cpp"
+  "$ROOT_DIR/lib/hal/HalDisplay.cpp"
+  "$ROOT_DIR/lib/AllocTracker/AllocTracker.cpp"
+  "$ROOT_DIR/lib/GfxRenderer/GfxRenderer.cpp"
+  "$ROOT_DIR/lib/GfxRenderer/Bitmap.cpp"
+  "$ROOT_DIR/lib/GfxRenderer/BitmapHelpers.cpp"
+  "$ROOT_DIR/lib/EpdFont/EpdFont.cpp"
+  "$ROOT_DIR/lib/EpdFont/EpdFontFamily.cpp"
+  "$ROOT_DIR/lib/EpdFont/FontDecompressor.cpp"
+  "$ROOT_DIR/lib/Epub/Epub.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/BookCacheKeys.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/BookMetadataCache.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/Page.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/ParsedText.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/Section.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/htmlEntities.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/blocks/ImageBlock.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/blocks/TextBlock.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/converters/ImageDecoderFactory.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/converters/ImageToFramebufferDecoder.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/converters/JpegToFramebufferConverter.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/converters/PngToFramebufferConverter.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/css/CssParser.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/hyphenation/Hyphenator.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/hyphenation/LanguageRegistry.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/hyphenation/LiangHyphenation.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/hyphenation/HyphenationCommon.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/parsers/ChapterHtmlSlimParser.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/parsers/ContainerParser.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/parsers/ContentOpfParser.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/parsers/TocNavParser.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/parsers/TocNcxParser.cpp"
+  "$ROOT_DIR/lib/FsHelpers/FsHelpers.cpp"
+  "$ROOT_DIR/lib/JpegToBmpConverter/JpegToBmpConverter.cpp"
+  "$ROOT_DIR/lib/PngToBmpConverter/PngToBmpConverter.cpp"
+  "$ROOT_DIR/lib/Serialization/BufferedFile.cpp"
+  "$ROOT_DIR/lib/Utf8/Utf8.cpp"
+  "$ROOT_DIR/lib/ZipFile/ZipFile.cpp"
+)
+
+C_SOURCES=(
+  "$ROOT_DIR/lib/expat/xmlparse.c"
+  "$ROOT_DIR/lib/expat/xmlrole.c"
+  "$ROOT_DIR/lib/expat/xmltok.c"
+  "$ROOT_DIR/lib/miniz/miniz.c"
+  "$ROOT_DIR/lib/picojpeg/picojpeg.c"
+  "$ROOT_DIR/lib/uzlib/src/tinflate.c"
+)
+
+# test/host must come first so its stand-ins shadow the device headers
+INCLUDES=(
+  -I"$ROOT_DIR/test/host"
+  -I"$ROOT_DIR"
+  -I"$ROOT_DIR/lib"
+  -I"$ROOT_DIR/lib/hal"
+  -I"$ROOT_DIR/lib/GfxRenderer"
+  -I"$ROOT_DIR/lib/EpdFont"
+  -I"$ROOT_DIR/lib/Epub"
+  -I"$ROOT_DIR/lib/Utf8"
+  -I"$ROOT_DIR/lib/Serialization"
+  -I"$ROOT_DIR/lib/Profiler"
+  -I"$ROOT_DIR/lib/AllocTracker"
+  -I"$ROOT_DIR/lib/FsHelpers"
+  -I"$ROOT_DIR/lib/JpegToBmpConverter"
+  -I"$ROOT_DIR/lib/PngToBmpConverter"
+  -I"$ROOT_DIR/lib/ZipFile"
+  -I"$ROOT_DIR/lib/expat"
+  -I"$ROOT_DIR/lib/miniz"
+  -I"$ROOT_DIR/lib/picojpeg"
+  -I"$ROOT_DIR/lib/uzlib/src"
+)
+
+# The platformio.ini base build_flags these libraries depend on
+DEFINES=(
+  -DMINIZ_NO_ZLIB_COMPATIBLE_NAMES=1
+  -DMINIZ_NO_STDIO=1
+  -DXML_GE=0
+  -DXML_CONTEXT_BYTES=1024
+  -DPNG_MAX_BUFFERED_PIXELS=16416
+  # The profile env's allocation tracker, so the report covers the whole reader pipeline
+  -DENABLE_ALLOC_TRACKER
+)
+
+CXXFLAGS=(
+  -std=c++20
+  -O2
+  -Wall
+  -Wextra
+  -pedantic
+  -Wno-bidi-chars
+  # The Arduino core is always in scope on device; some headers rely on it
+  -include Arduino.h
+)
+
+# Like the device link, drop unused sections (uzlib's checksum helpers are not vendored). Vendored C is built without
+# warnings, as on device.
+OBJECTS=()
+for source in "${C_SOURCES[@]}"; do
+  object="$BUILD_DIR/obj/$(basename "${source%.*}").o"
+  cc -O2 -w -ffunction-sections "${DEFINES[@]}" "${INCLUDES[@]}" -c "$source" -o "$object"
+  OBJECTS+=("$object")
+done
+c++ "${CXXFLAGS[@]}" "${DEFINES[@]}" "${INCLUDES[@]}" "${SOURCES[@]}" "${OBJECTS[@]}" -Wl,--gc-sections -o "$BINARY"
+
+cd "$ROOT_DIR"
+"$BINARY" --golden "$ROOT_DIR/test/golden_frames/golden.txt" --out "$BUILD_DIR/frames" --cache "$BUILD_DIR/cache" \
+  "$@" "${BOOKS[@]}"
@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Range header parsing of the web server's downloads (src/network/HttpRange).
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+BUILD_DIR="$ROOT_DIR/build/http_range"
+BINARY="$BUILD_DIR/HttpRangeTest"
+
+mkdir -p "$BUILD_DIR"
+
+SOURCES=(
+  "$ROOT_DIR/test/http_range/HttpRangeTest.cpp"
+  "$ROOT_DIR/src/network/HttpRange.cpp"
+)
+
+INCLUDES=(
+  -I"$ROOT_DIR/src/network"
+)
+
+CXXFLAGS=(
+  -std=c++20
+  -O2
+  -Wall
+  -Wextra
+  -pedantic
+)
+
+c++ "${CXXFLAGS[@]}" "${INCLUDES[@]}" "${SOURCES[@]}" -o "$BINARY"
+
+"$BINARY" "$@"
@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Power-loss test for lib/Serialization/RecordJournal: every append is cut short at each byte offset and the newest
+# complete record must still be the one loaded.
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+BUILD_DIR="$ROOT_DIR/build/record_journal"
+BINARY="$BUILD_DIR/RecordJournalTest"
+
+mkdir -p "$BUILD_DIR/work"
+
+SOURCES=(
+  "$ROOT_DIR/test/record_journal/RecordJournalTest.cpp"
+  "$ROOT_DIR/lib/Serialization/RecordJournal.cpp"
+)
+
+# test/host must come first so its stand-ins shadow the device headers
+INCLUDES=(
+  -I"$ROOT_DIR/test/host"
+  -I"$ROOT_DIR/lib/Serialization"
+)
+
+CXXFLAGS=(
+  -std=c++20
+  -O2
+  -Wall
+  -Wextra
+  -pedantic
+  -include Arduino.h
+)
+
+c++ "${CXXFLAGS[@]}" "${INCLUDES[@]}" "${SOURCES[@]}" -o "$BINARY"
+
+rm -f "$BUILD_DIR"/work/*
+"$BINARY" --work "$BUILD_DIR/work" "$@"
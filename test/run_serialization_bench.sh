@@ -0,0 +1,126 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Counts the FsFile calls and bytes behind indexing test/epubs/*.epub (metadata cache, section files, chapter IR, CSS
+# rules cache) and reading the pages back, once unbuffered (BUFFERED_FILE_BLOCK_SIZE=0, the old field-by-field I/O)
+# and once with the default BufferedFile block. Both runs also check that every page and CSS rule survives the round
+# trip.
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+BUILD_DIR="$ROOT_DIR/build/serialization_bench"
+
+mkdir -p "$BUILD_DIR/obj"
+
+SOURCES=(
+  "$ROOT_DIR/test/serialization_bench/SerializationBench.cpp"
+  "$ROOT_DIR/lib/hal/HalDisplay.cpp"
+  "$ROOT_DIR/lib/AllocTracker/AllocTracker.cpp"
+  "$ROOT_DIR/lib/GfxRenderer/GfxRenderer.cpp"
+  "$ROOT_DIR/lib/GfxRenderer/Bitmap.cpp"
+  "$ROOT_DIR/lib/GfxRenderer/BitmapHelpers.cpp"
+  "$ROOT_DIR/lib/EpdFont/EpdFont.cpp"
+  "$ROOT_DIR/lib/EpdFont/EpdFontFamily.cpp"
+  "$ROOT_DIR/lib/EpdFont/FontDecompressor.cpp"
+  "$ROOT_DIR/lib/Epub/Epub.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/BookCacheKeys.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/BookMetadataCache.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/Page.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/ParsedText.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/Section.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/htmlEntities.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/blocks/ImageBlock.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/blocks/TextBlock.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/converters/ImageDecoderFactory.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/converters/ImageToFramebufferDecoder.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/converters/JpegToFramebufferConverter.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/converters/PngToFramebufferConverter.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/css/CssParser.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/hyphenation/Hyphenator.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/hyphenation/LanguageRegistry.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/hyphenation/LiangHyphenation.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/hyphenation/HyphenationCommon.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/parsers/ChapterHtmlSlimParser.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/parsers/ContainerParser.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/parsers/ContentOpfParser.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/parsers/TocNavParser.cpp"
+  "$ROOT_DIR/lib/Epub/Epub/parsers/TocNcxParser.cpp"
+  "$ROOT_DIR/lib/FsHelpers/FsHelpers.cpp"
+  "$ROOT_DIR/lib/JpegToBmpConverter/JpegToBmpConverter.cpp"
+  "$ROOT_DIR/lib/PngToBmpConverter/PngToBmpConverter.cpp"
+  "$ROOT_DIR/lib/Serialization/BufferedFile.cpp"
+  "$ROOT_DIR/lib/Utf8/Utf8.cpp"
+  "$ROOT_DIR/lib/ZipFile/ZipFile.cpp"
+)
+
+C_SOURCES=(
+  "$ROOT_DIR/lib/expat/xmlparse.c"
+  "$ROOT_DIR/lib/expat/xmlrole.c"
+  "$ROOT_DIR/lib/expat/xmltok.c"
+  "$ROOT_DIR/lib/miniz/miniz.c"
+  "$ROOT_DIR/lib/picojpeg/picojpeg.c"
+  "$ROOT_DIR/lib/uzlib/src/tinflate.c"
+)
+
+# test/host must come first so its stand-ins shadow the device headers
+INCLUDES=(
+  -I"$ROOT_DIR/test/host"
+  -I"$ROOT_DIR"
+  -I"$ROOT_DIR/lib"
+  -I"$ROOT_DIR/lib/hal"
+  -I"$ROOT_DIR/lib/GfxRenderer"
+  -I"$ROOT_DIR/lib/EpdFont"
+  -I"$ROOT_DIR/lib/Epub"
+  -I"$ROOT_DIR/lib/Utf8"
+  -I"$ROOT_DIR/lib/Serialization"
+  -I"$ROOT_DIR/lib/Profiler"
+  -I"$ROOT_DIR/lib/AllocTracker"
+  -I"$ROOT_DIR/lib/FsHelpers"
+  -I"$ROOT_DIR/lib/JpegToBmpConverter"
+  -I"$ROOT_DIR/lib/PngToBmpConverter"
+  -I"$ROOT_DIR/lib/ZipFile"
+  -I"$ROOT_DIR/lib/expat"
+  -I"$ROOT_DIR/lib/miniz"
+  -I"$ROOT_DIR/lib/picojpeg"
+  -I"$ROOT_DIR/lib/uzlib/src"
+)
+
+# The platformio.ini base build_flags these libraries depend on
+DEFINES=(
+  -DMINIZ_NO_ZLIB_COMPATIBLE_NAMES=1
+  -DMINIZ_NO_STDIO=1
+  -DXML_GE=0
+  -DXML_CONTEXT_BYTES=1024
+  -DPNG_MAX_BUFFERED_PIXELS=16416
+  # The profile env's allocation tracker, so the report covers the whole reader pipeline
+  -DENABLE_ALLOC_TRACKER
+)
+
+CXXFLAGS=(
+  -std=c++20
+  -O2
+  -Wall
+  -Wextra
+  -pedantic
+  -Wno-bidi-chars
+  -include Arduino.h
+)
+
+OBJECTS=()
+for source in "${C_SOURCES[@]}"; do
+  object="$BUILD_DIR/obj/$(basename "${source%.*}").o"
+  cc -O2 -w -ffunction-sections "${DEFINES[@]}" "${INCLUDES[@]}" -c "$source" -o "$object"
+  OBJECTS+=("$object")
+done
+
+cd "$ROOT_DIR"
+for variant in unbuffered buffered; do
+  defines=()
+  if [ "$variant" = unbuffered ]; then
+    defines=(-DBUFFERED_FILE_BLOCK_SIZE=0)
+  fi
+  c++ "${CXXFLAGS[@]}" "${DEFINES[@]}" "${defines[@]}" "${INCLUDES[@]}" "${SOURCES[@]}" "${OBJECTS[@]}" \
+    -Wl,--gc-sections -o "$BUILD_DIR/SerializationBench_$variant"
+  echo "== $variant =="
+  mkdir -p "$BUILD_DIR/$variant"
+  "$BUILD_DIR/SerializationBench_$variant" --work "$BUILD_DIR/$variant" "$@" "$ROOT_DIR"/test/epubs/*.epub
+done
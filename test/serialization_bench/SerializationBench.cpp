@@ -0,0 +1,187 @@
+// Cache serialization I/O benchmark. Opens each EPUB through the reader's Epub and Section like the golden-frame test
+// and counts what indexing a book puts on the SD card: the metadata cache (book.bin and the CSS rules cache, built by
+// Epub::load), every chapter's section file and chapter IR (Section::createSectionFile), a re-flow from the IR, and
+// reading every page back (Section::loadPage). Every FsFile call is counted by the host stand-in, so building this once
+// with BUFFERED_FILE_BLOCK_SIZE=0 and once with the default shows what BufferedFile saves. Extracting chapters from
+// the zip is counted in the section write phase, as it is on device. The allocation tracker is compiled in with each
+// phase as an activity, and its report follows the I/O table.
+
+#include <AllocTracker.h>
+#include <Epub/Page.h>
+#include <GfxRenderer.h>
+#include <HalDisplay.h>
+#include <HalStorage.h>
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../golden_frames/BookLayout.h"
+
+namespace {
+
+struct Sample {
+  std::string book;
+  std::string phase;
+  FsFile::Counters io;
+};
+
+void resetCounters() { FsFile::counters() = FsFile::Counters(); }
+
+void addCounters(FsFile::Counters& into, const FsFile::Counters& c) {
+  into.reads += c.reads;
+  into.writes += c.writes;
+  into.seeks += c.seeks;
+  into.bytesRead += c.bytesRead;
+  into.bytesWritten += c.bytesWritten;
+}
+
+// Writes the CSS rules cache again and reads it back; false if a rule is lost on the way
+bool roundTripCss(CssParser& css, Sample& save, Sample& load) {
+  if (!css.loadFromCache()) {
+    return true;  // Book without a stylesheet
+  }
+  const size_t ruleCount = css.ruleCount();
+
+  ALLOC_TRACK_ACTIVITY_ENTER("css save");
+  resetCounters();
+  const bool saved = css.saveToCache();
+  save.io = FsFile::counters();
+  ALLOC_TRACK_ACTIVITY_EXIT("css save");
+
+  css.clear();
+  ALLOC_TRACK_ACTIVITY_ENTER("css load");
+  resetCounters();
+  const bool loaded = css.loadFromCache();
+  load.io = FsFile::counters();
+  ALLOC_TRACK_ACTIVITY_EXIT("css load");
+  const bool sameRules = css.ruleCount() == ruleCount;
+  css.clear();
+
+  if (!saved || !loaded || !sameRules) {
+    std::cerr << "CSS cache round trip failed (" << ruleCount << " rules)\n";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string workDir = "build/serialization_bench/cache";
+  std::vector<std::string> books;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--work" && i + 1 < argc) {
+      workDir = argv[++i];
+    } else {
+      books.push_back(arg);
+    }
+  }
+  if (books.empty()) {
+    std::cerr << "Usage: SerializationBench [--work dir] <book.epub>...\n";
+    return 1;
+  }
+
+  HalDisplay display;
+  display.begin();
+  GfxRenderer renderer(display);
+  renderer.begin();
+  ReaderFonts fonts;
+  fonts.install(renderer);
+  const ReaderViewport viewport = readerViewport(renderer);
+  Storage.removeDir(workDir.c_str());
+  Storage.mkdir(workDir.c_str());
+
+  std::vector<Sample> samples;
+  int failures = 0;
+  for (const auto& bookPath : books) {
+    const size_t nameStart = bookPath.find_last_of('/') + 1;
+    const std::string bookName = bookPath.substr(nameStart, bookPath.find_last_of('.') - nameStart);
+
+    Sample open{bookName, "book load", {}};
+    ALLOC_TRACK_ACTIVITY_ENTER("book load");
+    resetCounters();
+    const auto epub = openBook(bookPath, workDir);
+    open.io = FsFile::counters();
+    ALLOC_TRACK_ACTIVITY_EXIT("book load");
+    if (!epub) {
+      std::cerr << bookName << ": failed to open\n";
+      failures++;
+      continue;
+    }
+
+    Sample write{bookName, "section write", {}};
+    Sample reflow{bookName, "section reflow", {}};
+    Sample read{bookName, "section read", {}};
+    bool ok = true;
+    for (int spine = 0; spine < epub->getSpineItemsCount() && ok; spine++) {
+      ALLOC_TRACK_ACTIVITY_ENTER("section write");
+      resetCounters();
+      auto section = layoutSection(epub, spine, renderer, viewport);
+      addCounters(write.io, FsFile::counters());
+      ALLOC_TRACK_ACTIVITY_EXIT("section write");
+      if (!section) {
+        ok = false;
+        break;
+      }
+      const uint16_t parsedPages = section->pageCount;
+
+      section->clearCache();
+      ALLOC_TRACK_ACTIVITY_ENTER("section reflow");
+      resetCounters();
+      section = layoutSection(epub, spine, renderer, viewport);
+      addCounters(reflow.io, FsFile::counters());
+      ALLOC_TRACK_ACTIVITY_EXIT("section reflow");
+      if (!section || section->pageCount != parsedPages) {
+        std::cerr << bookName << ": spine item " << spine << " re-flowed to a different page count\n";
+        ok = false;
+        break;
+      }
+
+      // Opens the file per page exactly like the reader
+      ALLOC_TRACK_ACTIVITY_ENTER("section read");
+      resetCounters();
+      for (int p = 0; p < section->pageCount; p++) {
+        if (!section->loadPage(p)) {
+          std::cerr << bookName << ": page " << p << " of spine item " << spine << " did not load\n";
+          ok = false;
+          break;
+        }
+      }
+      addCounters(read.io, FsFile::counters());
+      ALLOC_TRACK_ACTIVITY_EXIT("section read");
+    }
+
+    Sample cssSave{bookName, "css save", {}};
+    Sample cssLoad{bookName, "css load", {}};
+    CssParser* css = epub->getCssParser();
+    const bool cssOk = !css || roundTripCss(*css, cssSave, cssLoad);
+
+    if (!ok || !cssOk) {
+      std::cerr << bookName << ": FAILED\n";
+      failures++;
+    }
+    samples.insert(samples.end(), {open, write, reflow, read, cssSave, cssLoad});
+  }
+
+  printf("BufferedFile block size: %zu\n", BufferedFile::BLOCK_SIZE);
+  printf("%-24s %-14s %9s %9s %9s %11s %11s\n", "book", "phase", "reads", "writes", "seeks", "bytes in", "bytes out");
+  FsFile::Counters total;
+  for (const auto& s : samples) {
+    printf("%-24s %-14s %9llu %9llu %9llu %11llu %11llu\n", s.book.c_str(), s.phase.c_str(),
+           static_cast<unsigned long long>(s.io.reads), static_cast<unsigned long long>(s.io.writes),
+           static_cast<unsigned long long>(s.io.seeks), static_cast<unsigned long long>(s.io.bytesRead),
+           static_cast<unsigned long long>(s.io.bytesWritten));
+    addCounters(total, s.io);
+  }
+  printf("%-24s %-14s %9llu %9llu %9llu %11llu %11llu\n", "total", "", static_cast<unsigned long long>(total.reads),
+         static_cast<unsigned long long>(total.writes), static_cast<unsigned long long>(total.seeks),
+         static_cast<unsigned long long>(total.bytesRead), static_cast<unsigned long long>(total.bytesWritten));
+#ifdef ENABLE_ALLOC_TRACKER
+  alloctracker::dump([](const char* line) { puts(line); });
+#endif
+  return failures == 0 ? 0 : 1;
+}